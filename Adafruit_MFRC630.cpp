@@ -27,6 +27,82 @@
 
 #include "Adafruit_MFRC630.h"
 
+/* Performance counter hooks, compiled out unless MFRC630_PERF_COUNTERS */
+#if MFRC630_PERF_COUNTERS
+#define PERF_BEGIN(op) perfBegin(op)
+#define PERF_END() perfEnd()
+#define PERF_BUS(len)                                                          \
+  do {                                                                         \
+    if (_perf.cur) {                                                           \
+      _perf.cur->bus_xfers++;                                                  \
+      _perf.cur->bus_bytes += (len) + 1;                                       \
+    }                                                                          \
+  } while (0)
+#define PERF_POLL()                                                            \
+  do {                                                                         \
+    if (_perf.cur) {                                                           \
+      _perf.cur->wait_polls++;                                                 \
+    }                                                                          \
+  } while (0)
+#else
+#define PERF_BEGIN(op)
+#define PERF_END()
+#define PERF_BUS(len)
+#define PERF_POLL()
+#endif
+
+/* Trace log hook, compiled out unless MFRC630_TRACE_LOG */
+#if MFRC630_TRACE_LOG
+#define TRACE_LOG(event, reg, value, len) traceLog(event, reg, value, len)
+#else
+#define TRACE_LOG(event, reg, value, len)
+#endif
+
+/***************************************************************************
+ REGISTER SCRIPTS
+ ***************************************************************************/
+
+/*
+ * ISO/IEC14443-A 106 antenna configuration (registers 0x28..0x39). This is
+ * antcfg_iso14443a_106 with the driver/transmitter tweaks for the Adafruit
+ * breakout applied, so it compiles down to a single 18 byte burst.
+ */
+MFRC630_REGISTER_SCRIPT(script_iso14443a_106,
+                        mfrc630_reg<MFRC630_REG_DRV_MOD, 0x8E>,
+                        mfrc630_reg<MFRC630_REG_TX_AMP, 0x12>,
+                        mfrc630_reg<MFRC630_REG_DRV_CON, 0x39>,
+                        mfrc630_reg<MFRC630_REG_TXL, 0x06>,
+                        mfrc630_reg<MFRC630_REG_TX_CRC_PRESET, 0x18>,
+                        mfrc630_reg<MFRC630_REG_RX_CRC_CON, 0x18>,
+                        mfrc630_reg<MFRC630_REG_TX_DATA_NUM, 0x0F>,
+                        mfrc630_reg<MFRC630_REG_TX_MOD_WIDTH, 0x21>,
+                        mfrc630_reg<MFRC630_REG_TX_SYM_10_BURST_LEN, 0x00>,
+                        mfrc630_reg<MFRC630_REG_TX_WAIT_CTRL, 0xC0>,
+                        mfrc630_reg<MFRC630_REG_TX_WAIT_LO, 0x12>,
+                        mfrc630_reg<MFRC630_REG_FRAME_CON, 0xCF>,
+                        mfrc630_reg<MFRC630_REG_RX_SOFD, 0x00>,
+                        mfrc630_reg<MFRC630_REG_RX_CTRL, 0x04>,
+                        mfrc630_reg<MFRC630_REG_RX_WAIT, 0x90>,
+                        mfrc630_reg<MFRC630_REG_RX_THRESHOLD, 0x5C>,
+                        mfrc630_reg<MFRC630_REG_RCV, 0x12>,
+                        mfrc630_reg<MFRC630_REG_RX_ANA, 0x0A>);
+
+/*
+ * The board's driver/transmitter settings at 106 kbit/s (0x28..0x2B), the
+ * start of script_iso14443a_106. loadProtocol() reapplies them after
+ * LOADPROTOCOL or a table upload has overwritten them.
+ */
+MFRC630_REGISTER_SCRIPT(script_tx106_driver,
+                        mfrc630_reg<MFRC630_REG_DRV_MOD, 0x8E>,
+                        mfrc630_reg<MFRC630_REG_TX_AMP, 0x12>,
+                        mfrc630_reg<MFRC630_REG_DRV_CON, 0x39>,
+                        mfrc630_reg<MFRC630_REG_TXL, 0x06>);
+
+/* Clears every IRQ0/IRQ1 flag (one burst to 0x06..0x07). */
+MFRC630_REGISTER_SCRIPT(script_clear_irqs,
+                        mfrc630_reg<MFRC630_REG_IRQ0, 0b01111111>,
+                        mfrc630_reg<MFRC630_REG_IRQ1, 0b00111111>);
+
 /***************************************************************************
  PRIVATE FUNCTIONS
  ***************************************************************************/
@@ -43,631 +119,2627 @@ uint8_t reverse8(uint8_t n) {
   return (rev8_lookup[n & 0b1111] << 4) | rev8_lookup[n >> 4];
 }
 
+/*!
+ * @brief Register accessed by byte 'i' of a burst starting at 'reg'. The
+ *        address auto-increments up to MFRC630_REG_FIFO_DATA and stays
+ *        there, so a burst can read the FIFO length and then the FIFO.
+ */
+static inline byte burstReg(byte reg, uint16_t i) {
+  return ((reg > MFRC630_REG_FIFO_DATA) || (reg + i < MFRC630_REG_FIFO_DATA))
+             ? (byte)(reg + i)
+             : (byte)MFRC630_REG_FIFO_DATA;
+}
+
+/*
+ * Register shadow cache maps, one bit per register 0x00..0x47.
+ *
+ * 'readable' registers only change when written by the host, so a cached
+ * value can stand in for a bus read. 'writable' additionally includes
+ * registers with read-only status bits (RX_BIT_CTRL), where a repeated
+ * write can be skipped but a read must still hit the bus. FIFO_CONTROL is
+ * handled separately, as only its FIFOSize and WaterLevelExtBit bits are
+ * configuration.
+ */
+static const uint8_t regcache_readable[] PROGMEM = {
+    0x08, 0x83, 0x73, 0xCE, 0x31, 0xFF, 0xFF, 0xEB, 0xB3};
+static const uint8_t regcache_writable[] PROGMEM = {
+    0x08, 0x93, 0x73, 0xCE, 0x31, 0xFF, 0xFF, 0xEB, 0xB3};
+
+/*!
+ * @brief Configuration bits of FIFO_CONTROL (FIFOSize, WaterLevelExtBit)
+ */
+#define MFRC630_FIFO_CONTROL_CFG_MASK (0x84)
+
+/*!
+ * @brief Converts microseconds to Timer0 ticks (211.875kHz, 4.72us)
+ */
+#define MFRC630_US_TO_TICKS(us) ((uint32_t)(us) * 339 / 1600)
+
+/*!
+ * @brief Converts Timer0 ticks to microseconds
+ */
+#define MFRC630_TICKS_TO_US(ticks) ((uint32_t)(ticks) * 1600 / 339)
+
+/*
+ * Default frame wait timeouts in Timer0 ticks, one per mfrc630_timeout_class.
+ */
+static const uint16_t timeout_default[] PROGMEM = {
+    0, MFRC630_US_TO_TICKS(MFRC630_TIMEOUT_ACTIVATION_US),
+    MFRC630_US_TO_TICKS(MFRC630_TIMEOUT_AUTH_US),
+    MFRC630_US_TO_TICKS(MFRC630_TIMEOUT_READ_US),
+    MFRC630_US_TO_TICKS(MFRC630_TIMEOUT_WRITE_US)};
+
+/*
+ * Steps of the non-blocking operations (see poll). START runs when the
+ * operation is started, the others once the frame they wait for is done.
+ */
+enum {
+  MFRC630_STATE_START = 0, /* Nothing sent yet */
+  MFRC630_STATE_ANTICOLL,  /* Select: waiting for the UID bits */
+  MFRC630_STATE_SELECT,    /* Select: waiting for the SAK */
+  MFRC630_STATE_AUTH,      /* Waiting for MFAUTHENT to finish */
+  MFRC630_STATE_READ,      /* Waiting for the block data */
+  MFRC630_STATE_WRITE_CMD, /* Waiting for the ACK to WRITE */
+  MFRC630_STATE_WRITE_DATA /* Waiting for the ACK to the data */
+};
+
+/* SEL codes for cascade levels 1..3 */
+static const uint8_t cascade_sel[3] = {
+    ISO14443_CAS_LEVEL_1, ISO14443_CAS_LEVEL_2, ISO14443_CAS_LEVEL_3};
+
 /**************************************************************************/
 /*!
-    @brief  Write a byte to the specified register
+    @brief  Looks up a register in the shadow cache
+
+    @returns True if the cache is enabled and holds a known value for 'reg'
+             in the specified map. A register in the map with no known
+             value counts as a miss.
 */
 /**************************************************************************/
-void Adafruit_MFRC630::write8(byte reg, byte value) {
-  TRACE_TIMESTAMP();
-  TRACE_PRINT(F("Writing 0x"));
-  TRACE_PRINT(value, HEX);
-  TRACE_PRINT(F(" to 0x"));
-  TRACE_PRINTLN(reg, HEX);
+bool Adafruit_MFRC630::regCacheLookup(byte reg, const uint8_t *map,
+                                      uint8_t *value) {
+  if (!_regcache_enabled || (reg >= MFRC630_REGCACHE_LEN) ||
+      !(pgm_read_byte(&map[reg >> 3]) & (1 << (reg & 7)))) {
+    return false;
+  }
+  if (!(_regcache_valid[reg >> 3] & (1 << (reg & 7)))) {
+    _regcache_misses++;
+    return false;
+  }
+  *value = _regcache[reg];
+  return true;
+}
 
-  switch (_transport) {
-  case MFRC630_TRANSPORT_I2C:
-    /* I2C */
-    _wire->beginTransmission(_i2c_addr);
-    _wire->write(reg);
-    _wire->write(value);
-    _wire->endTransmission();
-    break;
-  case MFRC630_TRANSPORT_SPI:
-    /* SPI */
-    digitalWrite(_cs, LOW);
-    SPI.transfer((reg << 1) | 0x00);
-    SPI.transfer(value);
-    digitalWrite(_cs, HIGH);
-    break;
-  case MFRC630_TRANSPORT_SERIAL:
-    /* TODO: Adjust for 10-bit protocol! */
-    _serial->write((reg << 1) | 0x00);
-    _serial->write(value);
-    break;
+/**************************************************************************/
+/*!
+    @brief  Records a value that just went over the bus in the shadow cache
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::regCacheStore(byte reg, uint8_t value,
+                                     const uint8_t *map) {
+  if (!_regcache_enabled || (reg >= MFRC630_REGCACHE_LEN)) {
+    return;
   }
+  if (reg == MFRC630_REG_FIFO_CONTROL) {
+    value &= MFRC630_FIFO_CONTROL_CFG_MASK;
+  } else if (!(pgm_read_byte(&map[reg >> 3]) & (1 << (reg & 7)))) {
+    return;
+  }
+  _regcache[reg] = value;
+  _regcache_valid[reg >> 3] |= (1 << (reg & 7));
 }
 
+/***************************************************************************
+ TRANSPORTS
+ ***************************************************************************/
+
+/*
+ * Bus access for each transport. The constructors bind one of these
+ * tables, so the common register access code above doesn't need to know
+ * which transport is in use. Calls go through a pointer to member, so they
+ * cost an indirect call and are never inlined.
+ */
+const struct Adafruit_MFRC630::bus_ops Adafruit_MFRC630::i2c_bus = {
+    &Adafruit_MFRC630::i2cBegin, &Adafruit_MFRC630::i2cWrite,
+    &Adafruit_MFRC630::i2cRead};
+const struct Adafruit_MFRC630::bus_ops Adafruit_MFRC630::spi_bus = {
+    &Adafruit_MFRC630::spiBegin, &Adafruit_MFRC630::spiWrite,
+    &Adafruit_MFRC630::spiRead};
+const struct Adafruit_MFRC630::bus_ops Adafruit_MFRC630::serial_bus = {
+    &Adafruit_MFRC630::serialBegin, &Adafruit_MFRC630::serialWrite,
+    &Adafruit_MFRC630::serialRead};
+const struct Adafruit_MFRC630::bus_ops Adafruit_MFRC630::custom_bus = {
+    &Adafruit_MFRC630::customBegin, &Adafruit_MFRC630::customWrite,
+    &Adafruit_MFRC630::customRead};
+
 /**************************************************************************/
 /*!
-    @brief  Write a buffer to the specified register
+    @brief  Starts the I2C bus
 */
 /**************************************************************************/
-void Adafruit_MFRC630::writeBuffer(byte reg, uint16_t len, uint8_t *buffer) {
-  TRACE_TIMESTAMP();
-  TRACE_PRINT(F("Writing "));
-  TRACE_PRINT(len);
-  TRACE_PRINT(F(" byte(s) to 0x"));
-  TRACE_PRINTLN(reg, HEX);
+void Adafruit_MFRC630::i2cBegin(void) {
+  DEBUG_PRINTLN(F("Initialising I2C"));
+  _wire->begin();
+}
 
-  TRACE_TIMESTAMP();
-  switch (_transport) {
-  case MFRC630_TRANSPORT_I2C:
-    /* I2C */
-    _wire->beginTransmission(_i2c_addr);
-    _wire->write(reg);
-    for (uint16_t i = 0; i < len; i++) {
-      _wire->write(buffer[i]);
-      TRACE_PRINT(F("0x"));
-      TRACE_PRINT(buffer[i], HEX);
-      TRACE_PRINT(F(" "));
+/**************************************************************************/
+/*!
+    @brief  Writes 'len' bytes starting at 'reg' over I2C, split into chunks
+            that fit in the Wire buffer (incl. the register byte)
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::i2cWrite(byte reg, uint16_t len, uint8_t *buffer) {
+  for (uint16_t pos = 0; pos < len;) {
+    uint16_t chunk = len - pos;
+    if (chunk > MFRC630_I2C_CHUNK_LEN - 1) {
+      chunk = MFRC630_I2C_CHUNK_LEN - 1;
     }
+    _wire->beginTransmission(_i2c_addr);
+    _wire->write(burstReg(reg, pos));
+    _wire->write(buffer + pos, chunk);
     _wire->endTransmission();
-    break;
-  case MFRC630_TRANSPORT_SPI:
-    /* SPI */
-    digitalWrite(_cs, LOW);
-    SPI.transfer((reg << 1) | 0x00);
-    for (uint8_t i = 0; i < len; i++) {
-      SPI.transfer(buffer[i]);
-      TRACE_PRINT(F("0x"));
-      TRACE_PRINT(buffer[i], HEX);
-      TRACE_PRINT(F(" "));
-    }
-    digitalWrite(_cs, HIGH);
-    break;
-  case MFRC630_TRANSPORT_SERIAL:
-    _serial->write((reg << 1) | 0x00);
-    for (uint16_t i = 0; i < len; i++) {
-      _serial->write(buffer[i]);
-      TRACE_PRINT(F("0x"));
-      TRACE_PRINT(buffer[i], HEX);
-      TRACE_PRINT(F(" "));
-    }
-    break;
+    pos += chunk;
   }
-  TRACE_PRINTLN("");
 }
 
 /**************************************************************************/
 /*!
-    @brief  Read a byte from the specified register
+    @brief  Reads 'len' bytes starting at 'reg' over I2C, split into chunks
+            that fit in the Wire buffer
+
+    @returns The number of bytes actually read.
 */
 /**************************************************************************/
-byte Adafruit_MFRC630::read8(byte reg) {
-  uint8_t resp = 0;
-  uint8_t tx[2] = {0};
-  uint8_t rx[2] = {0};
-  uint8_t timeout = 0xFF;
-
-  TRACE_TIMESTAMP();
-  TRACE_PRINT(F("Requesting 1 byte from 0x"));
-  TRACE_PRINTLN(reg, HEX);
-
-  switch (_transport) {
-  case MFRC630_TRANSPORT_I2C:
-/* I2C */
+uint16_t Adafruit_MFRC630::i2cRead(byte reg, uint16_t len, uint8_t *buffer) {
+  uint16_t counter = 0;
+
+  while (counter < len) {
+    byte chunkreg = burstReg(reg, counter);
+    uint8_t chunk = (len - counter) > MFRC630_I2C_CHUNK_LEN
+                        ? MFRC630_I2C_CHUNK_LEN
+                        : (uint8_t)(len - counter);
 #ifdef __SAM3X8E__
     /* http://forum.arduino.cc/index.php?topic=385377.msg2947227#msg2947227 */
-    _wire->requestFrom(_i2c_addr, 1, reg, 1, true);
+    _wire->requestFrom(_i2c_addr, chunk, chunkreg, 1, true);
 #else
     _wire->beginTransmission(_i2c_addr);
-    _wire->write(reg);
+    _wire->write(chunkreg);
     _wire->endTransmission();
-    _wire->requestFrom((uint8_t)_i2c_addr, (uint8_t)1);
+    _wire->requestFrom((uint8_t)_i2c_addr, chunk);
 #endif
-    /* Dump the response into the supplied buffer */
-    resp = _wire->read();
-    break;
-  case MFRC630_TRANSPORT_SPI:
-    /* SPI */
-    digitalWrite(_cs, LOW);
-    tx[0] = (reg << 1) | 0x01;
-    tx[1] = 0;
-    rx[0] = SPI.transfer(tx[0]);
-    rx[1] = SPI.transfer(tx[1]);
-    digitalWrite(_cs, HIGH);
-    resp = rx[1];
-    break;
-  case MFRC630_TRANSPORT_SERIAL:
-    tx[0] = (reg << 1) | 0x01;
-    _serial->write(tx[0]);
-    while (!_serial->available()) {
-      delay(1);
-      timeout--;
-      if (timeout == 0) {
-        return 0;
-      }
-    }
-    resp = _serial->read();
-    delay(1);
-    /* Check for stray byte(s) */
-    while (_serial->available()) {
-      _serial->read();
-      delay(1);
+    for (uint8_t i = 0; i < chunk; i++) {
+      buffer[counter++] = _wire->read();
     }
-    break;
-  }
-
-  TRACE_TIMESTAMP();
-  TRACE_PRINT(F("Response = "));
-  TRACE_PRINT(F(" 0x"));
-  if (resp <= 0xF) {
-    TRACE_PRINT(F("0"));
   }
-  TRACE_PRINT(resp, HEX);
-  TRACE_PRINTLN(F(""));
 
-  return resp;
+  return counter;
 }
 
-/***************************************************************************
- CONSTRUCTOR
- ***************************************************************************/
+/**************************************************************************/
+/*!
+    @brief  Starts the HW SPI bus
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::spiBegin(void) {
+  DEBUG_PRINTLN(F("Initialising SPI (Mode 0, MSB, DIV16)"));
+  SPI.begin();
+  SPI.setDataMode(SPI_MODE0);
+  SPI.setBitOrder(MSBFIRST);
+#ifdef SPI_CLOCK_DIV16
+  SPI.setClockDivider(SPI_CLOCK_DIV16);
+#endif
+}
 
 /**************************************************************************/
 /*!
-    @brief  Instantiates a new instance of the Adafruit_MFRC630 class
-            using the default I2C bus.
+    @brief  Writes 'len' bytes starting at 'reg' in one SPI frame
 */
 /**************************************************************************/
-Adafruit_MFRC630::Adafruit_MFRC630(uint8_t i2c_addr, int8_t pdown_pin) {
-  /* Set the transport */
-  _transport = MFRC630_TRANSPORT_I2C;
+void Adafruit_MFRC630::spiWrite(byte reg, uint16_t len, uint8_t *buffer) {
+  digitalWrite(_cs, LOW);
+  SPI.transfer((reg << 1) | 0x00);
+  for (uint16_t i = 0; i < len; i++) {
+    SPI.transfer(buffer[i]);
+  }
+  digitalWrite(_cs, HIGH);
+}
 
-  /* Set the PDOWN pin */
-  _pdown = pdown_pin;
+/**************************************************************************/
+/*!
+    @brief  Reads 'len' bytes starting at 'reg' in one SPI frame, where
+            each address byte clocks out the data for the previous one
 
-  /* Set the I2C address */
-  _i2c_addr = i2c_addr;
+    @returns The number of bytes actually read.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::spiRead(byte reg, uint16_t len, uint8_t *buffer) {
+  uint16_t counter;
 
-  /* Set the I2C bus instance */
-  _wire = &Wire;
+  if (!len) {
+    return 0;
+  }
 
-  /* Disable SPI access. */
-  _cs = -1;
+  digitalWrite(_cs, LOW);
+  SPI.transfer((reg << 1) | 0x01);
+  for (counter = 0; counter < len - 1; counter++) {
+    byte next = burstReg(reg, counter + 1);
+    buffer[counter] = SPI.transfer((next << 1) | 0x01);
+  }
+  buffer[counter++] = SPI.transfer(0x00);
+  digitalWrite(_cs, HIGH);
 
-  /* Disable SW serial access */
-  _serial = NULL;
+  return counter;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Instantiates a new instance of the Adafruit_MFRC630 class
-            using the specified I2C bus.
+    @brief  Nothing to do, 'Serial' has to be initialised in the calling
+            sketch!
 */
 /**************************************************************************/
-Adafruit_MFRC630::Adafruit_MFRC630(TwoWire *wireBus, uint8_t i2c_addr,
-                                   int8_t pdown_pin) {
-  /* Set the transport */
-  _transport = MFRC630_TRANSPORT_I2C;
+void Adafruit_MFRC630::serialBegin(void) {}
 
-  /* Set the PDOWN pin */
-  _pdown = pdown_pin;
+/**************************************************************************/
+/*!
+    @brief  Writes 'len' bytes starting at 'reg' over the serial link, as
+            one address/data pair per byte (the UART has no bursts)
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::serialWrite(byte reg, uint16_t len, uint8_t *buffer) {
+  for (uint16_t i = 0; i < len; i++) {
+    byte next = burstReg(reg, i);
+    _serial->write((next << 1) | 0x00);
+    _serial->write(buffer[i]);
+  }
+}
 
-  /* Set the I2C address */
-  _i2c_addr = i2c_addr;
+/**************************************************************************/
+/*!
+    @brief  Reads 'len' bytes starting at 'reg' over the serial link, with
+            up to MFRC630_SERIAL_WINDOW address bytes queued ahead of the
+            answers
 
-  /* Set the I2C bus instance */
-  _wire = wireBus;
+    @returns The number of bytes actually read.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::serialRead(byte reg, uint16_t len,
+                                      uint8_t *buffer) {
+  uint16_t counter = 0;
+  uint16_t sent = 0;
+
+  /* Drop stray bytes, so every answer lines up with its request */
+  while (_serial->available()) {
+    _serial->read();
+  }
 
-  /* Disable SPI access. */
-  _cs = -1;
+  while (counter < len) {
+    /* Top up the requests in flight, then collect the next answer */
+    while (sent < len && sent - counter < MFRC630_SERIAL_WINDOW) {
+      byte next = burstReg(reg, sent);
+      _serial->write((next << 1) | 0x01);
+      sent++;
+    }
+    uint32_t start = millis();
+    while (!_serial->available()) {
+      if ((millis() - start) > MFRC630_SERIAL_TIMEOUT_MS) {
+        return counter;
+      }
+      yield();
+    }
+    buffer[counter++] = _serial->read();
+  }
 
-  /* Disable SW serial access */
-  _serial = NULL;
+  return counter;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Instantiates a new instance of the Adafruit_MFRC630 class
-            using the HW SPI bus.
+    @brief  Starts the user supplied bus
 */
 /**************************************************************************/
-Adafruit_MFRC630::Adafruit_MFRC630(enum mfrc630_transport transport, int8_t cs,
-                                   int8_t pdown_pin) {
-  /* Set the transport */
-  _transport = transport;
-
-  /* Set the PDOWN pin */
-  _pdown = pdown_pin;
-
-  /* Set the CS/SSEL pin */
-  _cs = cs;
-  pinMode(_cs, OUTPUT);
-
-  /* Disable I2C access */
-  _wire = NULL;
-  _i2c_addr = 0;
-
-  /* Disable SW serial access */
-  _serial = NULL;
+void Adafruit_MFRC630::customBegin(void) {
+  DEBUG_PRINTLN(F("Initialising custom bus"));
+  _custom->begin();
 }
 
 /**************************************************************************/
 /*!
-    @brief  Instantiates a new instance of the Adafruit_MFRC630 class
-            using the specified Serial block.
+    @brief  Writes 'len' bytes starting at 'reg' over the user supplied bus
 */
 /**************************************************************************/
-Adafruit_MFRC630::Adafruit_MFRC630(Stream *serial, int8_t pdown_pin) {
-  /* Set the transport */
-  _transport = MFRC630_TRANSPORT_SERIAL;
-
-  /* Set the PDOWN pin */
-  _pdown = pdown_pin;
-
-  /* Set the Serial instance */
-  _serial = serial;
+void Adafruit_MFRC630::customWrite(byte reg, uint16_t len, uint8_t *buffer) {
+  _custom->write(reg, len, buffer);
+}
 
-  /* Disable I2C access */
-  _wire = NULL;
-  _i2c_addr = 0;
+/**************************************************************************/
+/*!
+    @brief  Reads 'len' bytes starting at 'reg' over the user supplied bus
 
-  /* Disable SPI access. */
-  _cs = -1;
+    @returns The number of bytes actually read.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::customRead(byte reg, uint16_t len,
+                                      uint8_t *buffer) {
+  return _custom->read(reg, len, buffer);
 }
 
 /***************************************************************************
- PUBLIC FUNCTIONS
+ REGISTER ACCESS
  ***************************************************************************/
 
 /**************************************************************************/
 /*!
-    @brief  Sets up the HW
+    @brief  Write a byte to the specified register
 */
 /**************************************************************************/
-bool Adafruit_MFRC630::begin() {
-  /* Display alert for DEBUG and TRACE output. */
-  DEBUG_PRINTLN(F("\tDebug output enabled: D [+ms] Message"));
-  TRACE_PRINTLN(F("\tTrace output enabled: . [+ms] Message"));
-  DEBUG_PRINTLN(F(""));
-
-  /* Enable I2C, SPI or SW serial */
-  DEBUG_TIMESTAMP();
-  switch (_transport) {
-  case MFRC630_TRANSPORT_I2C:
-    DEBUG_PRINTLN(F("Initialising I2C"));
-    _wire->begin();
-    break;
-  case MFRC630_TRANSPORT_SPI:
-    DEBUG_PRINTLN(F("Initialising SPI (Mode 0, MSB, DIV16)"));
-    SPI.begin();
-    SPI.setDataMode(SPI_MODE0);
-    SPI.setBitOrder(MSBFIRST);
-#ifdef SPI_CLOCK_DIV16
-    SPI.setClockDivider(SPI_CLOCK_DIV16);
-#endif
-    break;
-  case MFRC630_TRANSPORT_SERIAL:
-    /* NOTE: 'Serial' has to be initialised in the calling sketch! */
-    break;
-  }
-
-  /* Reset the MFRC630 if possible */
-  if (_pdown != -1) {
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("Resetting MFRC630"));
-    pinMode(_pdown, OUTPUT);
-    digitalWrite(_pdown, HIGH);
-    digitalWrite(_pdown, LOW);
-    digitalWrite(_pdown, HIGH);
-    digitalWrite(_pdown, LOW);
-    /* Typical 2.5ms startup delay */
-    delay(5);
+void Adafruit_MFRC630::write8(byte reg, byte value) {
+  /* Skip the bus entirely if the register already holds this value */
+  uint8_t cached;
+  if (regCacheLookup(reg, regcache_writable, &cached) && (cached == value)) {
+    _regcache_hits++;
+    return;
   }
 
-  /* Check device ID for bus response */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("Checking transport layer"));
+  TRACE_TIMESTAMP();
+  TRACE_PRINT(F("Writing 0x"));
+  TRACE_PRINT(value, HEX);
+  TRACE_PRINT(F(" to 0x"));
+  TRACE_PRINTLN(reg, HEX);
 
-  /* Read the VERSION register */
-  byte ver = read8(MFRC630_REG_VERSION);
+  PERF_BUS(1);
+  TRACE_LOG(MFRC630_TRACE_WRITE, reg, value, 1);
+  (this->*(_bus->write))(reg, 1, &value);
 
-  /* If ver == 0xFF or 0x0 likely a bus failure */
-  if ((ver == 0xFF) || (ver == 0)) {
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("Transport failure!"));
-    return false;
+  regCacheStore(reg, value, regcache_writable);
+  if (reg == MFRC630_REG_COMMAND) {
+    _cmd_idle = (value == MFRC630_CMD_IDLE);
   }
+}
 
-  /* If !1.8, there was a problem */
-  if (ver != 0x18) {
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("FAILED!"));
-    return false;
+/**************************************************************************/
+/*!
+    @brief  Write a buffer to the specified register
+
+    @note   The IC auto-increments the register address after each byte,
+            up to MFRC630_REG_FIFO_DATA where it stays, so a single call can
+            either fill a contiguous register block or stream data into the
+            FIFO.
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::writeBuffer(byte reg, uint16_t len, uint8_t *buffer) {
+  /* Trim leading/trailing bytes that the registers already hold */
+  if (len && (burstReg(reg, len - 1) != MFRC630_REG_FIFO_DATA)) {
+    uint8_t cached;
+    while (len && regCacheLookup(reg, regcache_writable, &cached) &&
+           (cached == buffer[0])) {
+      _regcache_hits++;
+      reg++;
+      buffer++;
+      len--;
+    }
+    while (len &&
+           regCacheLookup(reg + len - 1, regcache_writable, &cached) &&
+           (cached == buffer[len - 1])) {
+      _regcache_hits++;
+      len--;
+    }
+    if (!len) {
+      return;
+    }
   }
 
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINT(F("IC Version = "));
-  DEBUG_PRINT((ver & 0xF0) >> 4, HEX);
-  DEBUG_PRINT(F("."));
-  DEBUG_PRINTLN(ver & 0x0F, HEX);
+  TRACE_TIMESTAMP();
+  TRACE_PRINT(F("Writing "));
+  TRACE_PRINT(len);
+  TRACE_PRINT(F(" byte(s) to 0x"));
+  TRACE_PRINTLN(reg, HEX);
 
-  return true;
+  TRACE_TIMESTAMP();
+  for (uint16_t i = 0; i < len; i++) {
+    TRACE_PRINT(F("0x"));
+    TRACE_PRINT(buffer[i], HEX);
+    TRACE_PRINT(F(" "));
+  }
+  TRACE_PRINTLN("");
+
+  PERF_BUS(len);
+  TRACE_LOG(MFRC630_TRACE_WRITE, reg, buffer[0], len);
+  (this->*(_bus->write))(reg, len, buffer);
+
+  for (uint16_t i = 0;
+       (i < len) && (burstReg(reg, i) != MFRC630_REG_FIFO_DATA); i++) {
+    regCacheStore(reg + i, buffer[i], regcache_writable);
+  }
+  if (reg == MFRC630_REG_COMMAND) {
+    _cmd_idle = (buffer[0] == MFRC630_CMD_IDLE);
+  }
 }
 
 /**************************************************************************/
 /*!
-    @brief  Determines the number of bytes in the HW FIFO buffer (max 512)
+    @brief  Read a buffer from the specified register
 
-    @returns The number of bytes available in the HW FIFO buffer
+    @note   Follows the same addressing rules as writeBuffer: the register
+            address auto-increments up to MFRC630_REG_FIFO_DATA, which is
+            then read repeatedly within the same bus frame.
+
+    @returns The number of bytes actually read.
 */
 /**************************************************************************/
-int16_t Adafruit_MFRC630::readFIFOLen(void) {
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("Checking FIFO length"));
-
-  /* Give FIFO a chance to fill up. */
-  /* TODO: Why do we need a delay between reads?!? */
-  delay(10);
+uint16_t Adafruit_MFRC630::readBuffer(byte reg, uint16_t len,
+                                      uint8_t *buffer) {
+  TRACE_TIMESTAMP();
+  TRACE_PRINT(F("Requesting "));
+  TRACE_PRINT(len);
+  TRACE_PRINT(F(" byte(s) from 0x"));
+  TRACE_PRINTLN(reg, HEX);
 
-  /* Read the MFRC630_REG_FIFO_LENGTH register */
-  /* In 512 byte mode, the upper two bits are stored in FIFO_CONTROL */
-  byte hi = read8(MFRC630_REG_FIFO_CONTROL);
-  byte lo = read8(MFRC630_REG_FIFO_LENGTH);
+  PERF_BUS(len);
+  uint16_t counter = (this->*(_bus->read))(reg, len, buffer);
+  TRACE_LOG(MFRC630_TRACE_READ, reg, counter ? buffer[0] : 0, counter);
 
-  /* Determine len based on FIFO size (255 byte or 512 byte mode) */
-  int16_t l = (hi & 0x80) ? lo : (((hi & 0x3) << 8) | lo);
+  TRACE_TIMESTAMP();
+  TRACE_PRINT(F("Response = "));
+  for (uint16_t i = 0; i < counter; i++) {
+    TRACE_PRINT(F(" 0x"));
+    if (buffer[i] <= 0xF) {
+      TRACE_PRINT(F("0"));
+    }
+    TRACE_PRINT(buffer[i], HEX);
+  }
+  TRACE_PRINTLN(F(""));
 
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINT(F("FIFO contains "));
-  DEBUG_PRINT(l);
-  DEBUG_PRINTLN(F(" byte(s)"));
+  for (uint16_t i = 0;
+       (i < counter) && (burstReg(reg, i) != MFRC630_REG_FIFO_DATA); i++) {
+    regCacheStore(reg + i, buffer[i], regcache_readable);
+  }
 
-  return l;
+  return counter;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Read 'len' bytes from the HW FIFO buffer (max 512 bytes)
-
-    @returns The number of bytes read from the FIFO, or -1 if an error occured.
+    @brief  Read a byte from the specified register
 */
 /**************************************************************************/
-int16_t Adafruit_MFRC630::readFIFO(uint16_t len, uint8_t *buffer) {
-  int16_t counter = 0;
+byte Adafruit_MFRC630::read8(byte reg) {
+  uint8_t resp = 0;
 
-  /* Check for 512 byte overflow */
-  if (len > 512) {
-    return -1;
+  /* Serve configuration registers from the shadow cache if possible */
+  if (regCacheLookup(reg, regcache_readable, &resp)) {
+    _regcache_hits++;
+    return resp;
   }
 
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINT(F("Reading "));
-  DEBUG_PRINT(len);
-  DEBUG_PRINTLN(F(" byte(s) from FIFO"));
+  TRACE_TIMESTAMP();
+  TRACE_PRINT(F("Requesting 1 byte from 0x"));
+  TRACE_PRINTLN(reg, HEX);
 
-  /* Read len bytes from the FIFO */
-  for (uint16_t i = 0; i < len; i++) {
-    buffer[i] = read8(MFRC630_REG_FIFO_DATA);
-    counter++;
+  PERF_BUS(1);
+  if (!(this->*(_bus->read))(reg, 1, &resp)) {
+    return 0;
   }
+  TRACE_LOG(MFRC630_TRACE_READ, reg, resp, 1);
 
-  return counter;
+  TRACE_TIMESTAMP();
+  TRACE_PRINT(F("Response = "));
+  TRACE_PRINT(F(" 0x"));
+  if (resp <= 0xF) {
+    TRACE_PRINT(F("0"));
+  }
+  TRACE_PRINT(resp, HEX);
+  TRACE_PRINTLN(F(""));
+
+  regCacheStore(reg, resp, regcache_readable);
+
+  return resp;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Writes the specified number of bytes to the HW FIFO
-
-    @returns The number of bytes written to the FIFO, -1 if an error occured.
+    @brief  Checks once, without blocking, if the frame started by
+            frameStart() is done: GlobalIRQ was raised (RX, IDLE or error,
+            depending on IRQ0EN) or Timer0 expired. Frames larger than the
+            FIFO get the rest of their TX data at LoAlert and have their RX
+            data drained at HiAlert, so they never stall or overflow.
+            Frames with 'drain' set have their response read while it
+            arrives. When polling the IRQs, a frame still running
+            MFRC630_FRAME_MARGIN_MS past its Timer0 timeout is given up on,
+            as if Timer0 had expired.
+
+    @returns True once the frame is done, and frameFinish() can be called.
 */
 /**************************************************************************/
-int16_t Adafruit_MFRC630::writeFIFO(uint16_t len, uint8_t *buffer) {
-  int counter = 0;
+bool Adafruit_MFRC630::frameDone(void) {
+  struct mfrc630_frame *frame = _xfer.frame;
 
-  /* Check for 512 byte overflow */
-  if (len > 512) {
-    return -1;
+  if (!_xfer.active) {
+    return true;
   }
 
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINT(F("Writing "));
-  DEBUG_PRINT(len);
-  DEBUG_PRINTLN(F(" byte(s) to FIFO"));
+  PERF_POLL();
 
-  /* Write len bytes to the FIFO */
-  for (uint16_t i = 0; i < len; i++) {
-    write8(MFRC630_REG_FIFO_DATA, buffer[i]);
-    counter++;
+  if (!_xfer.stream) {
+    /* With the IRQ pin wired up, stay off the bus until GlobalIRQ asserts. */
+    if ((_irq != -1) && (digitalRead(_irq) == LOW)) {
+      /* Safety net in case the pin isn't actually connected. */
+      if ((millis() - _xfer.start) <= MFRC630_IRQ_PIN_TIMEOUT_MS) {
+        return false;
+      }
+      DEBUG_TIMESTAMP();
+      DEBUG_PRINTLN(F("Timed out waiting for the IRQ pin"));
+      _xfer.irq1 = read8(MFRC630_REG_IRQ1);
+      _xfer.timedout =
+          !(_xfer.irq1 & (MFRC630IRQ1_GLOBALIRQ | MFRC630IRQ1_TIMER0IRQ));
+      return true;
+    }
+
+    /*
+     * Drained frames pop the response while it arrives, so that it is
+     * all read by the time the CRC is. That starts once TX is over and the
+     * FIFO only holds the response. Bytes keep coming while it is received,
+     * so the IRQs only get polled when they pause.
+     */
+    if (_xfer.drain && (_xfer.irq0 & MFRC630IRQ0_TXIRQ) &&
+        (_xfer.received < frame->rxlen)) {
+      if (frameDrain() || _xfer.pending) {
+        return false;
+      }
+    }
+
+    /*
+     * Otherwise poll IRQ0 and IRQ1 in one burst (GlobalIRQ can only be ERR
+     * or RX), IRQ0 tells frameFinish() whether the command already ended.
+     * Timer0 stops once a response comes in, so from then on a drained
+     * frame only needs IRQ0.
+     */
+    uint8_t irq[2] = {0, _xfer.irq1};
+    bool rx = _xfer.drain && (_xfer.received || _xfer.pending);
+    readBuffer(MFRC630_REG_IRQ0, rx ? 1 : 2, irq);
+    _xfer.irq0 = irq[0];
+    _xfer.irq1 = irq[1];
+    if ((_xfer.irq1 & (MFRC630IRQ1_GLOBALIRQ | MFRC630IRQ1_TIMER0IRQ)) ||
+        (rx && (irq[0] & (frame->irq0en | MFRC630IRQ0_ERRIRQ)))) {
+      return true;
+    }
+
+    /* Safety net in case the Timer0 IRQ never comes. */
+    if ((millis() - _xfer.start) > _xfer.deadline) {
+      DEBUG_TIMESTAMP();
+      DEBUG_PRINTLN(F("Timed out polling the IRQs"));
+      _xfer.timedout = true;
+      return true;
+    }
+    return false;
   }
 
-  return counter;
+  /* IRQ0 and IRQ1 in one burst */
+  uint8_t irq[2];
+  readBuffer(MFRC630_REG_IRQ0, sizeof(irq), irq);
+  _xfer.irq0 = irq[0];
+  _xfer.irq1 = irq[1];
+  if (irq[1] & (MFRC630IRQ1_GLOBALIRQ | MFRC630IRQ1_TIMER0IRQ)) {
+    return true;
+  }
+
+  /* FIFO at or below the water level: top it up with the next chunk */
+  if ((_xfer.sent < frame->txlen) && (irq[0] & MFRC630IRQ0_LOALERTIRQ)) {
+    uint16_t len = frame->txlen - _xfer.sent;
+    if (len > _fifosize - MFRC630_FIFO_WATER_LEVEL) {
+      len = _fifosize - MFRC630_FIFO_WATER_LEVEL;
+    }
+    write8(MFRC630_REG_IRQ0, MFRC630IRQ0_LOALERTIRQ);
+    writeFIFO(len, frame->tx + _xfer.sent);
+    _xfer.sent += len;
+  }
+
+  /* FIFO close to full: pull out what has arrived so far */
+  if (frame->rx && (irq[0] & MFRC630IRQ0_HIALERTIRQ)) {
+    uint8_t fifo[3];
+    write8(MFRC630_REG_IRQ0, MFRC630IRQ0_HIALERTIRQ);
+    readBuffer(MFRC630_REG_FIFO_CONTROL, sizeof(fifo), fifo);
+    readFrameData(frame,
+                  (fifo[0] & 0x80) ? fifo[2]
+                                   : (((fifo[0] & 0x3) << 8) | fifo[2]),
+                  &_xfer.received);
+  }
+
+  /* Safety net, Timer0 doesn't run while a frame is being received. */
+  if ((millis() - _xfer.start) > MFRC630_IRQ_PIN_TIMEOUT_MS) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("Timed out streaming the frame"));
+    _xfer.timedout = true;
+    return true;
+  }
+
+  return false;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Flushes the contents of the FIFo buffer
+    @brief  Pops the bytes of a drained frame that the last look at the FIFO
+            found, and looks again, in one burst from FIFO_LENGTH into
+            FIFO_DATA
+
+    @returns The number of bytes popped.
 */
 /**************************************************************************/
-void Adafruit_MFRC630::clearFIFO(void) {
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("Clearing FIFO buffer "));
+uint8_t Adafruit_MFRC630::frameDrain(void) {
+  struct mfrc630_frame *frame = _xfer.frame;
+  uint8_t fifo[MFRC630_I2C_CHUNK_LEN];
+  uint8_t n = (_xfer.pending < sizeof(fifo)) ? _xfer.pending : sizeof(fifo) - 1;
+
+  readBuffer(MFRC630_REG_FIFO_LENGTH, 1 + n, fifo);
+  for (uint8_t i = 0; i < n; i++) {
+    if (_xfer.received < frame->rxlen) {
+      frame->rx[_xfer.received] = fifo[1 + i];
+    }
+    _xfer.received++;
+  }
+  _xfer.pending = (fifo[0] > n) ? fifo[0] - n : 0;
 
-  uint8_t ctrl = read8(MFRC630_REG_FIFO_CONTROL);
-  write8(MFRC630_REG_FIFO_CONTROL, ctrl | (1 << 4));
+  return n;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Writes a parameter-less command to the internal state machine
+    @brief  Moves 'len' bytes from the FIFO to 'frame->rx', discarding
+            anything that doesn't fit in the buffer
 */
 /**************************************************************************/
-void Adafruit_MFRC630::writeCommand(byte command) {
-  uint8_t buff[1] = {command};
+void Adafruit_MFRC630::readFrameData(struct mfrc630_frame *frame,
+                                     uint16_t len, uint16_t *received) {
+  uint8_t scratch[MFRC630_I2C_CHUNK_LEN];
+
+  while (len) {
+    uint16_t room =
+        (frame->rxlen > *received) ? (frame->rxlen - *received) : 0;
+    uint8_t *dst = frame->rx + *received;
+    uint16_t n = len;
+
+    /* Keep reading past the end of 'rx' so the FIFO can't overflow */
+    if (!room) {
+      dst = scratch;
+      room = sizeof(scratch);
+    }
+    if (n > room) {
+      n = room;
+    }
+    readFIFO(n, dst);
+    *received += n;
+    len -= n;
+  }
+}
 
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINT(F("Sending CMD 0x"));
-  DEBUG_PRINTLN(command, HEX);
+/***************************************************************************
+ CONSTRUCTOR
+ ***************************************************************************/
 
-  writeBuffer(MFRC630_REG_COMMAND, 1, buff);
+/**************************************************************************/
+/*!
+    @brief  Sets up the pins and the driver state shared by all
+            constructors, with every transport disabled
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::initState(int8_t pdown_pin, int8_t irq_pin) {
+  /* Set the PDOWN pin */
+  _pdown = pdown_pin;
+
+  /* Set the (optional) IRQ pin */
+  _irq = irq_pin;
+  _irqpin_en =
+      (_irq != -1) ? (MFRC630IRQ1EN_IRQ_PUSHPULL | MFRC630IRQ1EN_IRQ_PINEN) : 0;
+
+  /* Nothing is known about the register contents yet */
+  _framecfg_valid = false;
+  _cmd_idle = false;
+  _regcache_enabled = false;
+  _regcache_hits = 0;
+  _regcache_misses = 0;
+  memset(_regcache_valid, 0, sizeof(_regcache_valid));
+  _ntagcache_valid = false;
+  _fifosize = 255;
+  _isodep.active = false;
+  _card.present = false;
+  _xfer.active = false;
+  _xfer.emptied = false;
+  _op.op = MFRC630_OP_NONE;
+  _op.result = 0;
+  _status = MFRC630_STATUS_OK;
+  memset(_retry, 0, sizeof(_retry));
+  memset(_tmo, 0, sizeof(_tmo));
+  _tmo_uidlen = 0;
+  _lpcd.calibrated = false;
+  _lpcd.armed = false;
+  _lpcd.threshold = MFRC630_LPCD_THRESHOLD;
+  _eeprom_bytes = 0;
+  _eeprom_us = 0;
+#if MFRC630_PERF_COUNTERS
+  resetPerfCounters();
+#endif
+#if MFRC630_TRACE_LOG
+  _trace.filter = 0xFF;
+  traceClear();
+#endif
+
+  /* Disable I2C, SPI, SW serial and custom bus access */
+  _wire = NULL;
+  _i2c_addr = 0;
+  _cs = -1;
+  _serial = NULL;
+  _custom = NULL;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Writes a parameterised command to the internal state machine
+    @brief  Instantiates a new instance of the Adafruit_MFRC630 class
+            using the default I2C bus.
 */
 /**************************************************************************/
-void Adafruit_MFRC630::writeCommand(byte command, uint8_t paramlen,
-                                    uint8_t *params) {
-  /* Arguments and/or data necessary to process a command are exchanged via
-     the FIFO buffer:
+Adafruit_MFRC630::Adafruit_MFRC630(uint8_t i2c_addr, int8_t pdown_pin,
+                                   int8_t irq_pin) {
+  initState(pdown_pin, irq_pin);
 
-     - Each command that needs a certain number of arguments will start
-       processing only when it has received the correct number of arguments
-       via the FIFO buffer.
-     - The FIFO buffer is not cleared automatically at command start. It is
-       recommended to write the command arguments and/or the data bytes into
-       the FIFO buffer and start the command afterwards.
-     - Each command may be stopped by the host by writing a new command code
-       into the command register e.g.: the Idle-Command. */
+  /* Set the transport */
+  _bus = &i2c_bus;
 
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("Sending Command"));
+  /* Set the I2C address */
+  _i2c_addr = i2c_addr;
 
-  /* Cancel any current command. */
-  write8(MFRC630_REG_COMMAND, MFRC630_CMD_IDLE);
+  /* Set the I2C bus instance */
+  _wire = &Wire;
+}
 
-  /* Flush the FIFO */
-  clearFIFO();
+/**************************************************************************/
+/*!
+    @brief  Instantiates a new instance of the Adafruit_MFRC630 class
+            using the specified I2C bus.
+*/
+/**************************************************************************/
+Adafruit_MFRC630::Adafruit_MFRC630(TwoWire *wireBus, uint8_t i2c_addr,
+                                   int8_t pdown_pin, int8_t irq_pin) {
+  initState(pdown_pin, irq_pin);
 
-  /* Write data to the FIFO */
-  writeFIFO(paramlen, params);
+  /* Set the transport */
+  _bus = &i2c_bus;
 
-  /* Send the command */
-  write8(MFRC630_REG_COMMAND, command);
+  /* Set the I2C address */
+  _i2c_addr = i2c_addr;
+
+  /* Set the I2C bus instance */
+  _wire = wireBus;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Gets the three bit COM status for the IC
+    @brief  Instantiates a new instance of the Adafruit_MFRC630 class
+            using the HW SPI bus.
 */
 /**************************************************************************/
-uint8_t Adafruit_MFRC630::getComStatus(void) {
-  return (read8(MFRC630_REG_STATUS) & 0b111);
+Adafruit_MFRC630::Adafruit_MFRC630(enum mfrc630_transport transport, int8_t cs,
+                                   int8_t pdown_pin, int8_t irq_pin) {
+  initState(pdown_pin, irq_pin);
+
+  /* Set the transport (HW SPI) */
+  (void)transport;
+  _bus = &spi_bus;
+
+  /* Set the CS/SSEL pin */
+  _cs = cs;
+  pinMode(_cs, OUTPUT);
 }
 
 /**************************************************************************/
 /*!
-    @brief  Performs a soft reset of the IC
+    @brief  Instantiates a new instance of the Adafruit_MFRC630 class
+            using the specified Serial block.
 */
 /**************************************************************************/
-void Adafruit_MFRC630::softReset(void) {
-  writeCommand(MFRC630_CMD_SOFTRESET);
-  delay(100);
+Adafruit_MFRC630::Adafruit_MFRC630(Stream *serial, int8_t pdown_pin,
+                                   int8_t irq_pin) {
+  initState(pdown_pin, irq_pin);
+
+  /* Set the transport */
+  _bus = &serial_bus;
+
+  /* Set the Serial instance */
+  _serial = serial;
 }
 
 /**************************************************************************/
 /*!
-    @brief  Prints out n bytes of hex data.
+    @brief  Instantiates a new instance of the Adafruit_MFRC630 class
+            using a user supplied bus.
 */
 /**************************************************************************/
-void Adafruit_MFRC630::printHex(uint8_t *buf, size_t len) {
-  if (len) {
-    DEBUG_PRINT("[ ");
-  }
-  for (uint8_t i = 0; i < len; i++) {
-    // DEBUG_PRINT("0x");
-    if (buf[i] < 16) {
-      DEBUG_PRINT(F("0"));
-    }
-    DEBUG_PRINT(buf[i], HEX);
-    DEBUG_PRINT(F(" "));
-  }
-  if (len) {
-    DEBUG_PRINT(F("]"));
-  }
+Adafruit_MFRC630::Adafruit_MFRC630(Adafruit_MFRC630_Bus *bus, int8_t pdown_pin,
+                                   int8_t irq_pin) {
+  initState(pdown_pin, irq_pin);
+
+  /* Set the transport */
+  _bus = &custom_bus;
+  _custom = bus;
 }
 
+/***************************************************************************
+ PUBLIC FUNCTIONS
+ ***************************************************************************/
+
 /**************************************************************************/
 /*!
-    @brief  Prints a human readable error code.
+    @brief  Sets up the HW
 */
 /**************************************************************************/
-void Adafruit_MFRC630::printError(enum mfrc630errors err) {
-  ERROR_TIMESTAMP();
+bool Adafruit_MFRC630::begin() {
+  /* Display alert for DEBUG and TRACE output. */
+  DEBUG_PRINTLN(F("\tDebug output enabled: D [+ms] Message"));
+  TRACE_PRINTLN(F("\tTrace output enabled: . [+ms] Message"));
+  DEBUG_PRINTLN(F(""));
+
+  /* Enable I2C, SPI or SW serial */
+  DEBUG_TIMESTAMP();
+  (this->*(_bus->begin))();
+  DEBUG_PRINTLN(F(""));
+
+  /* The IRQ pin is push-pull and active high once routed in IRQ1EN */
+  if (_irq != -1) {
+    pinMode(_irq, INPUT);
+  }
+
+  /* Reset the MFRC630 if possible */
+  if (_pdown != -1) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("Resetting MFRC630"));
+    pinMode(_pdown, OUTPUT);
+    digitalWrite(_pdown, HIGH);
+    digitalWrite(_pdown, LOW);
+    digitalWrite(_pdown, HIGH);
+    digitalWrite(_pdown, LOW);
+    /* Typical 2.5ms startup delay */
+    delay(5);
+    _framecfg_valid = false;
+    invalidateRegisterCache();
+  }
+
+  /* Check device ID for bus response */
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Checking transport layer"));
+
+  /* Read the VERSION register */
+  byte ver = read8(MFRC630_REG_VERSION);
+
+  /* If ver == 0xFF or 0x0 likely a bus failure */
+  if ((ver == 0xFF) || (ver == 0)) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("Transport failure!"));
+    return false;
+  }
+
+  /* If !1.8, there was a problem */
+  if (ver != 0x18) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("FAILED!"));
+    return false;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("IC Version = "));
+  DEBUG_PRINT((ver & 0xF0) >> 4, HEX);
+  DEBUG_PRINT(F("."));
+  DEBUG_PRINTLN(ver & 0x0F, HEX);
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Determines the number of bytes in the HW FIFO buffer (max 512)
+
+    @returns The number of bytes available in the HW FIFO buffer
+*/
+/**************************************************************************/
+int16_t Adafruit_MFRC630::readFIFOLen(void) {
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Checking FIFO length"));
+
+  /*
+   * Rather than sleeping for a fixed period, wait for the frame to complete:
+   * the length is final once ComState shows the receiver is no longer busy,
+   * and either the state machine is IDLE (nothing can write to the FIFO) or
+   * two consecutive reads of the length agree.
+   */
+  int16_t l = -1;
+  uint32_t start = millis();
+  for (;;) {
+    uint8_t comstat = getComStatus();
+
+    /* Read FIFO_CONTROL..FIFO_LENGTH in one burst (0x02..0x04) */
+    /* In 512 byte mode, the upper two bits are stored in FIFO_CONTROL */
+    uint8_t fifo[3];
+    readBuffer(MFRC630_REG_FIFO_CONTROL, sizeof(fifo), fifo);
+
+    /* Determine len based on FIFO size (255 byte or 512 byte mode) */
+    int16_t now =
+        (fifo[0] & 0x80) ? fifo[2] : (((fifo[0] & 0x3) << 8) | fifo[2]);
+
+    if ((comstat != MFRC630_COMSTAT_RECEIVING) &&
+        ((comstat == MFRC630_COMSTAT_IDLE) || (now == l))) {
+      l = now;
+      break;
+    }
+    l = now;
+
+    if ((millis() - start) > MFRC630_FIFO_SETTLE_TIMEOUT_MS) {
+      DEBUG_TIMESTAMP();
+      DEBUG_PRINTLN(F("Timed out waiting for the FIFO to settle"));
+      break;
+    }
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("FIFO contains "));
+  DEBUG_PRINT(l);
+  DEBUG_PRINTLN(F(" byte(s)"));
+
+  return l;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Read 'len' bytes from the HW FIFO buffer (max 512 bytes)
+
+    @returns The number of bytes read from the FIFO, or -1 if an error occured.
+*/
+/**************************************************************************/
+int16_t Adafruit_MFRC630::readFIFO(uint16_t len, uint8_t *buffer) {
+  /* Check for 512 byte overflow */
+  if (len > 512) {
+    return -1;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Reading "));
+  DEBUG_PRINT(len);
+  DEBUG_PRINTLN(F(" byte(s) from FIFO"));
+
+  /* Read len bytes from the FIFO in a single burst */
+  return readBuffer(MFRC630_REG_FIFO_DATA, len, buffer);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes the specified number of bytes to the HW FIFO
+
+    @returns The number of bytes written to the FIFO, -1 if an error occured.
+*/
+/**************************************************************************/
+int16_t Adafruit_MFRC630::writeFIFO(uint16_t len, uint8_t *buffer) {
+  /* Check for 512 byte overflow */
+  if (len > 512) {
+    return -1;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Writing "));
+  DEBUG_PRINT(len);
+  DEBUG_PRINTLN(F(" byte(s) to FIFO"));
+
+  /* Write len bytes to the FIFO in a single burst */
+  writeBuffer(MFRC630_REG_FIFO_DATA, len, buffer);
+  _xfer.emptied = false;
+
+  return len;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Flushes the contents of the FIFo buffer
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::clearFIFO(void) {
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Clearing FIFO buffer "));
+
+  /*
+   * Only the FIFOSize/WaterLevelExtBit bits need preserving, which
+   * transceive() keeps along with the framing registers.
+   */
+  uint8_t ctrl;
+  if (_regcache_enabled && (_regcache_valid[MFRC630_REG_FIFO_CONTROL >> 3] &
+                            (1 << (MFRC630_REG_FIFO_CONTROL & 7)))) {
+    ctrl = _regcache[MFRC630_REG_FIFO_CONTROL];
+    _regcache_hits++;
+  } else if (_framecfg_valid) {
+    ctrl = _framecfg.fifoctrl;
+  } else {
+    ctrl = read8(MFRC630_REG_FIFO_CONTROL);
+    if (_regcache_enabled) {
+      _regcache_misses++;
+    }
+  }
+  _fifosize = (ctrl & 0x80) ? 255 : 512;
+  _framecfg.fifoctrl = ctrl & MFRC630_FIFO_CONTROL_CFG_MASK;
+  write8(MFRC630_REG_FIFO_CONTROL, ctrl | (1 << 4));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Switches between the 255 and 512 byte FIFO modes
+
+    @returns True if 'size' was valid, otherwise false.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::setFIFOSize(uint16_t size) {
+  if ((size != 255) && (size != 512)) {
+    return false;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Setting FIFO size to "));
+  DEBUG_PRINTLN(size);
+
+  /* FIFOSize is bit 7 (1 = 255 bytes), flush while we're at it */
+  write8(MFRC630_REG_FIFO_CONTROL, ((size == 255) ? 0x80 : 0x00) | (1 << 4));
+  _fifosize = size;
+  _framecfg.fifoctrl = (size == 255) ? 0x80 : 0x00;
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads the FIFO size back from FIFO_CONTROL
+
+    @returns 255 or 512.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::getFIFOSize(void) {
+  _fifosize = (read8(MFRC630_REG_FIFO_CONTROL) & 0x80) ? 255 : 512;
+  return _fifosize;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Reads 'len' bytes of EEPROM starting at 'addr'
+
+    @returns The number of bytes read.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::eepromRead(uint16_t addr, uint16_t len,
+                                      uint8_t *buf) {
+  uint32_t start = micros();
+  uint16_t done = 0;
+
+  if ((addr >= MFRC630_EEPROM_LEN) || (len > MFRC630_EEPROM_LEN - addr)) {
+    return 0;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Reading "));
+  DEBUG_PRINT(len);
+  DEBUG_PRINT(F(" byte(s) from EEPROM @ "));
+  DEBUG_PRINTLN(addr);
+
+  while (done < len) {
+    /* READE2 takes a 16-bit address and an 8-bit length */
+    uint16_t n = len - done;
+    if (n > 255) {
+      n = 255;
+    }
+    uint16_t a = addr + done;
+    uint8_t params[3] = {(uint8_t)(a >> 8), (uint8_t)(a & 0xFF), (uint8_t)n};
+    if (!runCommand(MFRC630_CMD_READE2, params, sizeof(params), buf + done,
+                    n)) {
+      break;
+    }
+    done += n;
+  }
+
+  _eeprom_bytes += done;
+  _eeprom_us += micros() - start;
+
+  return done;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Programs one full 64 byte EEPROM page
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::eepromWritePage(uint8_t page, uint8_t *data) {
+  uint8_t params[1 + MFRC630_EEPROM_PAGE_LEN];
+
+  /* WRITEE2PAGE takes the page number followed by the page data */
+  params[0] = page;
+  memcpy(&params[1], data, MFRC630_EEPROM_PAGE_LEN);
+
+  /* The command goes IDLE once programming is done, no need to sleep */
+  return runCommand(MFRC630_CMD_WRITEE2PAGE, params, sizeof(params), NULL, 0);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes 'len' bytes of EEPROM starting at 'addr'
+
+    @returns The number of bytes written.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::eepromWrite(uint16_t addr, uint16_t len,
+                                       uint8_t *buf) {
+  uint8_t page[MFRC630_EEPROM_PAGE_LEN];
+  uint32_t start = micros();
+  uint16_t done = 0;
+
+  /* Keep clear of the production/interface config, keys and RSP */
+  if ((addr < MFRC630_EEPROM_WRITE_START) ||
+      (addr >= MFRC630_EEPROM_WRITE_END) ||
+      (len > MFRC630_EEPROM_WRITE_END - addr)) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINT(F("EEPROM write out of range: "));
+    DEBUG_PRINTLN(addr);
+    return 0;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Writing "));
+  DEBUG_PRINT(len);
+  DEBUG_PRINT(F(" byte(s) to EEPROM @ "));
+  DEBUG_PRINTLN(addr);
+
+  while (done < len) {
+    uint16_t a = addr + done;
+    uint8_t offset = a % MFRC630_EEPROM_PAGE_LEN;
+    uint16_t n = len - done;
+    if (n > MFRC630_EEPROM_PAGE_LEN - offset) {
+      n = MFRC630_EEPROM_PAGE_LEN - offset;
+    }
+
+    /* Merge partial pages with what's already there */
+    uint8_t *data = buf + done;
+    if (n != MFRC630_EEPROM_PAGE_LEN) {
+      uint16_t base = a - offset;
+      uint8_t params[3] = {(uint8_t)(base >> 8), (uint8_t)(base & 0xFF),
+                           sizeof(page)};
+      if (!runCommand(MFRC630_CMD_READE2, params, sizeof(params), page,
+                      sizeof(page))) {
+        break;
+      }
+      memcpy(&page[offset], buf + done, n);
+      data = page;
+    }
+    if (!eepromWritePage(a / MFRC630_EEPROM_PAGE_LEN, data)) {
+      break;
+    }
+    done += n;
+  }
+
+  _eeprom_bytes += done;
+  _eeprom_us += micros() - start;
+
+  return done;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the EEPROM transfer totals
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::getEEPROMStats(uint32_t *bytes, uint32_t *us) {
+  *bytes = _eeprom_bytes;
+  *us = _eeprom_us;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes a parameter-less command to the internal state machine
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::writeCommand(byte command) {
+  uint8_t buff[1] = {command};
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Sending CMD 0x"));
+  DEBUG_PRINTLN(command, HEX);
+
+  invalidateCaches(command);
+  writeBuffer(MFRC630_REG_COMMAND, 1, buff);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes a parameterised command to the internal state machine
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::writeCommand(byte command, uint8_t paramlen,
+                                    uint8_t *params) {
+  /* Arguments and/or data necessary to process a command are exchanged via
+     the FIFO buffer:
+
+     - Each command that needs a certain number of arguments will start
+       processing only when it has received the correct number of arguments
+       via the FIFO buffer.
+     - The FIFO buffer is not cleared automatically at command start. It is
+       recommended to write the command arguments and/or the data bytes into
+       the FIFO buffer and start the command afterwards.
+     - Each command may be stopped by the host by writing a new command code
+       into the command register e.g.: the Idle-Command. */
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Sending Command"));
+
+  /* Cancel any current command. */
+  write8(MFRC630_REG_COMMAND, MFRC630_CMD_IDLE);
+
+  /* Flush the FIFO */
+  clearFIFO();
+
+  /* Write data to the FIFO */
+  writeFIFO(paramlen, params);
+
+  /* Send the command */
+  invalidateCaches(command);
+  write8(MFRC630_REG_COMMAND, command);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Forgets the framing registers cached by transceive() and the
+            register shadow if 'command' reloads the register set from
+            EEPROM or resets it
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::invalidateCaches(byte command) {
+  switch (command) {
+  case MFRC630_CMD_LOADREG:
+  case MFRC630_CMD_LOADPROTOCOL:
+  case MFRC630_CMD_SOFTRESET:
+    _framecfg_valid = false;
+    invalidateRegisterCache();
+    break;
+  default:
+    break;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Gets the three bit COM status for the IC
+*/
+/**************************************************************************/
+uint8_t Adafruit_MFRC630::getComStatus(void) {
+  return (read8(MFRC630_REG_STATUS) & 0b111);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Performs a soft reset of the IC
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::softReset(void) {
+  writeCommand(MFRC630_CMD_SOFTRESET);
+  delay(100);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Switches the receiver into LPCD measurement mode and starts
+            'command' with T4 set up as requested
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::lpcdRun(uint16_t t4reload, uint8_t t4control,
+                               uint8_t command) {
+  /* Remember the radio settings the measurement changes */
+  _lpcd.saved[0] = read8(MFRC630_REG_DRV_MOD);
+  readBuffer(MFRC630_REG_RCV, 2, &_lpcd.saved[1]);
+
+  write8(MFRC630_REG_COMMAND, MFRC630_CMD_IDLE);
+  clearFIFO();
+
+  /*
+   * Register values from NXP's LPCD sequence: field driver setting for the
+   * measurement, a short T3 measurement window, the T4 period, then the
+   * receiver in ADC mode at maximum gain.
+   */
+  uint8_t t3[2] = {0x00, 0x10};
+  uint8_t t4[2] = {(uint8_t)(t4reload >> 8), (uint8_t)(t4reload & 0xFF)};
+  uint8_t rx[2] = {0x52, 0x03}; /* RCV, RX_ANA */
+  write8(MFRC630_REG_DRV_MOD, 0x89);
+  writeBuffer(MFRC630_REG_T3_RELOAD_HI, sizeof(t3), t3);
+  writeBuffer(MFRC630_REG_T4_RELOAD_HI, sizeof(t4), t4);
+  write8(MFRC630_REG_T4_CONTROL, t4control);
+  write8(MFRC630_REG_LPCD_Q_RESULT, 0x40); /* Clear the last result */
+  writeBuffer(MFRC630_REG_RCV, sizeof(rx), rx);
+
+  write8(MFRC630_REG_COMMAND, command);
+  _lpcd.armed = true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stops the LPCD command and T4, and puts the receiver settings and
+            IRQ enables back the way they were
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::lpcdRestore(void) {
+  /* Clearing the command register also leaves standby */
+  write8(MFRC630_REG_COMMAND, MFRC630_CMD_IDLE);
+  delay(1); /* Crystal oscillator restart */
+  write8(MFRC630_REG_T4_CONTROL, 0);
+  clearFIFO();
+
+  write8(MFRC630_REG_DRV_MOD, _lpcd.saved[0]);
+  writeBuffer(MFRC630_REG_RCV, 2, &_lpcd.saved[1]);
+
+  /* LPCD changed the IRQ enables behind transceive()'s back */
+  writeScript(script_clear_irqs.bytes);
+  _framecfg_valid = false;
+  _lpcd.armed = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Measures the I/Q baseline used by LPCD
+
+    @param  i   Optional, filled in with the I channel baseline.
+    @param  q   Optional, filled in with the Q channel baseline.
+
+    @returns True if the measurement completed.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::lpcdCalibrate(uint8_t *i, uint8_t *q) {
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Calibrating LPCD"));
+
+  if (_lpcd.armed) {
+    lpcdStop();
+  }
+
+  /* Open the window (QMIN, QMAX, IMIN) all the way while measuring */
+  uint8_t window[3] = {0xC0, 0xFF, 0xC0};
+  writeBuffer(MFRC630_REG_LPCD_QMIN, sizeof(window), window);
+
+  /* One measurement after the shortest T4 period, with LFO trimming */
+  lpcdRun(0x0005,
+          MFRC630T4_RUNNING | MFRC630T4_STARTSTOP | MFRC630T4_AUTOTRIMM |
+              MFRC630T4_AUTOLPCD | MFRC630T4_AUTORESTART,
+          MFRC630_CMD_LPCD);
+
+  /* T4 stops once the measurement is done */
+  uint32_t start = millis();
+  bool done = false;
+  while (!done && ((millis() - start) < MFRC630_LPCD_CAL_TIMEOUT_MS)) {
+    done = !(read8(MFRC630_REG_T4_CONTROL) & MFRC630T4_RUNNING);
+  }
+
+  _lpcd.i = read8(MFRC630_REG_LPCD_I_RESULT) & 0x3F;
+  _lpcd.q = read8(MFRC630_REG_LPCD_Q_RESULT) & 0x3F;
+  lpcdRestore();
+
+  if (!done) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("Timed out waiting for the LPCD measurement"));
+    return false;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("LPCD baseline I="));
+  DEBUG_PRINT(_lpcd.i);
+  DEBUG_PRINT(F(" Q="));
+  DEBUG_PRINTLN(_lpcd.q);
+
+  _lpcd.calibrated = true;
+  if (i) {
+    *i = _lpcd.i;
+  }
+  if (q) {
+    *q = _lpcd.q;
+  }
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets the allowed I/Q deviation from the LPCD baseline
+
+    @param  threshold   The allowed deviation (0..63).
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::lpcdSetThreshold(uint8_t threshold) {
+  _lpcd.threshold = threshold;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Arms autonomous low power card detection
+
+    @param  period_ms   The time between two measurements.
+
+    @returns True if LPCD was armed.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::lpcdStart(uint16_t period_ms) {
+  if (_lpcd.armed) {
+    lpcdStop();
+  }
+  if (!_lpcd.calibrated && !lpcdCalibrate()) {
+    return false;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Arming LPCD"));
+
+  /* Detection window around the baseline, clamped to the 6-bit range */
+  uint8_t th = _lpcd.threshold;
+  uint8_t qmin = (_lpcd.q > th) ? _lpcd.q - th : 0;
+  uint8_t qmax = (_lpcd.q + th < 0x3F) ? _lpcd.q + th : 0x3F;
+  uint8_t imin = (_lpcd.i > th) ? _lpcd.i - th : 0;
+  uint8_t imax = (_lpcd.i + th < 0x3F) ? _lpcd.i + th : 0x3F;
+
+  /* IMAX is spread over the top two bits of QMIN, QMAX and IMIN */
+  uint8_t window[3] = {(uint8_t)(qmin | ((imax & 0x30) << 2)),
+                       (uint8_t)(qmax | ((imax & 0x0C) << 4)),
+                       (uint8_t)(imin | ((imax & 0x03) << 6))};
+  writeBuffer(MFRC630_REG_LPCD_QMIN, sizeof(window), window);
+
+  /* Only LPCDIRQ reaches GlobalIRQ (and the IRQ pin) while armed */
+  uint8_t irqen[2] = {0, (uint8_t)(MFRC630IRQ1_LPCDIRQ | _irqpin_en)};
+  writeScript(script_clear_irqs.bytes);
+  writeBuffer(MFRC630_REG_IRQOEN, sizeof(irqen), irqen);
+  _framecfg_valid = false;
+
+  /*
+   * T4 runs from the slowest LFO clock at ~2ms per tick, wakes the IC from
+   * standby and runs a measurement each time it expires, then restarts
+   * (0xDF). LFO trimming is only needed once, during calibration.
+   */
+  uint16_t reload = period_ms / 2;
+  lpcdRun(reload ? reload : 1,
+          MFRC630T4_RUNNING | MFRC630T4_STARTSTOP | MFRC630T4_AUTOLPCD |
+              MFRC630T4_AUTORESTART | MFRC630T4_AUTOWAKEUP |
+              MFRC630T4_CLK_LFO_DIV,
+          MFRC630_CMD_STANDBY | MFRC630_CMD_LPCD);
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks if the armed LPCD has detected something
+
+    @returns True once LPCDIRQ was raised.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::lpcdCheck(void) {
+  if (!_lpcd.armed) {
+    return false;
+  }
+  if (_irq != -1) {
+    return digitalRead(_irq) == HIGH;
+  }
+  return read8(MFRC630_REG_IRQ1) & MFRC630IRQ1_LPCDIRQ;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stops LPCD and restores the radio settings
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::lpcdStop(void) {
+  if (_lpcd.armed) {
+    lpcdRestore();
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Waits in LPCD mode until a card answers WUPA
+
+    @param  timeout_ms  How long to wait, 0 to wait forever.
+    @param  period_ms   The time between two measurements.
+
+    @returns True if a card answered, false on timeout.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::lpcdWait(uint32_t timeout_ms, uint16_t period_ms) {
+  uint32_t start = millis();
+
+  while (lpcdStart(period_ms)) {
+    /*
+     * The IRQ pin costs nothing to watch; otherwise poll IRQ1 once per
+     * measurement, as nothing can change in between.
+     */
+    bool detected = lpcdCheck();
+    while (!detected && !(timeout_ms && ((millis() - start) > timeout_ms))) {
+      if (_irq != -1) {
+        yield();
+      } else {
+        delay(period_ms);
+      }
+      detected = lpcdCheck();
+    }
+    lpcdStop();
+
+    if (!detected) {
+      return false;
+    }
+
+    /* Let the field settle, then confirm with WUPA */
+    delay(5);
+    if (iso14443aWakeup()) {
+      /* HLTA is invalid in READY, which drops the card back to IDLE */
+      iso14443aHalt();
+      return true;
+    }
+
+    /* Nothing there: the baseline has drifted, measure it again */
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("LPCD woke up without a card, recalibrating"));
+    _lpcd.calibrated = false;
+  }
+
+  return false;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Enables or disables the register shadow cache
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::enableRegisterCache(bool enable) {
+  _regcache_enabled = enable;
+  _regcache_hits = 0;
+  _regcache_misses = 0;
+  invalidateRegisterCache();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Marks every register in the shadow cache as unknown
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::invalidateRegisterCache(void) {
+  memset(_regcache_valid, 0, sizeof(_regcache_valid));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the shadow cache hit/miss counters
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::getRegisterCacheStats(uint32_t *hits,
+                                             uint32_t *misses) {
+  *hits = _regcache_hits;
+  *misses = _regcache_misses;
+}
+
+#if MFRC630_PERF_COUNTERS
+/**************************************************************************/
+/*!
+    @brief  Starts measuring an operation of type 'op'
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::perfBegin(enum mfrc630_perf_op op) {
+  _perf.cur = &_perf.ops[op];
+  _perf.start = micros();
+}
+
+/**************************************************************************/
+/*!
+    @brief  Books the latency of the operation being measured
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::perfEnd(void) {
+  if (!_perf.cur) {
+    return;
+  }
+
+  perfBook(_perf.cur, _perf.start);
+  _perf.cur = NULL;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Books one call to 'c' that started at micros() 'start'
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::perfBook(struct mfrc630_perf_counters *c,
+                                uint32_t start) {
+  uint32_t us = micros() - start;
+  uint8_t bucket = 0;
+  while ((bucket < MFRC630_PERF_BUCKETS - 1) && (us >= (128UL << bucket))) {
+    bucket++;
+  }
+
+  c->calls++;
+  c->total_us += us;
+  if (us > c->max_us) {
+    c->max_us = us;
+  }
+  c->histogram[bucket]++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns a snapshot of the performance counters of one operation
+            type
+
+    @param  op        The operation type to look at.
+    @param  counters  Filled in with the counters.
+
+    @returns False if 'op' is out of range.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::getPerfCounters(enum mfrc630_perf_op op,
+                                       struct mfrc630_perf_counters *counters) {
+  if (op >= MFRC630_PERF_OP_COUNT) {
+    return false;
+  }
+
+  *counters = _perf.ops[op];
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Clears the performance counters of all operation types
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::resetPerfCounters(void) {
+  memset(_perf.ops, 0, sizeof(_perf.ops));
+  _perf.cur = NULL;
+}
+#endif
+
+#if MFRC630_TRACE_LOG
+/**************************************************************************/
+/*!
+    @brief  Appends a record to the trace log, overwriting the oldest one
+            if it is full. Cheap enough to run on every bus access.
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::traceLog(uint8_t event, uint8_t reg, uint8_t value,
+                                uint16_t len) {
+  if (!(_trace.filter & MFRC630_TRACE_MASK(event))) {
+    return;
+  }
+
+  struct mfrc630_trace_record *r = &_trace.buf[_trace.head];
+  r->us = micros();
+  r->event = event;
+  r->reg = reg;
+  r->value = value;
+  r->len = (len > 0xFF) ? 0xFF : len;
+
+  _trace.head = (_trace.head + 1) & (MFRC630_TRACE_LOG_LEN - 1);
+  if (_trace.count < MFRC630_TRACE_LOG_LEN) {
+    _trace.count++;
+  } else {
+    _trace.dropped++;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Selects the event types the trace log records
+
+    @param  mask    MFRC630_TRACE_MASK() bits of the events to record.
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::traceSetFilter(uint8_t mask) { _trace.filter = mask; }
+
+/**************************************************************************/
+/*!
+    @brief  Discards all records and the dropped record count
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::traceClear(void) {
+  _trace.head = 0;
+  _trace.count = 0;
+  _trace.dropped = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Removes the oldest records from the trace log
+
+    @param  records The buffer for the records.
+    @param  max     The number of records that fit in 'records'.
+
+    @returns The number of records copied into 'records'.
+*/
+/**************************************************************************/
+uint8_t Adafruit_MFRC630::traceRead(struct mfrc630_trace_record *records,
+                                    uint8_t max) {
+  uint8_t n = 0;
+
+  while ((n < max) && _trace.count) {
+    uint8_t tail = (_trace.head - _trace.count) & (MFRC630_TRACE_LOG_LEN - 1);
+    records[n++] = _trace.buf[tail];
+    _trace.count--;
+  }
+
+  return n;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the number of records overwritten before being read
+
+    @returns The number of dropped records.
+*/
+/**************************************************************************/
+uint32_t Adafruit_MFRC630::traceDropped(void) { return _trace.dropped; }
+
+/**************************************************************************/
+/*!
+    @brief  Drains the trace log to 'out' in the format read by
+            extras/mfrc630_trace_decode.py
+
+    @param  out     Where to print the records.
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::traceDump(Print *out) {
+  struct mfrc630_trace_record r;
+
+  while (traceRead(&r, 1)) {
+    out->print(F("mfrc630_trace,"));
+    out->print(r.us);
+    out->print(F(","));
+    out->print(r.event);
+    out->print(F(","));
+    out->print(r.reg);
+    out->print(F(","));
+    out->print(r.value);
+    out->print(F(","));
+    out->println(r.len);
+  }
+
+  if (_trace.dropped) {
+    out->print(F("mfrc630_trace_dropped,"));
+    out->println(_trace.dropped);
+    _trace.dropped = 0;
+  }
+}
+#endif
+
+/**************************************************************************/
+/*!
+    @brief  Prints out n bytes of hex data.
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::printHex(uint8_t *buf, size_t len) {
+  if (len) {
+    DEBUG_PRINT("[ ");
+  }
+  for (uint8_t i = 0; i < len; i++) {
+    // DEBUG_PRINT("0x");
+    if (buf[i] < 16) {
+      DEBUG_PRINT(F("0"));
+    }
+    DEBUG_PRINT(buf[i], HEX);
+    DEBUG_PRINT(F(" "));
+  }
+  if (len) {
+    DEBUG_PRINT(F("]"));
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Prints a human readable error code.
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::printError(enum mfrc630errors err) {
+  ERROR_TIMESTAMP();
   ERROR_PRINT(F("ERROR! Danger, Will Robinson: "));
 
-  switch (err) {
-  case MFRC630_ERROR_INTEG:
-    ERROR_PRINTLN(F("Data integrity!"));
-    break;
-  case MFRC630_ERROR_PROT:
-    ERROR_PRINTLN(F("Protocol error!"));
-    break;
-  case MFRC630_ERROR_COLLDET:
-    ERROR_PRINTLN(F("Collision detected!"));
-    break;
-  case MFRC630_ERROR_NODATA:
-    ERROR_PRINTLN(F("No data!"));
-    break;
-  case MFRC630_ERROR_MINFRAME:
-    ERROR_PRINTLN(F("Frame data too small!"));
+  switch (err) {
+  case MFRC630_ERROR_INTEG:
+    ERROR_PRINTLN(F("Data integrity!"));
+    break;
+  case MFRC630_ERROR_PROT:
+    ERROR_PRINTLN(F("Protocol error!"));
+    break;
+  case MFRC630_ERROR_COLLDET:
+    ERROR_PRINTLN(F("Collision detected!"));
+    break;
+  case MFRC630_ERROR_NODATA:
+    ERROR_PRINTLN(F("No data!"));
+    break;
+  case MFRC630_ERROR_MINFRAME:
+    ERROR_PRINTLN(F("Frame data too small!"));
+    break;
+  case MFRC630_ERROR_FIFOOVL:
+    ERROR_PRINTLN(F("FIFO full!"));
+    break;
+  case MFRC630_ERROR_FIFOWR:
+    ERROR_PRINTLN(F("Couldn't write to FIFO!"));
+    break;
+  case MFRC630_ERROR_EEPROM:
+    ERROR_PRINTLN(F("EEPROM access!"));
+    break;
+  default:
+    ERROR_PRINT(F("Unhandled error code: "));
+    ERROR_PRINTLN(err, HEX);
+    break;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Plays back a compiled register script from flash
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::writeScript(const uint8_t *script) {
+  uint8_t buf[MFRC630_I2C_CHUNK_LEN];
+
+  for (;;) {
+    byte reg = pgm_read_byte(script++);
+    uint8_t count = pgm_read_byte(script++);
+    if (!count) {
+      break;
+    }
+    /* Copy the run out of flash, one bus-sized chunk at a time */
+    while (count) {
+      uint8_t chunk = (count > sizeof(buf)) ? sizeof(buf) : count;
+      for (uint8_t i = 0; i < chunk; i++) {
+        buf[i] = pgm_read_byte(script++);
+      }
+      writeBuffer(reg, chunk, buf);
+      reg += chunk;
+      count -= chunk;
+    }
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Configures the radio for the specified protocol
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::configRadio(mfrc630radiocfg cfg) {
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Configuring the radio for "));
+
+  /* The antenna block includes the CRC and TX framing registers */
+  _framecfg_valid = false;
+
+  switch (cfg) {
+  case MFRC630_RADIOCFG_ISO1443A_106:
+    DEBUG_PRINTLN(F("ISO1443A-106"));
+    /*
+     * Antenna table plus driver mode, transmitter amplifier (residual
+     * carrier %), driver configuration and transmitter (overshoot/TX load)
+     * settings, all in one burst.
+     */
+    writeScript(script_iso14443a_106.bytes);
+    break;
+  case MFRC630_RADIOCFG_ISO1443A_212:
+    DEBUG_PRINTLN(F("ISO1443A-212"));
+    writeBuffer(MFRC630_REG_DRV_MOD, sizeof(antcfg_iso14443a_212),
+                antcfg_iso14443a_212);
+    break;
+  case MFRC630_RADIOCFG_ISO1443A_424:
+    DEBUG_PRINTLN(F("ISO1443A-424"));
+    writeBuffer(MFRC630_REG_DRV_MOD, sizeof(antcfg_iso14443a_424),
+                antcfg_iso14443a_424);
+    break;
+  case MFRC630_RADIOCFG_ISO1443A_848:
+    DEBUG_PRINTLN(F("ISO1443A-848"));
+    writeBuffer(MFRC630_REG_DRV_MOD, sizeof(antcfg_iso14443a_848),
+                antcfg_iso14443a_848);
+    break;
+  default:
+    DEBUG_PRINTLN(F("[UNKNOWN!]"));
+    return false;
+    break;
+  }
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Loads a TX/RX register set from the EEPROM RSP area, falling
+            back to the antenna tables in flash
+
+    @returns True if either the EEPROM or the fallback provided the profile.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::loadProtocol(enum mfrc630protocol rx,
+                                    enum mfrc630protocol tx) {
+  static uint8_t *const antcfg[] = {antcfg_iso14443a_106, antcfg_iso14443a_212,
+                                    antcfg_iso14443a_424, antcfg_iso14443a_848};
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Loading protocol RX="));
+  DEBUG_PRINT(rx);
+  DEBUG_PRINT(F(" TX="));
+  DEBUG_PRINTLN(tx);
+
+  /* One short command instead of rewriting the antenna block */
+  uint8_t params[2] = {(uint8_t)rx, (uint8_t)tx};
+  if (!runCommand(MFRC630_CMD_LOADPROTOCOL, params, sizeof(params), NULL,
+                  0)) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("LOADPROTOCOL failed, uploading the antenna table"));
+
+    if ((rx > MFRC630_PROTO_ISO14443A_848) ||
+        (tx > MFRC630_PROTO_ISO14443A_848)) {
+      return false;
+    }
+
+    /*
+     * 0x28..0x33 are the transmitter settings and 0x34..0x39 the receiver
+     * settings, so mixed TX/RX profiles take one burst from each table.
+     */
+    _framecfg_valid = false;
+    if (rx == tx) {
+      writeBuffer(MFRC630_REG_DRV_MOD, 18, antcfg[tx]);
+    } else {
+      writeBuffer(MFRC630_REG_DRV_MOD, 12, antcfg[tx]);
+      writeBuffer(MFRC630_REG_RX_SOFD, 6, antcfg[rx] + 12);
+    }
+  }
+
+  /* Both load the plain NXP settings, as configRadio() does above 106 */
+  if (tx == MFRC630_PROTO_ISO14443A_106) {
+    writeScript(script_tx106_driver.bytes);
+  }
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Loads registers from a register set stored in EEPROM section 2
+
+    @returns True if the registers were loaded, otherwise false.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::loadRegisters(uint16_t addr, uint8_t reg,
+                                     uint8_t count) {
+  /* LOADREG only accepts addresses in the user area */
+  if ((addr < MFRC630_EEPROM_USER_START) ||
+      (addr >= MFRC630_EEPROM_WRITE_END) ||
+      (count > MFRC630_EEPROM_WRITE_END - addr)) {
+    return false;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Loading "));
+  DEBUG_PRINT(count);
+  DEBUG_PRINT(F(" register(s) from EEPROM @ "));
+  DEBUG_PRINTLN(addr);
+
+  uint8_t params[4] = {(uint8_t)(addr >> 8), (uint8_t)(addr & 0xFF), reg,
+                       count};
+  return runCommand(MFRC630_CMD_LOADREG, params, sizeof(params), NULL, 0);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Writes up to three contiguous frame configuration registers in a
+            single burst, or nothing if transceive() already set them
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::writeFrameRegs(byte reg, uint8_t len, uint8_t *values,
+                                      uint8_t *cached) {
+  if (_framecfg_valid && !memcmp(values, cached, len)) {
+    return;
+  }
+  writeBuffer(reg, len, values);
+  memcpy(cached, values, len);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets up the framing registers, loads the FIFO and starts the
+            command described by 'frame', without waiting for it
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::frameStart(struct mfrc630_frame *frame) {
+  uint8_t regs[6];
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Transceive: CMD 0x"));
+  DEBUG_PRINT(frame->command, HEX);
+  DEBUG_PRINT(F(", "));
+  DEBUG_PRINT(frame->txlen);
+  DEBUG_PRINTLN(F(" byte(s)"));
+
+  /* Cancel any current command and flush the FIFO. */
+  if (!_cmd_idle) {
+    write8(MFRC630_REG_COMMAND, MFRC630_CMD_IDLE);
+  }
+  clearFIFO();
+
+  /* Framing registers, each group only written if it changed. */
+  frameRegs(frame, regs);
+  writeFrameRegs(MFRC630_REG_TX_CRC_PRESET, 3, regs, _framecfg.crc);
+  writeFrameRegs(MFRC630_REG_RX_BIT_CTRL, 1, &regs[3], &_framecfg.rxbitctrl);
+  writeFrameRegs(MFRC630_REG_IRQOEN, 2, &regs[4], _framecfg.irqen);
+
+  /*
+   * Frame wait timeout using T0 @ 211.875kHz (1 'tick' = 4.72us), started at
+   * the end of TX and stopped as soon as a response starts (T0StopRx), so
+   * long responses aren't cut short. T0_CONTROL..T0_COUNTER_VAL_LO
+   * (0x0F..0x13) are written in a single burst the first time. After that
+   * only the reload value changes, which Timer0 loads when it starts.
+   */
+  uint16_t timeout = (frame->timeout_class != MFRC630_TIMEOUT_FIXED)
+                         ? frameTimeout(frame->timeout_class)
+                         : frame->timeout;
+  uint8_t timer[5] = {0b10010001, (uint8_t)(timeout >> 8),
+                      (uint8_t)(timeout & 0xFF), (uint8_t)(timeout >> 8),
+                      (uint8_t)(timeout & 0xFF)};
+  if (!_framecfg_valid) {
+    writeBuffer(MFRC630_REG_T0_CONTROL, sizeof(timer), timer);
+  } else if (_framecfg.timeout != timeout) {
+    writeBuffer(MFRC630_REG_T0_RELOAD_HI, 2, &timer[1]);
+  }
+  _framecfg.timeout = timeout;
+  _framecfg_valid = true;
+
+  /* Clear the interrupts (IRQ0 and IRQ1 in one burst). */
+  writeScript(script_clear_irqs.bytes);
+
+  /*
+   * Frames that don't fit in the FIFO are streamed: the TX data goes in
+   * one FIFO-full at a time and the response is drained while it arrives.
+   */
+  bool stream = (frame->txlen > _fifosize) ||
+                (frame->rx && (frame->rxlen > _fifosize));
+  uint16_t sent = (frame->txlen > _fifosize) ? _fifosize : frame->txlen;
+  if (stream) {
+    write8(MFRC630_REG_WATER_LEVEL, MFRC630_FIFO_WATER_LEVEL);
+  }
+
+  /* Load the frame into the FIFO and start the command. */
+  if (sent) {
+    writeFIFO(sent, frame->tx);
+  }
+  write8(MFRC630_REG_COMMAND, frame->command);
+  invalidateCaches(frame->command);
+
+  frameLaunch(frame, timeout, sent, stream);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Works out the framing registers for 'frame': TX_CRC_PRESET,
+            RX_CRC_CON, TX_DATA_NUM, RX_BIT_CTRL, IRQOEN and IRQ1EN
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::frameRegs(struct mfrc630_frame *frame, uint8_t *regs) {
+  /* CRC and TX framing (0x2C..0x2E). */
+  regs[0] = 0x18 | (frame->txcrc ? 1 : 0);
+  regs[1] = 0x18 | (frame->rxcrc ? 1 : 0);
+  regs[2] = (frame->txlastbits & 0x07) | (1 << 3);
+
+  /* RX alignment for bit-oriented anticollision frames. */
+  regs[3] = (0 << 7) | ((frame->rxalign & 0x07) << 4);
+
+  /* IRQ sources propagated to GlobalIRQ (0x08..0x09). */
+  regs[4] = frame->irq0en | MFRC630IRQ0_ERRIRQ;
+  regs[5] = MFRC630IRQ1_TIMER0IRQ | _irqpin_en;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Clears the IRQs of the last frame and, if 'timeout' changed,
+            reloads Timer0 for the next one
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::frameRearm(uint16_t timeout) {
+  writeScript(script_clear_irqs.bytes);
+  if (_framecfg.timeout != timeout) {
+    uint8_t reload[2] = {(uint8_t)(timeout >> 8), (uint8_t)(timeout & 0xFF)};
+    writeBuffer(MFRC630_REG_T0_RELOAD_HI, sizeof(reload), reload);
+    _framecfg.timeout = timeout;
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends 'frame' on the framing the last frame left set up, for
+            the Mifare frames of a card (the auth and READs of a sector all
+            share it): reloads the FIFO and restarts the command. Falls back
+            to frameStart() if that isn't enough.
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::frameRestart(struct mfrc630_frame *frame) {
+  uint16_t timeout = (frame->timeout_class != MFRC630_TIMEOUT_FIXED)
+                         ? frameTimeout(frame->timeout_class)
+                         : frame->timeout;
+  uint8_t regs[6];
+
+  /* The last frame has to be over and have left the framing as needed */
+  frameRegs(frame, regs);
+  if (!_cmd_idle || !_framecfg_valid || memcmp(regs, _framecfg.crc, 3) ||
+      (regs[3] != _framecfg.rxbitctrl) ||
+      memcmp(&regs[4], _framecfg.irqen, 2) || (frame->txlen > _fifosize) ||
+      (frame->rx && (frame->rxlen > _fifosize))) {
+    frameStart(frame);
+    return;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Transceive again: CMD 0x"));
+  DEBUG_PRINTLN(frame->command, HEX);
+
+  /* Only flush the FIFO if the last frame didn't leave it empty */
+  if (!_xfer.emptied) {
+    clearFIFO();
+  }
+  uint32_t start = micros();
+  writeFIFO(frame->txlen, frame->tx);
+
+  /*
+   * If the bus is fast enough, the IRQs are cleared and Timer0 reloaded
+   * while the frame goes out: that is over long before TX ends, which is
+   * when Timer0 starts, and before the response could end the frame.
+   * Otherwise they are done first, as usual.
+   */
+  bool late = (micros() - start) <
+              (uint32_t)MFRC630_RESTART_LATE_BYTE_US * (frame->txlen + 1);
+  if (!late) {
+    frameRearm(timeout);
+  }
+  write8(MFRC630_REG_COMMAND, frame->command);
+  if (late) {
+    frameRearm(timeout);
+  }
+
+  frameLaunch(frame, timeout, frame->txlen, false);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Tracks 'frame' as the one on air, just after its command was
+            started
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::frameLaunch(struct mfrc630_frame *frame,
+                                   uint16_t timeout, uint16_t sent,
+                                   bool stream) {
+  _xfer.active = true;
+  _xfer.stream = stream;
+  _xfer.drain = frame->drain && frame->rx && (frame->rxlen < 256) &&
+                !stream && (_irq == -1);
+  _xfer.frame = frame;
+  _xfer.sent = sent;
+  _xfer.received = 0;
+  _xfer.pending = 0;
+  _xfer.emptied = false;
+  _xfer.irq0 = 0;
+  _xfer.irq1 = 0;
+  _xfer.timedout = false;
+  _xfer.start = millis();
+  _xfer.deadline =
+      (uint32_t)timeout * 472 / 100000 + 1 + MFRC630_FRAME_MARGIN_MS;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Stops the command started by frameStart() and collects its
+            status and response
+
+    @returns True if the command completed before the Timer0 timeout
+             without raising the error IRQ.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::frameFinish(struct mfrc630_frame_result *result) {
+  struct mfrc630_frame *frame = _xfer.frame;
+  uint16_t received = _xfer.received;
+
+  _xfer.active = false;
+  result->irq1 = _xfer.irq1;
+
+  /* A frame given up on by frameDone() counts as a Timer0 timeout */
+  if (_xfer.timedout) {
+    result->irq1 |= MFRC630IRQ1_TIMER0IRQ;
+  }
+
+  /*
+   * Cancel the current command (in case we timed out or error occurred),
+   * unless the IRQs polled by frameDone() show it already ended.
+   */
+  bool ended = _xfer.irq0 & MFRC630IRQ0_IDLEIRQ;
+  if (!ended) {
+    write8(MFRC630_REG_COMMAND, MFRC630_CMD_IDLE);
+  }
+  _cmd_idle = true;
+
+  /*
+   * Collect IRQ0..RX_COLL (0x06..0x0D) in a single burst. If IRQ0 was
+   * polled after the end, ERROR..STATUS (0x0A..0x0B) will do, plus RX_COLL
+   * if there was a response. A drained frame that ended without an error
+   * needs none of it.
+   */
+  uint8_t status[8] = {0};
+  uint8_t *error = &status[MFRC630_REG_ERROR - MFRC630_REG_IRQ0];
+  if (!ended) {
+    readBuffer(MFRC630_REG_IRQ0, sizeof(status), status);
+  } else if (!_xfer.drain || (_xfer.irq0 & MFRC630IRQ0_ERRIRQ)) {
+    readBuffer(MFRC630_REG_ERROR, frame->rx ? 4 : 2, error);
+  }
+  result->irq0 = ended ? _xfer.irq0 : status[0];
+  result->error = status[MFRC630_REG_ERROR - MFRC630_REG_IRQ0];
+  result->status = status[MFRC630_REG_STATUS - MFRC630_REG_IRQ0];
+  result->coll = status[MFRC630_REG_RX_COLL - MFRC630_REG_IRQ0];
+
+  /*
+   * Read the (rest of the) response, if one is expected. Once the command
+   * ended the FIFO length is final, so a drained frame pops what its last
+   * look found along with one more look, which also shows anything that
+   * came in since. That leaves the FIFO empty, see frameRestart().
+   */
+  if (frame->rx && ended && _xfer.drain) {
+    frameDrain();
+    received = _xfer.received;
+    readFrameData(frame, _xfer.pending, &received);
+    _xfer.emptied = true;
+  } else if (frame->rx) {
+    int16_t fifolen = readFIFOLen();
+    uint16_t left = (fifolen > 0) ? fifolen : 0;
+    uint16_t room = (frame->rxlen > received) ? (frame->rxlen - received) : 0;
+    readFIFO((left < room) ? left : room, frame->rx + received);
+    received += left;
+  } else if (ended && !(_xfer.irq0 & MFRC630IRQ0_ERRIRQ) &&
+             (frame->command == MFRC630_CMD_MFAUTHENT)) {
+    /* MFAuthent takes its parameters out of the FIFO and puts nothing in */
+    _xfer.emptied = true;
+  }
+  result->rxlen = received;
+  TRACE_LOG(MFRC630_TRACE_FRAME, frame->command, result->error, received);
+
+  /* Classify the outcome for getStatus() and the retry policy */
+  if ((result->irq0 & MFRC630IRQ0_ERRIRQ) && result->error) {
+    if (result->error & MFRC630_ERROR_COLLDET) {
+      _status = MFRC630_STATUS_COLLISION;
+    } else if (result->error & MFRC630_ERROR_INTEG) {
+      _status = MFRC630_STATUS_INTEGRITY;
+    } else if (result->error & (MFRC630_ERROR_PROT | MFRC630_ERROR_MINFRAME)) {
+      _status = MFRC630_STATUS_PROTOCOL;
+    } else {
+      _status = MFRC630_STATUS_IC;
+    }
+  } else if (result->irq1 & MFRC630IRQ1_TIMER0IRQ) {
+    _status = MFRC630_STATUS_TIMEOUT;
+  } else {
+    _status = MFRC630_STATUS_OK;
+  }
+
+  /*
+   * Time the first responses of the card to reads and writes. Timer0 stops
+   * when the response starts, so the ticks it counted down are the card's
+   * response delay. A timeout drops what was learned, as the card may just
+   * have been slower than usual.
+   */
+  enum mfrc630_timeout_class cls = frame->timeout_class;
+  if ((cls == MFRC630_TIMEOUT_READ) || (cls == MFRC630_TIMEOUT_WRITE)) {
+    if (_status == MFRC630_STATUS_TIMEOUT) {
+      _tmo[cls].longest = 0;
+      _tmo[cls].samples = 0;
+    } else if ((_status == MFRC630_STATUS_OK) &&
+               (_tmo[cls].samples < MFRC630_TIMEOUT_SAMPLES)) {
+      uint8_t counter[2];
+      readBuffer(MFRC630_REG_T0_COUNTER_VAL_HI, sizeof(counter), counter);
+      uint16_t delay = _framecfg.timeout - ((counter[0] << 8) | counter[1]);
+      if (delay > _tmo[cls].longest) {
+        _tmo[cls].longest = delay;
+      }
+      _tmo[cls].samples++;
+    }
+  }
+
+  return !(result->irq1 & MFRC630IRQ1_TIMER0IRQ) &&
+         !(result->irq0 & MFRC630IRQ0_ERRIRQ);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Runs a single command/response exchange described by 'frame'
+
+    @returns True if the command completed before the Timer0 timeout
+             without raising the error IRQ.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::transceive(struct mfrc630_frame *frame,
+                                  struct mfrc630_frame_result *result) {
+  /* A non-blocking operation owns the FIFO until it completes. */
+  if (_xfer.active) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("Transceive: another frame is in flight"));
+    memset(result, 0, sizeof(*result));
+    _status = MFRC630_STATUS_BUSY;
+    return false;
+  }
+
+  frameStart(frame);
+  while (!frameDone()) {
+    yield();
+  }
+
+  return frameFinish(result);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Claims the instance for a non-blocking operation
+
+    @returns False if another operation or frame is still in flight.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::opBegin(enum mfrc630_op op, mfrc630_callback cb,
+                               void *arg) {
+  if ((_op.op != MFRC630_OP_NONE) || _xfer.active) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("Another operation is in flight"));
+    _status = MFRC630_STATUS_BUSY;
+    return false;
+  }
+
+  _op.op = op;
+  _op.retries = 0;
+  _op.state = MFRC630_STATE_START;
+  _op.result = 0;
+  _op.cb = cb;
+  _op.arg = arg;
+  memset(&_op.frame, 0, sizeof(_op.frame));
+  PERF_BEGIN((enum mfrc630_perf_op)(op - MFRC630_OP_SELECT));
+  TRACE_LOG(MFRC630_TRACE_OP_START, op, 0, 0);
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Runs the next step of the operation in flight, which either
+            starts its next frame or completes it
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::opStep(void) {
+  switch (_op.op) {
+  case MFRC630_OP_SELECT:
+    selectStep();
     break;
-  case MFRC630_ERROR_FIFOOVL:
-    ERROR_PRINTLN(F("FIFO full!"));
+  case MFRC630_OP_AUTH:
+    mifareAuthStep();
     break;
-  case MFRC630_ERROR_FIFOWR:
-    ERROR_PRINTLN(F("Couldn't write to FIFO!"));
+  case MFRC630_OP_READ:
+    mifareReadStep();
     break;
-  case MFRC630_ERROR_EEPROM:
-    ERROR_PRINTLN(F("EEPROM access!"));
+  case MFRC630_OP_WRITE:
+    mifareWriteStep();
     break;
   default:
-    ERROR_PRINT(F("Unhandled error code: "));
-    ERROR_PRINTLN(err, HEX);
     break;
   }
+}
+
+/**************************************************************************/
+/*!
+    @brief  Ends the operation in flight and calls its callback, which may
+            start the next one
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::opComplete(uint16_t result) {
+  enum mfrc630_op op = _op.op;
+
+  if ((_status != MFRC630_STATUS_OK) && opRetry()) {
+    return;
+  }
 
-  /* Halt execution here if we're not in release mode! */
-#if MFRC630_VERBOSITY > MFRC630_VERBOSITY_RELEASE
-  while (1) {
-    delay(1);
+  _op.op = MFRC630_OP_NONE;
+  _op.result = result;
+  PERF_END();
+  TRACE_LOG(MFRC630_TRACE_OP_DONE, op, 0, result);
+  if (_op.cb) {
+    _op.cb(op, result, _op.arg);
   }
-#endif
 }
 
 /**************************************************************************/
 /*!
-    @brief  Configures the radio for the specified protocol
+    @brief  Re-sends the current frame of the operation in flight if its
+            retry policy covers the status it failed with
+
+    @returns True if the frame was re-sent.
 */
 /**************************************************************************/
-bool Adafruit_MFRC630::configRadio(mfrc630radiocfg cfg) {
+bool Adafruit_MFRC630::opRetry(void) {
+  uint8_t i = _op.op - MFRC630_OP_SELECT;
+
+  if ((_op.retries >= _retry[i].retries) ||
+      !(_retry[i].mask & MFRC630_STATUS_MASK(_status))) {
+    return false;
+  }
+
   DEBUG_TIMESTAMP();
-  DEBUG_PRINT(F("Configuring the radio for "));
+  DEBUG_PRINT(F("Retrying frame, status "));
+  DEBUG_PRINTLN(_status);
+  _op.retries++;
+  frameStart(&_op.frame);
 
-  switch (cfg) {
-  case MFRC630_RADIOCFG_ISO1443A_106:
-    DEBUG_PRINTLN(F("ISO1443A-106"));
-    writeBuffer(MFRC630_REG_DRV_MOD, sizeof(antcfg_iso14443a_106),
-                antcfg_iso14443a_106);
+  return true;
+}
 
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("Setting driver mode"));
-    write8(MFRC630_REG_DRV_MOD, 0x8E); /* Driver mode register */
+/**************************************************************************/
+/*!
+    @brief  Drives the operation just started to completion, for the
+            blocking calls
 
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("Setting transmitter amplifier (residual carrier %)"));
-    write8(MFRC630_REG_TX_AMP, 0x12); /* Transmiter amplifier register */
+    @returns The result of the operation.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::opRun(void) {
+  while (poll()) {
+    yield();
+  }
 
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("Setting driver configuration"));
-    write8(MFRC630_REG_DRV_CON, 0x39); /* Driver configuration register */
+  return _op.result;
+}
 
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("Configuring transmitter (overshoot/TX load)"));
-    write8(MFRC630_REG_TXL, 0x06); /* Transmitter register */
-    break;
-  default:
-    DEBUG_PRINTLN(F("[UNKNOWN!]"));
+/**************************************************************************/
+/*!
+    @brief  Moves the operation in flight forward without blocking
+
+    @returns True while an operation is still in flight.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::poll(void) {
+  if (_op.op == MFRC630_OP_NONE) {
+    return false;
+  }
+  if (!frameDone()) {
+    return true;
+  }
+
+  frameFinish(&_op.res);
+  opStep();
+
+  return _op.op != MFRC630_OP_NONE;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks if a non-blocking operation is in flight
+
+    @returns True while an operation is in flight.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::busy(void) { return _op.op != MFRC630_OP_NONE; }
+
+/**************************************************************************/
+/*!
+    @brief  Returns the result of the last completed operation
+
+    @returns The value the blocking call would have returned.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::getResult(void) { return _op.result; }
+
+/**************************************************************************/
+/*!
+    @brief  Returns the outcome of the last frame or operation
+
+    @returns The status code.
+*/
+/**************************************************************************/
+enum mfrc630_status_code Adafruit_MFRC630::getStatus(void) { return _status; }
+
+/**************************************************************************/
+/*!
+    @brief  Sets the retry policy of one operation type
+
+    @param  op      The operation type.
+    @param  retries The number of re-sends per operation, 0 to disable.
+    @param  mask    MFRC630_STATUS_MASK() bits of the codes to retry on.
+
+    @returns False if 'op' is not a valid operation type.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::setRetryPolicy(enum mfrc630_op op, uint8_t retries,
+                                      uint16_t mask) {
+  if ((op < MFRC630_OP_SELECT) || (op > MFRC630_OP_WRITE)) {
+    return false;
+  }
+
+  _retry[op - MFRC630_OP_SELECT].retries = retries;
+  _retry[op - MFRC630_OP_SELECT].mask = mask;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Overrides the frame wait timeout of one class of card frames
+
+    @param  cls     The frame class.
+    @param  us      The timeout in microseconds, 0 for the computed one.
+
+    @returns False if 'cls' is not a computed frame class.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::setFrameTimeout(enum mfrc630_timeout_class cls,
+                                       uint32_t us) {
+  if ((cls <= MFRC630_TIMEOUT_FIXED) || (cls >= MFRC630_TIMEOUT_CLASS_COUNT)) {
     return false;
-    break;
   }
 
+  uint32_t ticks = MFRC630_US_TO_TICKS(us);
+  if (us && !ticks) {
+    ticks = 1;
+  }
+  _tmo[cls].override = (ticks > 0xFFFF) ? 0xFFFF : ticks;
   return true;
 }
 
+/**************************************************************************/
+/*!
+    @brief  Returns the frame wait timeout of one class of card frames
+
+    @param  cls     The frame class.
+
+    @returns The timeout in microseconds, 0 if 'cls' is not valid.
+*/
+/**************************************************************************/
+uint32_t Adafruit_MFRC630::getFrameTimeout(enum mfrc630_timeout_class cls) {
+  if ((cls <= MFRC630_TIMEOUT_FIXED) || (cls >= MFRC630_TIMEOUT_CLASS_COUNT)) {
+    return 0;
+  }
+
+  return MFRC630_TICKS_TO_US(frameTimeout(cls));
+}
+
+/**************************************************************************/
+/*!
+    @brief  Computes the Timer0 reload for a frame of class 'cls': the
+            caller's override, else twice the longest response delay timed
+            on the card plus a margin once enough were timed, else the
+            default (whichever is shorter)
+
+    @returns The frame wait timeout in Timer0 ticks.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::frameTimeout(enum mfrc630_timeout_class cls) {
+  if (_tmo[cls].override) {
+    return _tmo[cls].override;
+  }
+
+  uint16_t ticks = pgm_read_word(&timeout_default[cls]);
+  if (_tmo[cls].samples >= MFRC630_TIMEOUT_SAMPLES) {
+    uint32_t learned = 2UL * _tmo[cls].longest +
+                       MFRC630_US_TO_TICKS(MFRC630_TIMEOUT_MARGIN_US);
+    if (learned < ticks) {
+      ticks = learned;
+    }
+  }
+
+  return ticks;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Forgets the response delays timed so far when a different card
+            than the one they were timed on gets selected
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::frameTimeoutCard(uint8_t *uid, uint8_t uidlen) {
+  if ((uidlen == _tmo_uidlen) && !memcmp(uid, _tmo_uid, uidlen)) {
+    return;
+  }
+
+  for (uint8_t i = 0; i < MFRC630_TIMEOUT_CLASS_COUNT; i++) {
+    _tmo[i].longest = 0;
+    _tmo[i].samples = 0;
+  }
+  memcpy(_tmo_uid, uid, uidlen);
+  _tmo_uidlen = uidlen;
+}
+
 uint16_t Adafruit_MFRC630::iso14443aRequest(void) {
   return iso14443aCommand(ISO14443_CMD_REQA);
 }
@@ -679,95 +2751,48 @@ uint16_t Adafruit_MFRC630::iso14443aWakeup(void) {
 uint16_t Adafruit_MFRC630::iso14443aCommand(enum iso14443_cmd cmd) {
   uint16_t atqa = 0; /* Answer to request (2 bytes). */
 
+  /* A new activation may well be a different card */
+  _ntagcache_valid = false;
+  _isodep.active = false;
+
   DEBUG_TIMESTAMP();
   DEBUG_PRINTLN(F("Checking for an ISO14443A tag"));
 
-  /* Cancel any current command */
-  writeCommand(MFRC630_CMD_IDLE);
-
-  /* Flush the FIFO */
-  clearFIFO();
-
   /*
-   * Define the number of bits from the last byte should be sent. 000 means
-   * that all bits of the last data byte are sent, 1..7 causes the specified
-   * number of bits to be sent. Also set the DataEn bit to enable data xfer.
+   * REQA/WUPA are 7-bit short frames without CRC. The frame wait timeout
+   * is the activation class (MFRC630_TIMEOUT_ACTIVATION_US).
    */
-  write8(MFRC630_REG_TX_DATA_NUM, 0x07 | (1 << 3));
-
-  /* Disable CRC. */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("A. Disabling CRC checks."));
-  write8(MFRC630_REG_TX_CRC_PRESET, 0x18);
-  write8(MFRC630_REG_RX_CRC_CON, 0x18);
-
-  /* Clear the receiver control register. */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("B. Clearing the receiver control register."));
-  write8(MFRC630_REG_RX_BIT_CTRL, 0);
-
-  /* Clear the interrupts. */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("C. Clearing and configuring interrupts."));
-  write8(MFRC630_REG_IRQ0, 0b01111111);
-  write8(MFRC630_REG_IRQ1, 0b00111111);
-  /* Allow the receiver and Error IRQs to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQOEN, MFRC630IRQ0_RXIRQ | MFRC630IRQ0_ERRIRQ);
-  /* Allow Timer0 IRQ to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQ1EN, MFRC630IRQ1_TIMER0IRQ);
-
-  /* Configure the frame wait timeout using T0 (5ms max). */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("D. Configuring Timer0 @ 211.875kHz, post TX, 5ms timeout."));
-  write8(MFRC630_REG_T0_CONTROL, 0b10001);
-  write8(MFRC630_REG_T0_RELOAD_HI, 1100 >> 8);
-  write8(MFRC630_REG_TO_RELOAD_LO, 0xFF);
-  write8(MFRC630_REG_T0_COUNTER_VAL_HI, 1100 >> 8);
-  write8(MFRC630_REG_T0_COUNTER_VAL_LO, 0xFF);
-
-  /* Send the ISO14443 command. */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("E. Sending ISO14443 command."));
-  uint8_t send_req[] = {(uint8_t)cmd};
-  writeCommand(MFRC630_CMD_TRANSCEIVE, 1, send_req);
-
-  /* Wait here until we're done reading, get an error, or timeout. */
-  /* TODO: Update to use timeout parameter! */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("F. Waiting for a response or timeout."));
-  uint8_t irqval = 0;
-  while (!(irqval & MFRC630IRQ1_TIMER0IRQ)) {
-    irqval = read8(MFRC630_REG_IRQ1);
-    /* Check for a global interrrupt, which can only be ERR or RX. */
-    if (irqval & MFRC630IRQ1_GLOBALIRQ) {
-      break;
-    }
-  }
+  uint8_t send_req[] = {(uint8_t)cmd};
+  struct mfrc630_frame frame = {};
+  frame.command = MFRC630_CMD_TRANSCEIVE;
+  frame.tx = send_req;
+  frame.txlen = sizeof(send_req);
+  frame.txlastbits = 7;
+  frame.irq0en = MFRC630IRQ0_RXIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.timeout_class = MFRC630_TIMEOUT_ACTIVATION;
+  frame.rx = (uint8_t *)&atqa;
+  frame.rxlen = sizeof(atqa);
+  struct mfrc630_frame_result res;
 
-  /* Cancel the current command (in case we timed out or error occurred). */
-  writeCommand(MFRC630_CMD_IDLE);
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Sending ISO14443 command."));
+  transceive(&frame, &res);
 
   /* Check the RX IRQ, and exit appropriately if it has fired (error). */
-  irqval = read8(MFRC630_REG_IRQ0);
-  if ((!(irqval & MFRC630IRQ0_RXIRQ) || (irqval & MFRC630IRQ0_ERRIRQ))) {
+  if ((!(res.irq0 & MFRC630IRQ0_RXIRQ) || (res.irq0 & MFRC630IRQ0_ERRIRQ))) {
     DEBUG_TIMESTAMP();
     DEBUG_PRINTLN(F("ERROR: No RX flag set, transceive failed or timed out."));
     /* Display the error message if ERROR IRQ is set. */
-    if (irqval & MFRC630IRQ0_ERRIRQ) {
-      uint8_t error = read8(MFRC630_REG_ERROR);
+    if (res.irq0 & MFRC630IRQ0_ERRIRQ) {
       /* Only display the error if it isn't a timeout. */
-      if (error) {
-        printError((enum mfrc630errors)error);
+      if (res.error) {
+        printError((enum mfrc630errors)res.error);
       }
     }
     return 0;
   }
 
-  /* Read the response */
-  uint16_t rxlen = readFIFOLen();
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("G. Reading response from FIFO buffer."));
-  if (rxlen == 2) {
+  if (res.rxlen == 2) {
     /*
      * If we have 2 bytes for the response, it's the ATQA.
      *
@@ -779,7 +2804,6 @@ uint16_t Adafruit_MFRC630::iso14443aCommand(enum iso14443_cmd cmd) {
      * 0x44 = 4 bit frame anticollision
      *        UID size = double
      */
-    readFIFO(rxlen, (uint8_t *)&atqa);
     DEBUG_TIMESTAMP();
     DEBUG_PRINT(F("Received response (ATQA): 0x"));
     DEBUG_PRINTLN(atqa, HEX);
@@ -789,318 +2813,828 @@ uint16_t Adafruit_MFRC630::iso14443aCommand(enum iso14443_cmd cmd) {
   return 0;
 }
 
-/*
- * For high level details on the selection and anti-collision protocols see
- * "Chip Type Identification Procedure" in
- * https://www.nxp.com/docs/en/application-note/AN10833.pdf
- */
 uint8_t Adafruit_MFRC630::iso14443aSelect(uint8_t *uid, uint8_t *sak) {
-  (void)sak;
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("Selecting an ISO14443A tag"));
+  return startSelect(uid, sak) ? opRun() : 0;
+}
 
-  /* Cancel any current command */
-  writeCommand(MFRC630_CMD_IDLE);
+bool Adafruit_MFRC630::startSelect(uint8_t *uid, uint8_t *sak,
+                                   mfrc630_callback cb, void *arg) {
+  if (!opBegin(MFRC630_OP_SELECT, cb, arg)) {
+    return false;
+  }
+  _op.buf = uid;
+  _op.sak = sak;
+  selectStep();
 
-  /* Flush the FIFO */
-  clearFIFO();
+  return true;
+}
 
-  /* Allow the receiver and Error IRQs to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQOEN, MFRC630IRQ0_RXIRQ | MFRC630IRQ0_ERRIRQ);
+/**************************************************************************/
+/*!
+    @brief  Sends the anticollision frame for the current cascade level,
+            with the UID bits known so far
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::selectAnticoll(void) {
+  selectAnticollFrame();
+  frameStart(&_op.frame);
+}
 
-  /* Allow Timer0 IRQ to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQ1EN, MFRC630IRQ1_TIMER0IRQ);
+/**************************************************************************/
+/*!
+    @brief  Sets up the anticollision frame for the current cascade level,
+            with the UID bits known so far, without sending it
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::selectAnticollFrame(void) {
+  uint8_t *uid_this_level = &_op.tx[2];
+  uint8_t kbits = _op.kbits;
 
-  /* Configure the frame wait timeout using T0 (5ms max). */
-  /* 1 'tick' 4.72us, so 1100 = 5.2ms */
   DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("A. Configuring Timer0 @ 211.875kHz, post TX, 5ms timeout."));
-  write8(MFRC630_REG_T0_CONTROL, 0b10001);
-  write8(MFRC630_REG_T0_RELOAD_HI, 1100 >> 8);
-  write8(MFRC630_REG_TO_RELOAD_LO, 0xFF);
-  write8(MFRC630_REG_T0_COUNTER_VAL_HI, 1100 >> 8);
-  write8(MFRC630_REG_T0_COUNTER_VAL_LO, 0xFF);
-
-  /* Set the cascade level (collision detection loop) */
+  DEBUG_PRINT(F("Attempt = "));
+  DEBUG_PRINT(_op.cnum);
+  DEBUG_PRINT(F(", known bits = "));
+  DEBUG_PRINT(kbits);
+  DEBUG_PRINT(F(" "));
+  printHex(uid_this_level, (kbits + 8 - 1) / 8);
+  DEBUG_PRINTLN("");
+
+  /* Send the current collision level command */
+  _op.tx[0] = cascade_sel[_op.cascadelvl - 1];
+  _op.tx[1] = 0x20 + kbits;
+
+  /*
+   * CRC is disabled, and MFRC630_REG_TX_DATA_NUM is limited to the
+   * correct number of bits. ValuesAfterColl is cleared so every received
+   * bit after a collision is replaced by a zero, as needed for ISO/IEC14443
+   * anticollision, and RxAlign shifts the received bits into place.
+   */
+  struct mfrc630_frame *frame = &_op.frame;
+  frame->tx = _op.tx;
+  frame->txlen = ((kbits + 8 - 1) / 8) + 2;
+  frame->txlastbits = kbits % 8;
+  frame->rxalign = kbits % 8;
+  frame->txcrc = false;
+  frame->rxcrc = false;
+  frame->rx = _op.rx; /* UID = 4 bytes + BCC */
+  frame->rxlen = sizeof(_op.rx);
+
+  _op.state = MFRC630_STATE_ANTICOLL;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks the BCC of the UID bits collected at the current cascade
+            level and sends the SELECT frame
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::selectSelect(void) {
+  uint8_t *uid_this_level = &_op.tx[2];
+
+  /* Check if the BCC matches ... */
   DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("B. Checking cascade level (collision detection)."));
-  uint8_t cascadelvl;
-  for (cascadelvl = 1; cascadelvl <= 3; cascadelvl++) {
-    uint8_t cmd;
-    uint8_t kbits = 0;                        /* Bits known in UID so far. */
-    uint8_t send_req[7] = {0};                /* TX buffer */
-    uint8_t *uid_this_level = &(send_req[2]); /* UID pointer */
-    uint8_t message_length;
+  DEBUG_PRINTLN(F("B. Checking BCC for data integrity."));
+  uint8_t bcc_val = uid_this_level[4];
+  uint8_t bcc_calc = uid_this_level[0] ^ uid_this_level[1] ^
+                     uid_this_level[2] ^ uid_this_level[3];
+  if (bcc_val != bcc_calc) {
+    DEBUG_PRINTLN(F("ERROR: BCC mistmatch!\n"));
+    /* A retry starts the cascade level over, with no known bits */
+    memset(_op.tx, 0, sizeof(_op.tx));
+    _op.kbits = 0;
+    _op.cnum = 0;
+    selectAnticollFrame();
+    _status = MFRC630_STATUS_INTEGRITY;
+    opComplete(0);
+    return;
+  }
 
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINT(F("Cascade level "));
-    DEBUG_PRINTLN(cascadelvl);
+  _op.tx[0] = cascade_sel[_op.cascadelvl - 1];
+  _op.tx[1] = 0x70;
+  _op.tx[6] = bcc_calc;
 
-    switch (cascadelvl) {
-    case 1:
-      cmd = ISO14443_CAS_LEVEL_1;
-      break;
-    case 2:
-      cmd = ISO14443_CAS_LEVEL_2;
-      break;
-    case 3:
-      cmd = ISO14443_CAS_LEVEL_3;
-      break;
-    }
+  /*
+   * Re-enable CRCs, and reset the TX and RX registers (disable alignment,
+   * transmit full bytes).
+   */
+  struct mfrc630_frame *frame = &_op.frame;
+  frame->tx = _op.tx;
+  frame->txlen = 7;
+  frame->txlastbits = _op.kbits % 8;
+  frame->rxalign = 0;
+  frame->txcrc = true;
+  frame->rxcrc = true;
+  frame->rx = _op.rx; /* SAK */
+  frame->rxlen = 1;
+
+  /* Send the command. */
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("C. Sending collision command"));
+  _op.state = MFRC630_STATE_SELECT;
+  frameStart(frame);
+}
+
+/*
+ * For high level details on the selection and anti-collision protocols see
+ * "Chip Type Identification Procedure" in
+ * https://www.nxp.com/docs/en/application-note/AN10833.pdf
+ */
+void Adafruit_MFRC630::selectStep(void) {
+  struct mfrc630_frame_result *res = &_op.res;
+  uint8_t *uid = _op.buf;
+  uint8_t *uid_this_level = &_op.tx[2];
 
-    /* Disable CRC. */
+  switch (_op.state) {
+  case MFRC630_STATE_START:
     DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("a. Disabling CRC checks."));
-    write8(MFRC630_REG_TX_CRC_PRESET, 0x18);
-    write8(MFRC630_REG_RX_CRC_CON, 0x18);
+    DEBUG_PRINTLN(F("Selecting an ISO14443A tag"));
 
-    /* As per ISO14443-3, limit coliision checks to 32 attempts. */
-    uint8_t cnum;
+    /*
+     * Every round uses RX/ERR as completion sources and the activation
+     * frame wait timeout (MFRC630_TIMEOUT_ACTIVATION_US).
+     */
+    _op.frame.command = MFRC630_CMD_TRANSCEIVE;
+    _op.frame.irq0en = MFRC630IRQ0_RXIRQ | MFRC630IRQ0_ERRIRQ;
+    _op.frame.timeout_class = MFRC630_TIMEOUT_ACTIVATION;
+
+    /* Set the cascade level (collision detection loop) */
     DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("b. Collision detection (max 32 attempts)."));
-    for (cnum = 0; cnum < 32; cnum++) {
-      DEBUG_TIMESTAMP();
-      DEBUG_PRINT(F("Attempt = "));
-      DEBUG_PRINT(cnum);
-      DEBUG_PRINT(F(", known bits = "));
-      DEBUG_PRINT(kbits);
-      DEBUG_PRINT(F(" "));
-      printHex(uid_this_level, (kbits + 8 - 1) / 8);
-      DEBUG_PRINTLN("");
-
-      /* Clear the interrupts. */
-      write8(MFRC630_REG_IRQ0, 0b01111111);
-      write8(MFRC630_REG_IRQ1, 0b00111111);
-
-      /* Send the current collision level command */
-      send_req[0] = cmd;
-      send_req[1] = 0x20 + kbits;
-
-      /* Limit MFRC630_REG_TX_DATA_NUM to the correct number of bits. */
-      write8(MFRC630_REG_TX_DATA_NUM, (kbits % 8) | (1 << 3));
-
-      // ValuesAfterColl: If cleared, every received bit after a collision is
-      // replaced by a zero. This function is needed for ISO/IEC14443
-      // anticollision (0<<7). We want to shift the bits with RxAlign
-      uint8_t rxalign = kbits % 8;
-      write8(MFRC630_REG_RX_BIT_CTRL, (0 << 7) | (rxalign << 4));
-
-      /* Determine the message length */
-      if ((kbits % 8) == 0) {
-        message_length = ((kbits / 8)) + 2;
-      } else {
-        message_length = ((kbits / 8) + 1) + 2;
-      }
+    DEBUG_PRINTLN(F("A. Checking cascade level (collision detection)."));
+    _op.cascadelvl = 1;
+    break;
 
-      /* Send the command. */
-      writeCommand(MFRC630_CMD_TRANSCEIVE, message_length, send_req);
-
-      /* Wait until the command execution is complete. */
-      uint8_t irq1_value = 0;
-      while (!(irq1_value & MFRC630IRQ1_TIMER0IRQ)) {
-        irq1_value = read8(MFRC630_REG_IRQ1);
-        /* Check for a global interrrupt, which can only be ERR or RX. */
-        if (irq1_value & MFRC630IRQ1_GLOBALIRQ) {
-          break;
-        }
-      }
+  case MFRC630_STATE_ANTICOLL: {
+    /* Parse results */
+    uint8_t coll_p = 0;
+
+    /* Check if an error occured */
+    if (res->irq0 & MFRC630IRQ0_ERRIRQ) {
+      /* Display the error code in human-readable format. */
+      printError((enum mfrc630errors)res->error);
+      if (res->error & MFRC630_ERROR_COLLDET) {
+        /* Collision error, check if the collision position is valid */
+        if (res->coll & (1 << 7)) {
+          /* Valid, so check the collision position (bottom 7 bits). */
+          coll_p = res->coll & (~(1 << 7));
+          DEBUG_TIMESTAMP();
+          DEBUG_PRINT(F("Bit collision detected at bit "));
+          DEBUG_PRINTLN(coll_p);
+
+          uint8_t choice_pos = _op.kbits + coll_p;
+          uint8_t selection =
+              (uid[((choice_pos + (_op.cascadelvl - 1) * 3) / 8)] >>
+               ((choice_pos) % 8)) &
+              1;
+          uid_this_level[((choice_pos) / 8)] |= selection
+                                                << ((choice_pos) % 8);
+          _op.kbits++;
 
-      /* Cancel any current command */
-      writeCommand(MFRC630_CMD_IDLE);
-
-      /* Parse results */
-      uint8_t irq0_value = read8(MFRC630_REG_IRQ0);
-      uint8_t error = read8(MFRC630_REG_ERROR);
-      uint8_t coll = read8(MFRC630_REG_RX_COLL);
-      uint8_t coll_p = 0;
-
-      /* Check if an error occured */
-      if (irq0_value & MFRC630IRQ0_ERRIRQ) {
-        /* Display the error code in human-readable format. */
-        printError((enum mfrc630errors)error);
-        if (error & MFRC630_ERROR_COLLDET) {
-          /* Collision error, check if the collision position is valid */
-          if (coll & (1 << 7)) {
-            /* Valid, so check the collision position (bottom 7 bits). */
-            coll_p = coll & (~(1 << 7));
-            DEBUG_TIMESTAMP();
-            DEBUG_PRINT(F("Bit collision detected at bit "));
-            DEBUG_PRINTLN(coll_p);
-
-            uint8_t choice_pos = kbits + coll_p;
-            uint8_t selection =
-                (uid[((choice_pos + (cascadelvl - 1) * 3) / 8)] >>
-                 ((choice_pos) % 8)) &
-                1;
-            uid_this_level[((choice_pos) / 8)] |= selection
-                                                  << ((choice_pos) % 8);
-            kbits++;
-
-            DEBUG_TIMESTAMP();
-            DEBUG_PRINT(F("'uid_this_level' is now "));
-            DEBUG_PRINT(kbits);
-            DEBUG_PRINT(F(": "));
-            printHex(uid_this_level, 10);
-            DEBUG_PRINTLN(F(""));
-          } else {
-            /* Invalid collision position (bit 7 = 0) */
-            DEBUG_TIMESTAMP();
-            DEBUG_PRINTLN(F("Bit collision detected, but no valid position."));
-            coll_p = 0x20 - kbits;
-          } /* End: if (coll & (1 << 7)) */
+          DEBUG_TIMESTAMP();
+          DEBUG_PRINT(F("'uid_this_level' is now "));
+          DEBUG_PRINT(_op.kbits);
+          DEBUG_PRINT(F(": "));
+          printHex(uid_this_level, 5);
+          DEBUG_PRINTLN(F(""));
         } else {
+          /* Invalid collision position (bit 7 = 0) */
           DEBUG_TIMESTAMP();
-          DEBUG_PRINTLN(F("Unhandled error."));
-          coll_p = 0x20 - kbits;
-        } /* End: if (error & MFRC630_ERROR_COLLDET) */
-      } else if (irq0_value & MFRC630IRQ0_RXIRQ) {
-        /* We have data and no collision, all is well in the world! */
-        coll_p = 0x20 - kbits;
-        DEBUG_TIMESTAMP();
-        DEBUG_PRINTLN(F("Received data, no bit collision!"));
+          DEBUG_PRINTLN(F("Bit collision detected, but no valid position."));
+          coll_p = 0x20 - _op.kbits;
+        } /* End: if (coll & (1 << 7)) */
       } else {
-        /* Probably no card */
         DEBUG_TIMESTAMP();
-        DEBUG_PRINTLN(F("No error and no data = No card"));
-        return 0;
-      } /* End: if (irq0_value & (1 << 1)) */
-
-      /* Read the UID so far */
-      uint16_t rxlen = readFIFOLen();
-      uint8_t buf[5]; /* UID = 4 bytes + BCC */
-      readFIFO(rxlen < 5 ? rxlen : 5, buf);
-
-      /*
-       * Move current buffer contents into the UID placeholder, OR'ing the
-       * results so that we don't lose the bit we set if you have a collision.
-       */
-      uint8_t rbx;
-      for (rbx = 0; (rbx < rxlen); rbx++) {
-        uid_this_level[(kbits / 8) + rbx] |= buf[rbx];
+        DEBUG_PRINTLN(F("Unhandled error."));
+        coll_p = 0x20 - _op.kbits;
+      } /* End: if (error & MFRC630_ERROR_COLLDET) */
+    } else if (res->irq0 & MFRC630IRQ0_RXIRQ) {
+      /* We have data and no collision, all is well in the world! */
+      coll_p = 0x20 - _op.kbits;
+      DEBUG_TIMESTAMP();
+      DEBUG_PRINTLN(F("Received data, no bit collision!"));
+    } else {
+      /* Probably no card */
+      DEBUG_TIMESTAMP();
+      DEBUG_PRINTLN(F("No error and no data = No card"));
+      if (_status == MFRC630_STATUS_OK) {
+        _status = MFRC630_STATUS_TIMEOUT;
       }
-      kbits += coll_p;
+      opComplete(0);
+      return;
+    } /* End: if (irq0_value & (1 << 1)) */
 
-      if ((kbits >= 32)) {
-        DEBUG_TIMESTAMP();
-        DEBUG_PRINT(F("Leaving collision loop: uid "));
-        DEBUG_PRINT(kbits);
-        DEBUG_PRINTLN(F(" bits long"));
-        DEBUG_TIMESTAMP();
-        printHex(uid_this_level, kbits / 8);
-        DEBUG_PRINTLN(F(""));
-        break; /* Exit the collision loop */
-      }
-    } /* End: for (cnum = 0; cnum < 32; cnum++) */
+    /*
+     * Move current buffer contents into the UID placeholder, OR'ing the
+     * results so that we don't lose the bit we set if you have a collision.
+     */
+    uint8_t rbx;
+    for (rbx = 0; (rbx < res->rxlen) && (rbx < sizeof(_op.rx)); rbx++) {
+      uid_this_level[(_op.kbits / 8) + rbx] |= _op.rx[rbx];
+    }
+    _op.kbits += coll_p;
 
-    /* Check if the BCC matches ... */
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("C. Checking BCC for data integrity."));
-    uint8_t bcc_val = uid_this_level[4];
-    uint8_t bcc_calc = uid_this_level[0] ^ uid_this_level[1] ^
-                       uid_this_level[2] ^ uid_this_level[3];
-    if (bcc_val != bcc_calc) {
-      DEBUG_PRINTLN(F("ERROR: BCC mistmatch!\n"));
-      return 0;
+    /* As per ISO14443-3, limit coliision checks to 32 attempts. */
+    if ((_op.kbits < 32) && (++_op.cnum < 32)) {
+      selectAnticoll();
+      return;
     }
 
-    /* Clear the interrupts. */
     DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("D. Clearing and configuring interrupts."));
-    write8(MFRC630_REG_IRQ0, 0b01111111);
-    write8(MFRC630_REG_IRQ1, 0b00111111);
-
-    send_req[0] = cmd;
-    send_req[1] = 0x70;
-    send_req[6] = bcc_calc;
-    message_length = 7;
-
-    /* Re-enable CRCs. */
-    write8(MFRC630_REG_TX_CRC_PRESET, 0x18 | 1);
-    write8(MFRC630_REG_RX_CRC_CON, 0x18 | 1);
-
-    /* Reset the TX and RX registers (disable alignment, transmit full bytes) */
-    write8(MFRC630_REG_TX_DATA_NUM, (kbits % 8) | (1 << 3));
-    uint8_t rxalign = 0;
-    write8(MFRC630_REG_RX_BIT_CTRL, (0 << 7) | (rxalign << 4));
-
-    /* Send the command. */
+    DEBUG_PRINT(F("Leaving collision loop: uid "));
+    DEBUG_PRINT(_op.kbits);
+    DEBUG_PRINTLN(F(" bits long"));
     DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("E. Sending collision command"));
-    writeCommand(MFRC630_CMD_TRANSCEIVE, message_length, send_req);
-
-    /* Wait until the command execution is complete. */
-    uint8_t irq1_value = 0;
-    while (!(irq1_value & MFRC630IRQ1_TIMER0IRQ)) {
-      irq1_value = read8(MFRC630_REG_IRQ1);
-      /* Check for a global interrrupt, which can only be ERR or RX. */
-      if (irq1_value & MFRC630IRQ1_GLOBALIRQ) {
-        break;
-      }
-    }
-    writeCommand(MFRC630_CMD_IDLE);
+    printHex(uid_this_level, _op.kbits / 8);
+    DEBUG_PRINTLN(F(""));
+    selectSelect();
+    return;
+  }
 
+  case MFRC630_STATE_SELECT: {
     /* Check the source of exiting the loop. */
     DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("F. Command complete, verifying proper exit."));
-    uint8_t irq0_value = read8(MFRC630_REG_IRQ0);
+    DEBUG_PRINTLN(F("D. Command complete, verifying proper exit."));
     /* Check the ERROR IRQ */
-    if (irq0_value & MFRC630IRQ0_ERRIRQ) {
+    if (res->irq0 & MFRC630IRQ0_ERRIRQ) {
       /* Check what kind of error. */
-      uint8_t error = read8(MFRC630_REG_ERROR);
-      if (error & MFRC630_ERROR_COLLDET) {
+      if (res->error & MFRC630_ERROR_COLLDET) {
         /* Collision detecttion. */
         printError(MFRC630_ERROR_COLLDET);
-        return 0;
+        opComplete(0);
+        return;
       }
     }
 
     /* Read SAK answer from fifo. */
     DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("G. Checking SAK in response payload."));
-    uint8_t sak_len = readFIFOLen();
-    if (sak_len != 1) {
+    DEBUG_PRINTLN(F("E. Checking SAK in response payload."));
+    if (res->rxlen != 1) {
       DEBUG_TIMESTAMP();
       DEBUG_PRINTLN(F("ERROR: NO SAK in response!\n"));
-      return 0;
+      if (_status == MFRC630_STATUS_OK) {
+        _status = MFRC630_STATUS_LENGTH;
+      }
+      opComplete(0);
+      return;
     }
-    uint8_t sak_value;
-    readFIFO(sak_len, &sak_value);
 
+    uint8_t sak_value = _op.rx[0];
     DEBUG_TIMESTAMP();
     DEBUG_PRINT(F("SAK answer: "));
     DEBUG_PRINTLN(sak_value);
 
     /* Check if there is more data to read. */
-    if (sak_value & (1 << 2)) {
-      /* UID not yet complete, continue to next cascade. */
+    if (!(sak_value & (1 << 2))) {
       DEBUG_TIMESTAMP();
-      DEBUG_PRINTLN(F("UID not complete ... looping to next cascade level."));
-      uint8_t UIDn;
-      for (UIDn = 0; UIDn < 3; UIDn++) {
-        // uid_this_level[UIDn] = uid_this_level[UIDn + 1];
-        uid[(cascadelvl - 1) * 3 + UIDn] = uid_this_level[UIDn + 1];
+      DEBUG_PRINTLN(F("DONE! UID fully parsed, exiting."));
+      /* Done! The final SAK tells us what the card supports (-4, etc.) */
+      if (_op.sak) {
+        *_op.sak = sak_value;
+      }
+      /* Add current bytes at this level to the UID. */
+      memcpy(&uid[(_op.cascadelvl - 1) * 3], uid_this_level, 4);
+
+      /* Finally, return the length of the UID that's now at 'uid'. */
+      frameTimeoutCard(uid, _op.cascadelvl * 3 + 1);
+      opComplete(_op.cascadelvl * 3 + 1);
+      return;
+    }
+
+    /* UID not yet complete, continue to next cascade. */
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("UID not complete ... looping to next cascade level."));
+    memcpy(&uid[(_op.cascadelvl - 1) * 3], &uid_this_level[1], 3);
+
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINTLN(F("Exiting cascade loop"));
+    if (++_op.cascadelvl > 3) {
+      /* Return 0 for UUID length if nothing was found. */
+      _status = MFRC630_STATUS_PROTOCOL;
+      opComplete(0);
+      return;
+    }
+    break;
+  }
+
+  default:
+    return;
+  }
+
+  /* Start a new cascade level */
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Cascade level "));
+  DEBUG_PRINTLN(_op.cascadelvl);
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("a. Collision detection (max 32 attempts)."));
+  memset(_op.tx, 0, sizeof(_op.tx));
+  _op.kbits = 0;
+  _op.cnum = 0;
+  selectAnticoll();
+}
+
+bool Adafruit_MFRC630::iso14443aSelectUid(uint8_t *uid, uint8_t uidlen,
+                                          uint8_t *sak) {
+  uint8_t levels = (uidlen == 10) ? 3 : (uidlen == 7) ? 2 : 1;
+  uint8_t sak_value = 0;
+
+  if ((uidlen != 4) && (uidlen != 7) && (uidlen != 10)) {
+    return false;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Selecting a known ISO14443A tag"));
+
+  /* CRC in both directions, activation frame wait timeout */
+  struct mfrc630_frame frame = {};
+  frame.command = MFRC630_CMD_TRANSCEIVE;
+  frame.txlen = 7;
+  frame.txcrc = true;
+  frame.rxcrc = true;
+  frame.irq0en = MFRC630IRQ0_RXIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.timeout_class = MFRC630_TIMEOUT_ACTIVATION;
+  frame.rx = &sak_value;
+  frame.rxlen = 1;
+  struct mfrc630_frame_result res;
+
+  for (uint8_t lvl = 0; lvl < levels; lvl++) {
+    /*
+     * SEL, NVB = 0x70 (all 40 bits), four UID bytes and the BCC. All but
+     * the last level start with the cascade tag (0x88) and three bytes.
+     */
+    uint8_t req[7] = {cascade_sel[lvl], 0x70};
+    if (lvl < levels - 1) {
+      req[2] = 0x88;
+      memcpy(&req[3], &uid[lvl * 3], 3);
+    } else {
+      memcpy(&req[2], &uid[lvl * 3], 4);
+    }
+    req[6] = req[2] ^ req[3] ^ req[4] ^ req[5];
+    frame.tx = req;
+
+    if (!transceive(&frame, &res) || (res.rxlen != 1)) {
+      return false;
+    }
+  }
+
+  if (sak) {
+    *sak = sak_value;
+  }
+  frameTimeoutCard(uid, uidlen);
+
+  return true;
+}
+
+bool Adafruit_MFRC630::iso14443aHalt(void) {
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Sending HLTA"));
+
+  /*
+   * The card acknowledges HLTA by staying silent, so wait out the 1ms
+   * (MFRC630_TIMEOUT_ACTIVATION_US) response window and treat a timeout as
+   * success.
+   */
+  uint8_t req[2] = {ISO14443_CMD_HLTA, 0x00};
+  uint8_t resp;
+  struct mfrc630_frame frame = {};
+  frame.command = MFRC630_CMD_TRANSCEIVE;
+  frame.tx = req;
+  frame.txlen = sizeof(req);
+  frame.txcrc = true;
+  frame.irq0en = MFRC630IRQ0_RXIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.timeout_class = MFRC630_TIMEOUT_ACTIVATION;
+  frame.rx = &resp;
+  frame.rxlen = 1;
+  struct mfrc630_frame_result res;
+  transceive(&frame, &res);
+
+  _ntagcache_valid = false;
+  _isodep.active = false;
+
+  /* Silence is the expected answer */
+  if (_status == MFRC630_STATUS_TIMEOUT) {
+    _status = MFRC630_STATUS_OK;
+  }
+
+  return res.rxlen == 0;
+}
+
+enum mfrc630_card_event
+Adafruit_MFRC630::pollCard(uint8_t *uid, uint8_t *uidlen, uint8_t *sak) {
+  enum mfrc630_card_event event = MFRC630_CARD_NONE;
+
+  if (_card.present) {
+    /*
+     * Park the card in HALT (ISO14443-4 cards are deselected instead) and
+     * leave any Crypto1 session, then wake it up and select it by UID.
+     * A missing card shows up as a WUPA timeout.
+     */
+    if (_isodep.active) {
+      isoDepDeselect();
+    } else {
+      iso14443aHalt();
+    }
+    write8(MFRC630_REG_STATUS, 0);
+
+    if (iso14443aWakeup() &&
+        iso14443aSelectUid(_card.uid, _card.uidlen, &_card.sak)) {
+      event = MFRC630_CARD_PRESENT;
+    } else {
+      _card.present = false;
+      event = MFRC630_CARD_REMOVED;
+    }
+  } else if (iso14443aWakeup()) {
+    /* WUPA also wakes up cards that were left halted */
+    _card.uidlen = iso14443aSelect(_card.uid, &_card.sak);
+    if (_card.uidlen) {
+      _card.present = true;
+      event = MFRC630_CARD_ARRIVED;
+    }
+  }
+
+  if (event != MFRC630_CARD_NONE) {
+    if (uid) {
+      memcpy(uid, _card.uid, _card.uidlen);
+    }
+    if (uidlen) {
+      *uidlen = _card.uidlen;
+    }
+    if (sak) {
+      *sak = _card.sak;
+    }
+  }
+
+  return event;
+}
+
+uint8_t Adafruit_MFRC630::iso14443aRats(uint8_t fsdi, uint8_t cid,
+                                        uint8_t *ats, uint8_t len) {
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Sending RATS"));
+
+  /*
+   * CRC is enabled in both directions. The activation frame wait time is
+   * ~5ms, T0 uses 0x0FFF ticks (1 'tick' 4.72us, so ~19ms) for margin.
+   */
+  uint8_t req[2] = {ISO14443_CMD_RATS,
+                    (uint8_t)(((fsdi & 0x0F) << 4) | (cid & 0x0F))};
+  struct mfrc630_frame frame = {};
+  frame.command = MFRC630_CMD_TRANSCEIVE;
+  frame.tx = req;
+  frame.txlen = sizeof(req);
+  frame.txcrc = true;
+  frame.rxcrc = true;
+  frame.irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.timeout = 0x0FFF;
+  frame.rx = ats;
+  frame.rxlen = len;
+  struct mfrc630_frame_result res;
+  if (!transceive(&frame, &res)) {
+    DEBUG_PRINTLN(F("No ATS!"));
+    return 0;
+  }
+
+  /* TL (the first byte) is the ATS length, including itself */
+  if ((res.rxlen == 0) || (res.rxlen > len) || (ats[0] != res.rxlen)) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINT(F("Unexpected ATS length: "));
+    DEBUG_PRINTLN(res.rxlen);
+    return 0;
+  }
+
+  return res.rxlen;
+}
+
+bool Adafruit_MFRC630::iso14443aPPS(uint8_t cid, enum iso14443_bitrate dsi,
+                                    enum iso14443_bitrate dri) {
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Sending PPS DSI="));
+  DEBUG_PRINT(dsi);
+  DEBUG_PRINT(F(" DRI="));
+  DEBUG_PRINTLN(dri);
+
+  /* PPSS, PPS0 (PPS1 follows), PPS1 (DSI/DRI) */
+  uint8_t req[3] = {(uint8_t)(ISO14443_CMD_PPS | (cid & 0x0F)), 0x11,
+                    (uint8_t)((dsi << 2) | dri)};
+  uint8_t resp = 0;
+  struct mfrc630_frame frame = {};
+  frame.command = MFRC630_CMD_TRANSCEIVE;
+  frame.tx = req;
+  frame.txlen = sizeof(req);
+  frame.txcrc = true;
+  frame.rxcrc = true;
+  frame.irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.timeout = 0x0FFF;
+  frame.rx = &resp;
+  frame.rxlen = 1;
+  struct mfrc630_frame_result res;
+  if (!transceive(&frame, &res) || (res.rxlen != 1) || (resp != req[0])) {
+    DEBUG_PRINTLN(F("PPS not acknowledged"));
+    return false;
+  }
+
+  /*
+   * The card switches as soon as it has sent the PPS response, so follow
+   * it: DSI is the receive (card to reader) rate, DRI the transmit rate.
+   */
+  return loadProtocol((enum mfrc630protocol)dsi, (enum mfrc630protocol)dri);
+}
+
+bool Adafruit_MFRC630::iso14443aNegotiateBitrate(
+    uint8_t *ats, uint8_t atslen, uint8_t cid, enum iso14443_bitrate max,
+    enum iso14443_bitrate *dsi, enum iso14443_bitrate *dri) {
+  uint8_t ds = 0, dr = 0;
+
+  /* TA(1) is only present if bit 4 of the format byte T0 is set */
+  if ((atslen > 2) && (ats[1] & 0x10)) {
+    uint8_t ta = ats[2];
+    uint8_t dsmask = (ta >> 4) & 0x07;
+    uint8_t drmask = ta & 0x07;
+
+    /* Bit 7: the card only supports the same rate in both directions */
+    if (ta & 0x80) {
+      dsmask &= drmask;
+      drmask = dsmask;
+    }
+
+    /* Bit n of each mask is 2^(n+1) times 106 kbit/s */
+    for (uint8_t d = 1; d <= max; d++) {
+      if (dsmask & (1 << (d - 1))) {
+        ds = d;
+      }
+      if (drmask & (1 << (d - 1))) {
+        dr = d;
+      }
+    }
+  }
+
+  bool ok = true;
+  if (ds || dr) {
+    ok = iso14443aPPS(cid, (enum iso14443_bitrate)ds,
+                      (enum iso14443_bitrate)dr);
+    if (!ok) {
+      ds = dr = 0;
+    }
+  }
+
+  if (dsi) {
+    *dsi = (enum iso14443_bitrate)ds;
+  }
+  if (dri) {
+    *dri = (enum iso14443_bitrate)dr;
+  }
+
+  return ok;
+}
+
+/*
+ * Frame sizes for the FSDI/FSCI codes (see ISO-14443-4 5.2.3). Codes above
+ * 8 are treated as 256 bytes, the most this driver uses.
+ */
+static const uint16_t isodep_frame_sizes[] = {16, 24, 32,  40, 48,
+                                              64, 96, 128, 256};
+
+uint8_t Adafruit_MFRC630::isoDepActivate(uint8_t *ats, uint8_t len) {
+  uint8_t fsdi = 0;
+  while ((fsdi < 8) && (isodep_frame_sizes[fsdi + 1] <= MFRC630_ISODEP_FSD)) {
+    fsdi++;
+  }
+
+  _isodep.active = false;
+  uint8_t atslen = iso14443aRats(fsdi, 0, ats, len);
+  if (!atslen) {
+    return 0;
+  }
+
+  /*
+   * T0 holds FSCI and flags which of TA(1), TB(1) and TC(1) follow. If
+   * they're missing the defaults are FSCI = 2, FWI = 4 and SFGI = 0.
+   */
+  uint8_t fsci = 2, fwi = 4, sfgi = 0;
+  if (atslen > 1) {
+    uint8_t t0 = ats[1];
+    uint8_t i = (t0 & 0x10) ? 3 : 2;
+    fsci = t0 & 0x0F;
+    if ((t0 & 0x20) && (i < atslen)) {
+      fwi = ats[i] >> 4;
+      sfgi = ats[i] & 0x0F;
+    }
+  }
+  if (fwi == 15) {
+    fwi = 4;
+  }
+  if (sfgi == 15) {
+    sfgi = 0;
+  }
+
+  _isodep.fsc = isodep_frame_sizes[(fsci > 8) ? 8 : fsci];
+  if (_isodep.fsc > MFRC630_ISODEP_FSD) {
+    _isodep.fsc = MFRC630_ISODEP_FSD;
+  }
+
+  /*
+   * FWT = 302us * 2^FWI, which is 64 * 2^FWI Timer0 ticks (4.72us), plus
+   * ~3.6ms for delta FWT. The largest FWIs exceed what Timer0 can count
+   * and are clamped to ~309ms.
+   */
+  uint32_t fwt = (64UL << fwi) + 768;
+  _isodep.fwt = (fwt > 0xFFFF) ? 0xFFFF : fwt;
+  _isodep.block = 0;
+  _isodep.active = true;
+
+  /* Wait out the start-up frame guard time (302us * 2^SFGI) */
+  if (sfgi) {
+    uint32_t sfgt = 302UL << sfgi;
+    delay(sfgt / 1000);
+    delayMicroseconds(sfgt % 1000);
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("ISO14443-4 active, FSC="));
+  DEBUG_PRINT(_isodep.fsc);
+  DEBUG_PRINT(F(" FWI="));
+  DEBUG_PRINTLN(fwi);
+
+  return atslen;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends one ISO14443-4 block and returns the card's answer,
+            granting S(WTX) requests and recovering lost blocks with R(NAK)
+
+    @returns The length of the received block (which may be larger than
+             'rxlen' if it was truncated), or 0 on failure.
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::isoDepFrame(uint8_t *tx, uint16_t txlen,
+                                       uint8_t *rx, uint16_t rxlen) {
+  uint8_t ctrl[2];
+  uint8_t *out = tx;
+  uint16_t outlen = txlen;
+  uint16_t timeout = _isodep.fwt;
+  uint8_t retries = 0;
+
+  struct mfrc630_frame frame = {};
+  frame.command = MFRC630_CMD_TRANSCEIVE;
+  frame.txcrc = true;
+  frame.rxcrc = true;
+  frame.irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.rx = rx;
+  frame.rxlen = rxlen;
+  struct mfrc630_frame_result res;
+
+  for (;;) {
+    frame.tx = out;
+    frame.txlen = outlen;
+    frame.timeout = timeout;
+    timeout = _isodep.fwt;
+
+    if (!transceive(&frame, &res) || (res.rxlen == 0)) {
+      /* Timeout or transmission error: ask for the block again */
+      if (++retries > MFRC630_ISODEP_RETRIES) {
+        DEBUG_PRINTLN(F("ISO14443-4 block lost"));
+        return 0;
       }
+      ctrl[0] = 0xB2 | _isodep.block; /* R(NAK) */
+      out = ctrl;
+      outlen = 1;
+      continue;
+    }
+
+    /* S(WTX): echo WTXM and wait WTXM times longer for the answer */
+    if (((rx[0] & 0xF7) == 0xF2) && (res.rxlen >= 2)) {
+      uint8_t wtxm = rx[1] & 0x3F;
+      uint32_t wtx = (uint32_t)_isodep.fwt * (wtxm ? wtxm : 1);
+      ctrl[0] = 0xF2;
+      ctrl[1] = wtxm;
+      out = ctrl;
+      outlen = 2;
+      timeout = (wtx > 0xFFFF) ? 0xFFFF : wtx;
+      continue;
+    }
+
+    /*
+     * R(ACK) with the other block number in reply to our R(NAK): the card
+     * never got our last block, so send it again.
+     */
+    if ((out != tx) && ((rx[0] & 0xF6) == 0xA2) &&
+        ((rx[0] & 0x01) != _isodep.block)) {
+      out = tx;
+      outlen = txlen;
+      continue;
+    }
+
+    return res.rxlen;
+  }
+}
+
+uint16_t Adafruit_MFRC630::exchange(uint8_t *apdu, uint16_t len,
+                                    uint8_t *resp, uint16_t resplen) {
+  uint8_t block[MFRC630_ISODEP_FSD - 2];
+  uint8_t hdr[2];
+  uint16_t maxinf = _isodep.fsc - 3; /* PCB and CRC */
+  uint16_t sent = 0;
+  uint16_t received = 0;
+  uint16_t rxlen;
+  bool overflow = false;
+
+  if (!_isodep.active || (resplen < 2)) {
+    return 0;
+  }
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Exchanging APDU, "));
+  DEBUG_PRINT(len);
+  DEBUG_PRINTLN(F(" byte(s)"));
+
+  /*
+   * Send the command as I-blocks filled up to FSC, chaining when it doesn't
+   * fit in one. Every chained block is acknowledged with R(ACK). Replies
+   * land straight in 'resp', so no second frame buffer is needed.
+   */
+  for (;;) {
+    uint16_t n = len - sent;
+    if (n > maxinf) {
+      n = maxinf;
+    }
+    bool more = (sent + n) < len;
+    block[0] = 0x02 | (more ? 0x10 : 0x00) | _isodep.block;
+    memcpy(&block[1], apdu + sent, n);
+
+    rxlen = isoDepFrame(block, n + 1, resp, resplen);
+    if (!rxlen) {
+      return 0;
+    }
+    if (!more) {
+      break;
+    }
+    if (((resp[0] & 0xF6) != 0xA2) || ((resp[0] & 0x01) != _isodep.block)) {
+      DEBUG_PRINTLN(F("Expected R(ACK) for chained block"));
+      return 0;
+    }
+    _isodep.block ^= 1;
+    sent += n;
+  }
+
+  /*
+   * Collect the response. Each I-block is received with its PCB where the
+   * next INF byte belongs, then moved down over it.
+   */
+  uint8_t *dst = resp;
+  uint16_t room = resplen;
+  for (;;) {
+    uint8_t pcb = dst[0];
+    if (((pcb & 0xE2) != 0x02) || ((pcb & 0x01) != _isodep.block)) {
+      DEBUG_PRINTLN(F("Unexpected ISO14443-4 block"));
+      return 0;
+    }
+    _isodep.block ^= 1;
+
+    if ((dst == hdr) || (rxlen > room)) {
+      overflow = true;
     } else {
-      DEBUG_TIMESTAMP();
-      DEBUG_PRINTLN(F("DONE! UID fully parsed, exiting."));
-      /* Done! */
-      /* Add current bytes at this level to the UID. */
-      uint8_t UIDn;
-      for (UIDn = 0; UIDn < 4; UIDn++) {
-        uid[(cascadelvl - 1) * 3 + UIDn] = uid_this_level[UIDn];
-      }
+      memmove(dst, dst + 1, rxlen - 1);
+      received += rxlen - 1;
+    }
 
-      /* Finally, return the length of the UID that's now at the uid pointer. */
-      return cascadelvl * 3 + 1;
+    /* No chaining bit: that was the last block */
+    if (!(pcb & 0x10)) {
+      break;
     }
 
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINTLN(F("Exiting cascade loop"));
+    /* Acknowledge and fetch the next block */
+    uint8_t ack = 0xA2 | _isodep.block;
+    room = resplen - received;
+    dst = (overflow || (room < 2)) ? hdr : resp + received;
+    rxlen = isoDepFrame(&ack, 1, dst, (dst == hdr) ? sizeof(hdr) : room);
+    if (!rxlen) {
+      return 0;
+    }
+  }
 
-  } /* End: for (cascadelvl = 1; cascadelvl <= 3; cascadelvl++) */
+  return overflow ? 0 : received;
+}
 
-  /* Return 0 for UUID length if nothing was found. */
-  return 0;
+bool Adafruit_MFRC630::isoDepDeselect(void) {
+  uint8_t req = 0xC2; /* S(DESELECT) */
+  uint8_t resp = 0;
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINTLN(F("Sending S(DESELECT)"));
+
+  struct mfrc630_frame frame = {};
+  frame.command = MFRC630_CMD_TRANSCEIVE;
+  frame.tx = &req;
+  frame.txlen = 1;
+  frame.txcrc = true;
+  frame.rxcrc = true;
+  frame.irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.timeout = _isodep.fwt;
+  frame.rx = &resp;
+  frame.rxlen = 1;
+  struct mfrc630_frame_result res;
+
+  _isodep.active = false;
+  return transceive(&frame, &res) && (res.rxlen == 1) && (resp == req);
 }
 
 void Adafruit_MFRC630::mifareLoadKey(uint8_t *key) {
@@ -1113,358 +3647,608 @@ void Adafruit_MFRC630::mifareLoadKey(uint8_t *key) {
   writeCommand(MFRC630_CMD_LOADKEY);
 }
 
-bool Adafruit_MFRC630::mifareAuth(uint8_t key_type, uint8_t blocknum,
-                                  uint8_t *uid) {
+/**************************************************************************/
+/*!
+    @brief  Runs a local (non-RF) command with FIFO parameters and waits
+            for it to go IDLE, optionally reading back 'rxlen' bytes
+
+    @returns True if the command completed without an error.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::runCommand(byte command, uint8_t *params,
+                                  uint16_t paramlen, uint8_t *rx,
+                                  uint16_t rxlen) {
+  /* Timer0 only starts at the end of an RF transmission, so it never fires */
+  struct mfrc630_frame frame = {};
+  frame.command = command;
+  frame.tx = params;
+  frame.txlen = paramlen;
+  frame.irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.timeout = 0xFFFF;
+  frame.rx = rx;
+  frame.rxlen = rxlen;
+  struct mfrc630_frame_result res;
+
+  if (!transceive(&frame, &res)) {
+    if (res.error) {
+      printError((enum mfrc630errors)res.error);
+    }
+    return false;
+  }
+
+  return true;
+}
+
+bool Adafruit_MFRC630::mifareStoreKeyE2(uint8_t slot, uint8_t *key) {
+  if (slot >= MFRC630_KEY_SLOTS) {
+    return false;
+  }
+
   DEBUG_TIMESTAMP();
-  DEBUG_PRINT(F("Authenticating Mifare block "));
-  DEBUG_PRINTLN(blocknum);
+  DEBUG_PRINT(F("Storing Mifare key in EEPROM slot "));
+  DEBUG_PRINTLN(slot);
 
-  writeCommand(MFRC630_CMD_IDLE);
-  clearFIFO();
+  /* STOREKEYE2 takes the slot number followed by the 6 key bytes */
+  uint8_t params[7] = {slot, key[0], key[1], key[2], key[3], key[4], key[5]};
+  return runCommand(MFRC630_CMD_STOREKEYE2, params, sizeof(params), NULL, 0);
+}
 
-  /* Allow the IDLE and Error IRQs to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQOEN, MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ);
-  /* Allow Timer0 IRQ to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQ1EN, MFRC630IRQ1_TIMER0IRQ);
+bool Adafruit_MFRC630::mifareLoadKeyE2(uint8_t slot) {
+  if (slot >= MFRC630_KEY_SLOTS) {
+    return false;
+  }
 
-  /* Configure the frame wait timeout using T0 (10ms max). */
-  /* 1 'tick' 4.72us, so 2000 = ~10ms */
   DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("Configuring Timer0 @ 211.875kHz, post TX, 10ms timeout."));
-  write8(MFRC630_REG_T0_CONTROL, 0b10001);
-  write8(MFRC630_REG_T0_RELOAD_HI, 2000 >> 8);
-  write8(MFRC630_REG_TO_RELOAD_LO, 0xFF);
-  write8(MFRC630_REG_T0_COUNTER_VAL_HI, 2000 >> 8);
-  write8(MFRC630_REG_T0_COUNTER_VAL_LO, 0xFF);
-
-  /* Clear interrupts. */
-  write8(MFRC630_REG_IRQ0, 0b01111111);
-  write8(MFRC630_REG_IRQ1, 0b00111111);
-
-  /* Start of AUTH procedure. */
-  writeCommand(MFRC630_CMD_IDLE);
-  clearFIFO();
+  DEBUG_PRINT(F("Loading Mifare key from EEPROM slot "));
+  DEBUG_PRINTLN(slot);
 
-  /*
-   * MFAUTHENT command has the following parameters:
-   * [0]    Key type (0x60 = KEYA, 0x61 = KEYB)
-   * [1]    Block address
-   * [2]    UID byte 0
-   * [3]    UID byte 1
-   * [4]    UID byte 2
-   * [5]    UID byte 3
-   *
-   * NOTE: When the MFAuthent command is active, any FIFO access is blocked!
-   */
-  uint8_t params[6] = {key_type, blocknum, uid[0], uid[1], uid[2], uid[3]};
-  writeFIFO(6, params);
-  writeCommand(MFRC630_CMD_MFAUTHENT);
+  /* Only the slot number goes over the bus, the key stays on the IC */
+  return runCommand(MFRC630_CMD_LOADKEYE2, &slot, 1, NULL, 0);
+}
 
-  /*
-   * This command terminates automatically when the MIFARE Classic card is
-   * authenticated and the bit MFCrypto1On is set to logic 1.
-   *
-   * This command does not terminate automatically when the card does not
-   * answer, therefore the timer should be initialized to automatic mode. In
-   * this case, beside the bit IdleIRQ the bit TimerIRQ can be used as
-   * termination criteria. During authentication processing the bits RxIRQ
-   * and TxIRQ are blocked. The Crypto1On shows if the authentication was
-   * successful. The Crypto1On is always valid.
-   *
-   * In case there is an error during authentication, the bit ProtocolErr in
-   * the Error register is set to logic 1 and the bit Crypto1On in register
-   * Status2Reg is set to logic 0.
-   */
+bool Adafruit_MFRC630::mifareAuthE2(uint8_t key_type, uint8_t slot,
+                                    uint8_t blocknum, uint8_t *uid) {
+  if (!mifareLoadKeyE2(slot)) {
+    return false;
+  }
 
-  /* Wait until the command execution is complete. */
-  uint8_t irq1_value = 0;
-  while (!(irq1_value & MFRC630IRQ1_TIMER0IRQ)) {
-    irq1_value = read8(MFRC630_REG_IRQ1);
-    /* Check for a global interrrupt, which can only be ERR or RX. */
-    if (irq1_value & MFRC630IRQ1_GLOBALIRQ) {
-      break;
-    }
+  return mifareAuth(key_type, blocknum, uid);
+}
+
+bool Adafruit_MFRC630::mifareAuth(uint8_t key_type, uint8_t blocknum,
+                                  uint8_t *uid) {
+  return startMifareAuth(key_type, blocknum, uid) && opRun();
+}
+
+bool Adafruit_MFRC630::startMifareAuth(uint8_t key_type, uint8_t blocknum,
+                                       uint8_t *uid, mfrc630_callback cb,
+                                       void *arg) {
+  if (!opBegin(MFRC630_OP_AUTH, cb, arg)) {
+    return false;
   }
 
-#if 0
-  uint8_t irq0_value = read8(MFRC630_REG_IRQ0);
-  uint8_t error = read8(MFRC630_REG_ERROR);
-  uint8_t status = read8(MFRC630_REG_STATUS);
-  Serial.print(F("ERROR : ")); Serial.println(error, HEX);
-  Serial.print(F("IRQ0  : ")); Serial.println(irq0_value, HEX);
-  Serial.print(F("IRQ1  : ")); Serial.println(irq1_value, HEX);
-  Serial.print(F("STATUS: ")); Serial.println(status, HEX);
-#endif
+  /* Key type, block address and UID bytes 0..3 (see mifareAuthStep) */
+  _op.tx[0] = key_type;
+  _op.tx[1] = blocknum;
+  memcpy(&_op.tx[2], uid, 4);
+  mifareAuthStep();
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Starts MFAUTHENT, then checks that Crypto1 came on
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::mifareAuthStep(void) {
+  struct mfrc630_frame_result *res = &_op.res;
+
+  if (_op.state == MFRC630_STATE_START) {
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINT(F("Authenticating Mifare block "));
+    DEBUG_PRINTLN(_op.tx[1]);
+
+    /*
+     * MFAUTHENT command has the following parameters:
+     * [0]    Key type (0x60 = KEYA, 0x61 = KEYB)
+     * [1]    Block address
+     * [2]    UID byte 0
+     * [3]    UID byte 1
+     * [4]    UID byte 2
+     * [5]    UID byte 3
+     *
+     * NOTE: When the MFAuthent command is active, any FIFO access is blocked!
+     *
+     * This command terminates automatically when the MIFARE Classic card is
+     * authenticated and the bit MFCrypto1On is set to logic 1.
+     *
+     * This command does not terminate automatically when the card does not
+     * answer, therefore the timer should be initialized to automatic mode. In
+     * this case, beside the bit IdleIRQ the bit TimerIRQ can be used as
+     * termination criteria. During authentication processing the bits RxIRQ
+     * and TxIRQ are blocked. The Crypto1On shows if the authentication was
+     * successful. The Crypto1On is always valid.
+     *
+     * In case there is an error during authentication, the bit ProtocolErr in
+     * the Error register is set to logic 1 and the bit Crypto1On in register
+     * Status2Reg is set to logic 0.
+     *
+     * The frame wait timeout is the authentication class
+     * (MFRC630_TIMEOUT_AUTH_US). The framing is that of the READs, so the
+     * auth of the next sector only has to restart the command.
+     */
+    struct mfrc630_frame *frame = &_op.frame;
+    frame->command = MFRC630_CMD_MFAUTHENT;
+    frame->tx = _op.tx;
+    frame->txlen = 6;
+    frame->txcrc = true;
+    frame->rxcrc = true;
+    frame->irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+    frame->timeout_class = MFRC630_TIMEOUT_AUTH;
+    _op.state = MFRC630_STATE_AUTH;
+    frameRestart(frame);
+    return;
+  }
 
   /* Check the error flag (MFRC630_ERROR_PROT, etc.) */
-  uint8_t error = read8(MFRC630_REG_ERROR);
-  if (error) {
-    printError((enum mfrc630errors)error);
-    return false;
+  if (res->error) {
+    printError((enum mfrc630errors)res->error);
+    if (_status == MFRC630_STATUS_OK) {
+      _status = MFRC630_STATUS_PROTOCOL;
+    }
+    opComplete(0);
+    return;
   }
 
   /* Check if we timed out or got a response. */
-  if (irq1_value & MFRC630IRQ1_TIMER0IRQ) {
+  if (res->irq1 & MFRC630IRQ1_TIMER0IRQ) {
     /* Timed out, no auth! :( */
-    return false;
+    opComplete(0);
+    return;
   }
 
   /* Check the status register for CRYPTO1 flag (Mifare AUTH). */
-  uint8_t status = read8(MFRC630_REG_STATUS);
-  return (status & MFRC630STATUS_CRYPTO1ON) ? true : false;
+  if (!(res->status & MFRC630STATUS_CRYPTO1ON)) {
+    _status = MFRC630_STATUS_AUTH;
+    opComplete(0);
+    return;
+  }
+  opComplete(1);
 }
 
 uint16_t Adafruit_MFRC630::mifareReadBlock(uint8_t blocknum, uint8_t *buf) {
-  clearFIFO();
+  return startMifareReadBlock(blocknum, buf) ? opRun() : 0;
+}
 
-  /* Enable CRC. */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("A. Disabling CRC checks."));
-  write8(MFRC630_REG_TX_CRC_PRESET, 0x18 | 1);
-  write8(MFRC630_REG_RX_CRC_CON, 0x18 | 1);
+bool Adafruit_MFRC630::startMifareReadBlock(uint8_t blocknum, uint8_t *buf,
+                                            mfrc630_callback cb, void *arg) {
+  if (!opBegin(MFRC630_OP_READ, cb, arg)) {
+    return false;
+  }
+  _op.tx[0] = MIFARE_CMD_READ;
+  _op.tx[1] = blocknum;
+  _op.buf = buf;
+  mifareReadStep();
+
+  return true;
+}
 
-  /* Allow the IDLE and Error IRQs to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQOEN, MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ);
-  /* Allow Timer0 IRQ to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQ1EN, MFRC630IRQ1_TIMER0IRQ);
+/**************************************************************************/
+/*!
+    @brief  Sends a Mifare READ, then checks the 16 byte response
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::mifareReadStep(void) {
+  struct mfrc630_frame_result *res = &_op.res;
 
-  /* Configure the frame wait timeout using T0 (10ms max). */
-  /* 1 'tick' 4.72us, so 2000 = ~10ms */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("Configuring Timer0 @ 211.875kHz, post TX, 10ms timeout."));
-  write8(MFRC630_REG_T0_CONTROL, 0b10001); /* Start at end of TX, 211kHz */
-  write8(MFRC630_REG_T0_RELOAD_HI, 0xFF);
-  write8(MFRC630_REG_TO_RELOAD_LO, 0xFF);
-  write8(MFRC630_REG_T0_COUNTER_VAL_HI, 0xFF);
-  write8(MFRC630_REG_T0_COUNTER_VAL_LO, 0xFF);
-
-  /* Clear interrupts. */
-  write8(MFRC630_REG_IRQ0, 0b01111111);
-  write8(MFRC630_REG_IRQ1, 0b00111111);
-
-  /* Transceive the command. */
-  uint8_t req[2] = {MIFARE_CMD_READ, blocknum};
-  writeCommand(MFRC630_CMD_TRANSCEIVE, 2, req);
-
-  /* Wait until the command execution is complete. */
-  uint8_t irq1_value = 0;
-  while (!(irq1_value & MFRC630IRQ1_TIMER0IRQ)) {
-    irq1_value = read8(MFRC630_REG_IRQ1);
-    /* Check for a global interrrupt, which can only be ERR or RX. */
-    if (irq1_value & MFRC630IRQ1_GLOBALIRQ) {
-      break;
-    }
+  if (_op.state == MFRC630_STATE_START) {
+    /*
+     * CRC is enabled in both directions. The frame wait timeout is the
+     * read class: MFRC630_TIMEOUT_READ_US, or the delay learned for the
+     * card once its first reads have been timed.
+     */
+    struct mfrc630_frame *frame = &_op.frame;
+    frame->command = MFRC630_CMD_TRANSCEIVE;
+    frame->tx = _op.tx;
+    frame->txlen = 2;
+    frame->txcrc = true;
+    frame->rxcrc = true;
+    frame->irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+    frame->timeout_class = MFRC630_TIMEOUT_READ;
+    frame->rx = _op.buf;
+    frame->rxlen = 16;
+    frame->drain = true;
+    _op.state = MFRC630_STATE_READ;
+    frameRestart(frame);
+    return;
   }
-  writeCommand(MFRC630_CMD_IDLE);
 
   /* Check if we timed out or got a response. */
-  if (irq1_value & MFRC630IRQ1_TIMER0IRQ) {
+  if (res->irq1 & MFRC630IRQ1_TIMER0IRQ) {
+    /* Timed out, no auth :( */
+    DEBUG_PRINTLN(F("TIMED OUT!"));
+    opComplete(0);
+    return;
+  }
+
+  /* Return the number of bytes placed in buf. */
+  if ((res->rxlen != 16) && (_status == MFRC630_STATUS_OK)) {
+    _status = MFRC630_STATUS_LENGTH;
+  }
+  opComplete((res->rxlen <= 16) ? res->rxlen : 16);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends an NTAG READ/FAST_READ and copies up to 'len' bytes of the
+            response into 'buf', returning the number of bytes received
+*/
+/**************************************************************************/
+uint16_t Adafruit_MFRC630::ntagReadFrame(uint8_t *req, uint8_t reqlen,
+                                         uint8_t *buf, uint16_t len) {
+  /*
+   * CRC is enabled in both directions. The frame wait timeout is the read
+   * class: MFRC630_TIMEOUT_READ_US, or the delay learned for the card.
+   */
+  struct mfrc630_frame frame = {};
+  frame.command = MFRC630_CMD_TRANSCEIVE;
+  frame.tx = req;
+  frame.txlen = reqlen;
+  frame.txcrc = true;
+  frame.rxcrc = true;
+  frame.irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.timeout_class = MFRC630_TIMEOUT_READ;
+  frame.rx = buf;
+  frame.rxlen = len;
+  struct mfrc630_frame_result res;
+#if MFRC630_PERF_COUNTERS
+  /*
+   * Timed from a local start, with the bus traffic booked to NTAG reads
+   * only for the exchange itself, so an operation in flight keeps its own
+   * counters.
+   */
+  struct mfrc630_perf_counters *outer = _perf.cur;
+  uint32_t start = micros();
+  _perf.cur = &_perf.ops[MFRC630_PERF_NTAG_READ];
+#endif
+  transceive(&frame, &res);
+#if MFRC630_PERF_COUNTERS
+  perfBook(_perf.cur, start);
+  _perf.cur = outer;
+#endif
+
+  /* Check if we timed out or got a response. */
+  if (res.irq1 & MFRC630IRQ1_TIMER0IRQ) {
     /* Timed out, no auth :( */
     DEBUG_PRINTLN(F("TIMED OUT!"));
     return 0;
   }
 
-  /* Read the size and contents of the FIFO, and return the results. */
-  uint16_t buffer_length = readFIFOLen();
-  uint16_t rx_len = (buffer_length <= 16) ? buffer_length : 16;
-  readFIFO(rx_len, buf);
+  /* A NAK is a 4-bit frame, which shows up as a CRC/framing error */
+  if (res.irq0 & MFRC630IRQ0_ERRIRQ) {
+    printError((enum mfrc630errors)res.error);
+    return 0;
+  }
 
-  return rx_len;
+  return res.rxlen;
 }
 
 uint16_t Adafruit_MFRC630::ntagReadPage(uint16_t pagenum, uint8_t *buf) {
-  clearFIFO();
+  /*
+   * READ always returns four pages, so keep them around: dumping a card
+   * page by page then only needs one exchange for every fourth page.
+   */
+  if (!_ntagcache_valid || (pagenum < _ntagcache_page) ||
+      (pagenum >= _ntagcache_page + 4)) {
+    uint8_t req[2] = {(uint8_t)NTAG_CMD_READ, (uint8_t)pagenum};
+    _ntagcache_valid = ntagReadFrame(req, sizeof(req), _ntagcache, 16) == 16;
+    if (!_ntagcache_valid) {
+      return 0;
+    }
+    _ntagcache_page = pagenum;
+  }
 
-  /* Enable CRC. */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("A. Disabling CRC checks."));
-  write8(MFRC630_REG_TX_CRC_PRESET, 0x18 | 1);
-  write8(MFRC630_REG_RX_CRC_CON, 0x18 | 1);
+  memcpy(buf, &_ntagcache[(pagenum - _ntagcache_page) * 4], 4);
+  return 4;
+}
 
-  /* Allow the IDLE and Error IRQs to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQOEN, MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ);
-  /* Allow Timer0 IRQ to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQ1EN, MFRC630IRQ1_TIMER0IRQ);
+uint16_t Adafruit_MFRC630::ntagReadPages(uint16_t pagenum, uint16_t count,
+                                         uint8_t *buf, bool fastread) {
+  /* Size FAST_READ ranges so the whole response fits in the FIFO */
+  uint16_t maxpages = getFIFOSize() / 4;
+  uint16_t done = 0;
 
-  /* Configure the frame wait timeout using T0 (10ms max). */
-  /* 1 'tick' 4.72us, so 2000 = ~10ms */
   DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("Configuring Timer0 @ 211.875kHz, post TX, 10ms timeout."));
-  write8(MFRC630_REG_T0_CONTROL, 0b10001); /* Start at end of TX, 211kHz */
-  write8(MFRC630_REG_T0_RELOAD_HI, 0xFF);
-  write8(MFRC630_REG_TO_RELOAD_LO, 0xFF);
-  write8(MFRC630_REG_T0_COUNTER_VAL_HI, 0xFF);
-  write8(MFRC630_REG_T0_COUNTER_VAL_LO, 0xFF);
-
-  /* Clear interrupts. */
-  write8(MFRC630_REG_IRQ0, 0b01111111);
-  write8(MFRC630_REG_IRQ1, 0b00111111);
-
-  /* Transceive the command. */
-  uint8_t req[2] = {(uint8_t)NTAG_CMD_READ, (uint8_t)pagenum};
-  writeCommand(MFRC630_CMD_TRANSCEIVE, 2, req);
-
-  /* Wait until the command execution is complete. */
-  uint8_t irq1_value = 0;
-  while (!(irq1_value & MFRC630IRQ1_TIMER0IRQ)) {
-    irq1_value = read8(MFRC630_REG_IRQ1);
-    /* Check for a global interrrupt, which can only be ERR or RX. */
-    if (irq1_value & MFRC630IRQ1_GLOBALIRQ) {
-      break;
+  DEBUG_PRINT(F("Reading NTAG pages from "));
+  DEBUG_PRINTLN(pagenum);
+
+  while (done < count) {
+    uint16_t page = pagenum + done;
+    uint16_t pages = count - done;
+
+    if (fastread) {
+      /* FAST_READ start/end pages are inclusive */
+      if (pages > maxpages) {
+        pages = maxpages;
+      }
+      uint8_t req[3] = {(uint8_t)NTAG_CMD_FAST_READ, (uint8_t)page,
+                        (uint8_t)(page + pages - 1)};
+      if (ntagReadFrame(req, sizeof(req), buf + done * 4, pages * 4) !=
+          pages * 4) {
+        break;
+      }
+    } else {
+      /* READ returns four pages, which also refills the page cache */
+      if (ntagReadPage(page, buf + done * 4) == 0) {
+        break;
+      }
+      uint16_t cached = _ntagcache_page + 4 - page;
+      if (pages > cached) {
+        pages = cached;
+      }
+      memcpy(buf + done * 4, &_ntagcache[(page - _ntagcache_page) * 4],
+             pages * 4);
     }
+    done += pages;
   }
-  writeCommand(MFRC630_CMD_IDLE);
 
-  /* Check if we timed out or got a response. */
-  if (irq1_value & MFRC630IRQ1_TIMER0IRQ) {
-    /* Timed out, no auth :( */
-    DEBUG_PRINTLN(F("TIMED OUT!"));
-    return 0;
-  }
+  return done * 4;
+}
 
-  /* Read the size and contents of the FIFO, and return the results. */
-  uint16_t buffer_length = readFIFOLen();
-  uint16_t rx_len = (buffer_length <= 4) ? buffer_length : 4;
-  readFIFO(rx_len, buf);
+uint8_t Adafruit_MFRC630::mifareSectorCount(enum mifare_layout layout) {
+  return (layout == MIFARE_LAYOUT_4K) ? 40 : 16;
+}
 
-  return rx_len;
+uint8_t Adafruit_MFRC630::mifareSectorBlocks(uint8_t sector) {
+  return (sector < 32) ? 4 : 16;
 }
 
-uint16_t Adafruit_MFRC630::mifareWriteBlock(uint16_t blocknum, uint8_t *buf) {
-  clearFIFO();
+uint8_t Adafruit_MFRC630::mifareSectorFirstBlock(uint8_t sector) {
+  /* 4K cards switch to 16 block sectors at block 128 */
+  return (sector < 32) ? sector * 4 : 128 + (sector - 32) * 16;
+}
 
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINT(F("Writing data to card @ 0x"));
-  DEBUG_PRINTLN(blocknum);
+/**************************************************************************/
+/*!
+    @brief  Reads 'count' consecutive (already authenticated) blocks
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::mifareReadBlocks(uint8_t blocknum, uint8_t count,
+                                        uint8_t *buf) {
+  /*
+   * Each block is a READ operation of its own, so it is counted and retried
+   * like mifareReadBlock(). The framing set up for the auth serves them
+   * all: each block only reloads the FIFO and restarts the command (see
+   * frameRestart()).
+   */
+  for (uint8_t b = 0; b < count; b++) {
+    if ((mifareReadBlock(blocknum + b, buf + b * 16) != 16) ||
+        (_status != MFRC630_STATUS_OK)) {
+      DEBUG_TIMESTAMP();
+      DEBUG_PRINT(F("Failed to read block "));
+      DEBUG_PRINTLN(blocknum + b);
+      return false;
+    }
+  }
 
-  /* Enable CRC for TX (RX off!). */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("A. Disabling CRC checks."));
-  write8(MFRC630_REG_TX_CRC_PRESET, 0x18 | 1);
-  write8(MFRC630_REG_RX_CRC_CON, 0x18 | 0);
+  return true;
+}
 
-  /* Allow the IDLE and Error IRQs to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQOEN, MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ);
-  /* Allow Timer0 IRQ to be propagated to the GlobalIRQ. */
-  write8(MFRC630_REG_IRQ1EN, MFRC630IRQ1_TIMER0IRQ);
+/**************************************************************************/
+/*!
+    @brief  Wakes up and reselects a card that dropped out after an error
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::mifareReactivate(uint8_t *uid, uint8_t uidlen) {
+  uint8_t newuid[10] = {0};
+  uint8_t sak;
 
-  /* Configure the frame wait timeout using T0 (10ms max). */
-  /* 1 'tick' 4.72us, so 2000 = ~10ms */
-  DEBUG_TIMESTAMP();
-  DEBUG_PRINTLN(F("Configuring Timer0 @ 211.875kHz, post TX, 10ms timeout."));
-  write8(MFRC630_REG_T0_CONTROL, 0b10001); /* Start at end of TX, 211kHz */
-  write8(MFRC630_REG_T0_RELOAD_HI, 0xFF);
-  write8(MFRC630_REG_TO_RELOAD_LO, 0xFF);
-  write8(MFRC630_REG_T0_COUNTER_VAL_HI, 0xFF);
-  write8(MFRC630_REG_T0_COUNTER_VAL_LO, 0xFF);
-
-  /* Clear interrupts. */
-  write8(MFRC630_REG_IRQ0, 0b01111111);
-  write8(MFRC630_REG_IRQ1, 0b00111111);
-
-  /* Transceive the WRITE command. */
-  uint8_t req1[2] = {(uint8_t)MIFARE_CMD_WRITE, (uint8_t)blocknum};
-  writeCommand(MFRC630_CMD_TRANSCEIVE, sizeof(req1), req1);
-
-  /* Wait until the command execution is complete. */
-  uint8_t irq1_value = 0;
-  while (!(irq1_value & MFRC630IRQ1_TIMER0IRQ)) {
-    irq1_value = read8(MFRC630_REG_IRQ1);
-    /* Check for a global interrrupt, which can only be ERR or RX. */
-    if (irq1_value & MFRC630IRQ1_GLOBALIRQ) {
-      break;
-    }
+  /* Leave the Crypto1 session, the next frames must go out in the clear */
+  write8(MFRC630_REG_STATUS, 0);
+
+  if (!iso14443aWakeup()) {
+    return false;
+  }
+  if (iso14443aSelect(newuid, &sak) != uidlen) {
+    return false;
   }
-  writeCommand(MFRC630_CMD_IDLE);
 
-  /* Check if we timed out or got a response. */
-  if (irq1_value & MFRC630IRQ1_TIMER0IRQ) {
-    /* Timed out, no auth :( */
-    DEBUG_PRINTLN(F("TIMED OUT!"));
+  /* Make sure it's the same card that we started with */
+  return memcmp(newuid, uid, uidlen) == 0;
+}
+
+uint16_t Adafruit_MFRC630::mifareReadSector(uint8_t key_type, uint8_t sector,
+                                            uint8_t *uid, uint8_t *buf,
+                                            uint8_t uidlen) {
+  uint8_t first = mifareSectorFirstBlock(sector);
+  uint8_t blocks = mifareSectorBlocks(sector);
+
+  DEBUG_TIMESTAMP();
+  DEBUG_PRINT(F("Reading Mifare sector "));
+  DEBUG_PRINTLN(sector);
+
+  /* Double size UIDs authenticate with their last four bytes */
+  if (uidlen < 4) {
     return 0;
   }
-
-  /* Check if an error occured */
-  uint8_t error = read8(MFRC630_REG_ERROR);
-  uint8_t irq0_value = read8(MFRC630_REG_IRQ0);
-  if (irq0_value & MFRC630IRQ0_ERRIRQ) {
-    printError((enum mfrc630errors)error);
+  if (!mifareAuth(key_type, first, uid + uidlen - 4)) {
     return 0;
   }
-
-  /* We should have a single ACK byte in buffer at this point. */
-  uint16_t buffer_length = readFIFOLen();
-  if (buffer_length != 1) {
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINT(F("Unexpected response buffer len: "));
-    DEBUG_PRINTLN(buffer_length);
+  if (!mifareReadBlocks(first, blocks, buf)) {
     return 0;
   }
 
-  uint8_t ack = 0;
-  readFIFO(1, &ack);
-  if (ack != 0x0A) {
-    /* Missing valid ACK response! */
-    DEBUG_TIMESTAMP();
-    DEBUG_PRINT(F("Invalid ACK response: "));
-    DEBUG_PRINTLN(ack, HEX);
+  return blocks * 16;
+}
+
+uint8_t Adafruit_MFRC630::mifareReadCard(enum mifare_layout layout,
+                                         uint8_t key_type, uint8_t *uid,
+                                         uint8_t *buf, uint8_t *status,
+                                         uint8_t uidlen) {
+  uint8_t sectors = mifareSectorCount(layout);
+  uint8_t good = 0;
+  bool reselect = false;
+
+  if (uidlen < 4) {
     return 0;
   }
 
-  /* TODO: Verift values! */
-  /* Clear the interrupts. */
-  write8(MFRC630_REG_IRQ0, 0b01111111);
-  write8(MFRC630_REG_IRQ1, 0b00111111);
+  for (uint8_t s = 0; s < sectors; s++) {
+    uint8_t first = mifareSectorFirstBlock(s);
+    uint8_t blocks = mifareSectorBlocks(s);
+    uint8_t *dst = buf + first * 16;
+    enum mifare_sector_status rc = MIFARE_SECTOR_OK;
 
-  /* Transfer the page data. */
-  writeCommand(MFRC630_CMD_TRANSCEIVE, 16, buf);
+    /*
+     * A failed auth or read leaves the card in HALT/IDLE, so it has to be
+     * woken up again before the next sector can be authenticated.
+     */
+    if (reselect && !mifareReactivate(uid, uidlen)) {
+      rc = MIFARE_SECTOR_NO_CARD;
+    } else if (!mifareAuth(key_type, first, uid + uidlen - 4)) {
+      rc = MIFARE_SECTOR_AUTH_FAILED;
+    } else if (!mifareReadBlocks(first, blocks, dst)) {
+      rc = MIFARE_SECTOR_READ_FAILED;
+    }
 
-  /* Wait until the command execution is complete. */
-  irq1_value = 0;
-  while (!(irq1_value & MFRC630IRQ1_TIMER0IRQ)) {
-    irq1_value = read8(MFRC630_REG_IRQ1);
-    /* Check for a global interrrupt, which can only be ERR or RX. */
-    if (irq1_value & MFRC630IRQ1_GLOBALIRQ) {
-      break;
+    reselect = (rc != MIFARE_SECTOR_OK);
+    if (reselect) {
+      memset(dst, 0, blocks * 16);
+    } else {
+      good++;
+    }
+    if (status) {
+      status[s] = rc;
     }
   }
-  writeCommand(MFRC630_CMD_IDLE);
+
+  return good;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends one half of a Mifare WRITE, see mifareAckResult()
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::mifareAckFrame(uint8_t *data, uint16_t len) {
+  /*
+   * Enable CRC for TX (RX off, the ACK is only 4 bits!). The frame wait
+   * timeout is the write class: MFRC630_TIMEOUT_WRITE_US, or the delay
+   * learned for the card.
+   */
+  struct mfrc630_frame *frame = &_op.frame;
+  _op.rx[0] = 0;
+  frame->command = MFRC630_CMD_TRANSCEIVE;
+  frame->tx = data;
+  frame->txlen = len;
+  frame->txcrc = true;
+  frame->irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+  frame->timeout_class = MFRC630_TIMEOUT_WRITE;
+  frame->rx = _op.rx;
+  frame->rxlen = 1;
+  frameStart(frame);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks for the 4-bit ACK to a frame sent by mifareAckFrame()
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630::mifareAckResult(void) {
+  struct mfrc630_frame_result *res = &_op.res;
+  uint8_t ack = _op.rx[0];
 
   /* Check if we timed out or got a response. */
-  if (irq1_value & MFRC630IRQ1_TIMER0IRQ) {
+  if (res->irq1 & MFRC630IRQ1_TIMER0IRQ) {
     /* Timed out, no auth :( */
     DEBUG_PRINTLN(F("TIMED OUT!"));
-    return 0;
+    return false;
   }
 
   /* Check if an error occured */
-  error = read8(MFRC630_REG_ERROR);
-  irq0_value = read8(MFRC630_REG_IRQ0);
-  if (irq0_value & MFRC630IRQ0_ERRIRQ) {
-    printError((enum mfrc630errors)error);
-    return 0;
+  if (res->irq0 & MFRC630IRQ0_ERRIRQ) {
+    printError((enum mfrc630errors)res->error);
+    if (_status == MFRC630_STATUS_OK) {
+      _status = MFRC630_STATUS_PROTOCOL;
+    }
+    return false;
   }
 
   /* We should have a single ACK byte in buffer at this point. */
-  buffer_length = readFIFOLen();
-  if (buffer_length != 1) {
+  if (res->rxlen != 1) {
     DEBUG_TIMESTAMP();
     DEBUG_PRINT(F("Unexpected response buffer len: "));
-    DEBUG_PRINTLN(buffer_length);
-    return 0;
+    DEBUG_PRINTLN(res->rxlen);
+    _status = MFRC630_STATUS_LENGTH;
+    return false;
   }
 
-  ack = 0;
-  readFIFO(1, &ack);
   if (ack != 0x0A) {
     /* Missing valid ACK response! */
     DEBUG_TIMESTAMP();
     DEBUG_PRINT(F("Invalid ACK response: "));
     DEBUG_PRINTLN(ack, HEX);
-    return 0;
+    _status = MFRC630_STATUS_NAK;
+    return false;
+  }
+
+  return true;
+}
+
+uint16_t Adafruit_MFRC630::mifareWriteBlock(uint16_t blocknum, uint8_t *buf) {
+  return startMifareWriteBlock(blocknum, buf) ? opRun() : 0;
+}
+
+bool Adafruit_MFRC630::startMifareWriteBlock(uint16_t blocknum, uint8_t *buf,
+                                             mfrc630_callback cb, void *arg) {
+  if (!opBegin(MFRC630_OP_WRITE, cb, arg)) {
+    return false;
   }
+  _op.tx[0] = MIFARE_CMD_WRITE;
+  _op.tx[1] = (uint8_t)blocknum;
+  _op.buf = buf;
+  mifareWriteStep();
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sends the WRITE command, then the 16 bytes of data, each
+            acknowledged by the card
+*/
+/**************************************************************************/
+void Adafruit_MFRC630::mifareWriteStep(void) {
+  switch (_op.state) {
+  case MFRC630_STATE_START:
+    DEBUG_TIMESTAMP();
+    DEBUG_PRINT(F("Writing data to card @ 0x"));
+    DEBUG_PRINTLN(_op.tx[1]);
+
+    /* Any cached NTAG pages may be stale after this */
+    _ntagcache_valid = false;
+
+    /* Transceive the WRITE command. */
+    _op.state = MFRC630_STATE_WRITE_CMD;
+    mifareAckFrame(_op.tx, 2);
+    break;
 
-  return 16;
+  case MFRC630_STATE_WRITE_CMD:
+    if (!mifareAckResult()) {
+      opComplete(0);
+      break;
+    }
+
+    /* Transfer the page data. */
+    _op.state = MFRC630_STATE_WRITE_DATA;
+    mifareAckFrame(_op.buf, 16);
+    break;
+
+  default:
+    opComplete(mifareAckResult() ? 16 : 0);
+    break;
+  }
 }
 
 uint16_t Adafruit_MFRC630::ntagWritePage(uint16_t pagenum, uint8_t *buf) {
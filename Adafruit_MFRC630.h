@@ -6,6 +6,7 @@
 
 #include "Adafruit_MFRC630_consts.h"
 #include "Adafruit_MFRC630_regs.h"
+#include "Adafruit_MFRC630_script.h"
 #include "Arduino.h"
 #include <SPI.h>
 #include <Stream.h>
@@ -16,10 +17,177 @@
  */
 #define MFRC630_I2C_ADDR (0x28)
 
+/*!
+ * @brief Max bytes moved per I2C transaction (Wire buffer size on AVR)
+ */
+#define MFRC630_I2C_CHUNK_LEN (32)
+
+/*!
+ * @brief Max register reads in flight on the UART, so the answers fit in
+ *        the serial RX buffer (64 bytes on AVR)
+ */
+#ifndef MFRC630_SERIAL_WINDOW
+#define MFRC630_SERIAL_WINDOW (32)
+#endif
+
+/*!
+ * @brief Time to wait for the answer to a register read over the UART
+ */
+#define MFRC630_SERIAL_TIMEOUT_MS (255)
+
+/*!
+ * @brief Upper bound on waiting for the FIFO length to settle (one 256 byte
+ *        frame at 106 kbit/s)
+ */
+#define MFRC630_FIFO_SETTLE_TIMEOUT_MS (25)
+
+/*!
+ * @brief Safety timeout when waiting on the IRQ pin (> max Timer0 period)
+ */
+#define MFRC630_IRQ_PIN_TIMEOUT_MS (400)
+
+/*!
+ * @brief Time allowed on top of the Timer0 timeout when polling IRQ1 over
+ *        the bus (TX and RX of a full FIFO at 106 kbit/s)
+ */
+#define MFRC630_FRAME_MARGIN_MS (2 * MFRC630_FIFO_SETTLE_TIMEOUT_MS)
+
+/*!
+ * @brief Bus time per byte below which frameRestart() clears the IRQs and
+ *        reloads Timer0 while the frame goes out (two short writes, well
+ *        within the shortest Mifare TX at 106 kbit/s)
+ */
+#define MFRC630_RESTART_LATE_BYTE_US (40)
+
+/*!
+ * @brief Default frame wait timeouts per mfrc630_timeout_class, in us
+ */
+#define MFRC630_TIMEOUT_ACTIVATION_US (1000) //!< REQA/WUPA, select, HLTA
+#define MFRC630_TIMEOUT_AUTH_US (10000)      //!< Mifare authentication
+#define MFRC630_TIMEOUT_READ_US (5000)       //!< Mifare and NTAG reads
+#define MFRC630_TIMEOUT_WRITE_US (10000)     //!< Mifare write ACKs
+
+/*!
+ * @brief Response delays timed per card before the read and write timeouts
+ *        are narrowed down to what that card needs
+ */
+#define MFRC630_TIMEOUT_SAMPLES (4)
+
+/*!
+ * @brief Slack added to twice the longest response delay timed on a card
+ */
+#define MFRC630_TIMEOUT_MARGIN_US (1000)
+
+/*!
+ * @brief Number of registers covered by the shadow cache (0x00..0x47)
+ */
+#define MFRC630_REGCACHE_LEN (MFRC630_REG_SIGOUT + 1)
+
+/*!
+ * @brief Number of Mifare key slots in EEPROM section 3 (see docs/EEPROM.md)
+ */
+#define MFRC630_KEY_SLOTS (128)
+
+/*!
+ * @brief EEPROM page size, the unit of WRITEE2PAGE
+ */
+#define MFRC630_EEPROM_PAGE_LEN (64)
+
+/*!
+ * @brief First EEPROM address eepromWrite() may touch (start of section 1,
+ *        section 0 holds the production data and interface config)
+ */
+#define MFRC630_EEPROM_WRITE_START (64)
+
+/*!
+ * @brief Start of the EEPROM user area (section 2), where LOADREG register
+ *        sets have to live
+ */
+#define MFRC630_EEPROM_USER_START (192)
+
+/*!
+ * @brief End (exclusive) of the EEPROM area eepromWrite() may touch (end of
+ *        the user area, section 3 keys and section 4 RSP are off limits)
+ */
+#define MFRC630_EEPROM_WRITE_END (6144)
+
+/*!
+ * @brief Total EEPROM size in bytes
+ */
+#define MFRC630_EEPROM_LEN (8192)
+
+/*!
+ * @brief Largest ISO14443-4 frame (including the CRC) the reader accepts
+ *        (FSD) and sends, one of 16, 24, 32, 40, 48, 64, 96, 128 or 256.
+ *        exchange() keeps a frame buffer of this size on the stack.
+ */
+#define MFRC630_ISODEP_FSD (256)
+
+/*!
+ * @brief How often a lost or corrupted ISO14443-4 block is recovered with
+ *        R(NAK) before exchange() gives up
+ */
+#define MFRC630_ISODEP_RETRIES (2)
+
+/*!
+ * @brief Default I/Q deviation from the LPCD baseline that counts as a card
+ */
+#define MFRC630_LPCD_THRESHOLD (2)
+
+/*!
+ * @brief Default time between two autonomous LPCD measurements
+ */
+#define MFRC630_LPCD_PERIOD_MS (100)
+
+/*!
+ * @brief Upper bound on waiting for an LPCD calibration measurement
+ */
+#define MFRC630_LPCD_CAL_TIMEOUT_MS (10)
+
+/*!
+ * @brief FIFO water level used when transceive() streams a frame that is
+ *        larger than the FIFO (refill at LoAlert, drain at HiAlert)
+ */
+#define MFRC630_FIFO_WATER_LEVEL (64)
+
+/*!
+ * @brief Set to 1 to compile in the per-operation performance counters (see
+ *        getPerfCounters), at the cost of ~370 bytes of SRAM
+ */
+#ifndef MFRC630_PERF_COUNTERS
+#define MFRC630_PERF_COUNTERS (0)
+#endif
+
+/*!
+ * @brief Number of latency histogram buckets. Bucket n counts operations
+ *        that took less than (128us << n), the last one all slower ones.
+ */
+#define MFRC630_PERF_BUCKETS (12)
+
+/*!
+ * @brief Set to 1 to compile in the binary trace log (see traceRead), which
+ *        records bus traffic and frames without blocking on Serial
+ */
+#ifndef MFRC630_TRACE_LOG
+#define MFRC630_TRACE_LOG (0)
+#endif
+
+/*!
+ * @brief Number of records in the trace log ring buffer, 8 bytes each (a
+ *        power of two, up to 128)
+ */
+#define MFRC630_TRACE_LOG_LEN (32)
+
+#if (MFRC630_TRACE_LOG_LEN > 128) ||                                           \
+    (MFRC630_TRACE_LOG_LEN & (MFRC630_TRACE_LOG_LEN - 1))
+#error "MFRC630_TRACE_LOG_LEN must be a power of two up to 128"
+#endif
+
 /* Debug output level */
 /*
  * NOTE: Setting this macro above RELEASE may require more SRAM than small
- *       MCUs like the Atmel 32u4 can provide!
+ *       MCUs like the Atmel 32u4 can provide! The trace output also blocks
+ *       on Serial, see MFRC630_TRACE_LOG for a log that doesn't.
  */
 #define MFRC630_VERBOSITY_RELEASE (0) //!< No debug output
 #define MFRC630_VERBOSITY_DEBUG (1)   //!< Debug message output
@@ -84,6 +252,194 @@ enum mfrc630_transport {
   MFRC630_TRANSPORT_SERIAL = 2
 };
 
+/**
+ * User supplied register transport for Adafruit_MFRC630, e.g. a bus the
+ * driver doesn't support itself or a behavioural model of the IC so the
+ * driver can run on a host without hardware.
+ *
+ * Multi-byte accesses start at 'reg' and auto-increment up to
+ * MFRC630_REG_FIFO_DATA, which is then accessed repeatedly, like on the
+ * real buses.
+ */
+class Adafruit_MFRC630_Bus {
+public:
+  /**
+   * Called from Adafruit_MFRC630::begin() before the IC is accessed.
+   */
+  virtual void begin(void) {}
+
+  /**
+   * Writes 'len' bytes starting at register 'reg'.
+   *
+   * @param reg       The first register to write.
+   * @param len       The number of bytes to write.
+   * @param buffer    The data to write.
+   */
+  virtual void write(uint8_t reg, uint16_t len, const uint8_t *buffer) = 0;
+
+  /**
+   * Reads 'len' bytes starting at register 'reg'.
+   *
+   * @param reg       The first register to read.
+   * @param len       The number of bytes to read.
+   * @param buffer    The buffer for the data.
+   *
+   * @return The number of bytes actually read.
+   */
+  virtual uint16_t read(uint8_t reg, uint16_t len, uint8_t *buffer) = 0;
+};
+
+/*!
+ * @brief Card frames whose wait timeout the driver computes, see
+ *        setFrameTimeout()
+ */
+enum mfrc630_timeout_class {
+  MFRC630_TIMEOUT_FIXED = 0,      /**< Use mfrc630_frame::timeout as is */
+  MFRC630_TIMEOUT_ACTIVATION = 1, /**< REQA/WUPA, anticollision, HLTA */
+  MFRC630_TIMEOUT_AUTH = 2,       /**< Mifare Classic authentication */
+  MFRC630_TIMEOUT_READ = 3,       /**< Mifare and NTAG reads */
+  MFRC630_TIMEOUT_WRITE = 4,      /**< Mifare write ACKs */
+  MFRC630_TIMEOUT_CLASS_COUNT = 5 /**< Number of classes */
+};
+
+/*!
+ * @brief Describes a single command/response exchange for transceive()
+ */
+struct mfrc630_frame {
+  uint8_t command;    /**< IC command to run, usually MFRC630_CMD_TRANSCEIVE */
+  uint8_t *tx;        /**< Data written to the FIFO before the command */
+  uint16_t txlen;     /**< Number of bytes in 'tx' */
+  uint8_t txlastbits; /**< Valid bits in the last TX byte (0 = all 8) */
+  uint8_t rxalign;    /**< Bit position of the first received bit */
+  bool txcrc;         /**< Append a CRC to the transmitted frame */
+  bool rxcrc;         /**< Check and strip the CRC of the received frame */
+  uint8_t irq0en;     /**< IRQ0 sources that end the wait (ERRIRQ implied) */
+  uint16_t timeout;   /**< Timer0 reload value in 4.72us ticks */
+  uint8_t *rx;        /**< Response buffer, or NULL if no response is read */
+  uint16_t rxlen;     /**< Size of 'rx' (expected response length) */
+  /** Frame class to compute 'timeout' for, see setFrameTimeout() */
+  enum mfrc630_timeout_class timeout_class;
+  /**
+   * Read the response while it arrives and stop once 'rxlen' bytes came
+   * in. Without an error, the result's error, status and coll stay 0.
+   */
+  bool drain;
+};
+
+/*!
+ * @brief Outcome of a transceive() exchange
+ */
+struct mfrc630_frame_result {
+  uint8_t irq0;   /**< IRQ0 flags once the command was stopped */
+  uint8_t irq1;   /**< IRQ1 flags at the end of the wait */
+  uint8_t error;  /**< Contents of MFRC630_REG_ERROR */
+  uint8_t status; /**< Contents of MFRC630_REG_STATUS */
+  uint8_t coll;   /**< Contents of MFRC630_REG_RX_COLL */
+  uint16_t rxlen; /**< Bytes received (at most frame rxlen are copied) */
+};
+
+/*!
+ * @brief Card presence events reported by pollCard()
+ */
+enum mfrc630_card_event {
+  MFRC630_CARD_NONE = 0,    /**< No card, and none was there before */
+  MFRC630_CARD_ARRIVED = 1, /**< A new card was found and selected */
+  MFRC630_CARD_PRESENT = 2, /**< The same card is still there (reselected) */
+  MFRC630_CARD_REMOVED = 3  /**< The card that was there has gone */
+};
+
+/*!
+ * @brief Card operations that can run without blocking (see poll())
+ */
+enum mfrc630_op {
+  MFRC630_OP_NONE = 0,   /**< Nothing in flight */
+  MFRC630_OP_SELECT = 1, /**< Anticollision and select */
+  MFRC630_OP_AUTH = 2,   /**< Mifare Classic authentication */
+  MFRC630_OP_READ = 3,   /**< Mifare Classic block read */
+  MFRC630_OP_WRITE = 4   /**< Mifare Classic block write */
+};
+
+/*!
+ * @brief Called by poll() when a non-blocking operation completes, with
+ *        the value the blocking call would have returned (0 on failure)
+ */
+typedef void (*mfrc630_callback)(enum mfrc630_op op, uint16_t result,
+                                 void *arg);
+
+/*!
+ * @brief Outcome of the last frame or operation, see getStatus()
+ */
+enum mfrc630_status_code {
+  MFRC630_STATUS_OK = 0,        /**< Success */
+  MFRC630_STATUS_TIMEOUT = 1,   /**< No response in time (no card?) */
+  MFRC630_STATUS_INTEGRITY = 2, /**< CRC or parity error */
+  MFRC630_STATUS_PROTOCOL = 3,  /**< Framing error or unexpected frame */
+  MFRC630_STATUS_COLLISION = 4, /**< Bit collision (several cards) */
+  MFRC630_STATUS_NAK = 5,       /**< The card answered with a NAK */
+  MFRC630_STATUS_LENGTH = 6,    /**< Response of an unexpected length */
+  MFRC630_STATUS_AUTH = 7,      /**< Mifare authentication failed */
+  MFRC630_STATUS_BUSY = 8,      /**< Another operation is in flight */
+  MFRC630_STATUS_IC = 9         /**< FIFO or EEPROM error in the IC */
+};
+
+/*!
+ * @brief Bit of a status code in a retry mask, see setRetryPolicy()
+ */
+#define MFRC630_STATUS_MASK(status) (1 << (status))
+
+/*!
+ * @brief Operation types tracked by the performance counters
+ */
+enum mfrc630_perf_op {
+  MFRC630_PERF_SELECT = 0,    /**< Anticollision and select */
+  MFRC630_PERF_AUTH = 1,      /**< Mifare Classic authentication */
+  MFRC630_PERF_READ = 2,      /**< Mifare Classic block read */
+  MFRC630_PERF_WRITE = 3,     /**< Mifare Classic block write */
+  MFRC630_PERF_NTAG_READ = 4, /**< NTAG READ/FAST_READ exchange */
+  MFRC630_PERF_OP_COUNT = 5   /**< Number of operation types */
+};
+
+/*!
+ * @brief Performance counters of one operation type
+ */
+struct mfrc630_perf_counters {
+  uint32_t calls;      /**< Operations completed */
+  uint32_t bus_xfers;  /**< Register accesses (one per burst) */
+  uint32_t bus_bytes;  /**< Bytes moved, incl. the register address */
+  uint32_t wait_polls; /**< Iterations of the frame completion wait */
+  uint32_t total_us;   /**< Sum of the operation latencies */
+  uint32_t max_us;     /**< Worst operation latency */
+  /** Latency histogram, see MFRC630_PERF_BUCKETS */
+  uint32_t histogram[MFRC630_PERF_BUCKETS];
+};
+
+/*!
+ * @brief Trace log event types (fields: reg, value, len)
+ */
+enum mfrc630_trace_event {
+  MFRC630_TRACE_WRITE = 0,    /**< Register write: reg, first byte, bytes */
+  MFRC630_TRACE_READ = 1,     /**< Register read: reg, first byte, bytes */
+  MFRC630_TRACE_FRAME = 2,    /**< Frame done: command, ERROR, rx bytes */
+  MFRC630_TRACE_OP_START = 3, /**< Operation started: mfrc630_op */
+  MFRC630_TRACE_OP_DONE = 4   /**< Operation done: mfrc630_op, -, result */
+};
+
+/*!
+ * @brief Filter bit of a trace log event type, see traceSetFilter()
+ */
+#define MFRC630_TRACE_MASK(event) (1 << (event))
+
+/*!
+ * @brief One trace log record
+ */
+struct mfrc630_trace_record {
+  uint32_t us;   /**< micros() when the event was logged */
+  uint8_t event; /**< See mfrc630_trace_event */
+  uint8_t reg;   /**< Register, command or operation */
+  uint8_t value; /**< First byte, or contents of the ERROR register */
+  uint8_t len;   /**< Number of bytes or result, capped to 255 */
+};
+
 /**
  * Driver for the Adafruit MFRC630 RFID front-end.
  */
@@ -94,8 +450,10 @@ public:
    *
    * @param i2c_addr      The I2C address to use (default value is empty)
    * @param pdown_pin     The power down pin number (required)/
+   * @param irq_pin       The pin connected to the IC's IRQ output (optional)
    */
-  Adafruit_MFRC630(uint8_t i2c_addr, int8_t pdown_pin = -1);
+  Adafruit_MFRC630(uint8_t i2c_addr, int8_t pdown_pin = -1,
+                   int8_t irq_pin = -1);
 
   /**
    * Custom I2C bus constructor with user-defined I2C bus
@@ -103,8 +461,10 @@ public:
    * @param wireBus       The I2C bus to use
    * @param i2c_addr      The I2C address to use (default value is empty)
    * @param pdown_pin     The power down pin number (required)/
+   * @param irq_pin       The pin connected to the IC's IRQ output (optional)
    */
-  Adafruit_MFRC630(TwoWire *wireBus, uint8_t i2c_addr, int8_t pdown_pin = -1);
+  Adafruit_MFRC630(TwoWire *wireBus, uint8_t i2c_addr, int8_t pdown_pin = -1,
+                   int8_t irq_pin = -1);
 
   /**
    * HW SPI bus constructor
@@ -112,20 +472,32 @@ public:
    * @param transport     The transport to use when communicating with the IC
    * @param cs            The CS/Sel pin for HW SPI access.
    * @param pdown_pin     The power down pin number (required)/
+   * @param irq_pin       The pin connected to the IC's IRQ output (optional)
    *
    * @note This instance of the constructor requires the 'transport'
    *       parameter to distinguish is from the default I2C version.
    */
   Adafruit_MFRC630(enum mfrc630_transport transport, int8_t cs,
-                   int8_t pdown_pin = -1);
+                   int8_t pdown_pin = -1, int8_t irq_pin = -1);
 
   /**
    * SW serial bus constructor
    *
    * @param serial        The Serial instance to use
    * @param pdown_pin     The power down pin number (required)/
+   * @param irq_pin       The pin connected to the IC's IRQ output (optional)
    */
-  Adafruit_MFRC630(Stream *serial, int8_t pdown_pin = -1);
+  Adafruit_MFRC630(Stream *serial, int8_t pdown_pin = -1, int8_t irq_pin = -1);
+
+  /**
+   * Custom bus constructor
+   *
+   * @param bus           The transport to use, see Adafruit_MFRC630_Bus.
+   * @param pdown_pin     The power down pin number (optional)
+   * @param irq_pin       The pin connected to the IC's IRQ output (optional)
+   */
+  Adafruit_MFRC630(Adafruit_MFRC630_Bus *bus, int8_t pdown_pin = -1,
+                   int8_t irq_pin = -1);
 
   /**
    * Initialises the IC and performs some simple system checks.
@@ -136,7 +508,8 @@ public:
 
   /* FIFO helpers (see section 7.5) */
   /**
-   * Returns the number of bytes current in the FIFO buffer.
+   * Returns the number of bytes current in the FIFO buffer, once the
+   * receiver has finished writing the current frame.
    *
    * @return The number of bytes in the FIFO buffer.
    */
@@ -167,6 +540,57 @@ public:
    */
   void clearFIFO(void);
 
+  /**
+   * Selects the FIFO size, flushing the FIFO. The IC comes out of reset in
+   * 255 byte mode.
+   *
+   * @param size      255 or 512.
+   *
+   * @return True if the size was valid and has been applied.
+   */
+  bool setFIFOSize(uint16_t size);
+
+  /**
+   * Reads back the current FIFO size.
+   *
+   * @return 255 or 512.
+   */
+  uint16_t getFIFOSize(void);
+
+  /* EEPROM access (see docs/EEPROM.md) */
+  /**
+   * Reads a block of EEPROM memory.
+   *
+   * @param addr      The first EEPROM address to read.
+   * @param len       The number of bytes to read.
+   * @param buf       The buffer the data should be written into.
+   *
+   * @return The number of bytes read.
+   */
+  uint16_t eepromRead(uint16_t addr, uint16_t len, uint8_t *buf);
+
+  /**
+   * Writes a block of EEPROM memory, one 64 byte page at a time. Partial
+   * pages are read back and merged first. Only addresses between
+   * MFRC630_EEPROM_WRITE_START and MFRC630_EEPROM_WRITE_END can be written.
+   *
+   * @param addr      The first EEPROM address to write.
+   * @param len       The number of bytes to write.
+   * @param buf       The data to write.
+   *
+   * @return The number of bytes written.
+   */
+  uint16_t eepromWrite(uint16_t addr, uint16_t len, uint8_t *buf);
+
+  /**
+   * Returns the EEPROM transfer totals since power up, so the throughput
+   * can be worked out (bytes * 1000000 / us = bytes/s).
+   *
+   * @param bytes     Filled in with the number of bytes read or written.
+   * @param us        Filled in with the time spent on those transfers.
+   */
+  void getEEPROMStats(uint32_t *bytes, uint32_t *us);
+
   /* Command wrappers */
   /**
    * Sends an unparameterized command to the IC.
@@ -184,6 +608,14 @@ public:
    */
   void writeCommand(byte command, uint8_t paramlen, uint8_t *params);
 
+  /**
+   * Plays back a register script built with MFRC630_REGISTER_SCRIPT, issuing
+   * one auto-increment burst write per contiguous register run.
+   *
+   * @param script    The script's 'bytes' member (stored in flash).
+   */
+  void writeScript(const uint8_t *script);
+
   /* Radio config. */
   /**
    * Configures the radio for the specified protocol.
@@ -194,6 +626,33 @@ public:
    */
   bool configRadio(mfrc630radiocfg cfg);
 
+  /**
+   * Switches the TX and RX register sets with a single LOADPROTOCOL command,
+   * which copies them from the EEPROM register set protocol area (section
+   * 4). If the EEPROM can't provide the profile, the matching antenna table
+   * is uploaded instead. Either way, a 106 kbit/s transmitter gets the
+   * same driver settings for the board as configRadio() applies.
+   *
+   * @param rx    The protocol to load the receiver settings for.
+   * @param tx    The protocol to load the transmitter settings for.
+   *
+   * @return True if either the EEPROM or the table fallback succeeded.
+   */
+  bool loadProtocol(enum mfrc630protocol rx, enum mfrc630protocol tx);
+
+  /**
+   * Loads 'count' consecutive registers from a register set stored in the
+   * EEPROM user area (section 2), e.g. a custom profile written with
+   * eepromWrite(), using a single LOADREG command.
+   *
+   * @param addr      The EEPROM address of the register values.
+   * @param reg       The first register to load.
+   * @param count     The number of registers to load.
+   *
+   * @return True if the registers were loaded, otherwise false.
+   */
+  bool loadRegisters(uint16_t addr, uint8_t reg, uint8_t count);
+
   /* General helpers */
   /**
    * Returns the current 'comm status' of the IC's internal state machine.
@@ -207,6 +666,310 @@ public:
    */
   void softReset(void);
 
+  /* Low power card detection */
+  /**
+   * Measures the I/Q baseline used by LPCD. Run this with no card in the
+   * field; lpcdWait() repeats it whenever it wakes up without a card, so
+   * the baseline follows slow drift (temperature, nearby metal).
+   *
+   * @param i     Optional, filled in with the I channel baseline (0..63).
+   * @param q     Optional, filled in with the Q channel baseline (0..63).
+   *
+   * @return True if the measurement completed.
+   */
+  bool lpcdCalibrate(uint8_t *i = NULL, uint8_t *q = NULL);
+
+  /**
+   * Sets how far the I or Q channel may move away from the baseline before
+   * LPCD reports a card. Smaller is more sensitive, but wakes up on noise.
+   *
+   * @param threshold The allowed deviation, default MFRC630_LPCD_THRESHOLD.
+   */
+  void lpcdSetThreshold(uint8_t threshold);
+
+  /**
+   * Arms autonomous low power card detection. The IC goes into standby and
+   * T4 wakes it up every 'period_ms' for a short measurement, without any
+   * host traffic. A card raises LPCDIRQ (and the IRQ pin, if connected).
+   * Calibrates first if that hasn't been done yet.
+   *
+   * @param period_ms The time between two measurements.
+   *
+   * @return True if LPCD was armed.
+   */
+  bool lpcdStart(uint16_t period_ms = MFRC630_LPCD_PERIOD_MS);
+
+  /**
+   * Checks if the armed LPCD has detected something. With the IRQ pin
+   * connected this doesn't touch the bus.
+   *
+   * @return True once LPCDIRQ was raised.
+   */
+  bool lpcdCheck(void);
+
+  /**
+   * Stops LPCD, leaves standby and restores the radio settings changed by
+   * lpcdStart().
+   */
+  void lpcdStop(void);
+
+  /**
+   * Waits in LPCD mode until a card shows up. Each wakeup is confirmed with
+   * WUPA; a wakeup without a card recalibrates the baseline and goes back
+   * to LPCD. On success the radio is restored and the card is back in its
+   * IDLE state, ready for pollCard() or iso14443aRequest().
+   *
+   * @param timeout_ms    How long to wait, 0 to wait forever.
+   * @param period_ms     The time between two measurements.
+   *
+   * @return True if a card answered, false on timeout.
+   */
+  bool lpcdWait(uint32_t timeout_ms,
+                uint16_t period_ms = MFRC630_LPCD_PERIOD_MS);
+
+  /* Register shadow cache */
+  /**
+   * Enables or disables the write-through register shadow cache. When
+   * enabled, writes that wouldn't change a configuration register are
+   * skipped and reads of known configuration registers are served without
+   * a bus access. The cache is cleared and the counters reset on each call.
+   *
+   * @param enable    True to enable the cache, false to disable it.
+   */
+  void enableRegisterCache(bool enable);
+
+  /**
+   * Forgets all cached register values. This happens automatically on
+   * softReset() and the LOADREG/LOADPROTOCOL commands, but must be called
+   * if the IC is reset or reconfigured behind the driver's back.
+   */
+  void invalidateRegisterCache(void);
+
+  /**
+   * Returns the register shadow cache counters.
+   *
+   * @param hits      Accesses served or skipped without a bus access.
+   * @param misses    Lookups of cacheable registers whose value wasn't
+   *                  known, so the access hit the bus.
+   */
+  void getRegisterCacheStats(uint32_t *hits, uint32_t *misses);
+
+#if MFRC630_PERF_COUNTERS
+  /**
+   * Returns a snapshot of the performance counters of one operation type.
+   * Blocking and non-blocking operations are counted alike, from the
+   * start call to completion.
+   *
+   * @param op        The operation type to look at.
+   * @param counters  Filled in with the counters.
+   *
+   * @return False if 'op' is out of range.
+   */
+  bool getPerfCounters(enum mfrc630_perf_op op,
+                       struct mfrc630_perf_counters *counters);
+
+  /**
+   * Clears the performance counters of all operation types.
+   */
+  void resetPerfCounters(void);
+#endif
+
+#if MFRC630_TRACE_LOG
+  /**
+   * Selects the event types the trace log records, as a mask of
+   * MFRC630_TRACE_MASK() bits. All event types are recorded by default.
+   *
+   * @param mask      The event types to record.
+   */
+  void traceSetFilter(uint8_t mask);
+
+  /**
+   * Discards all records and the dropped record count.
+   */
+  void traceClear(void);
+
+  /**
+   * Removes the oldest records from the trace log.
+   *
+   * @param records   The buffer for the records.
+   * @param max       The number of records that fit in 'records'.
+   *
+   * @return The number of records copied into 'records'.
+   */
+  uint8_t traceRead(struct mfrc630_trace_record *records, uint8_t max);
+
+  /**
+   * Returns the number of records that were overwritten before they could
+   * be read, since the last traceDump() or traceClear().
+   *
+   * @return The number of dropped records.
+   */
+  uint32_t traceDropped(void);
+
+  /**
+   * Drains the trace log to 'out' as 'mfrc630_trace,us,event,reg,value,len'
+   * lines, followed by a 'mfrc630_trace_dropped,n' line if records were
+   * lost since the last dump. extras/mfrc630_trace_decode.py decodes them.
+   *
+   * @param out       Where to print the records, e.g. &Serial.
+   */
+  void traceDump(Print *out);
+#endif
+
+  /**
+   * Runs a single command/response exchange: loads 'frame->tx' into the
+   * FIFO, starts 'frame->command', waits for completion or the Timer0
+   * timeout and copies the response into 'frame->rx'. Framing registers
+   * (CRC, bit alignment, IRQ enables, Timer0) are only written when they
+   * differ from the previous exchange. Frames larger than the FIFO are
+   * streamed, refilling or draining the FIFO at MFRC630_FIFO_WATER_LEVEL.
+   * Fails straight away while a non-blocking operation is in flight.
+   *
+   * @param frame     The exchange to run.
+   * @param result    Filled in with the IRQ, error and length results.
+   *
+   * @return True if the command completed without an error or timeout.
+   */
+  bool transceive(struct mfrc630_frame *frame,
+                  struct mfrc630_frame_result *result);
+
+  /* Non-blocking operations */
+  /**
+   * Starts iso14443aSelect() without waiting for it. 'uid' and 'sak' must
+   * stay valid until the operation completes.
+   *
+   * @param uid       Pointer to the buffer for the UID (10 bytes).
+   * @param sak       Pointer to the placeholder for the SAK value.
+   * @param cb        Optional, called by poll() on completion.
+   * @param arg       Passed on to 'cb'.
+   *
+   * @return True if started, false if another operation is in flight.
+   */
+  bool startSelect(uint8_t *uid, uint8_t *sak, mfrc630_callback cb = NULL,
+                   void *arg = NULL);
+
+  /**
+   * Starts mifareAuth() without waiting for it.
+   *
+   * @param key_type  The key type to use, MIFARE_CMD_AUTH_A or B.
+   * @param blocknum  The block number to authenticate against.
+   * @param uid       The UID of the card (4 bytes, copied).
+   * @param cb        Optional, called by poll() on completion.
+   * @param arg       Passed on to 'cb'.
+   *
+   * @return True if started, false if another operation is in flight.
+   */
+  bool startMifareAuth(uint8_t key_type, uint8_t blocknum, uint8_t *uid,
+                       mfrc630_callback cb = NULL, void *arg = NULL);
+
+  /**
+   * Starts mifareReadBlock() without waiting for it. 'buf' must stay valid
+   * until the operation completes.
+   *
+   * @param blocknum  The block number to read.
+   * @param buf       The buffer for the 16 bytes of data.
+   * @param cb        Optional, called by poll() on completion.
+   * @param arg       Passed on to 'cb'.
+   *
+   * @return True if started, false if another operation is in flight.
+   */
+  bool startMifareReadBlock(uint8_t blocknum, uint8_t *buf,
+                            mfrc630_callback cb = NULL, void *arg = NULL);
+
+  /**
+   * Starts mifareWriteBlock() without waiting for it. 'buf' must stay
+   * valid until the operation completes.
+   *
+   * @param blocknum  The block number to write to.
+   * @param buf       The 16 bytes of data to write.
+   * @param cb        Optional, called by poll() on completion.
+   * @param arg       Passed on to 'cb'.
+   *
+   * @return True if started, false if another operation is in flight.
+   */
+  bool startMifareWriteBlock(uint16_t blocknum, uint8_t *buf,
+                             mfrc630_callback cb = NULL, void *arg = NULL);
+
+  /**
+   * Moves the operation in flight forward without blocking: checks if the
+   * current frame is done and, if so, sends the next one or completes the
+   * operation and calls its callback. Call this from the main loop.
+   *
+   * @return True while an operation is still in flight.
+   */
+  bool poll(void);
+
+  /**
+   * Checks if a non-blocking operation is in flight.
+   *
+   * @return True while an operation is in flight.
+   */
+  bool busy(void);
+
+  /**
+   * Returns the result of the last completed operation, the same value
+   * the blocking call would have returned (UID length, 1/0 for auth, bytes
+   * read or written).
+   *
+   * @return The result of the last completed operation.
+   */
+  uint16_t getResult(void);
+
+  /**
+   * Returns the outcome of the last frame or card operation, e.g. to tell
+   * a missing card (MFRC630_STATUS_TIMEOUT) from a corrupted response
+   * (MFRC630_STATUS_INTEGRITY) after a call returned 0 or false.
+   *
+   * @return The status of the last frame or operation.
+   */
+  enum mfrc630_status_code getStatus(void);
+
+  /**
+   * Sets how often an operation of type 'op' re-sends its current frame,
+   * instead of failing, when that frame ends with one of the status codes
+   * in 'mask'. No operation retries by default.
+   *
+   * Re-sending only helps while the card is still in the state the frame
+   * expects. A Mifare Classic card drops its authentication on any error,
+   * so after e.g. MFRC630_STATUS_PROTOCOL it is cheaper to reactivate it
+   * (pollCard(), iso14443aSelectUid()) and authenticate again than to
+   * softReset() the IC.
+   *
+   * @param op        The operation type.
+   * @param retries   The number of re-sends per operation, 0 to disable.
+   * @param mask      MFRC630_STATUS_MASK() bits of the codes to retry on.
+   *
+   * @return False if 'op' is not a valid operation type.
+   */
+  bool setRetryPolicy(enum mfrc630_op op, uint8_t retries, uint16_t mask);
+
+  /**
+   * Overrides the frame wait timeout of one class of card frames, e.g. for
+   * a card that is known to answer slowly. By default a class waits for
+   * its MFRC630_TIMEOUT_*_US. Reads and writes then time the first
+   * MFRC630_TIMEOUT_SAMPLES responses of the selected card and wait for
+   * twice the longest of them plus MFRC630_TIMEOUT_MARGIN_US, so a card
+   * that went away is noticed quickly. A timeout, or selecting another
+   * card, goes back to the default. ISO14443-4 frames use the FWT from the
+   * card's ATS instead.
+   *
+   * @param cls       The frame class.
+   * @param us        The timeout in microseconds (up to 309000), or 0 to
+   *                  go back to the computed one.
+   *
+   * @return False if 'cls' is not a computed frame class.
+   */
+  bool setFrameTimeout(enum mfrc630_timeout_class cls, uint32_t us);
+
+  /**
+   * Returns the frame wait timeout the next frame of a class will use.
+   *
+   * @param cls       The frame class.
+   *
+   * @return The timeout in microseconds, 0 if 'cls' is not valid.
+   */
+  uint32_t getFrameTimeout(enum mfrc630_timeout_class cls);
+
   /* Generic ISO14443a commands (common to any supported card variety). */
   /**
    * Sends the REQA command, requesting an ISO14443A-106 tag.
@@ -232,6 +995,125 @@ public:
    */
   uint8_t iso14443aSelect(uint8_t *uid, uint8_t *sak);
 
+  /**
+   * Selects a card with a known UID directly, skipping anticollision.
+   *
+   * @param uid       The UID of the card to select.
+   * @param uidlen    The length of the UID (4, 7 or 10).
+   * @param sak       Pointer to the placeholder for the SAK value.
+   *
+   * @return True if the card answered at every cascade level.
+   */
+  bool iso14443aSelectUid(uint8_t *uid, uint8_t uidlen, uint8_t *sak);
+
+  /**
+   * Sends HLTA, putting the selected card into the HALT state where it
+   * only answers WUPA.
+   *
+   * @return True if the card accepted the halt (it stays silent).
+   */
+  bool iso14443aHalt(void);
+
+  /**
+   * Tracks the card in the field without resetting the reader. When no
+   * card is known, a WUPA plus anticollision looks for one. Once a card is
+   * known, each call halts it (or deselects it after ISO14443-4), wakes it
+   * with WUPA and selects it by UID. A card that went away costs a
+   * single WUPA timeout (MFRC630_TIMEOUT_ACTIVATION_US).
+   * The card is left selected after ARRIVED and PRESENT, ready for a
+   * session.
+   *
+   * @param uid       Optional, filled in with the UID of the card.
+   * @param uidlen    Optional, filled in with the length of the UID.
+   * @param sak       Optional, filled in with the SAK of the card.
+   *
+   * @return The presence event, see mfrc630_card_event.
+   */
+  enum mfrc630_card_event pollCard(uint8_t *uid, uint8_t *uidlen,
+                                   uint8_t *sak);
+
+  /**
+   * Sends RATS to a selected ISO14443-4 card, switching it to ISO-DEP.
+   *
+   * @param fsdi  The reader's frame size code (0..8, 8 = 256 bytes).
+   * @param cid   The card identifier to assign (0..14).
+   * @param ats   The buffer the answer to select should be written into.
+   * @param len   The size of 'ats'.
+   *
+   * @return The length of the ATS, or 0 if the card didn't answer.
+   */
+  uint8_t iso14443aRats(uint8_t fsdi, uint8_t cid, uint8_t *ats, uint8_t len);
+
+  /**
+   * Sends a PPS request and, once the card has acknowledged it, switches
+   * the reader's receiver and transmitter to the new bit rates.
+   *
+   * @param cid   The card identifier used in RATS.
+   * @param dsi   The card to reader (receive) bit rate.
+   * @param dri   The reader to card (transmit) bit rate.
+   *
+   * @return True if the card accepted the new bit rates.
+   */
+  bool iso14443aPPS(uint8_t cid, enum iso14443_bitrate dsi,
+                    enum iso14443_bitrate dri);
+
+  /**
+   * Picks the fastest bit rates advertised in TA(1) of an ATS (up to
+   * 'max') and applies them with iso14443aPPS(). Cards that don't
+   * advertise anything faster stay at 106 kbit/s without a PPS exchange.
+   *
+   * @param ats       The ATS returned by iso14443aRats().
+   * @param atslen    The length of the ATS.
+   * @param cid       The card identifier used in RATS.
+   * @param max       The fastest bit rate to consider.
+   * @param dsi       Optional, filled in with the receive bit rate in use.
+   * @param dri       Optional, filled in with the transmit bit rate in use.
+   *
+   * @return True unless the PPS exchange failed.
+   */
+  bool iso14443aNegotiateBitrate(uint8_t *ats, uint8_t atslen, uint8_t cid,
+                                 enum iso14443_bitrate max,
+                                 enum iso14443_bitrate *dsi,
+                                 enum iso14443_bitrate *dri);
+
+  /* ISO14443-4 (T=CL) transport */
+  /**
+   * Activates ISO14443-4 on a selected card: sends RATS (FSD =
+   * MFRC630_ISODEP_FSD, CID 0) and picks up the card's frame size (FSC),
+   * frame wait time and start-up guard time from the ATS.
+   *
+   * @param ats   The buffer the answer to select should be written into.
+   * @param len   The size of 'ats'.
+   *
+   * @return The length of the ATS, or 0 if the activation failed.
+   */
+  uint8_t isoDepActivate(uint8_t *ats, uint8_t len);
+
+  /**
+   * Sends an APDU to the activated card and collects the response,
+   * splitting the command into I-blocks filled up to the card's FSC and
+   * acknowledging chained response blocks. Waiting time extensions
+   * (S(WTX)) are granted and lost blocks are recovered with R(NAK).
+   *
+   * @param apdu      The command APDU.
+   * @param len       The length of the command APDU.
+   * @param resp      The buffer the response APDU should be written into.
+   * @param resplen   The size of 'resp', which needs one spare byte on top
+   *                  of the longest expected response (for the PCB).
+   *
+   * @return The length of the response APDU, or 0 if the exchange failed
+   *         or the response didn't fit into 'resp'.
+   */
+  uint16_t exchange(uint8_t *apdu, uint16_t len, uint8_t *resp,
+                    uint16_t resplen);
+
+  /**
+   * Sends S(DESELECT), putting the card into the HALT state.
+   *
+   * @return True if the card acknowledged the deselect.
+   */
+  bool isoDepDeselect(void);
+
   /* Mifare commands. */
   /**
    * Loads the specified authentication keys on the IC.
@@ -240,6 +1122,27 @@ public:
    */
   void mifareLoadKey(uint8_t *key);
 
+  /**
+   * Stores a Mifare key in one of the IC's write-only EEPROM key slots, so
+   * it can later be loaded with mifareLoadKeyE2() without ever crossing the
+   * host bus again.
+   *
+   * @param slot  The key slot (0..MFRC630_KEY_SLOTS-1).
+   * @param key   Pointer to the buffer containing the 6 key bytes.
+   *
+   * @return True if the key was written, otherwise false.
+   */
+  bool mifareStoreKeyE2(uint8_t slot, uint8_t *key);
+
+  /**
+   * Loads the key stored in an EEPROM key slot into the crypto unit.
+   *
+   * @param slot  The key slot (0..MFRC630_KEY_SLOTS-1).
+   *
+   * @return True if the key was loaded, otherwise false.
+   */
+  bool mifareLoadKeyE2(uint8_t slot);
+
   /**
    * Authenticates the selected card using the previously supplied key/
    *
@@ -251,6 +1154,20 @@ public:
    */
   bool mifareAuth(uint8_t key_type, uint8_t blocknum, uint8_t *uid);
 
+  /**
+   * Loads a key from an EEPROM key slot and authenticates the selected card
+   * with it.
+   *
+   * @param key_type  Whether to use KEYA or KEYB for authentication.
+   * @param slot      The key slot (0..MFRC630_KEY_SLOTS-1).
+   * @param blocknum  The block number to authenticate.
+   * @param uid       The UID of the card to authenticate.
+   *
+   * @return True if the authentication succeeded, otherwise false.
+   */
+  bool mifareAuthE2(uint8_t key_type, uint8_t slot, uint8_t blocknum,
+                    uint8_t *uid);
+
   /**
    * Reads the contents of the specified (and previously authenticated)
    * memory block.
@@ -273,6 +1190,71 @@ public:
    */
   uint16_t mifareWriteBlock(uint16_t blocknum, uint8_t *buf);
 
+  /**
+   * Authenticates a sector once and reads all of its blocks back-to-back.
+   *
+   * @param key_type  Whether to use KEYA or KEYB for authentication.
+   * @param sector    The sector number (0..39, sectors 32+ are 4K only).
+   * @param uid       The UID of the card to authenticate.
+   * @param buf       The buffer the data should be written into (must hold
+   *                  mifareSectorBlocks(sector) * 16 bytes).
+   * @param uidlen    The length of 'uid' (4 or 7), the last four bytes are
+   *                  used for the authentication.
+   *
+   * @return The number of bytes read, or 0 if the auth or a read failed.
+   */
+  uint16_t mifareReadSector(uint8_t key_type, uint8_t sector, uint8_t *uid,
+                            uint8_t *buf, uint8_t uidlen = 4);
+
+  /**
+   * Reads every sector of a selected Mifare Classic card using the
+   * previously loaded key. Sectors that can't be read are zero-filled, and
+   * the card is woken up and reselected after a failure so the remaining
+   * sectors can still be read.
+   *
+   * @param layout    MIFARE_LAYOUT_1K (1024 bytes) or MIFARE_LAYOUT_4K
+   *                  (4096 bytes).
+   * @param key_type  Whether to use KEYA or KEYB for authentication.
+   * @param uid       The UID of the card to authenticate.
+   * @param buf       The buffer the card contents should be written into.
+   * @param status    Optional (may be NULL) array of mifareSectorCount()
+   *                  entries that receives a mifare_sector_status per sector.
+   * @param uidlen    The length of 'uid' (4 or 7). A reselected card must
+   *                  return the same UID.
+   *
+   * @return The number of sectors that were read successfully.
+   */
+  uint8_t mifareReadCard(enum mifare_layout layout, uint8_t key_type,
+                         uint8_t *uid, uint8_t *buf, uint8_t *status,
+                         uint8_t uidlen = 4);
+
+  /**
+   * Returns the number of sectors for a Mifare Classic memory layout.
+   *
+   * @param layout    The card layout.
+   *
+   * @return 16 for 1K cards, 40 for 4K cards.
+   */
+  static uint8_t mifareSectorCount(enum mifare_layout layout);
+
+  /**
+   * Returns the number of blocks in a Mifare Classic sector.
+   *
+   * @param sector    The sector number.
+   *
+   * @return 4, or 16 for the large sectors (32..39) on 4K cards.
+   */
+  static uint8_t mifareSectorBlocks(uint8_t sector);
+
+  /**
+   * Returns the first block number of a Mifare Classic sector.
+   *
+   * @param sector    The sector number.
+   *
+   * @return The absolute block number.
+   */
+  static uint8_t mifareSectorFirstBlock(uint8_t sector);
+
   /**
    * The default key for fresh Mifare cards.
    */
@@ -294,6 +1276,22 @@ public:
    */
   uint16_t ntagReadPage(uint16_t pagenum, uint8_t *buf);
 
+  /**
+   * Reads a range of pages, using every byte the card returns. FAST_READ
+   * fetches as many pages as fit in the FIFO (63, or 128 in 512 byte mode)
+   * per exchange, READ (for cards without FAST_READ) fetches four.
+   *
+   * @param pagenum   The first page number to read.
+   * @param count     The number of pages to read.
+   * @param buf       The buffer the data should be written into (must hold
+   *                  count * 4 bytes).
+   * @param fastread  Use FAST_READ (NTAG21x) rather than READ.
+   *
+   * @return The number of bytes read.
+   */
+  uint16_t ntagReadPages(uint16_t pagenum, uint16_t count, uint8_t *buf,
+                         bool fastread = true);
+
   /**
    * Writes the supplied content of the specified page.
    *
@@ -306,20 +1304,235 @@ public:
 
 private:
   int8_t _pdown;
+  int8_t _irq;
+  uint8_t _irqpin_en;
+
+  /* Set while no command runs, so frameStart() needn't cancel one */
+  bool _cmd_idle;
+
+  /* Framing registers last written by transceive() */
+  bool _framecfg_valid;
+  struct {
+    uint8_t crc[3];    /* TX_CRC_PRESET, RX_CRC_CON, TX_DATA_NUM */
+    uint8_t rxbitctrl; /* RX_BIT_CTRL */
+    uint8_t irqen[2];  /* IRQOEN, IRQ1EN */
+    uint16_t timeout;  /* Timer0 reload value */
+    uint8_t fifoctrl;  /* FIFO_CONTROL configuration bits (see clearFIFO) */
+  } _framecfg;
+
+  /* Write-through register shadow (see enableRegisterCache) */
+  bool _regcache_enabled;
+  uint8_t _regcache[MFRC630_REGCACHE_LEN];
+  uint8_t _regcache_valid[(MFRC630_REGCACHE_LEN + 7) / 8];
+  uint32_t _regcache_hits;
+  uint32_t _regcache_misses;
+
+  /* Low power card detection state (see lpcdCalibrate) */
+  struct {
+    bool calibrated;   /* Set once i/q hold a baseline */
+    bool armed;        /* Set while LPCD is running */
+    uint8_t i;         /* I channel baseline */
+    uint8_t q;         /* Q channel baseline */
+    uint8_t threshold; /* Allowed deviation from the baseline */
+    uint8_t saved[3];  /* DRV_MOD, RCV and RX_ANA to restore afterwards */
+  } _lpcd;
+
+  /* Frame started by frameStart(), until frameFinish() */
+  struct {
+    bool active;                 /* Set while the command runs */
+    bool stream;                 /* Larger than the FIFO, see frameDone() */
+    bool drain;                  /* RX read while it arrives, see frameDone() */
+    struct mfrc630_frame *frame; /* The frame on air */
+    uint16_t sent;               /* TX bytes loaded into the FIFO so far */
+    uint16_t received;           /* RX bytes drained from the FIFO so far */
+    uint8_t pending;             /* Drain: bytes seen in the FIFO, not read */
+    bool emptied;                /* FIFO left empty by the last frame */
+    uint8_t irq0;                /* IRQ0 once the frame was done, if polled */
+    uint8_t irq1;                /* IRQ1 once the frame was done */
+    bool timedout;               /* Given up on without a Timer0 IRQ */
+    uint32_t start;              /* millis() when the command started */
+    uint32_t deadline;           /* Polling limit in ms from 'start' */
+  } _xfer;
+
+  /* Non-blocking operation in flight (see poll) */
+  struct {
+    enum mfrc630_op op;              /* MFRC630_OP_NONE when idle */
+    uint8_t state;                   /* Step within the operation */
+    uint16_t result;                 /* Result once completed */
+    mfrc630_callback cb;             /* Completion callback */
+    void *arg;                       /* Passed on to 'cb' */
+    struct mfrc630_frame frame;      /* Frame currently on air */
+    struct mfrc630_frame_result res; /* Outcome of the last frame */
+    uint8_t *buf;                    /* UID (select) or block data */
+    uint8_t *sak;                    /* SAK placeholder (select) */
+    uint8_t tx[10];                  /* Request, room for anticollision */
+    uint8_t rx[5];                   /* UID + BCC, SAK or ACK */
+    uint8_t cascadelvl;              /* Select: cascade level (1..3) */
+    uint8_t cnum;                    /* Select: anticollision attempts */
+    uint8_t kbits;                   /* Select: UID bits known so far */
+    uint8_t retries;                 /* Frames re-sent so far */
+  } _op;
+
+  /* Retry policy per operation type (see setRetryPolicy) */
+  struct {
+    uint8_t retries; /* Re-sends per operation */
+    uint16_t mask;   /* MFRC630_STATUS_MASK() bits to retry on */
+  } _retry[MFRC630_OP_WRITE];
+
+  /* Outcome of the last frame or operation (see getStatus) */
+  enum mfrc630_status_code _status;
+
+  /* Frame wait timeout per class, in Timer0 ticks (see setFrameTimeout) */
+  struct {
+    uint16_t override; /* Set by the caller, 0 = computed */
+    uint16_t longest;  /* Longest response delay timed on this card */
+    uint8_t samples;   /* Response delays timed on this card */
+  } _tmo[MFRC630_TIMEOUT_CLASS_COUNT];
+  uint8_t _tmo_uid[10]; /* Card the delays were timed on */
+  uint8_t _tmo_uidlen;
+
+  /* Card tracked by pollCard() */
+  struct {
+    bool present;
+    uint8_t uid[10];
+    uint8_t uidlen;
+    uint8_t sak;
+  } _card;
+
+  /* ISO14443-4 session state (see isoDepActivate) */
+  struct {
+    bool active;   /* Set once the ATS has been received */
+    uint8_t block; /* Current block number (0 or 1) */
+    uint16_t fsc;  /* Card frame size, capped to MFRC630_ISODEP_FSD */
+    uint16_t fwt;  /* Frame wait time in Timer0 ticks */
+  } _isodep;
+
+#if MFRC630_PERF_COUNTERS
+  /* Performance counters (see getPerfCounters) */
+  struct {
+    struct mfrc630_perf_counters ops[MFRC630_PERF_OP_COUNT];
+    struct mfrc630_perf_counters *cur; /* Operation in flight, or NULL */
+    uint32_t start;                    /* micros() when it started */
+  } _perf;
+#endif
+
+#if MFRC630_TRACE_LOG
+  /* Binary trace log ring buffer (see traceRead) */
+  struct {
+    struct mfrc630_trace_record buf[MFRC630_TRACE_LOG_LEN];
+    uint8_t head;     /* Next record to write */
+    uint8_t count;    /* Records not read yet */
+    uint8_t filter;   /* MFRC630_TRACE_MASK() bits of the recorded events */
+    uint32_t dropped; /* Records overwritten before they were read */
+  } _trace;
+#endif
+
+  /* EEPROM transfer totals (see getEEPROMStats) */
+  uint32_t _eeprom_bytes;
+  uint32_t _eeprom_us;
+
+  /* FIFO size, refreshed whenever FIFO_CONTROL is read or written */
+  uint16_t _fifosize;
+
+  /* Last four NTAG pages returned by READ (see ntagReadPage) */
+  bool _ntagcache_valid;
+  uint16_t _ntagcache_page;
+  uint8_t _ntagcache[16];
+
   uint8_t _i2c_addr;
   TwoWire *_wire;
   Stream *_serial;
   int8_t _cs;
-  enum mfrc630_transport _transport;
+
+  /* Bus access functions of one transport, bound by the constructors */
+  struct bus_ops {
+    void (Adafruit_MFRC630::*begin)(void);
+    void (Adafruit_MFRC630::*write)(byte reg, uint16_t len, uint8_t *buffer);
+    uint16_t (Adafruit_MFRC630::*read)(byte reg, uint16_t len,
+                                       uint8_t *buffer);
+  };
+  static const struct bus_ops i2c_bus;
+  static const struct bus_ops spi_bus;
+  static const struct bus_ops serial_bus;
+  static const struct bus_ops custom_bus;
+  const struct bus_ops *_bus;
+  Adafruit_MFRC630_Bus *_custom;
+
+  void initState(int8_t pdown_pin, int8_t irq_pin);
+  void i2cBegin(void);
+  void i2cWrite(byte reg, uint16_t len, uint8_t *buffer);
+  uint16_t i2cRead(byte reg, uint16_t len, uint8_t *buffer);
+  void spiBegin(void);
+  void spiWrite(byte reg, uint16_t len, uint8_t *buffer);
+  uint16_t spiRead(byte reg, uint16_t len, uint8_t *buffer);
+  void serialBegin(void);
+  void serialWrite(byte reg, uint16_t len, uint8_t *buffer);
+  uint16_t serialRead(byte reg, uint16_t len, uint8_t *buffer);
+  void customBegin(void);
+  void customWrite(byte reg, uint16_t len, uint8_t *buffer);
+  uint16_t customRead(byte reg, uint16_t len, uint8_t *buffer);
+
+#if MFRC630_PERF_COUNTERS
+  void perfBegin(enum mfrc630_perf_op op);
+  void perfEnd(void);
+  void perfBook(struct mfrc630_perf_counters *c, uint32_t start);
+#endif
+#if MFRC630_TRACE_LOG
+  void traceLog(uint8_t event, uint8_t reg, uint8_t value, uint16_t len);
+#endif
 
   void write8(byte reg, byte value);
   void writeBuffer(byte reg, uint16_t len, uint8_t *buffer);
+  uint16_t readBuffer(byte reg, uint16_t len, uint8_t *buffer);
   byte read8(byte reg);
 
+  void frameStart(struct mfrc630_frame *frame);
+  void frameRestart(struct mfrc630_frame *frame);
+  void frameRegs(struct mfrc630_frame *frame, uint8_t *regs);
+  void frameRearm(uint16_t timeout);
+  void frameLaunch(struct mfrc630_frame *frame, uint16_t timeout,
+                   uint16_t sent, bool stream);
+  bool frameDone(void);
+  bool frameFinish(struct mfrc630_frame_result *result);
+  uint8_t frameDrain(void);
+  void readFrameData(struct mfrc630_frame *frame, uint16_t len,
+                     uint16_t *received);
+  void writeFrameRegs(byte reg, uint8_t len, uint8_t *values, uint8_t *cached);
+  void invalidateCaches(byte command);
+  bool regCacheLookup(byte reg, const uint8_t *map, uint8_t *value);
+  void regCacheStore(byte reg, uint8_t value, const uint8_t *map);
+
   void printHex(uint8_t *buf, size_t len);
   void printError(enum mfrc630errors err);
 
   uint16_t iso14443aCommand(enum iso14443_cmd cmd);
+  uint16_t isoDepFrame(uint8_t *tx, uint16_t txlen, uint8_t *rx,
+                       uint16_t rxlen);
+  void lpcdRun(uint16_t t4reload, uint8_t t4control, uint8_t command);
+  void lpcdRestore(void);
+  bool runCommand(byte command, uint8_t *params, uint16_t paramlen,
+                  uint8_t *rx, uint16_t rxlen);
+  bool eepromWritePage(uint8_t page, uint8_t *data);
+  bool opBegin(enum mfrc630_op op, mfrc630_callback cb, void *arg);
+  void opStep(void);
+  void opComplete(uint16_t result);
+  bool opRetry(void);
+  uint16_t frameTimeout(enum mfrc630_timeout_class cls);
+  void frameTimeoutCard(uint8_t *uid, uint8_t uidlen);
+  uint16_t opRun(void);
+  void selectStep(void);
+  void selectAnticoll(void);
+  void selectAnticollFrame(void);
+  void selectSelect(void);
+  void mifareAuthStep(void);
+  void mifareReadStep(void);
+  void mifareWriteStep(void);
+  void mifareAckFrame(uint8_t *data, uint16_t len);
+  bool mifareAckResult(void);
+  uint16_t ntagReadFrame(uint8_t *req, uint8_t reqlen, uint8_t *buf,
+                         uint16_t len);
+  bool mifareReadBlocks(uint8_t blocknum, uint8_t count, uint8_t *buf);
+  bool mifareReactivate(uint8_t *uid, uint8_t uidlen);
 };
 
 #endif
@@ -0,0 +1,291 @@
+/*!
+ * @file Adafruit_MFRC630_Group.cpp
+ *
+ * Round-robin scheduler for several MFRC630 readers, see
+ * Adafruit_MFRC630_Group.h.
+ *
+ * BSD license, all text above must be included in any redistribution
+ */
+
+#include "Adafruit_MFRC630_Group.h"
+
+/**************************************************************************/
+/*!
+    @brief  Instantiates an empty reader group
+*/
+/**************************************************************************/
+Adafruit_MFRC630_Group::Adafruit_MFRC630_Group(void) {
+  _count = 0;
+  _next = 0;
+  _idle_cb = NULL;
+  _idle_arg = NULL;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Adds a reader to the group
+
+    @param  reader  The reader to add.
+
+    @returns The index of the reader, or -1 if the group is full.
+*/
+/**************************************************************************/
+int8_t Adafruit_MFRC630_Group::addReader(Adafruit_MFRC630 *reader) {
+  if (_count >= MFRC630_GROUP_MAX_READERS) {
+    return -1;
+  }
+
+  struct slot *s = &_slots[_count];
+  memset(s, 0, sizeof(*s));
+  s->reader = reader;
+
+  return _count++;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the number of readers in the group
+
+    @returns The number of readers.
+*/
+/**************************************************************************/
+uint8_t Adafruit_MFRC630_Group::count(void) { return _count; }
+
+/**************************************************************************/
+/*!
+    @brief  Returns a reader of the group
+
+    @param  index   The index returned by addReader().
+
+    @returns The reader, or NULL if 'index' is out of range.
+*/
+/**************************************************************************/
+Adafruit_MFRC630 *Adafruit_MFRC630_Group::reader(uint8_t index) {
+  return (index < _count) ? _slots[index].reader : NULL;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Sets the callback that hands idle readers their next operation
+
+    @param  cb      The callback, or NULL to disable it.
+    @param  arg     Passed on to 'cb'.
+*/
+/**************************************************************************/
+void Adafruit_MFRC630_Group::onIdle(mfrc630_group_idle cb, void *arg) {
+  _idle_cb = cb;
+  _idle_arg = arg;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Looks up reader 'index' for an operation about to start
+
+    @returns The reader's slot, or NULL if the reader is busy or unknown.
+*/
+/**************************************************************************/
+struct Adafruit_MFRC630_Group::slot *
+Adafruit_MFRC630_Group::claim(uint8_t index) {
+  if ((index >= _count) || _slots[index].reader->busy()) {
+    return NULL;
+  }
+
+  return &_slots[index];
+}
+
+/**************************************************************************/
+/*!
+    @brief  Records the caller's callback and the start time once the
+            operation on slot 's' is running, so a start that failed
+            leaves the slot as it was
+*/
+/**************************************************************************/
+void Adafruit_MFRC630_Group::commit(struct slot *s, mfrc630_callback cb,
+                                    void *arg, uint32_t start_us) {
+  s->cb = cb;
+  s->arg = arg;
+  s->start_us = start_us;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Completion callback of every operation started by the group:
+            updates the reader's statistics and calls the caller's callback
+*/
+/**************************************************************************/
+void Adafruit_MFRC630_Group::opDone(enum mfrc630_op op, uint16_t result,
+                                    void *arg) {
+  struct slot *s = (struct slot *)arg;
+  uint32_t us = micros() - s->start_us;
+
+  s->stats.ops++;
+  if (!result) {
+    s->stats.failures++;
+  }
+  s->stats.total_us += us;
+  if (us > s->stats.max_us) {
+    s->stats.max_us = us;
+  }
+
+  if (s->cb) {
+    s->cb(op, result, s->arg);
+  }
+}
+
+/*
+ * The operations below start the matching Adafruit_MFRC630 call on one
+ * reader, with opDone() in between for the statistics. The operations
+ * don't complete before their start call returns, so the slot can be
+ * filled in afterwards.
+ */
+bool Adafruit_MFRC630_Group::startSelect(uint8_t index, uint8_t *uid,
+                                         uint8_t *sak, mfrc630_callback cb,
+                                         void *arg) {
+  struct slot *s = claim(index);
+  uint32_t start_us = micros();
+
+  if (!s || !s->reader->startSelect(uid, sak, opDone, s)) {
+    return false;
+  }
+  commit(s, cb, arg, start_us);
+
+  return true;
+}
+
+bool Adafruit_MFRC630_Group::startMifareAuth(uint8_t index, uint8_t key_type,
+                                             uint8_t blocknum, uint8_t *uid,
+                                             mfrc630_callback cb, void *arg) {
+  struct slot *s = claim(index);
+  uint32_t start_us = micros();
+
+  if (!s || !s->reader->startMifareAuth(key_type, blocknum, uid, opDone, s)) {
+    return false;
+  }
+  commit(s, cb, arg, start_us);
+
+  return true;
+}
+
+bool Adafruit_MFRC630_Group::startMifareReadBlock(uint8_t index,
+                                                  uint8_t blocknum,
+                                                  uint8_t *buf,
+                                                  mfrc630_callback cb,
+                                                  void *arg) {
+  struct slot *s = claim(index);
+  uint32_t start_us = micros();
+
+  if (!s || !s->reader->startMifareReadBlock(blocknum, buf, opDone, s)) {
+    return false;
+  }
+  commit(s, cb, arg, start_us);
+
+  return true;
+}
+
+bool Adafruit_MFRC630_Group::startMifareWriteBlock(uint8_t index,
+                                                   uint16_t blocknum,
+                                                   uint8_t *buf,
+                                                   mfrc630_callback cb,
+                                                   void *arg) {
+  struct slot *s = claim(index);
+  uint32_t start_us = micros();
+
+  if (!s || !s->reader->startMifareWriteBlock(blocknum, buf, opDone, s)) {
+    return false;
+  }
+  commit(s, cb, arg, start_us);
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Runs one round-robin scheduling round over all readers
+
+    @returns True while any reader has an operation in flight.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630_Group::service(void) {
+  bool busy = false;
+
+  for (uint8_t n = 0; n < _count; n++) {
+    uint8_t index = (_next + n) % _count;
+    struct slot *s = &_slots[index];
+
+    /*
+     * A busy reader only costs one IRQ check here (none with the IRQ pin
+     * wired up) while its card is answering, so the bus is free for the
+     * others in the meantime.
+     */
+    if (s->reader->busy()) {
+      s->stats.polls++;
+      s->reader->poll();
+    }
+
+    if (!s->reader->busy() && _idle_cb) {
+      _idle_cb(this, index, _idle_arg);
+    }
+
+    busy |= s->reader->busy();
+  }
+
+  /* Rotate the starting point for fairness */
+  if (_count) {
+    _next = (_next + 1) % _count;
+  }
+
+  return busy;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Services the readers until none has an operation in flight
+
+    @param  timeout_ms  How long to wait at most, 0 to wait forever.
+
+    @returns True if all readers went idle, false on timeout.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630_Group::waitAll(uint32_t timeout_ms) {
+  uint32_t start = millis();
+
+  while (service()) {
+    if (timeout_ms && ((millis() - start) > timeout_ms)) {
+      return false;
+    }
+    yield();
+  }
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Returns the scheduling statistics of one reader
+
+    @param  index   The reader to look at.
+    @param  stats   Filled in with the statistics.
+
+    @returns False if 'index' is out of range.
+*/
+/**************************************************************************/
+bool Adafruit_MFRC630_Group::getStats(uint8_t index,
+                                      struct mfrc630_reader_stats *stats) {
+  if (index >= _count) {
+    return false;
+  }
+
+  *stats = _slots[index].stats;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Clears the statistics of all readers
+*/
+/**************************************************************************/
+void Adafruit_MFRC630_Group::resetStats(void) {
+  for (uint8_t i = 0; i < _count; i++) {
+    memset(&_slots[i].stats, 0, sizeof(_slots[i].stats));
+  }
+}
@@ -0,0 +1,208 @@
+/*!
+ * @file Adafruit_MFRC630_Group.h
+ *
+ * Scheduler for several MFRC630 readers on one controller.
+ *
+ * Each reader runs its card operations with the non-blocking start/poll
+ * API, and the group polls them round-robin, so while one reader waits for
+ * its card to answer the others get their bus work done. A reader that
+ * goes idle can be handed its next operation from an idle callback.
+ *
+ * Example:
+ *
+ *   Adafruit_MFRC630 a(0x28), b(0x29);
+ *   Adafruit_MFRC630_Group group;
+ *   group.addReader(&a);
+ *   group.addReader(&b);
+ *   group.onIdle(next_operation, NULL);
+ *   ...
+ *   loop() { group.service(); }
+ */
+#ifndef __ADAFRUIT_MFRC630_GROUP_H__
+#define __ADAFRUIT_MFRC630_GROUP_H__
+
+#include "Adafruit_MFRC630.h"
+
+/*!
+ * @brief Maximum number of readers in one Adafruit_MFRC630_Group
+ */
+#define MFRC630_GROUP_MAX_READERS (8)
+
+/*!
+ * @brief Per-reader scheduling statistics
+ */
+struct mfrc630_reader_stats {
+  uint32_t ops;      /**< Operations completed */
+  uint32_t failures; /**< Operations that completed with a 0 result */
+  uint32_t polls;    /**< poll() calls spent on this reader */
+  uint32_t total_us; /**< Sum of the start to completion latencies */
+  uint32_t max_us;   /**< Worst start to completion latency */
+};
+
+class Adafruit_MFRC630_Group;
+
+/*!
+ * @brief Called by service() for each idle reader, in round-robin order,
+ *        so it can be given its next operation
+ */
+typedef void (*mfrc630_group_idle)(Adafruit_MFRC630_Group *group,
+                                   uint8_t index, void *arg);
+
+/**
+ * Interleaves the card operations of several Adafruit_MFRC630 instances.
+ */
+class Adafruit_MFRC630_Group {
+public:
+  Adafruit_MFRC630_Group(void);
+
+  /**
+   * Adds a reader to the group. It must already be set up with begin().
+   *
+   * @param reader    The reader to add.
+   *
+   * @return The index of the reader in the group, or -1 if it is full.
+   */
+  int8_t addReader(Adafruit_MFRC630 *reader);
+
+  /**
+   * Returns the number of readers in the group.
+   *
+   * @return The number of readers.
+   */
+  uint8_t count(void);
+
+  /**
+   * Returns a reader of the group, e.g. for blocking calls while it is
+   * idle.
+   *
+   * @param index     The index returned by addReader().
+   *
+   * @return The reader, or NULL if 'index' is out of range.
+   */
+  Adafruit_MFRC630 *reader(uint8_t index);
+
+  /**
+   * Sets the callback service() uses to hand idle readers their next
+   * operation.
+   *
+   * @param cb        The callback, or NULL to disable it.
+   * @param arg       Passed on to 'cb'.
+   */
+  void onIdle(mfrc630_group_idle cb, void *arg);
+
+  /**
+   * Starts Adafruit_MFRC630::startSelect() on one reader.
+   *
+   * @param index     The reader to use.
+   * @param uid       Pointer to the buffer for the UID (10 bytes).
+   * @param sak       Pointer to the placeholder for the SAK value.
+   * @param cb        Optional, called on completion.
+   * @param arg       Passed on to 'cb'.
+   *
+   * @return True if started, false if the reader is busy or unknown.
+   */
+  bool startSelect(uint8_t index, uint8_t *uid, uint8_t *sak,
+                   mfrc630_callback cb = NULL, void *arg = NULL);
+
+  /**
+   * Starts Adafruit_MFRC630::startMifareAuth() on one reader.
+   *
+   * @param index     The reader to use.
+   * @param key_type  The key type to use, MIFARE_CMD_AUTH_A or B.
+   * @param blocknum  The block number to authenticate against.
+   * @param uid       The UID of the card (4 bytes).
+   * @param cb        Optional, called on completion.
+   * @param arg       Passed on to 'cb'.
+   *
+   * @return True if started, false if the reader is busy or unknown.
+   */
+  bool startMifareAuth(uint8_t index, uint8_t key_type, uint8_t blocknum,
+                       uint8_t *uid, mfrc630_callback cb = NULL,
+                       void *arg = NULL);
+
+  /**
+   * Starts Adafruit_MFRC630::startMifareReadBlock() on one reader.
+   *
+   * @param index     The reader to use.
+   * @param blocknum  The block number to read.
+   * @param buf       The buffer for the 16 bytes of data.
+   * @param cb        Optional, called on completion.
+   * @param arg       Passed on to 'cb'.
+   *
+   * @return True if started, false if the reader is busy or unknown.
+   */
+  bool startMifareReadBlock(uint8_t index, uint8_t blocknum, uint8_t *buf,
+                            mfrc630_callback cb = NULL, void *arg = NULL);
+
+  /**
+   * Starts Adafruit_MFRC630::startMifareWriteBlock() on one reader.
+   *
+   * @param index     The reader to use.
+   * @param blocknum  The block number to write to.
+   * @param buf       The 16 bytes of data to write.
+   * @param cb        Optional, called on completion.
+   * @param arg       Passed on to 'cb'.
+   *
+   * @return True if started, false if the reader is busy or unknown.
+   */
+  bool startMifareWriteBlock(uint8_t index, uint16_t blocknum, uint8_t *buf,
+                             mfrc630_callback cb = NULL, void *arg = NULL);
+
+  /**
+   * Runs one scheduling round: every busy reader gets one poll(), and
+   * every idle reader is offered to the idle callback. The round starts
+   * one reader further each time, so no reader is always served first.
+   *
+   * @return True while any reader has an operation in flight.
+   */
+  bool service(void);
+
+  /**
+   * Calls service() until no reader has an operation in flight. With an
+   * idle callback that keeps starting operations, this only ends on the
+   * timeout.
+   *
+   * @param timeout_ms    How long to wait at most, 0 to wait forever.
+   *
+   * @return True if all readers went idle, false on timeout.
+   */
+  bool waitAll(uint32_t timeout_ms = 0);
+
+  /**
+   * Returns the scheduling statistics of one reader.
+   *
+   * @param index     The reader to look at.
+   * @param stats     Filled in with the statistics.
+   *
+   * @return False if 'index' is out of range.
+   */
+  bool getStats(uint8_t index, struct mfrc630_reader_stats *stats);
+
+  /**
+   * Clears the statistics of all readers.
+   */
+  void resetStats(void);
+
+private:
+  /* One reader and the operation it runs on behalf of the group */
+  struct slot {
+    Adafruit_MFRC630 *reader;          /* The reader */
+    mfrc630_callback cb;               /* Caller's completion callback */
+    void *arg;                         /* Passed on to 'cb' */
+    uint32_t start_us;                 /* micros() when the op started */
+    struct mfrc630_reader_stats stats; /* See getStats() */
+  };
+
+  struct slot _slots[MFRC630_GROUP_MAX_READERS];
+  uint8_t _count;
+  uint8_t _next;
+  mfrc630_group_idle _idle_cb;
+  void *_idle_arg;
+
+  struct slot *claim(uint8_t index);
+  void commit(struct slot *s, mfrc630_callback cb, void *arg,
+              uint32_t start_us);
+  static void opDone(enum mfrc630_op op, uint16_t result, void *arg);
+};
+
+#endif
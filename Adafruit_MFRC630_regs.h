@@ -118,13 +118,29 @@ enum mfrc630cmd {
   MFRC630_CMD_SOFTRESET = 0x1F /**< SW resets the MFRC630 */
 };
 
+/*! Command register control bits */
+enum mfrc630cmdctrl {
+  MFRC630_CMD_STANDBY = (1 << 7) /**< Enters standby mode (e.g. during LPCD) */
+};
+
 /*! ISO14443 Commands (see ISO-14443-3) */
 enum iso14443_cmd {
   ISO14443_CMD_REQA = 0x26,    /**< Request command. */
   ISO14443_CMD_WUPA = 0x52,    /**< Wakeup command. */
+  ISO14443_CMD_HLTA = 0x50,    /**< Halt command. */
   ISO14443_CAS_LEVEL_1 = 0x93, /**< Anticollision cascade level 1. */
   ISO14443_CAS_LEVEL_2 = 0x95, /**< Anticollision cascade level 2. */
-  ISO14443_CAS_LEVEL_3 = 0x97  /**< Anticollision cascade level 3. */
+  ISO14443_CAS_LEVEL_3 = 0x97, /**< Anticollision cascade level 3. */
+  ISO14443_CMD_RATS = 0xE0,    /**< Request for answer to select (-4). */
+  ISO14443_CMD_PPS = 0xD0      /**< Protocol and parameter selection (-4). */
+};
+
+/*! ISO14443-4 bit rate divisor codes (DSI/DRI, see ISO-14443-4 5.3) */
+enum iso14443_bitrate {
+  ISO14443_BITRATE_106 = 0, /**< 106 kbit/s (D = 1) */
+  ISO14443_BITRATE_212 = 1, /**< 212 kbit/s (D = 2) */
+  ISO14443_BITRATE_424 = 2, /**< 424 kbit/s (D = 4) */
+  ISO14443_BITRATE_848 = 3  /**< 848 kbit/s (D = 8) */
 };
 
 /*! Mifare Commands */
@@ -140,9 +156,24 @@ enum mifare_cmd {
   MIFARE_ULTRALIGHT_CMD_WRITE = 0xA2
 };
 
+/*! Mifare Classic memory layouts */
+enum mifare_layout {
+  MIFARE_LAYOUT_1K = 0, /**< 16 sectors of 4 blocks. */
+  MIFARE_LAYOUT_4K = 1  /**< 32 sectors of 4 blocks, then 8 of 16 blocks. */
+};
+
+/*! Per-sector outcome of a Mifare Classic sector/card read */
+enum mifare_sector_status {
+  MIFARE_SECTOR_OK = 0,          /**< All blocks in the sector were read. */
+  MIFARE_SECTOR_AUTH_FAILED = 1, /**< The key was rejected. */
+  MIFARE_SECTOR_READ_FAILED = 2, /**< A block read failed after auth. */
+  MIFARE_SECTOR_NO_CARD = 3      /**< The card could not be reselected. */
+};
+
 /*! NTAG Commands */
 enum ntag_cmd {
   NTAG_CMD_READ = 0x30,      /**> NTAG page read. */
+  NTAG_CMD_FAST_READ = 0x3A, /**< NTAG page range read. */
   NTAG_CMD_WRITE = 0xA2,     /**< NTAG-specfiic 4 byte write. */
   NTAG_CMD_COMP_WRITE = 0xA0 /**< Mifare Classic 16-byte compat. write. */
 };
@@ -160,9 +191,20 @@ enum mfrc630comstat {
 /*! Radio config modes */
 enum mfrc630radiocfg {
   MFRC630_RADIOCFG_ISO1443A_106 = 1, /**< ISO1443A 106 Mode */
+  MFRC630_RADIOCFG_ISO1443A_212 = 2, /**< ISO1443A 212 Mode */
+  MFRC630_RADIOCFG_ISO1443A_424 = 3, /**< ISO1443A 424 Mode */
+  MFRC630_RADIOCFG_ISO1443A_848 = 4, /**< ISO1443A 848 Mode */
   MFRC630_LAST
 };
 
+/*! Register set protocol numbers for MFRC630_CMD_LOADPROTOCOL */
+enum mfrc630protocol {
+  MFRC630_PROTO_ISO14443A_106 = 0x00, /**< ISO/IEC14443-A 106 / MIFARE */
+  MFRC630_PROTO_ISO14443A_212 = 0x01, /**< ISO/IEC14443-A 212 */
+  MFRC630_PROTO_ISO14443A_424 = 0x02, /**< ISO/IEC14443-A 424 */
+  MFRC630_PROTO_ISO14443A_848 = 0x03  /**< ISO/IEC14443-A 848 */
+};
+
 /*! MFRC360 errors */
 enum mfrc630errors {
   MFRC630_ERROR_EEPROM = (1 << 7),   /**< EEPROM error. */
@@ -200,6 +242,24 @@ enum mfrc630irq1 {
   MFRC630IRQ1_TIMER0IRQ = (1 << 0), /**< Timer 0 underflow */
 };
 
+/*! IRQ pin configuration bits in MFRC630_REG_IRQOEN/MFRC630_REG_IRQ1EN */
+enum mfrc630irqpin {
+  MFRC630IRQ0EN_IRQ_INV = (1 << 7),      /**< Invert the IRQ pin (IRQ0EN). */
+  MFRC630IRQ1EN_IRQ_PUSHPULL = (1 << 7), /**< Push-pull IRQ pin (IRQ1EN). */
+  MFRC630IRQ1EN_IRQ_PINEN = (1 << 6)     /**< GlobalIRQ drives the pin. */
+};
+
+/*! Timer4 control bits in MFRC630_REG_T4_CONTROL (T4 drives LPCD) */
+enum mfrc630t4control {
+  MFRC630T4_RUNNING = (1 << 7),     /**< T4 is running. */
+  MFRC630T4_STARTSTOP = (1 << 6),   /**< Starts (or stops) T4 right away. */
+  MFRC630T4_AUTOTRIMM = (1 << 5),   /**< Trims the LFO against the XTAL. */
+  MFRC630T4_AUTOLPCD = (1 << 4),    /**< Runs an LPCD measurement at 0. */
+  MFRC630T4_AUTORESTART = (1 << 3), /**< Reloads T4 when it reaches 0. */
+  MFRC630T4_AUTOWAKEUP = (1 << 2),  /**< Leaves standby when T4 reaches 0. */
+  MFRC630T4_CLK_LFO_DIV = (3 << 0)  /**< Slowest LFO clock (~2ms/tick). */
+};
+
 /*! MFRC630 crypto engine status */
 enum mfrc630status {
   MFRC630STATUS_CRYPTO1ON = (1 << 5) /**< Mifare Classic Crypto engine on */
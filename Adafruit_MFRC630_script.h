@@ -0,0 +1,112 @@
+/*!
+ * @file Adafruit_MFRC630_script.h
+ *
+ * Compile-time register scripts.
+ *
+ * A script is a declarative list of (register, value) pairs. At compile time
+ * consecutive pairs that target contiguous registers are merged into a single
+ * run, and the result is stored in flash as a sequence of records:
+ *
+ *   [start register] [count] [count x value] ... [0x00] [0x00]
+ *
+ * Adafruit_MFRC630::writeScript() plays each record back as one
+ * auto-increment burst write, so building the plan costs nothing at runtime.
+ *
+ * Example:
+ *
+ *   MFRC630_REGISTER_SCRIPT(timer0_5ms,
+ *                           mfrc630_reg<MFRC630_REG_T0_CONTROL, 0x11>,
+ *                           mfrc630_reg<MFRC630_REG_T0_RELOAD_HI, 0x04>,
+ *                           mfrc630_reg<MFRC630_REG_TO_RELOAD_LO, 0xFF>);
+ *   ...
+ *   rfid.writeScript(timer0_5ms.bytes);
+ */
+#ifndef __ADAFRUIT_MFRC630_SCRIPT_H__
+#define __ADAFRUIT_MFRC630_SCRIPT_H__
+
+#include <stdint.h>
+
+/*!
+ * @brief One (register, value) pair in a register script
+ */
+template <uint8_t Reg, uint8_t Value> struct mfrc630_reg {};
+
+/*!
+ * @brief Flash image of a compiled register script
+ */
+template <unsigned N> struct mfrc630_script_image {
+  uint8_t bytes[N]; /**< Run records, terminated by a zero count */
+};
+
+/*!
+ * @brief Implementation details of the register script compiler
+ */
+namespace mfrc630_script_impl {
+
+/* A compile-time byte sequence */
+template <uint8_t... B> struct seq {
+  static constexpr mfrc630_script_image<sizeof...(B)> image() {
+    return {{B...}};
+  }
+};
+
+/* build<records so far, start of current run, current run, pairs left> */
+template <class Done, uint8_t Start, class Run, class... Pairs> struct build;
+
+/* step<extend current run?, ...> */
+template <bool Extend, class Done, uint8_t Start, class Run, class... Pairs>
+struct step;
+
+/* No pairs left: close the current run and append the terminator */
+template <uint8_t... D, uint8_t Start, uint8_t... R>
+struct build<seq<D...>, Start, seq<R...>> {
+  typedef seq<D..., Start, sizeof...(R), R..., 0, 0> type;
+};
+
+/* Extend the run if the next register follows on (FIFO_DATA, 0x05, doesn't
+ * auto-increment so it always gets a run of its own) */
+template <uint8_t... D, uint8_t Start, uint8_t... R, uint8_t Reg, uint8_t Val,
+          class... Rest>
+struct build<seq<D...>, Start, seq<R...>, mfrc630_reg<Reg, Val>, Rest...>
+    : step<(Reg == Start + sizeof...(R)) && (Reg != 0x05) &&
+               (Start != 0x05) && (sizeof...(R) < 255),
+           seq<D...>, Start, seq<R...>, mfrc630_reg<Reg, Val>, Rest...> {};
+
+template <uint8_t... D, uint8_t Start, uint8_t... R, uint8_t Reg, uint8_t Val,
+          class... Rest>
+struct step<true, seq<D...>, Start, seq<R...>, mfrc630_reg<Reg, Val>, Rest...>
+    : build<seq<D...>, Start, seq<R..., Val>, Rest...> {};
+
+template <uint8_t... D, uint8_t Start, uint8_t... R, uint8_t Reg, uint8_t Val,
+          class... Rest>
+struct step<false, seq<D...>, Start, seq<R...>, mfrc630_reg<Reg, Val>,
+            Rest...>
+    : build<seq<D..., Start, sizeof...(R), R...>, Reg, seq<Val>, Rest...> {};
+
+} // namespace mfrc630_script_impl
+
+/*!
+ * @brief Compiles a list of mfrc630_reg<> pairs into a burst write plan
+ */
+template <class... Pairs> struct mfrc630_script;
+
+/*!
+ * @brief Compiles a list of mfrc630_reg<> pairs into a burst write plan
+ */
+template <uint8_t Reg, uint8_t Val, class... Rest>
+struct mfrc630_script<mfrc630_reg<Reg, Val>, Rest...> {
+  /*! The merged run records, see mfrc630_script_impl::seq */
+  typedef typename mfrc630_script_impl::build<mfrc630_script_impl::seq<>, Reg,
+                                              mfrc630_script_impl::seq<Val>,
+                                              Rest...>::type plan;
+};
+
+/*!
+ * @brief Defines 'name' as a flash-resident register script built from the
+ *        mfrc630_reg<> pairs that follow. Pass 'name.bytes' to writeScript().
+ */
+#define MFRC630_REGISTER_SCRIPT(name, ...)                                     \
+  static const decltype(mfrc630_script<__VA_ARGS__>::plan::image())            \
+      name PROGMEM = mfrc630_script<__VA_ARGS__>::plan::image()
+
+#endif
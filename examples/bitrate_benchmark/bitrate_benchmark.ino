@@ -0,0 +1,151 @@
+#include <Wire.h>
+#include <Adafruit_MFRC630.h>
+
+/* Indicate the pin number where PDOWN is connected. */
+#if defined(ESP8266)
+#define PDOWN_PIN         (A0)
+#else
+#define PDOWN_PIN         (A2)
+#endif
+
+/* Number of timed exchanges per bit rate. */
+#define ITERATIONS        (20)
+
+/* Use the default I2C address */
+Adafruit_MFRC630 rfid = Adafruit_MFRC630(MFRC630_I2C_ADDR, PDOWN_PIN);
+
+/*
+ * APDU sent in every timed exchange. READ BINARY with Le = 0 asks for as
+ * much data as the card will return in one frame, which suits a simulated
+ * ISO14443-4 card (phone HCE, card emulator, etc.) serving a large file.
+ */
+uint8_t apdu[] = { 0x00, 0xB0, 0x00, 0x00, 0x00 };
+
+/* Scratch buffer for I-block responses (FSD = 256). */
+uint8_t resp[256];
+
+/*
+ * Power cycles the field and activates the card (REQA, select, RATS), then
+ * switches to the requested bit rate with PPS. Returns false if the card
+ * isn't there or doesn't support the bit rate.
+ */
+bool activate(enum iso14443_bitrate rate)
+{
+  uint8_t uid[10] = { 0 };
+  uint8_t sak;
+  uint8_t ats[32];
+
+  rfid.softReset();
+  rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+  delay(5);
+
+  if (!rfid.iso14443aRequest()) {
+    return false;
+  }
+  if (!rfid.iso14443aSelect(uid, &sak)) {
+    return false;
+  }
+  /* FSDI 8 = 256 byte frames, CID 0. */
+  uint8_t atslen = rfid.iso14443aRats(8, 0, ats, sizeof(ats));
+  if (!atslen) {
+    return false;
+  }
+  if (rate == ISO14443_BITRATE_106) {
+    return true;
+  }
+
+  /* Only try rates the card advertises in TA(1) (both directions). */
+  if ((atslen < 3) || !(ats[1] & 0x10)) {
+    return false;
+  }
+  uint8_t bit = 1 << (rate - 1);
+  if (!(ats[2] & (bit << 4)) || !(ats[2] & bit)) {
+    return false;
+  }
+  return rfid.iso14443aPPS(0, rate, rate);
+}
+
+/*
+ * Sends ITERATIONS I-blocks carrying the APDU and returns the number of
+ * bytes moved over the air (both directions), along with the time taken.
+ */
+uint32_t run_exchanges(uint32_t *elapsed)
+{
+  uint8_t iblock[1 + sizeof(apdu)];
+  uint8_t pcb = 0x02;
+  uint32_t bytes = 0;
+
+  struct mfrc630_frame frame = {};
+  frame.command = MFRC630_CMD_TRANSCEIVE;
+  frame.tx = iblock;
+  frame.txlen = sizeof(iblock);
+  frame.txcrc = true;
+  frame.rxcrc = true;
+  frame.irq0en = MFRC630IRQ0_IDLEIRQ | MFRC630IRQ0_ERRIRQ;
+  frame.timeout = 0xFFFF;
+  frame.rx = resp;
+  frame.rxlen = sizeof(resp);
+  struct mfrc630_frame_result res;
+
+  memcpy(&iblock[1], apdu, sizeof(apdu));
+  uint32_t start = micros();
+  for (uint8_t i = 0; i < ITERATIONS; i++) {
+    iblock[0] = pcb;
+    if (!rfid.transceive(&frame, &res) || (res.rxlen == 0)) {
+      break;
+    }
+    bytes += sizeof(iblock) + res.rxlen;
+    /* Toggle the block number for the next I-block. */
+    pcb ^= 0x01;
+  }
+  *elapsed = micros() - start;
+
+  return bytes;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  while (!Serial) {
+    delay(1);
+  }
+
+  Serial.println("");
+  Serial.println("-------------------------------------");
+  Serial.println("Adafruit MFRC630 Bit Rate Throughput");
+  Serial.println("-------------------------------------");
+
+  /* Try to initialize the IC */
+  if (!(rfid.begin())) {
+    Serial.println("Unable to initialize the MFRC630. Check wiring?");
+    while(1) {
+      delay(10);
+    }
+  }
+
+  Serial.println("Place an ISO14443-4 card on the reader ...");
+}
+
+void loop() {
+  static const uint16_t kbps[] = { 106, 212, 424, 848 };
+
+  for (uint8_t r = ISO14443_BITRATE_106; r <= ISO14443_BITRATE_848; r++) {
+    uint32_t elapsed = 0;
+    if (!activate((enum iso14443_bitrate)r)) {
+      continue;
+    }
+    uint32_t bytes = run_exchanges(&elapsed);
+    if (bytes && elapsed) {
+      Serial.print("kbps=");
+      Serial.print(kbps[r]);
+      Serial.print(" bytes=");
+      Serial.print(bytes);
+      Serial.print(" us=");
+      Serial.print(elapsed);
+      Serial.print(" bytes_per_s=");
+      Serial.println((uint32_t)((uint64_t)bytes * 1000000 / elapsed));
+    }
+  }
+
+  delay(1000);
+}
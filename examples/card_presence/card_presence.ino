@@ -0,0 +1,74 @@
+#include <Wire.h>
+#include <Adafruit_MFRC630.h>
+
+/* Indicate the pin number where PDOWN is connected. */
+#if defined(ESP8266)
+#define PDOWN_PIN         (A0)
+#else
+#define PDOWN_PIN         (A2)
+#endif
+
+/* Use the default I2C address */
+Adafruit_MFRC630 rfid = Adafruit_MFRC630(MFRC630_I2C_ADDR, PDOWN_PIN);
+
+/* Prints out the UID of a card. */
+static void print_uid(uint8_t *uid, uint8_t uidlen)
+{
+  for (uint8_t i = 0; i < uidlen; i++) {
+    Serial.print(uid[i], HEX);
+    Serial.print(" ");
+  }
+  Serial.println("");
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  while (!Serial) {
+    delay(1);
+  }
+
+  Serial.println("");
+  Serial.println("------------------------------------");
+  Serial.println("Adafruit MFRC630 Card Presence Test");
+  Serial.println("------------------------------------");
+
+  /* Try to initialize the IC */
+  if (!(rfid.begin())) {
+    Serial.println("Unable to initialize the MFRC630. Check wiring?");
+    while(1) {
+      delay(10);
+    }
+  }
+
+  /*
+   * Reset and configure the radio once. pollCard() keeps track of the card
+   * with HLTA/WUPA, so there is no need to reset between polls.
+   */
+  rfid.softReset();
+  rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+
+  Serial.println("Waiting for an ISO14443-A compatible card ...");
+}
+
+void loop() {
+  uint8_t uid[10] = { 0 };
+  uint8_t uidlen;
+  uint8_t sak;
+
+  switch (rfid.pollCard(uid, &uidlen, &sak)) {
+    case MFRC630_CARD_ARRIVED:
+      /* The card is selected here, a session could start right away. */
+      Serial.print("Card arrived: ");
+      print_uid(uid, uidlen);
+      break;
+    case MFRC630_CARD_REMOVED:
+      Serial.print("Card removed: ");
+      print_uid(uid, uidlen);
+      break;
+    default:
+      break;
+  }
+
+  delay(10);
+}
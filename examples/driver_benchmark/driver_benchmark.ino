@@ -0,0 +1,362 @@
+#include <Wire.h>
+#include <SPI.h>
+#include <Adafruit_MFRC630.h>
+
+/*
+ * Times the main driver operations against whatever card is on the reader
+ * and prints one CSV row per operation, so runs can be collected and
+ * compared between library versions, transports and bus clocks:
+ *
+ *   op,transport,clock,uidlen,samples,fail,avg_us,min_us,max_us,ops_per_s
+ *
+ * With MFRC630_PERF_COUNTERS enabled in Adafruit_MFRC630.h two more columns
+ * (bus_xfers, bus_bytes) give the bus traffic per operation. begin and
+ * request aren't instrumented by the counters and report 0.
+ *
+ * The settings below can also be given on the compiler command line, which
+ * is how extras/host/bench runs this sketch against the simulator.
+ */
+
+/* Indicate the pin number where PDOWN is connected. */
+#if defined(ESP8266)
+#define PDOWN_PIN         (A0)
+#define SSEL_PIN          (15)
+#else
+#define PDOWN_PIN         (A2)
+#define SSEL_PIN          (A4)
+#endif
+
+/* Transport to benchmark: 0 = I2C, 1 = HW SPI, 2 = UART (Serial1). */
+#ifndef TRANSPORT
+#define TRANSPORT         (0)
+#endif
+
+/*
+ * Bus clocks. The UART baud rate has to match the rate the IC is strapped
+ * or configured for.
+ */
+#ifndef I2C_CLOCK
+#define I2C_CLOCK         (400000)
+#endif
+#ifndef SPI_CLOCK
+#define SPI_CLOCK         (4000000)
+#endif
+#ifndef UART_BAUD
+#define UART_BAUD         (115200)
+#endif
+
+/* Number of timed iterations per operation. */
+#ifndef ITERATIONS
+#define ITERATIONS        (10)
+#endif
+
+/* Pages read by the NTAG dump: 45 for NTAG213, 231 for NTAG216. */
+#ifndef NTAG_PAGES
+#define NTAG_PAGES        (45)
+#endif
+
+#if TRANSPORT == 1
+Adafruit_MFRC630 rfid = Adafruit_MFRC630(MFRC630_TRANSPORT_SPI,
+    SSEL_PIN, PDOWN_PIN);
+#define TRANSPORT_NAME    "spi"
+#define BUS_CLOCK         (SPI_CLOCK)
+#elif TRANSPORT == 2
+Adafruit_MFRC630 rfid = Adafruit_MFRC630(&Serial1, PDOWN_PIN);
+#define TRANSPORT_NAME    "uart"
+#define BUS_CLOCK         (UART_BAUD)
+#else
+Adafruit_MFRC630 rfid = Adafruit_MFRC630(MFRC630_I2C_ADDR, PDOWN_PIN);
+#define TRANSPORT_NAME    "i2c"
+#define BUS_CLOCK         (I2C_CLOCK)
+#endif
+
+/* Timing results of one operation. */
+struct timing {
+  uint32_t sum;
+  uint32_t min_us;
+  uint32_t max_us;
+  uint16_t samples;
+  uint16_t fail;
+};
+
+/*
+ * Scratch buffer for the dumps: one Mifare sector, or as many NTAG pages
+ * as one FAST_READ returns with the default 255 byte FIFO.
+ */
+uint8_t buf[252];
+
+uint8_t uid[10];
+uint8_t uidlen;
+uint8_t sak;
+
+/* Applies the configured bus clock (begin() resets it for SPI). */
+void set_bus_clock()
+{
+#if TRANSPORT == 1
+  SPI.beginTransaction(SPISettings(SPI_CLOCK, MSBFIRST, SPI_MODE0));
+  SPI.endTransaction();
+#elif TRANSPORT == 0
+  Wire.setClock(I2C_CLOCK);
+#endif
+}
+
+/*
+ * Power cycles the field so the card starts from IDLE, then optionally
+ * activates it again, updating uid/uidlen/sak. Not part of any timed
+ * section.
+ */
+bool prepare(bool activate)
+{
+  rfid.softReset();
+  rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+  rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+  delay(5);
+
+  if (!activate) {
+    return true;
+  }
+  if (!rfid.iso14443aRequest()) {
+    return false;
+  }
+  uidlen = rfid.iso14443aSelect(uid, &sak);
+  return uidlen != 0;
+}
+
+void timing_reset(struct timing *t)
+{
+  t->sum = 0;
+  t->min_us = 0xFFFFFFFF;
+  t->max_us = 0;
+  t->samples = 0;
+  t->fail = 0;
+#if MFRC630_PERF_COUNTERS
+  rfid.resetPerfCounters();
+#endif
+}
+
+void timing_add(struct timing *t, bool ok, uint32_t us)
+{
+  if (!ok) {
+    t->fail++;
+    return;
+  }
+  t->sum += us;
+  if (us < t->min_us) {
+    t->min_us = us;
+  }
+  if (us > t->max_us) {
+    t->max_us = us;
+  }
+  t->samples++;
+}
+
+void print_header()
+{
+  Serial.print("op,transport,clock,uidlen,samples,fail,avg_us,min_us,max_us,"
+               "ops_per_s");
+#if MFRC630_PERF_COUNTERS
+  Serial.print(",bus_xfers,bus_bytes");
+#endif
+  Serial.println("");
+}
+
+void print_row(const char *op, struct timing *t)
+{
+  uint32_t avg = t->samples ? t->sum / t->samples : 0;
+
+  Serial.print(op);
+  Serial.print(",");
+  Serial.print(TRANSPORT_NAME);
+  Serial.print(",");
+  Serial.print((uint32_t)BUS_CLOCK);
+  Serial.print(",");
+  Serial.print(uidlen);
+  Serial.print(",");
+  Serial.print(t->samples);
+  Serial.print(",");
+  Serial.print(t->fail);
+  Serial.print(",");
+  Serial.print(avg);
+  Serial.print(",");
+  Serial.print(t->samples ? t->min_us : 0);
+  Serial.print(",");
+  Serial.print(t->max_us);
+  Serial.print(",");
+  Serial.print(avg ? 1000000.0 / avg : 0.0, 1);
+#if MFRC630_PERF_COUNTERS
+  /* Per operation averages over all operation types the driver counted. */
+  uint32_t xfers = 0, bytes = 0;
+  for (uint8_t i = 0; i < MFRC630_PERF_OP_COUNT; i++) {
+    struct mfrc630_perf_counters c;
+    rfid.getPerfCounters((enum mfrc630_perf_op)i, &c);
+    xfers += c.bus_xfers;
+    bytes += c.bus_bytes;
+  }
+  uint16_t n = t->samples + t->fail;
+  Serial.print(",");
+  Serial.print(n ? xfers / n : 0);
+  Serial.print(",");
+  Serial.print(n ? bytes / n : 0);
+#endif
+  Serial.println("");
+}
+
+void bench_begin()
+{
+  struct timing t;
+  timing_reset(&t);
+  for (uint8_t i = 0; i < ITERATIONS; i++) {
+    uint32_t start = micros();
+    bool ok = rfid.begin();
+    timing_add(&t, ok, micros() - start);
+    set_bus_clock();
+  }
+  print_row("begin", &t);
+}
+
+void bench_request()
+{
+  struct timing t;
+  timing_reset(&t);
+  for (uint8_t i = 0; i < ITERATIONS; i++) {
+    prepare(false);
+    uint32_t start = micros();
+    bool ok = rfid.iso14443aRequest() != 0;
+    timing_add(&t, ok, micros() - start);
+  }
+  print_row("request", &t);
+}
+
+void bench_select()
+{
+  struct timing t;
+  timing_reset(&t);
+  for (uint8_t i = 0; i < ITERATIONS; i++) {
+    prepare(false);
+    if (!rfid.iso14443aRequest()) {
+      timing_add(&t, false, 0);
+      continue;
+    }
+    uint32_t start = micros();
+    bool ok = rfid.iso14443aSelect(uid, &sak) == uidlen;
+    timing_add(&t, ok, micros() - start);
+  }
+  print_row("select", &t);
+}
+
+/* Mifare Classic: auth + read of one block. */
+void bench_auth_read()
+{
+  struct timing t;
+  timing_reset(&t);
+  for (uint8_t i = 0; i < ITERATIONS; i++) {
+    if (!prepare(true)) {
+      timing_add(&t, false, 0);
+      continue;
+    }
+    uint32_t start = micros();
+    bool ok = rfid.mifareAuth(MIFARE_CMD_AUTH_A, 4, uid + uidlen - 4) &&
+              (rfid.mifareReadBlock(4, buf) == 16);
+    timing_add(&t, ok, micros() - start);
+  }
+  print_row("auth_read", &t);
+}
+
+/* Mifare Classic 1K: all 16 sectors, one auth per sector. */
+void bench_dump_1k()
+{
+  struct timing t;
+  timing_reset(&t);
+  for (uint8_t i = 0; i < ITERATIONS; i++) {
+    if (!prepare(true)) {
+      timing_add(&t, false, 0);
+      continue;
+    }
+    bool ok = true;
+    uint32_t start = micros();
+    for (uint8_t s = 0; (s < 16) && ok; s++) {
+      ok = rfid.mifareReadSector(MIFARE_CMD_AUTH_A, s, uid, buf, uidlen) ==
+           64;
+    }
+    timing_add(&t, ok, micros() - start);
+  }
+  print_row("dump_1k", &t);
+}
+
+/*
+ * NTAG: NTAG_PAGES pages with FAST_READ, in the same FIFO sized ranges
+ * ntagReadPages() uses for a single large read.
+ */
+void bench_dump_ntag()
+{
+  struct timing t;
+  timing_reset(&t);
+  for (uint8_t i = 0; i < ITERATIONS; i++) {
+    if (!prepare(true)) {
+      timing_add(&t, false, 0);
+      continue;
+    }
+    bool ok = true;
+    uint32_t start = micros();
+    for (uint16_t p = 0; (p < NTAG_PAGES) && ok; p += sizeof(buf) / 4) {
+      uint16_t pages = NTAG_PAGES - p;
+      if (pages > sizeof(buf) / 4) {
+        pages = sizeof(buf) / 4;
+      }
+      ok = rfid.ntagReadPages(p, pages, buf) == pages * 4;
+    }
+    timing_add(&t, ok, micros() - start);
+  }
+  print_row(NTAG_PAGES > 45 ? "dump_ntag216" : "dump_ntag213", &t);
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  while (!Serial) {
+    delay(1);
+  }
+
+  Serial.println("");
+  Serial.println("---------------------------------");
+  Serial.println("Adafruit MFRC630 Driver Benchmark");
+  Serial.println("---------------------------------");
+
+#if TRANSPORT == 2
+  Serial1.begin(UART_BAUD);
+#endif
+
+  /* Try to initialize the IC */
+  if (!(rfid.begin())) {
+    Serial.println("Unable to initialize the MFRC630. Check wiring?");
+    while(1) {
+      delay(10);
+    }
+  }
+  set_bus_clock();
+
+  Serial.println("Place a card on the reader ...");
+}
+
+void loop() {
+  /* Wait for a card, and remember its UID length and type. */
+  if (!prepare(true)) {
+    delay(500);
+    return;
+  }
+
+  print_header();
+  bench_begin();
+  bench_request();
+  bench_select();
+  if (sak & 0x08) {
+    /* Mifare Classic 1K/4K */
+    bench_auth_read();
+    bench_dump_1k();
+  } else if (sak == 0x00) {
+    /* NTAG/Ultralight */
+    bench_dump_ntag();
+  }
+
+  delay(5000);
+}
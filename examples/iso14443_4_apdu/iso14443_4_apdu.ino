@@ -0,0 +1,109 @@
+#include <Wire.h>
+#include <Adafruit_MFRC630.h>
+
+/* Indicate the pin number where PDOWN is connected. */
+#if defined(ESP8266)
+#define PDOWN_PIN         (A0)
+#else
+#define PDOWN_PIN         (A2)
+#endif
+
+/* Use the default I2C address */
+Adafruit_MFRC630 rfid = Adafruit_MFRC630(MFRC630_I2C_ADDR, PDOWN_PIN);
+
+/* SELECT the payment system environment ("2PAY.SYS.DDF01"). */
+uint8_t select_ppse[] = { 0x00, 0xA4, 0x04, 0x00, 0x0E,
+                          '2', 'P', 'A', 'Y', '.', 'S', 'Y', 'S',
+                          '.', 'D', 'D', 'F', '0', '1', 0x00 };
+
+/* Prints out len bytes of hex data in table format. */
+static void print_buf_hex(uint8_t *buf, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+  {
+    Serial.print("0x");
+    if (buf[i] < 16)
+    {
+      Serial.print("0");
+    }
+    Serial.print(buf[i], HEX);
+    Serial.print(" ");
+  }
+  Serial.println(" ");
+}
+
+/*
+ * Activates an ISO14443-4 card (REQA, select, RATS) and sends it one APDU.
+ * Returns false if no ISO14443-4 card answered.
+ */
+bool radio_apdu_minimal(void)
+{
+  uint8_t uid[10] = { 0 };
+  uint8_t sak;
+  uint8_t ats[32];
+  uint8_t resp[258];
+
+  /* Put the IC in a known-state and configure the radio. */
+  rfid.softReset();
+  rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+
+  if (!rfid.iso14443aRequest()) {
+    return false;
+  }
+  if (!rfid.iso14443aSelect(uid, &sak)) {
+    return false;
+  }
+
+  /* Bit 5 of the SAK flags ISO14443-4 support. */
+  if (!(sak & 0x20)) {
+    Serial.println("Card doesn't support ISO14443-4");
+    return false;
+  }
+
+  uint8_t atslen = rfid.isoDepActivate(ats, sizeof(ats));
+  if (!atslen) {
+    Serial.println("No ATS!");
+    return false;
+  }
+  Serial.print("ATS: ");
+  print_buf_hex(ats, atslen);
+
+  uint16_t len = rfid.exchange(select_ppse, sizeof(select_ppse),
+                               resp, sizeof(resp));
+  Serial.print("Response: ");
+  print_buf_hex(resp, len);
+
+  rfid.isoDepDeselect();
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  while (!Serial) {
+    delay(1);
+  }
+
+  Serial.println("");
+  Serial.println("-----------------------------------");
+  Serial.println("Adafruit MFRC630 ISO14443-4 APDU Test");
+  Serial.println("-----------------------------------");
+
+  /* Try to initialize the IC */
+  if (!(rfid.begin())) {
+    Serial.println("Unable to initialize the MFRC630. Check wiring?");
+    while(1) {
+      delay(10);
+    }
+  }
+
+  Serial.println("Waiting for an ISO14443-4 compatible card ...");
+  while (!radio_apdu_minimal())
+  {
+    delay(500);
+  }
+}
+
+void loop() {
+  delay(1000);
+}
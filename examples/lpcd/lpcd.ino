@@ -0,0 +1,82 @@
+#include <Wire.h>
+#include <Adafruit_MFRC630.h>
+
+/* Indicate the pin number where PDOWN is connected. */
+#if defined(ESP8266)
+#define PDOWN_PIN         (A0)
+#else
+#define PDOWN_PIN         (A2)
+#endif
+
+/*
+ * Optional: the pin connected to the IRQ output. With it, waiting for a card
+ * generates no I2C traffic at all and the MCU could sleep until it rises.
+ */
+#define IRQ_PIN           (-1)
+
+/* Allowed I/Q deviation before LPCD reports a card (lower = more sensitive) */
+#define LPCD_THRESHOLD    (2)
+
+/* Use the default I2C address */
+Adafruit_MFRC630 rfid = Adafruit_MFRC630(MFRC630_I2C_ADDR, PDOWN_PIN, IRQ_PIN);
+
+void setup() {
+  Serial.begin(115200);
+
+  while (!Serial) {
+    delay(1);
+  }
+
+  Serial.println("");
+  Serial.println("-----------------------------------------");
+  Serial.println("Adafruit MFRC630 Low Power Card Detection");
+  Serial.println("-----------------------------------------");
+
+  /* Try to initialize the IC */
+  if (!(rfid.begin())) {
+    Serial.println("Unable to initialize the MFRC630. Check wiring?");
+    while(1) {
+      delay(10);
+    }
+  }
+
+  rfid.softReset();
+  rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+
+  /* Measure the baseline with no card in the field. */
+  uint8_t i, q;
+  if (!rfid.lpcdCalibrate(&i, &q)) {
+    Serial.println("LPCD calibration failed");
+  }
+  Serial.print("LPCD baseline I="); Serial.print(i);
+  Serial.print(" Q="); Serial.println(q);
+  rfid.lpcdSetThreshold(LPCD_THRESHOLD);
+
+  Serial.println("Waiting for an ISO14443-A compatible card ...");
+}
+
+void loop() {
+  uint8_t uid[10] = { 0 };
+  uint8_t uidlen;
+  uint8_t sak;
+
+  /* Sleep in LPCD mode until a card shows up. */
+  if (!rfid.lpcdWait(0)) {
+    return;
+  }
+
+  if (rfid.pollCard(uid, &uidlen, &sak) == MFRC630_CARD_ARRIVED) {
+    Serial.print("Card detected: ");
+    for (uint8_t i = 0; i < uidlen; i++) {
+      Serial.print(uid[i], HEX);
+      Serial.print(" ");
+    }
+    Serial.println("");
+  }
+
+  /* Keep tracking the card until it is gone, then go back to LPCD. */
+  while (rfid.pollCard(NULL, NULL, NULL) == MFRC630_CARD_PRESENT) {
+    delay(100);
+  }
+  Serial.println("Card removed");
+}
@@ -28,27 +28,23 @@ static void print_buf_hex(uint8_t *buf, size_t len)
 }
 
 /* Dumps an entire sector (4*16-byte blocks) to the serial monitor. */
-void radio_mifare_dump_sector(uint8_t sector_num)
+void radio_mifare_dump_sector(uint8_t sector_num, uint8_t *uid)
 {
-  uint8_t readbuf[16] = { 0 };
-  /* Try to read four blocks inside the sector. */
+  uint8_t readbuf[64] = { 0 };
+  /* Authenticate once and read all four blocks inside the sector. */
+  if (rfid.mifareReadSector(MIFARE_CMD_AUTH_A, sector_num, uid, readbuf) == 0) {
+    /* No data returned! */
+    Serial.print("AUTH_A or read failed for sector ");
+    Serial.println(sector_num);
+    #if MOJIC_TRICK
+    Serial.println("(ノ ゜Д゜)ノ ︵ ┻━┻");
+    #endif
+    return;
+  }
   for (uint8_t b = 0; b < 4 ; b++) {
-    uint8_t len = 0;
-    len = rfid.mifareReadBlock(sector_num * 4 + b, readbuf);
-    if (len == 0) {
-      /* No data returned! */
-      Serial.print("What!?! No data returned for block ");
-      Serial.print(sector_num * 4 + b);
-      Serial.println("!");
-      #if MOJIC_TRICK
-      Serial.println("(ノ ゜Д゜)ノ ︵ ┻━┻");
-      #endif
-      return;
-    } else {
-      /* Display the block contents. */
-      Serial.print(sector_num * 4 + b); Serial.print(": ");
-      print_buf_hex(readbuf, len);
-    }
+    /* Display the block contents. */
+    Serial.print(sector_num * 4 + b); Serial.print(": ");
+    print_buf_hex(&readbuf[b * 16], 16);
   }
 }
 
@@ -91,15 +87,9 @@ bool radio_mifare1K_dump_minimal(void)
             rfid.mifareLoadKey(rfid.mifareKeyGlobal);
             /* Try to authenticate sectors 0..15. */
             for (uint8_t s = 0; s < 16; s++) {
-                /* Try to authenticate this sector. */
+                /* Authenticate and read this sector. */
                 Serial.print("Sector "); Serial.println(s);
-                if(rfid.mifareAuth(MIFARE_CMD_AUTH_A, s*4, uid)) {
-                    /* We should be able to read the sector contents now. */
-                    radio_mifare_dump_sector(s);
-                } else {
-                    Serial.print("AUTH_A failed for sector ");
-                    Serial.println(s);
-                }
+                radio_mifare_dump_sector(s, uid);
             }
             rc = true;
         } else {
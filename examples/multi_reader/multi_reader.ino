@@ -0,0 +1,93 @@
+#include <Wire.h>
+#include <Adafruit_MFRC630.h>
+#include <Adafruit_MFRC630_Group.h>
+
+/*
+ * Two readers on the same I2C bus, with the address pins strapped so one
+ * answers at 0x28 and the other at 0x29.
+ */
+Adafruit_MFRC630 reader_a = Adafruit_MFRC630(0x28);
+Adafruit_MFRC630 reader_b = Adafruit_MFRC630(0x29);
+Adafruit_MFRC630_Group group;
+
+/* Per-reader UID buffers, they must stay valid while a select runs. */
+uint8_t uid[2][10];
+uint8_t sak[2];
+uint32_t last_report = 0;
+
+/* Prints the UID once a select completes, 'arg' is the reader index. */
+void select_done(enum mfrc630_op op, uint16_t result, void *arg)
+{
+  uint8_t index = (uint8_t)(uintptr_t)arg;
+  (void)op;
+
+  if (result) {
+    Serial.print("Reader "); Serial.print(index);
+    Serial.print(": ");
+    for (uint8_t i = 0; i < result; i++) {
+      Serial.print(uid[index][i], HEX);
+      Serial.print(" ");
+    }
+    Serial.println("");
+  }
+}
+
+/* Hands each reader that goes idle its next scan. */
+void next_scan(Adafruit_MFRC630_Group *g, uint8_t index, void *arg)
+{
+  (void)arg;
+
+  if (g->reader(index)->iso14443aRequest()) {
+    g->startSelect(index, uid[index], &sak[index], select_done,
+                   (void *)(uintptr_t)index);
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  while (!Serial) {
+    delay(1);
+  }
+
+  Serial.println("");
+  Serial.println("------------------------------------");
+  Serial.println("Adafruit MFRC630 Multi-Reader Group");
+  Serial.println("------------------------------------");
+
+  if (!reader_a.begin() || !reader_b.begin()) {
+    Serial.println("Unable to initialize both MFRC630s. Check wiring?");
+    while(1) {
+      delay(10);
+    }
+  }
+
+  reader_a.softReset();
+  reader_a.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+  reader_b.softReset();
+  reader_b.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+
+  group.addReader(&reader_a);
+  group.addReader(&reader_b);
+  group.onIdle(next_scan, NULL);
+}
+
+void loop() {
+  /* One round-robin pass, never blocks on a card. */
+  group.service();
+
+  /* Print per-reader fairness/latency stats every 5 seconds. */
+  if (millis() - last_report > 5000) {
+    last_report = millis();
+    for (uint8_t i = 0; i < group.count(); i++) {
+      struct mfrc630_reader_stats st;
+      group.getStats(i, &st);
+      Serial.print("reader="); Serial.print(i);
+      Serial.print(" ops="); Serial.print(st.ops);
+      Serial.print(" failures="); Serial.print(st.failures);
+      Serial.print(" avg_us="); Serial.print(st.ops ? st.total_us / st.ops : 0);
+      Serial.print(" max_us="); Serial.println(st.max_us);
+    }
+    group.resetStats();
+  }
+}
@@ -0,0 +1,105 @@
+#include <Wire.h>
+#include <Adafruit_MFRC630.h>
+
+/* Indicate the pin number where PDOWN is connected. */
+#if defined(ESP8266)
+#define PDOWN_PIN         (A0)
+#else
+#define PDOWN_PIN         (A2)
+#endif
+
+/* Use the default I2C address */
+Adafruit_MFRC630 rfid = Adafruit_MFRC630(MFRC630_I2C_ADDR, PDOWN_PIN);
+
+uint8_t uid[10];
+uint8_t sak;
+uint8_t block[16];
+uint32_t last_blink = 0;
+uint32_t last_scan = 0;
+
+/*
+ * Called by rfid.poll() whenever an operation completes. Each step starts
+ * the next one, so select -> auth -> read runs without ever blocking loop().
+ */
+void card_done(enum mfrc630_op op, uint16_t result, void *arg)
+{
+  (void)arg;
+
+  if (!result) {
+    /* No card, or the step failed: try again on the next scan. */
+    return;
+  }
+
+  switch (op) {
+    case MFRC630_OP_SELECT:
+      Serial.print("Found a tag with UID ");
+      for (uint8_t i = 0; i < result; i++) {
+        Serial.print(uid[i], HEX);
+        Serial.print(" ");
+      }
+      Serial.println("");
+      if (result == 4) {
+        rfid.startMifareAuth(MIFARE_CMD_AUTH_A, 4, uid, card_done);
+      }
+      break;
+    case MFRC630_OP_AUTH:
+      rfid.startMifareReadBlock(4, block, card_done);
+      break;
+    case MFRC630_OP_READ:
+      Serial.print("Block 4:");
+      for (uint8_t i = 0; i < result; i++) {
+        Serial.print(" ");
+        Serial.print(block[i], HEX);
+      }
+      Serial.println("");
+      break;
+    default:
+      break;
+  }
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  while (!Serial) {
+    delay(1);
+  }
+
+  Serial.println("");
+  Serial.println("------------------------------------");
+  Serial.println("Adafruit MFRC630 Non-Blocking Reads");
+  Serial.println("------------------------------------");
+
+  pinMode(LED_BUILTIN, OUTPUT);
+
+  /* Try to initialize the IC */
+  if (!(rfid.begin())) {
+    Serial.println("Unable to initialize the MFRC630. Check wiring?");
+    while(1) {
+      delay(10);
+    }
+  }
+
+  rfid.softReset();
+  rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+  rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+}
+
+void loop() {
+  /* Keep the card operation in flight moving, this never blocks. */
+  rfid.poll();
+
+  /* Look for a new card twice a second, unless one is being read. */
+  if (!rfid.busy() && (millis() - last_scan > 500)) {
+    last_scan = millis();
+    if (rfid.iso14443aRequest()) {
+      rfid.startSelect(uid, &sak, card_done);
+    }
+  }
+
+  /* Meanwhile, the rest of the sketch keeps running. */
+  if (millis() - last_blink > 250) {
+    last_blink = millis();
+    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+  }
+}
@@ -64,14 +64,13 @@ bool radio_ntag156b_dump_minimal(void)
             }
             Serial.println("");
             if (uidlen == 7) {
-                /* Try to read the first 42 pages from the card. */
-                for (uint8_t i = 0; i < 42; i++) {
-                    /* We should be able to read the page contents now. */
-                    uint8_t pagebuf[4] = { 0, 0, 0, 0 };
-                    uint8_t len = rfid.ntagReadPage(i, pagebuf);
+                /* Read the first 42 pages from the card in one go. */
+                uint8_t pagebuf[42 * 4] = { 0 };
+                uint16_t len = rfid.ntagReadPages(0, 42, pagebuf);
+                for (uint8_t i = 0; i < len / 4; i++) {
                     Serial.print(i);
                     Serial.print(": ");
-                    print_buf_hex(pagebuf, len);
+                    print_buf_hex(&pagebuf[i * 4], 4);
                 }
                 rc = true;
             } else {
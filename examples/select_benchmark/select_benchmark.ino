@@ -0,0 +1,115 @@
+#include <Wire.h>
+#include <Adafruit_MFRC630.h>
+
+/* Indicate the pin number where PDOWN is connected. */
+#if defined(ESP8266)
+#define PDOWN_PIN         (A0)
+#else
+#define PDOWN_PIN         (A2)
+#endif
+
+/* Number of timed iterations per card. */
+#define ITERATIONS        (10)
+
+/* Use the default I2C address */
+Adafruit_MFRC630 rfid = Adafruit_MFRC630(MFRC630_I2C_ADDR, PDOWN_PIN);
+
+/*
+ * Times one full activation (REQA + anticollision/select) followed by a
+ * Mifare auth and block read, returning the elapsed time in microseconds
+ * for each step. Returns false if any step failed.
+ */
+bool time_card_session(uint32_t *t_select, uint32_t *t_read)
+{
+  uint8_t uid[10] = { 0 };
+  uint8_t sak;
+  uint8_t block[16];
+  uint32_t start;
+
+  /* Activation: REQA + select. */
+  start = micros();
+  if (!rfid.iso14443aRequest()) {
+    return false;
+  }
+  uint8_t uidlen = rfid.iso14443aSelect(uid, &sak);
+  *t_select = micros() - start;
+  if (uidlen == 0) {
+    return false;
+  }
+
+  /* Auth + read of the first data block (Mifare Classic only). */
+  start = micros();
+  if (uidlen == 4) {
+    if (!rfid.mifareAuth(MIFARE_CMD_AUTH_A, 4, uid)) {
+      return false;
+    }
+    if (rfid.mifareReadBlock(4, block) != 16) {
+      return false;
+    }
+  } else {
+    /* Assume NTAG/Ultralight and read one page instead. */
+    if (rfid.ntagReadPage(4, block) != 4) {
+      return false;
+    }
+  }
+  *t_read = micros() - start;
+
+  return true;
+}
+
+void setup() {
+  Serial.begin(115200);
+
+  while (!Serial) {
+    delay(1);
+  }
+
+  Serial.println("");
+  Serial.println("-----------------------------------");
+  Serial.println("Adafruit MFRC630 Select/Read Timing");
+  Serial.println("-----------------------------------");
+
+  /* Try to initialize the IC */
+  if (!(rfid.begin())) {
+    Serial.println("Unable to initialize the MFRC630. Check wiring?");
+    while(1) {
+      delay(10);
+    }
+  }
+
+  /* Put the IC in a known-state and configure the radio once. */
+  rfid.softReset();
+  rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+  rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+
+  Serial.println("Place a card on the reader ...");
+}
+
+void loop() {
+  uint32_t t_select = 0, t_read = 0;
+  uint32_t sum_select = 0, sum_read = 0;
+  uint8_t ok = 0;
+
+  for (uint8_t i = 0; i < ITERATIONS; i++) {
+    if (time_card_session(&t_select, &t_read)) {
+      sum_select += t_select;
+      sum_read += t_read;
+      ok++;
+    }
+    /* Drop the field state so the next REQA starts from scratch. */
+    rfid.softReset();
+    rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+    rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+  }
+
+  if (ok) {
+    Serial.print("select_us=");
+    Serial.print(sum_select / ok);
+    Serial.print(" read_us=");
+    Serial.print(sum_read / ok);
+    Serial.print(" samples=");
+    Serial.println(ok);
+  }
+
+  delay(1000);
+}
@@ -0,0 +1,277 @@
+/*!
+ * @file Arduino.cpp
+ *
+ * Virtual time, pins and formatted output for the host Arduino shim
+ */
+#include "Arduino.h"
+#include "host.h"
+
+#include <map>
+#include <queue>
+#include <stdio.h>
+#include <vector>
+
+namespace {
+
+struct event {
+  host::time_ns when;
+  uint64_t seq;
+  std::function<void(void)> fn;
+};
+
+struct later {
+  bool operator()(const event &a, const event &b) const {
+    return (a.when != b.when) ? (a.when > b.when) : (a.seq > b.seq);
+  }
+};
+
+std::priority_queue<event, std::vector<event>, later> events;
+host::time_ns now_ns = 0;
+uint64_t next_seq = 0;
+
+std::map<uint8_t, std::vector<std::function<void(uint8_t)>>> write_hooks;
+std::map<uint8_t, std::function<int(void)>> drivers;
+uint8_t levels[256];
+
+/* Undriven pins read high, as if pulled up */
+struct pins_init {
+  pins_init(void) { memset(levels, HIGH, sizeof(levels)); }
+} pins_init_instance;
+
+std::vector<std::function<void(void)>> &reset_hooks(void) {
+  static std::vector<std::function<void(void)>> hooks;
+  return hooks;
+}
+
+} // namespace
+
+namespace host {
+
+time_ns now(void) { return now_ns; }
+
+void advance(time_ns ns) {
+  time_ns target = now_ns + ns;
+
+  while (!events.empty() && (events.top().when <= target)) {
+    event e = events.top();
+    events.pop();
+    if (e.when > now_ns) {
+      now_ns = e.when;
+    }
+    e.fn();
+  }
+  now_ns = target;
+}
+
+void at(time_ns when, std::function<void(void)> fn) {
+  event e = {when, next_seq++, fn};
+  events.push(e);
+}
+
+void reset(void) {
+  while (!events.empty()) {
+    events.pop();
+  }
+  now_ns = 0;
+  next_seq = 0;
+  write_hooks.clear();
+  drivers.clear();
+  memset(levels, HIGH, sizeof(levels));
+  for (size_t i = 0; i < reset_hooks().size(); i++) {
+    reset_hooks()[i]();
+  }
+}
+
+void onPinWrite(uint8_t pin, std::function<void(uint8_t)> fn) {
+  write_hooks[pin].push_back(fn);
+}
+
+void drivePin(uint8_t pin, std::function<int(void)> fn) { drivers[pin] = fn; }
+
+uint8_t pinLevel(uint8_t pin) { return levels[pin]; }
+
+void onReset(std::function<void(void)> fn) { reset_hooks().push_back(fn); }
+
+} // namespace host
+
+/***************************************************************************
+ CORE
+ ***************************************************************************/
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  host::advance(HOST_CALL_NS);
+  levels[pin] = val ? HIGH : LOW;
+  std::map<uint8_t, std::vector<std::function<void(uint8_t)>>>::iterator it =
+      write_hooks.find(pin);
+  if (it != write_hooks.end()) {
+    for (size_t i = 0; i < it->second.size(); i++) {
+      it->second[i](levels[pin]);
+    }
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  host::advance(HOST_CALL_NS);
+  std::map<uint8_t, std::function<int(void)>>::iterator it = drivers.find(pin);
+  if (it != drivers.end()) {
+    return it->second() ? HIGH : LOW;
+  }
+  return levels[pin];
+}
+
+unsigned long millis(void) {
+  host::advance(HOST_CALL_NS);
+  return (unsigned long)(host::now() / 1000000);
+}
+
+unsigned long micros(void) {
+  host::advance(HOST_CALL_NS);
+  return (unsigned long)(host::now() / 1000);
+}
+
+void delay(unsigned long ms) { host::advance((host::time_ns)ms * 1000000); }
+
+void delayMicroseconds(unsigned int us) {
+  host::advance((host::time_ns)us * 1000);
+}
+
+void yield(void) { host::advance(HOST_CALL_NS); }
+
+/***************************************************************************
+ PRINT
+ ***************************************************************************/
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+  size_t n = 0;
+  while (size--) {
+    n += write(*buffer++);
+  }
+  return n;
+}
+
+size_t Print::write(const char *str) {
+  return str ? write((const uint8_t *)str, strlen(str)) : 0;
+}
+
+size_t Print::print(const __FlashStringHelper *str) {
+  return write(reinterpret_cast<const char *>(str));
+}
+
+size_t Print::print(const char str[]) { return write(str); }
+
+size_t Print::print(char c) { return write((uint8_t)c); }
+
+size_t Print::print(unsigned char n, int base) {
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(int n, int base) { return print((long)n, base); }
+
+size_t Print::print(unsigned int n, int base) {
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base) {
+  if ((base == DEC) && (n < 0)) {
+    return print('-') + printNumber((unsigned long)-n, DEC);
+  }
+  if (base == DEC) {
+    return printNumber((unsigned long)n, DEC);
+  }
+  /* Like on AVR, other bases print the two's complement of a long */
+  return printNumber((uint32_t)n, base);
+}
+
+size_t Print::print(unsigned long n, int base) {
+  return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits) { return printFloat(n, digits); }
+
+size_t Print::println(void) { return write("\r\n"); }
+
+size_t Print::println(const __FlashStringHelper *str) {
+  return print(str) + println();
+}
+
+size_t Print::println(const char str[]) { return print(str) + println(); }
+
+size_t Print::println(char c) { return print(c) + println(); }
+
+size_t Print::println(unsigned char n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(int n, int base) { return print(n, base) + println(); }
+
+size_t Print::println(unsigned int n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(long n, int base) { return print(n, base) + println(); }
+
+size_t Print::println(unsigned long n, int base) {
+  return print(n, base) + println();
+}
+
+size_t Print::println(double n, int digits) {
+  return print(n, digits) + println();
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base) {
+  char buf[8 * sizeof(long) + 1];
+  char *str = &buf[sizeof(buf) - 1];
+
+  if (base < 2) {
+    base = 10;
+  }
+
+  *str = '\0';
+  do {
+    char c = n % base;
+    n /= base;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+
+  return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits) {
+  char buf[64];
+
+  if (isnan(number)) {
+    return print("nan");
+  }
+  if (isinf(number)) {
+    return print("inf");
+  }
+  snprintf(buf, sizeof(buf), "%.*f", digits, number);
+  return write(buf);
+}
+
+/***************************************************************************
+ STREAM
+ ***************************************************************************/
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length) {
+  size_t count = 0;
+  unsigned long start = millis();
+
+  while (count < length) {
+    int c = read();
+    if (c < 0) {
+      if ((millis() - start) >= _timeout) {
+        break;
+      }
+      continue;
+    }
+    buffer[count++] = (uint8_t)c;
+  }
+
+  return count;
+}
@@ -0,0 +1,74 @@
+/*!
+ * @file Arduino.h
+ *
+ * Minimal Arduino core for building the library and its examples on a
+ * host, against virtual time (see host.h). Only what the library and the
+ * examples use is provided. This header is also included from C.
+ */
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW 0x0
+
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+#define memcpy_P memcpy
+
+/* Uno pin numbering */
+#define A0 (14)
+#define A1 (15)
+#define A2 (16)
+#define A3 (17)
+#define A4 (18)
+#define A5 (19)
+#define A6 (20)
+#define A7 (21)
+#define LED_BUILTIN (13)
+
+#define NUM_DIGITAL_PINS (22)
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+
+#ifdef __cplusplus
+} // extern "C"
+
+/* Opaque type F() strings are passed around as */
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+#include "HardwareSerial.h"
+#endif
+
+#endif
@@ -0,0 +1,120 @@
+/*!
+ * @file HardwareSerial.cpp
+ *
+ * Console and UART link for the host Arduino shim
+ */
+#include "Arduino.h"
+
+#include <stdio.h>
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+
+HardwareSerial::HardwareSerial(void)
+    : _device(NULL), _capture(NULL), _epoch(0) {
+  reset();
+  host::onReset([this]() { reset(); });
+}
+
+void HardwareSerial::reset(void) {
+  _device = NULL;
+  _baud = 9600;
+  _rx.clear();
+  _txdone.clear();
+  _txfree = 0;
+  _rxfree = 0;
+  _overruns = 0;
+  _txcount = 0;
+  _epoch++;
+}
+
+void HardwareSerial::begin(unsigned long baud) { _baud = baud ? baud : 9600; }
+
+host::time_ns HardwareSerial::charTime(void) {
+  /* Start bit, 8 data bits, stop bit */
+  return 10ULL * 1000000000ULL / _baud;
+}
+
+int HardwareSerial::available(void) {
+  host::advance(HOST_CALL_NS);
+  return (int)_rx.size();
+}
+
+int HardwareSerial::peek(void) { return _rx.empty() ? -1 : _rx.front(); }
+
+int HardwareSerial::read(void) {
+  if (_rx.empty()) {
+    return -1;
+  }
+  uint8_t c = _rx.front();
+  _rx.pop_front();
+  return c;
+}
+
+int HardwareSerial::availableForWrite(void) {
+  return (int)(SERIAL_TX_BUFFER_SIZE - 1 - _txdone.size());
+}
+
+void HardwareSerial::flush(void) {
+  if (_device && !_txdone.empty()) {
+    host::advance(_txdone.back() - host::now());
+  }
+  if (!_device && !_capture) {
+    fflush(stdout);
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (!_device) {
+    if (_capture) {
+      _capture->push_back((char)c);
+    } else {
+      fputc(c, stdout);
+    }
+    return 1;
+  }
+
+  /* Block like the AVR core while the TX buffer is full */
+  while (_txdone.size() >= SERIAL_TX_BUFFER_SIZE) {
+    host::advance(_txdone.front() - host::now());
+  }
+
+  host::time_ns start = (_txfree > host::now()) ? _txfree : host::now();
+  host::time_ns done = start + charTime();
+  uint32_t epoch = _epoch;
+  _txfree = done;
+  _txdone.push_back(done);
+  _txcount++;
+  host::at(done, [this, c, epoch]() {
+    if (epoch != _epoch) {
+      return;
+    }
+    _txdone.pop_front();
+    if (_device) {
+      _device->serialReceive(c);
+    }
+  });
+
+  return 1;
+}
+
+void HardwareSerial::attach(SerialDevice *device) { _device = device; }
+
+void HardwareSerial::deviceWrite(uint8_t c) {
+  host::time_ns start = (_rxfree > host::now()) ? _rxfree : host::now();
+  host::time_ns done = start + charTime();
+  uint32_t epoch = _epoch;
+  _rxfree = done;
+  host::at(done, [this, c, epoch]() {
+    if (epoch != _epoch) {
+      return;
+    }
+    if (_rx.size() >= SERIAL_RX_BUFFER_SIZE - 1) {
+      _overruns++;
+    } else {
+      _rx.push_back(c);
+    }
+  });
+}
+
+void HardwareSerial::capture(std::string *out) { _capture = out; }
@@ -0,0 +1,118 @@
+/*!
+ * @file HardwareSerial.h
+ *
+ * Arduino HardwareSerial for the host shim. 'Serial' is the console, its
+ * output goes to stdout or to a capture string. 'Serial1' is a UART link
+ * to a simulated device (see SerialDevice), timed at the configured baud
+ * rate with the TX and RX buffer sizes of the AVR core.
+ */
+#ifndef HardwareSerial_h
+#define HardwareSerial_h
+
+#include "Stream.h"
+#include "host.h"
+
+#include <deque>
+#include <string>
+
+/*!
+ * @brief RX and TX ring buffer size of the AVR core. Like there, a ring
+ *        holds one byte less than its size.
+ */
+#define SERIAL_RX_BUFFER_SIZE (64)
+#define SERIAL_TX_BUFFER_SIZE (64) //!< See SERIAL_RX_BUFFER_SIZE
+
+#define HAVE_HWSERIAL1 //!< Serial1 exists
+
+/**
+ * Far end of a simulated UART link.
+ */
+class SerialDevice {
+public:
+  virtual ~SerialDevice() {}
+
+  /**
+   * Called when a byte sent by the sketch has arrived at the device.
+   */
+  virtual void serialReceive(uint8_t c) = 0;
+};
+
+/**
+ * A hardware UART, see the file comment.
+ */
+class HardwareSerial : public Stream {
+public:
+  HardwareSerial(void);
+
+  void begin(unsigned long baud);
+  void begin(unsigned long baud, uint8_t config) {
+    (void)config;
+    begin(baud);
+  }
+  void end(void) {}
+
+  int available(void);
+  int peek(void);
+  int read(void);
+  int availableForWrite(void);
+  void flush(void);
+  size_t write(uint8_t c);
+  using Print::write;
+
+  operator bool() { return true; }
+
+  /* Host side */
+
+  /**
+   * Connects the far end of the link (NULL for a console).
+   */
+  void attach(SerialDevice *device);
+
+  /**
+   * Sends a byte from the device to the sketch. It arrives in the RX
+   * buffer one character time after the line is free, or is dropped (and
+   * counted) if the buffer is full by then.
+   */
+  void deviceWrite(uint8_t c);
+
+  /**
+   * Sends console output to 'out' (appended) instead of stdout, or back to
+   * stdout if NULL.
+   */
+  void capture(std::string *out);
+
+  /**
+   * Returns the number of bytes dropped because the RX buffer was full.
+   */
+  uint32_t overruns(void) { return _overruns; }
+
+  /**
+   * Returns the number of bytes sent by the sketch.
+   */
+  uint32_t txCount(void) { return _txcount; }
+
+  /**
+   * Drops all state and the attached device, see host::reset(). The
+   * console capture is kept.
+   */
+  void reset(void);
+
+private:
+  host::time_ns charTime(void);
+
+  SerialDevice *_device;
+  std::string *_capture;
+  unsigned long _baud;
+  std::deque<uint8_t> _rx;
+  std::deque<host::time_ns> _txdone; /* Bytes in the TX buffer or shifter */
+  host::time_ns _txfree;             /* Line to the device idle again */
+  host::time_ns _rxfree;             /* Line from the device idle again */
+  uint32_t _overruns;
+  uint32_t _txcount;
+  uint32_t _epoch; /* Bumped by reset() to drop bytes in flight */
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+
+#endif
@@ -0,0 +1,59 @@
+/*!
+ * @file Print.h
+ *
+ * Arduino Print for the host shim
+ */
+#ifndef Print_h
+#define Print_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class __FlashStringHelper;
+
+/**
+ * Formatted output on top of a byte sink, as in the Arduino core.
+ */
+class Print {
+public:
+  virtual ~Print() {}
+
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buffer, size_t size);
+  size_t write(const char *str);
+  size_t write(const char *buffer, size_t size) {
+    return write((const uint8_t *)buffer, size);
+  }
+
+  size_t print(const __FlashStringHelper *str);
+  size_t print(const char str[]);
+  size_t print(char c);
+  size_t print(unsigned char n, int base = DEC);
+  size_t print(int n, int base = DEC);
+  size_t print(unsigned int n, int base = DEC);
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println(const __FlashStringHelper *str);
+  size_t println(const char str[]);
+  size_t println(char c);
+  size_t println(unsigned char n, int base = DEC);
+  size_t println(int n, int base = DEC);
+  size_t println(unsigned int n, int base = DEC);
+  size_t println(long n, int base = DEC);
+  size_t println(unsigned long n, int base = DEC);
+  size_t println(double n, int digits = 2);
+  size_t println(void);
+
+private:
+  size_t printNumber(unsigned long n, uint8_t base);
+  size_t printFloat(double n, uint8_t digits);
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*!
+ * @file SPI.cpp
+ *
+ * SPI master for the host Arduino shim
+ */
+#include "SPI.h"
+#include "host.h"
+
+SPIClass SPI;
+
+SPIClass::SPIClass(void) {
+  reset();
+  host::onReset([this]() { reset(); });
+}
+
+void SPIClass::reset(void) {
+  _devices.clear();
+  _clock = 4000000;
+}
+
+void SPIClass::setClockDivider(uint8_t div) {
+  /* SPR1:SPR0 select /4../128, SPI2X (bit 2) halves that */
+  static const uint32_t dividers[4] = {4, 16, 64, 128};
+  uint32_t d = dividers[div & 0x03];
+  if (div & 0x04) {
+    d /= 2;
+  }
+  _clock = 16000000UL / d;
+}
+
+uint8_t SPIClass::transfer(uint8_t data) {
+  SPIDevice *selected = NULL;
+  uint8_t count = 0;
+
+  host::advance(8ULL * 1000000000ULL / _clock);
+
+  for (std::map<uint8_t, SPIDevice *>::iterator it = _devices.begin();
+       it != _devices.end(); ++it) {
+    if (host::pinLevel(it->first) == LOW) {
+      selected = it->second;
+      count++;
+    }
+  }
+
+  /* Nobody (or more than one device) driving MISO */
+  if (count != 1) {
+    for (std::map<uint8_t, SPIDevice *>::iterator it = _devices.begin();
+         it != _devices.end(); ++it) {
+      if (host::pinLevel(it->first) == LOW) {
+        it->second->spiTransfer(data);
+      }
+    }
+    return 0xFF;
+  }
+
+  return selected->spiTransfer(data);
+}
+
+void SPIClass::transfer(void *buf, size_t count) {
+  uint8_t *p = (uint8_t *)buf;
+  while (count--) {
+    *p = transfer(*p);
+    p++;
+  }
+}
+
+void SPIClass::attach(uint8_t cs, SPIDevice *device) {
+  if (!device) {
+    _devices.erase(cs);
+    return;
+  }
+  _devices[cs] = device;
+  host::onPinWrite(cs, [this, cs](uint8_t level) {
+    std::map<uint8_t, SPIDevice *>::iterator it = _devices.find(cs);
+    if (it != _devices.end()) {
+      it->second->spiSelect(level == LOW);
+    }
+  });
+}
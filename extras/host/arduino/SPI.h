@@ -0,0 +1,96 @@
+/*!
+ * @file SPI.h
+ *
+ * Arduino SPIClass for the host shim. Each byte takes 8 clock periods and
+ * is exchanged with the SPIDevice whose chip select pin is low.
+ */
+#ifndef _SPI_H_INCLUDED
+#define _SPI_H_INCLUDED
+
+#include "Arduino.h"
+
+#include <map>
+
+#define SPI_MODE0 0x00
+#define SPI_MODE1 0x04
+#define SPI_MODE2 0x08
+#define SPI_MODE3 0x0C
+
+/* AVR clock dividers, applied to a 16MHz core clock */
+#define SPI_CLOCK_DIV4 0x00
+#define SPI_CLOCK_DIV16 0x01
+#define SPI_CLOCK_DIV64 0x02
+#define SPI_CLOCK_DIV128 0x03
+#define SPI_CLOCK_DIV2 0x04
+#define SPI_CLOCK_DIV8 0x05
+#define SPI_CLOCK_DIV32 0x06
+
+/**
+ * A device on a simulated SPI bus.
+ */
+class SPIDevice {
+public:
+  virtual ~SPIDevice() {}
+
+  /**
+   * Called when the chip select pin changes ('selected' = pin low).
+   */
+  virtual void spiSelect(bool selected) = 0;
+
+  /**
+   * Exchanges one byte while selected.
+   */
+  virtual uint8_t spiTransfer(uint8_t mosi) = 0;
+};
+
+/**
+ * Clock, bit order and mode for SPIClass::beginTransaction()
+ */
+class SPISettings {
+public:
+  SPISettings(uint32_t clock, uint8_t bitOrder, uint8_t dataMode)
+      : clock(clock), bitOrder(bitOrder), dataMode(dataMode) {}
+  SPISettings(void) : clock(4000000), bitOrder(MSBFIRST), dataMode(0) {}
+
+  uint32_t clock;   /**< SCK frequency in Hz */
+  uint8_t bitOrder; /**< MSBFIRST or LSBFIRST */
+  uint8_t dataMode; /**< SPI_MODEx */
+};
+
+/**
+ * An SPI master, see the file comment.
+ */
+class SPIClass {
+public:
+  SPIClass(void);
+
+  void begin(void) {}
+  void end(void) {}
+  void beginTransaction(SPISettings settings) { _clock = settings.clock; }
+  void endTransaction(void) {}
+  void setDataMode(uint8_t mode) { (void)mode; }
+  void setBitOrder(uint8_t order) { (void)order; }
+  void setClockDivider(uint8_t div);
+  uint8_t transfer(uint8_t data);
+  void transfer(void *buf, size_t count);
+
+  /* Host side */
+
+  /**
+   * Puts 'device' on the bus with its chip select on 'cs' (NULL removes it).
+   */
+  void attach(uint8_t cs, SPIDevice *device);
+
+  /**
+   * Drops all state, see host::reset().
+   */
+  void reset(void);
+
+private:
+  std::map<uint8_t, SPIDevice *> _devices;
+  uint32_t _clock;
+};
+
+extern SPIClass SPI;
+
+#endif
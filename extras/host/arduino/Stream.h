@@ -0,0 +1,33 @@
+/*!
+ * @file Stream.h
+ *
+ * Arduino Stream for the host shim
+ */
+#ifndef Stream_h
+#define Stream_h
+
+#include "Print.h"
+
+/**
+ * Byte input on top of Print, as in the Arduino core.
+ */
+class Stream : public Print {
+public:
+  Stream() : _timeout(1000) {}
+
+  virtual int available(void) = 0;
+  virtual int read(void) = 0;
+  virtual int peek(void) = 0;
+  virtual void flush(void) {}
+
+  void setTimeout(unsigned long timeout) { _timeout = timeout; }
+  size_t readBytes(uint8_t *buffer, size_t length);
+  size_t readBytes(char *buffer, size_t length) {
+    return readBytes((uint8_t *)buffer, length);
+  }
+
+protected:
+  unsigned long _timeout; /**< readBytes() timeout in ms */
+};
+
+#endif
@@ -0,0 +1,109 @@
+/*!
+ * @file Wire.cpp
+ *
+ * I2C master for the host Arduino shim
+ */
+#include "Wire.h"
+#include "host.h"
+
+TwoWire Wire;
+
+TwoWire::TwoWire(void) {
+  reset();
+  host::onReset([this]() { reset(); });
+}
+
+void TwoWire::reset(void) {
+  _devices.clear();
+  _clock = 100000;
+  _address = 0;
+  _txlen = 0;
+  _rxlen = 0;
+  _rxpos = 0;
+}
+
+void TwoWire::begin(void) {
+  /* Like the AVR core, (re)starting the bus goes back to 100kHz */
+  _clock = 100000;
+  _txlen = 0;
+  _rxlen = 0;
+  _rxpos = 0;
+}
+
+void TwoWire::setClock(uint32_t clock) { _clock = clock ? clock : 100000; }
+
+void TwoWire::busTime(size_t bytes) {
+  /* Start and stop condition, 8 bits and (N)ACK per byte */
+  uint64_t bits = 2 + 9 * (uint64_t)bytes;
+  host::advance(bits * 1000000000ULL / _clock);
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+  _address = address;
+  _txlen = 0;
+}
+
+size_t TwoWire::write(uint8_t c) {
+  if (_txlen >= BUFFER_LENGTH) {
+    return 0;
+  }
+  _tx[_txlen++] = c;
+  return 1;
+}
+
+size_t TwoWire::write(const uint8_t *data, size_t len) {
+  size_t n = 0;
+  while ((n < len) && write(data[n])) {
+    n++;
+  }
+  return n;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+  (void)stop;
+  std::map<uint8_t, TwoWireDevice *>::iterator it = _devices.find(_address);
+
+  if ((it == _devices.end()) || !it->second) {
+    busTime(1);
+    return 2;
+  }
+  busTime(1 + _txlen);
+  if (!it->second->i2cWrite(_tx, _txlen)) {
+    return 2;
+  }
+  return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity, uint8_t stop) {
+  (void)stop;
+  std::map<uint8_t, TwoWireDevice *>::iterator it = _devices.find(address);
+
+  _rxlen = 0;
+  _rxpos = 0;
+  if (quantity > BUFFER_LENGTH) {
+    quantity = BUFFER_LENGTH;
+  }
+  if ((it == _devices.end()) || !it->second ||
+      !it->second->i2cRead(_rx, quantity)) {
+    busTime(1);
+    return 0;
+  }
+  busTime(1 + quantity);
+  _rxlen = quantity;
+
+  return quantity;
+}
+
+int TwoWire::available(void) { return _rxlen - _rxpos; }
+
+int TwoWire::read(void) { return (_rxpos < _rxlen) ? _rx[_rxpos++] : -1; }
+
+int TwoWire::peek(void) { return (_rxpos < _rxlen) ? _rx[_rxpos] : -1; }
+
+void TwoWire::attach(uint8_t address, TwoWireDevice *device) {
+  if (device) {
+    _devices[address] = device;
+  } else {
+    _devices.erase(address);
+  }
+}
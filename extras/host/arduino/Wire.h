@@ -0,0 +1,87 @@
+/*!
+ * @file Wire.h
+ *
+ * Arduino TwoWire for the host shim, with the 32 byte buffer of the AVR
+ * core. Transfers are timed at the bus clock (9 bits per byte plus start
+ * and stop) and go to the TwoWireDevice attached at the address.
+ */
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Stream.h"
+
+#include <map>
+
+#define BUFFER_LENGTH 32 //!< Wire TX/RX buffer size of the AVR core
+
+/**
+ * A device on a simulated I2C bus.
+ */
+class TwoWireDevice {
+public:
+  virtual ~TwoWireDevice() {}
+
+  /**
+   * Write transaction. Returns false to NACK the address.
+   */
+  virtual bool i2cWrite(const uint8_t *data, size_t len) = 0;
+
+  /**
+   * Read transaction. Returns false to NACK the address.
+   */
+  virtual bool i2cRead(uint8_t *data, size_t len) = 0;
+};
+
+/**
+ * An I2C master, see the file comment.
+ */
+class TwoWire : public Stream {
+public:
+  TwoWire(void);
+
+  void begin(void);
+  void end(void) {}
+  void setClock(uint32_t clock);
+  void beginTransmission(uint8_t address);
+  void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+  uint8_t endTransmission(bool stop = true);
+  uint8_t requestFrom(uint8_t address, uint8_t quantity, uint8_t stop = true);
+  uint8_t requestFrom(int address, int quantity) {
+    return requestFrom((uint8_t)address, (uint8_t)quantity);
+  }
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *data, size_t len);
+  using Print::write;
+  int available(void);
+  int read(void);
+  int peek(void);
+
+  /* Host side */
+
+  /**
+   * Puts 'device' on the bus at 'address' (NULL removes it).
+   */
+  void attach(uint8_t address, TwoWireDevice *device);
+
+  /**
+   * Drops all state, see host::reset().
+   */
+  void reset(void);
+
+private:
+  void busTime(size_t bytes);
+
+  std::map<uint8_t, TwoWireDevice *> _devices;
+  uint32_t _clock;
+  uint8_t _address;
+  uint8_t _tx[BUFFER_LENGTH];
+  uint8_t _txlen;
+  uint8_t _rx[BUFFER_LENGTH];
+  uint8_t _rxlen;
+  uint8_t _rxpos;
+};
+
+extern TwoWire Wire;
+
+#endif
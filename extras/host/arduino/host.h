@@ -0,0 +1,76 @@
+/*!
+ * @file host.h
+ *
+ * Virtual time and pin state behind the host Arduino shim. Nothing runs on
+ * its own: time only moves when the code under test calls delay(),
+ * micros(), digitalRead() etc. or moves a bus, and the simulated devices
+ * react to it through scheduled events.
+ */
+#ifndef __HOST_H__
+#define __HOST_H__
+
+#include <functional>
+#include <stdint.h>
+
+namespace host {
+
+/*!
+ * @brief Virtual time in nanoseconds since reset()
+ */
+typedef uint64_t time_ns;
+
+/*!
+ * @brief Time charged for a call into the Arduino core (micros(),
+ *        digitalRead(), yield() ...), so busy loops make progress
+ */
+#define HOST_CALL_NS (1000)
+
+/**
+ * Returns the current virtual time.
+ */
+time_ns now(void);
+
+/**
+ * Moves the virtual time forward by 'ns', running every event that falls
+ * into that window in order.
+ */
+void advance(time_ns ns);
+
+/**
+ * Runs 'fn' once the virtual time reaches 'when' (right away on the next
+ * advance() if 'when' already passed). Events at the same time run in the
+ * order they were scheduled.
+ */
+void at(time_ns when, std::function<void(void)> fn);
+
+/**
+ * Drops all pending events and pin hooks and starts over at time zero. The
+ * bus shims (Serial, Wire, SPI) are reset as well.
+ */
+void reset(void);
+
+/**
+ * Calls 'fn' with the new level whenever the sketch writes to 'pin'.
+ */
+void onPinWrite(uint8_t pin, std::function<void(uint8_t)> fn);
+
+/**
+ * Makes digitalRead('pin') return what 'fn' says, for pins driven by a
+ * simulated device.
+ */
+void drivePin(uint8_t pin, std::function<int(void)> fn);
+
+/**
+ * Returns the level last written to 'pin' by the sketch (pins start out
+ * high, as if pulled up).
+ */
+uint8_t pinLevel(uint8_t pin);
+
+/**
+ * Called by reset() so the bus shims can drop their state.
+ */
+void onReset(std::function<void(void)> fn);
+
+} // namespace host
+
+#endif
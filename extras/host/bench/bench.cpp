@@ -0,0 +1,51 @@
+/*!
+ * @file bench.cpp
+ *
+ * Sketch runner for the host benchmarks, see bench.h
+ */
+#include "bench.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <string>
+
+namespace bench {
+
+int run(void (*setup)(void), void (*loop)(void), MFRC630Sim *sim,
+        SimCard **cards, size_t count, const char *reference) {
+  std::string out;
+
+  Serial.capture(&out);
+  setup();
+  for (size_t i = 0; i < count; i++) {
+    sim->addCard(cards[i]);
+    loop();
+    sim->removeCard(cards[i]);
+  }
+  Serial.capture(NULL);
+  fputs(out.c_str(), stdout);
+
+  if (!reference) {
+    return 0;
+  }
+
+  std::ifstream file(reference, std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "Can't read %s\n", reference);
+    return 1;
+  }
+  std::stringstream expected;
+  expected << file.rdbuf();
+  if (expected.str() != out) {
+    fprintf(stderr,
+            "Output differs from %s, rerun without it to regenerate the "
+            "reference\n",
+            reference);
+    return 1;
+  }
+
+  return 0;
+}
+
+} // namespace bench
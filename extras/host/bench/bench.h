@@ -0,0 +1,26 @@
+/*!
+ * @file bench.h
+ *
+ * Runs a benchmark sketch from examples/ against the MFRC630 model: setup()
+ * once, then loop() once per card in the field. Everything the sketch
+ * prints is written to stdout and, if a reference file is given, compared
+ * with it. Virtual time makes the output repeatable, so any difference
+ * means the driver (or the model) changed its timing.
+ */
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <MFRC630Sim.h>
+
+namespace bench {
+
+/**
+ * Runs the sketch and returns the exit code for the benchmark: non-zero if
+ * the output differs from 'reference' (ignored if NULL).
+ */
+int run(void (*setup)(void), void (*loop)(void), MFRC630Sim *sim,
+        SimCard **cards, size_t count, const char *reference);
+
+} // namespace bench
+
+#endif
@@ -0,0 +1,25 @@
+/*!
+ * @file bench_bitrate.cpp
+ *
+ * examples/bitrate_benchmark on the simulator, with an ISO14443-4 card
+ * that supports all four bit rates
+ */
+#include <Arduino.h>
+
+#include "bench.h"
+
+#include "bitrate_benchmark/bitrate_benchmark.ino"
+
+static uint8_t uid4[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+int main(int argc, char **argv) {
+  MFRC630Sim sim;
+  IsoDepCard card(uid4, 4);
+  SimCard *cards[] = {&card};
+
+  sim.attachI2C(&Wire, MFRC630_I2C_ADDR);
+  sim.attachPdown(PDOWN_PIN);
+
+  return bench::run(setup, loop, &sim, cards, sizeof(cards) / sizeof(*cards),
+                    (argc > 1) ? argv[1] : NULL);
+}
@@ -0,0 +1,39 @@
+/*!
+ * @file bench_driver.cpp
+ *
+ * examples/driver_benchmark on the simulator, over the transport and bus
+ * clock the build selects (TRANSPORT, I2C_CLOCK, SPI_CLOCK, UART_BAUD,
+ * NTAG_PAGES), with Mifare Classic cards with 4 and 7 byte UIDs, an NTAG
+ * and an ISO14443-4 card with a 10 byte UID (select only)
+ */
+#include <Arduino.h>
+
+#include "bench.h"
+
+#include "driver_benchmark/driver_benchmark.ino"
+
+static uint8_t uid4[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+static uint8_t uid7[7] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+static uint8_t uid10[10] = {0x08, 0x01, 0x02, 0x03, 0x04,
+                            0x05, 0x06, 0x07, 0x08, 0x09};
+
+int main(int argc, char **argv) {
+  MFRC630Sim sim;
+  MifareClassicCard mifare4(uid4, 4);
+  MifareClassicCard mifare7(uid7, 7);
+  NtagCard ntag(uid7, (NTAG_PAGES > 45) ? 216 : 213);
+  IsoDepCard isodep(uid10, 10);
+  SimCard *cards[] = {&mifare4, &mifare7, &ntag, &isodep};
+
+#if TRANSPORT == 1
+  sim.attachSPI(&SPI, SSEL_PIN);
+#elif TRANSPORT == 2
+  sim.attachSerial(&Serial1);
+#else
+  sim.attachI2C(&Wire, MFRC630_I2C_ADDR);
+#endif
+  sim.attachPdown(PDOWN_PIN);
+
+  return bench::run(setup, loop, &sim, cards, sizeof(cards) / sizeof(*cards),
+                    (argc > 1) ? argv[1] : NULL);
+}
@@ -0,0 +1,27 @@
+/*!
+ * @file bench_select.cpp
+ *
+ * examples/select_benchmark on the simulator, with a Mifare Classic card
+ * and an NTAG
+ */
+#include <Arduino.h>
+
+#include "bench.h"
+
+#include "select_benchmark/select_benchmark.ino"
+
+static uint8_t uid4[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+static uint8_t uid7[7] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+
+int main(int argc, char **argv) {
+  MFRC630Sim sim;
+  MifareClassicCard mifare(uid4, 4);
+  NtagCard ntag(uid7);
+  SimCard *cards[] = {&mifare, &ntag};
+
+  sim.attachI2C(&Wire, MFRC630_I2C_ADDR);
+  sim.attachPdown(PDOWN_PIN);
+
+  return bench::run(setup, loop, &sim, cards, sizeof(cards) / sizeof(*cards),
+                    (argc > 1) ? argv[1] : NULL);
+}
@@ -0,0 +1,1214 @@
+/*!
+ * @file MFRC630Sim.cpp
+ *
+ * Behavioural model of the MFRC630, see MFRC630Sim.h
+ */
+#include "MFRC630Sim.h"
+
+#include <Adafruit_MFRC630_regs.h>
+
+#include <string.h>
+
+/* Carrier and timing constants (ISO14443-2/3 and the MFRC630 datasheet) */
+#define SIM_FC_MHZ (13.56)
+#define SIM_BIT_US (128.0 / SIM_FC_MHZ)  /* 106 kbit/s bit time */
+#define SIM_FDT_US (1172.0 / SIM_FC_MHZ) /* Minimum frame delay time */
+#define SIM_TURNAROUND_US (SIM_FDT_US)    /* MFAUTHENT reader turnaround */
+#define SIM_STARTUP_NS (2500000ULL)        /* Out of PDOWN to ready */
+#define SIM_EEPROM_WRITE_US (4000.0)       /* One EEPROM programming cycle */
+#define SIM_EEPROM_SIZE (8192)
+#define SIM_EEPROM_KEYS (6144) /* Start of the key area (sector 96..111) */
+
+/* Default LPCD I/Q results without a card */
+#define SIM_LPCD_I (0x20)
+#define SIM_LPCD_Q (0x18)
+
+/* Register set protocols loaded by LOADPROTOCOL (0x28..0x39) */
+static const uint8_t protocols[4][18] = {
+    {0x8E, 0x12, 0x39, 0x0A, 0x18, 0x18, 0x0F, 0x21, 0x00, 0xC0, 0x12, 0xCF,
+     0x00, 0x04, 0x90, 0x5C, 0x12, 0x0A},
+    {0x8E, 0xD2, 0x11, 0x0A, 0x18, 0x18, 0x0F, 0x10, 0x00, 0xC0, 0x12, 0xCF,
+     0x00, 0x05, 0x90, 0x3C, 0x12, 0x0B},
+    {0x8F, 0xDE, 0x11, 0x0F, 0x18, 0x18, 0x0F, 0x07, 0x00, 0xC0, 0x12, 0xCF,
+     0x00, 0x06, 0x90, 0x2B, 0x12, 0x0B},
+    {0x8F, 0xDB, 0x21, 0x0F, 0x18, 0x18, 0x0F, 0x02, 0x00, 0xC0, 0x12, 0xCF,
+     0x00, 0x07, 0x90, 0x3A, 0x12, 0x0B}};
+
+/* First register of the RX half of a protocol */
+#define SIM_PROTOCOL_RX (MFRC630_REG_RX_SOFD)
+
+/**
+ * CRC_A (ISO14443-3 Annex B)
+ */
+static uint16_t crc_a(const uint8_t *data, size_t len) {
+  uint16_t crc = 0x6363;
+
+  while (len--) {
+    uint8_t b = *data++;
+    b ^= (uint8_t)(crc & 0xFF);
+    b ^= (uint8_t)(b << 4);
+    crc = (crc >> 8) ^ ((uint16_t)b << 8) ^ ((uint16_t)b << 3) ^ (b >> 4);
+  }
+
+  return crc;
+}
+
+MFRC630Sim::MFRC630Sim(void)
+    : _i2cptr(0), _spistate(SPI_ADDR), _spireg(0), _uartwrite(false),
+      _uartreg(0), _serial(NULL), _wire(NULL), _i2caddr(0), _spi(NULL),
+      _spics(0), _pdown(-1), _eeprom(SIM_EEPROM_SIZE, 0xFF), _powered(true),
+      _readyat(0), _cmd(MFRC630_CMD_IDLE), _standby(false), _phase(PH_IDLE),
+      _gen(0), _rng(0x2545F491), _alive(new bool(true)), _hasresp(false),
+      _collision(false), _collpos(0), _rxbits(0), _rxpos(0), _authcard(NULL),
+      _authkeytype(0), _authblock(0), _t0running(false), _t0start(0),
+      _t0value(0), _t0gen(0), _t0stalled(false), _t4running(false),
+      _t4gen(0), _field(false), _lpcd_i(SIM_LPCD_I), _lpcd_q(SIM_LPCD_Q),
+      _frames(0), _pagewrites(0), _lpcdruns(0), _overflows(0),
+      _commands(0) {
+  memset(_key, 0, sizeof(_key));
+  memset(_authuid, 0, sizeof(_authuid));
+
+  /* Transport keys in the key area, as shipped */
+  for (uint16_t i = 0; i < 128; i++) {
+    memset(&_eeprom[SIM_EEPROM_KEYS + i * 8], 0xFF, 6);
+  }
+
+  resetRegisters();
+}
+
+MFRC630Sim::~MFRC630Sim() {
+  *_alive = false;
+  if (_wire) {
+    _wire->attach(_i2caddr, NULL);
+  }
+  if (_spi) {
+    _spi->attach(_spics, NULL);
+  }
+  if (_serial) {
+    _serial->attach(NULL);
+  }
+}
+
+/***************************************************************************
+ WIRING
+ ***************************************************************************/
+
+void MFRC630Sim::attachI2C(TwoWire *wire, uint8_t address) {
+  _wire = wire;
+  _i2caddr = address;
+  wire->attach(address, this);
+}
+
+void MFRC630Sim::attachSPI(SPIClass *spi, uint8_t cs) {
+  _spi = spi;
+  _spics = cs;
+  spi->attach(cs, this);
+}
+
+void MFRC630Sim::attachSerial(HardwareSerial *serial) {
+  _serial = serial;
+  serial->attach(this);
+}
+
+void MFRC630Sim::attachPdown(uint8_t pin) {
+  std::shared_ptr<bool> alive = _alive;
+
+  _pdown = pin;
+  if (host::pinLevel(pin) == HIGH) {
+    powerOff();
+  }
+  host::onPinWrite(pin, [this, alive](uint8_t level) {
+    if (!*alive) {
+      return;
+    }
+    if (level == HIGH) {
+      powerOff();
+    } else if (!_powered) {
+      powerOn();
+    }
+  });
+}
+
+void MFRC630Sim::attachIrq(uint8_t pin) {
+  std::shared_ptr<bool> alive = _alive;
+  host::drivePin(pin, [this, alive]() { return *alive && irqLevel(); });
+}
+
+/***************************************************************************
+ FIELD
+ ***************************************************************************/
+
+void MFRC630Sim::addCard(SimCard *card) {
+  _cards.push_back(card);
+  card->power(_field);
+}
+
+void MFRC630Sim::removeCard(SimCard *card) {
+  for (size_t i = 0; i < _cards.size(); i++) {
+    if (_cards[i] == card) {
+      _cards.erase(_cards.begin() + i);
+      card->power(false);
+      if (_authcard == card) {
+        _authcard = NULL;
+      }
+      return;
+    }
+  }
+}
+
+bool MFRC630Sim::fieldOn(void) const { return _field; }
+
+void MFRC630Sim::updateField(void) {
+  bool field = _powered && !_standby && (_regs[MFRC630_REG_DRV_MOD] & 0x08);
+
+  if (field == _field) {
+    return;
+  }
+  _field = field;
+  for (size_t i = 0; i < _cards.size(); i++) {
+    _cards[i]->power(field);
+  }
+}
+
+uint8_t MFRC630Sim::txRate(void) const {
+  switch (_regs[MFRC630_REG_TX_MOD_WIDTH]) {
+  case 0x10:
+    return 1;
+  case 0x07:
+    return 2;
+  case 0x02:
+    return 3;
+  default:
+    return 0;
+  }
+}
+
+uint8_t MFRC630Sim::rxRate(void) const {
+  switch (_regs[MFRC630_REG_RX_CTRL] & 0x07) {
+  case 5:
+    return 1;
+  case 6:
+    return 2;
+  case 7:
+    return 3;
+  default:
+    return 0;
+  }
+}
+
+double MFRC630Sim::bitTime(uint8_t rate) const {
+  return SIM_BIT_US / (1 << rate);
+}
+
+/***************************************************************************
+ POWER
+ ***************************************************************************/
+
+bool MFRC630Sim::ready(void) const {
+  return _powered && (host::now() >= _readyat);
+}
+
+void MFRC630Sim::powerOn(void) {
+  _powered = true;
+  _readyat = host::now() + SIM_STARTUP_NS;
+  resetRegisters();
+}
+
+void MFRC630Sim::powerOff(void) {
+  _powered = false;
+  resetRegisters();
+}
+
+void MFRC630Sim::resetRegisters(void) {
+  memset(_regs, 0, sizeof(_regs));
+  _regs[MFRC630_REG_FIFO_CONTROL] = 0x80;
+  _regs[MFRC630_REG_WATER_LEVEL] = 0x08;
+  _regs[MFRC630_REG_VERSION] = 0x18;
+  _fifo.clear();
+  _gen++;
+  _cmd = MFRC630_CMD_IDLE;
+  _phase = PH_IDLE;
+  _standby = false;
+  _t0running = false;
+  _t0value = 0;
+  _t0gen++;
+  _t4running = false;
+  _t4gen++;
+  _authcard = NULL;
+  _spistate = SPI_ADDR;
+  _uartwrite = false;
+  updateField();
+}
+
+/***************************************************************************
+ REGISTERS
+ ***************************************************************************/
+
+uint8_t MFRC630Sim::readRegister(uint8_t reg) {
+  reg &= 0x7F;
+  if (!ready()) {
+    return 0;
+  }
+
+  switch (reg) {
+  case MFRC630_REG_COMMAND:
+    return (_standby ? MFRC630_CMD_STANDBY : 0) | _cmd;
+
+  case MFRC630_REG_FIFO_CONTROL: {
+    uint8_t v = _regs[reg] & 0x84;
+    uint16_t wl = waterLevel();
+    if (fifoSize() - _fifo.size() <= wl) {
+      v |= 0x40; /* HiAlert */
+    }
+    if (_fifo.size() <= wl) {
+      v |= 0x20; /* LoAlert */
+    }
+    if (!(_regs[reg] & 0x80)) {
+      v |= (_fifo.size() >> 8) & 0x03;
+    }
+    return v;
+  }
+
+  case MFRC630_REG_FIFO_LENGTH:
+    return _fifo.size() & 0xFF;
+
+  case MFRC630_REG_FIFO_DATA:
+    return fifoPop();
+
+  case MFRC630_REG_IRQ1:
+    return irq1();
+
+  case MFRC630_REG_T0_COUNTER_VAL_HI:
+    return t0Counter() >> 8;
+
+  case MFRC630_REG_T0_COUNTER_VAL_LO:
+    return t0Counter() & 0xFF;
+
+  case MFRC630_REG_T4_CONTROL:
+    return (_regs[reg] & 0x7F) | (_t4running ? MFRC630T4_RUNNING : 0);
+
+  default:
+    return _regs[reg];
+  }
+}
+
+void MFRC630Sim::writeRegister(uint8_t reg, uint8_t value) {
+  reg &= 0x7F;
+  if (!ready()) {
+    return;
+  }
+
+  switch (reg) {
+  case MFRC630_REG_COMMAND:
+    startCommand(value);
+    break;
+
+  case MFRC630_REG_FIFO_CONTROL: {
+    bool resize = (value ^ _regs[reg]) & 0x80;
+    _regs[reg] = value & 0x84;
+    if (resize || (value & 0x10)) {
+      fifoFlush();
+    }
+    break;
+  }
+
+  case MFRC630_REG_FIFO_LENGTH:
+  case MFRC630_REG_ERROR:
+  case MFRC630_REG_RX_COLL:
+  case MFRC630_REG_LPCD_I_RESULT:
+  case MFRC630_REG_VERSION:
+    break;
+
+  case MFRC630_REG_FIFO_DATA:
+    fifoPush(value);
+    if (_phase == PH_PARAMS) {
+      tryParams();
+    }
+    break;
+
+  case MFRC630_REG_IRQ0:
+    if (value & MFRC630IRQ0_SET) {
+      _regs[reg] |= value & 0x7F;
+    } else {
+      _regs[reg] &= ~value;
+    }
+    break;
+
+  case MFRC630_REG_IRQ1:
+    if (value & MFRC630IRQ1_SET) {
+      _regs[reg] |= value & 0x3F;
+    } else {
+      _regs[reg] &= ~value & 0x3F;
+    }
+    break;
+
+  case MFRC630_REG_STATUS:
+    /* Only Crypto1On can be written, and only cleared */
+    if (!(value & MFRC630STATUS_CRYPTO1ON)) {
+      _regs[reg] &= ~MFRC630STATUS_CRYPTO1ON;
+    }
+    break;
+
+  case MFRC630_REG_RX_BIT_CTRL:
+    _regs[reg] = (value & 0xF8) | (_regs[reg] & 0x07);
+    break;
+
+  case MFRC630_REG_T0_COUNTER_VAL_HI:
+  case MFRC630_REG_T0_COUNTER_VAL_LO:
+    _regs[reg] = value;
+    if (!_t0running) {
+      _t0value = (_regs[MFRC630_REG_T0_COUNTER_VAL_HI] << 8) |
+                 _regs[MFRC630_REG_T0_COUNTER_VAL_LO];
+    }
+    break;
+
+  case MFRC630_REG_T4_CONTROL:
+    _regs[reg] = value & 0x7F;
+    if (value & MFRC630T4_STARTSTOP) {
+      t4Start();
+    } else {
+      _t4running = false;
+      _t4gen++;
+    }
+    break;
+
+  case MFRC630_REG_LPCD_Q_RESULT:
+    /* Bit 6 clears both results */
+    if (value & 0x40) {
+      _regs[MFRC630_REG_LPCD_I_RESULT] = 0;
+      _regs[MFRC630_REG_LPCD_Q_RESULT] = 0;
+    }
+    break;
+
+  case MFRC630_REG_DRV_MOD:
+    _regs[reg] = value;
+    updateField();
+    break;
+
+  default:
+    _regs[reg] = value;
+    break;
+  }
+}
+
+/***************************************************************************
+ FIFO
+ ***************************************************************************/
+
+uint16_t MFRC630Sim::fifoSize(void) const {
+  return (_regs[MFRC630_REG_FIFO_CONTROL] & 0x80) ? 255 : 512;
+}
+
+uint16_t MFRC630Sim::waterLevel(void) const {
+  return _regs[MFRC630_REG_WATER_LEVEL] |
+         ((_regs[MFRC630_REG_FIFO_CONTROL] & 0x04) << 6);
+}
+
+void MFRC630Sim::fifoPush(uint8_t c) {
+  if (_fifo.size() >= fifoSize()) {
+    _overflows++;
+    error(MFRC630_ERROR_FIFOOVL);
+    return;
+  }
+  _fifo.push_back(c);
+  if (fifoSize() - _fifo.size() <= waterLevel()) {
+    raise0(MFRC630IRQ0_HIALERTIRQ);
+  }
+}
+
+uint8_t MFRC630Sim::fifoPop(void) {
+  if (_fifo.empty()) {
+    return 0;
+  }
+  uint8_t c = _fifo.front();
+  _fifo.pop_front();
+  if (_fifo.size() <= waterLevel()) {
+    raise0(MFRC630IRQ0_LOALERTIRQ);
+  }
+  return c;
+}
+
+void MFRC630Sim::fifoFlush(void) {
+  _fifo.clear();
+  _regs[MFRC630_REG_ERROR] &= ~MFRC630_ERROR_FIFOOVL;
+}
+
+/***************************************************************************
+ IRQS
+ ***************************************************************************/
+
+void MFRC630Sim::raise0(uint8_t bits) { _regs[MFRC630_REG_IRQ0] |= bits; }
+
+void MFRC630Sim::raise1(uint8_t bits) { _regs[MFRC630_REG_IRQ1] |= bits; }
+
+void MFRC630Sim::error(uint8_t bits) {
+  _regs[MFRC630_REG_ERROR] |= bits;
+  raise0(MFRC630IRQ0_ERRIRQ);
+}
+
+uint8_t MFRC630Sim::irq1(void) const {
+  uint8_t irq1 = _regs[MFRC630_REG_IRQ1] & 0x3F;
+
+  if ((_regs[MFRC630_REG_IRQ0] & _regs[MFRC630_REG_IRQOEN] & 0x7F) ||
+      (irq1 & _regs[MFRC630_REG_IRQ1EN] & 0x3F)) {
+    irq1 |= MFRC630IRQ1_GLOBALIRQ;
+  }
+
+  return irq1;
+}
+
+bool MFRC630Sim::irqLevel(void) const {
+  bool level = (_regs[MFRC630_REG_IRQ1EN] & MFRC630IRQ1EN_IRQ_PINEN) &&
+               (irq1() & MFRC630IRQ1_GLOBALIRQ);
+
+  if (_regs[MFRC630_REG_IRQOEN] & MFRC630IRQ0EN_IRQ_INV) {
+    level = !level;
+  }
+
+  return ready() && level;
+}
+
+/***************************************************************************
+ COMMAND ENGINE
+ ***************************************************************************/
+
+void MFRC630Sim::schedule(double us, uint32_t *gen,
+                          void (MFRC630Sim::*fn)(void)) {
+  std::shared_ptr<bool> alive = _alive;
+  uint32_t expected = *gen;
+
+  host::at(host::now() + (host::time_ns)(us * 1000.0 + 0.5),
+           [this, alive, gen, expected, fn]() {
+             if (*alive && (*gen == expected)) {
+               (this->*fn)();
+             }
+           });
+}
+
+void MFRC630Sim::setComState(uint8_t state) {
+  _regs[MFRC630_REG_STATUS] = (_regs[MFRC630_REG_STATUS] & ~0x07) | state;
+}
+
+void MFRC630Sim::cancel(void) {
+  _gen++;
+  _cmd = MFRC630_CMD_IDLE;
+  _phase = PH_IDLE;
+  _authcard = NULL;
+  setComState(MFRC630_COMSTAT_IDLE);
+}
+
+void MFRC630Sim::commandDone(void) {
+  cancel();
+  raise0(MFRC630IRQ0_IDLEIRQ);
+}
+
+void MFRC630Sim::startCommand(uint8_t value) {
+  uint8_t cmd = value & 0x1F;
+
+  /* A new command (IDLE included) stops the current one */
+  cancel();
+  _standby = (value & MFRC630_CMD_STANDBY) != 0;
+  updateField();
+  if (cmd == MFRC630_CMD_IDLE) {
+    return;
+  }
+
+  _commands++;
+  _cmd = cmd;
+  _regs[MFRC630_REG_ERROR] = 0;
+
+  switch (cmd) {
+  case MFRC630_CMD_SOFTRESET:
+    resetRegisters();
+    return;
+
+  case MFRC630_CMD_LPCD:
+    _phase = PH_LPCD;
+    return;
+
+  case MFRC630_CMD_TRANSMIT:
+  case MFRC630_CMD_TRANSCEIVE:
+    txStart();
+    return;
+
+  case MFRC630_CMD_RECEIVE:
+    /* Nothing talks unless asked to */
+    _hasresp = false;
+    _phase = PH_RXWAIT;
+    setComState(MFRC630_COMSTAT_RXWAIT);
+    return;
+
+  case MFRC630_CMD_READRNR:
+    _phase = PH_BUSY;
+    while (_fifo.size() < fifoSize()) {
+      _rng ^= _rng << 13;
+      _rng ^= _rng >> 17;
+      _rng ^= _rng << 5;
+      fifoPush((uint8_t)_rng);
+    }
+    schedule(fifoSize() * 1.0, &_gen, &MFRC630Sim::commandDone);
+    return;
+
+  default:
+    _phase = PH_PARAMS;
+    tryParams();
+    return;
+  }
+}
+
+/**
+ * Number of FIFO bytes a command needs before it starts, 0 if unknown
+ */
+static uint8_t params_needed(uint8_t cmd) {
+  switch (cmd) {
+  case MFRC630_CMD_MFAUTHENT:
+  case MFRC630_CMD_LOADKEY:
+    return 6;
+  case MFRC630_CMD_WRITEE2:
+  case MFRC630_CMD_READE2:
+    return 3;
+  case MFRC630_CMD_WRITEE2PAGE:
+  case MFRC630_CMD_LOADPROTOCOL:
+    return 2;
+  case MFRC630_CMD_LOADREG:
+    return 4;
+  case MFRC630_CMD_LOADKEYE2:
+    return 1;
+  case MFRC630_CMD_STOREKEYE2:
+    return 7;
+  default:
+    return 0;
+  }
+}
+
+void MFRC630Sim::tryParams(void) {
+  uint8_t needed = params_needed(_cmd);
+
+  if (!needed) {
+    /* Not a command this model knows: it just ends */
+    commandDone();
+    return;
+  }
+  if (_fifo.size() < needed) {
+    return;
+  }
+
+  _phase = PH_BUSY;
+  if (_cmd == MFRC630_CMD_MFAUTHENT) {
+    authStart();
+  } else {
+    runLocal();
+  }
+}
+
+void MFRC630Sim::localError(void) {
+  error(MFRC630_ERROR_EEPROM);
+  commandDone();
+}
+
+void MFRC630Sim::runLocal(void) {
+  uint8_t p[7];
+  double busy = 1.0;
+
+  switch (_cmd) {
+  case MFRC630_CMD_LOADKEY:
+    for (uint8_t i = 0; i < 6; i++) {
+      _key[i] = fifoPop();
+    }
+    break;
+
+  case MFRC630_CMD_WRITEE2: {
+    for (uint8_t i = 0; i < 3; i++) {
+      p[i] = fifoPop();
+    }
+    uint16_t addr = (p[0] << 8) | p[1];
+    if ((addr < 64) || (addr >= SIM_EEPROM_KEYS)) {
+      localError();
+      return;
+    }
+    _eeprom[addr] = p[2];
+    _pagewrites++;
+    busy = SIM_EEPROM_WRITE_US;
+    break;
+  }
+
+  case MFRC630_CMD_WRITEE2PAGE: {
+    uint8_t page = fifoPop();
+    if (!page || (page >= SIM_EEPROM_KEYS / 64)) {
+      fifoFlush();
+      localError();
+      return;
+    }
+    for (uint8_t i = 0; (i < 64) && !_fifo.empty(); i++) {
+      _eeprom[page * 64 + i] = fifoPop();
+    }
+    _pagewrites++;
+    busy = SIM_EEPROM_WRITE_US;
+    break;
+  }
+
+  case MFRC630_CMD_READE2: {
+    for (uint8_t i = 0; i < 3; i++) {
+      p[i] = fifoPop();
+    }
+    uint16_t addr = (p[0] << 8) | p[1];
+    uint16_t n = p[2] ? p[2] : 256;
+    if ((addr + n > SIM_EEPROM_KEYS) && (addr < SIM_EEPROM_KEYS + 1024)) {
+      localError();
+      return;
+    }
+    if (addr + n > SIM_EEPROM_SIZE) {
+      localError();
+      return;
+    }
+    for (uint16_t i = 0; i < n; i++) {
+      fifoPush(_eeprom[addr + i]);
+    }
+    busy = n;
+    break;
+  }
+
+  case MFRC630_CMD_LOADREG: {
+    for (uint8_t i = 0; i < 4; i++) {
+      p[i] = fifoPop();
+    }
+    uint16_t addr = (p[0] << 8) | p[1];
+    if ((addr < 192) || (addr + p[3] > SIM_EEPROM_KEYS)) {
+      localError();
+      return;
+    }
+    for (uint8_t i = 0; i < p[3]; i++) {
+      writeRegister(p[2] + i, _eeprom[addr + i]);
+    }
+    busy = p[3];
+    break;
+  }
+
+  case MFRC630_CMD_LOADPROTOCOL: {
+    uint8_t rx = fifoPop();
+    uint8_t tx = fifoPop();
+    if ((rx > 3) || (tx > 3)) {
+      localError();
+      return;
+    }
+    for (uint8_t i = 0; i < 18; i++) {
+      uint8_t reg = MFRC630_REG_DRV_MOD + i;
+      writeRegister(reg, protocols[(reg < SIM_PROTOCOL_RX) ? tx : rx][i]);
+    }
+    busy = 18;
+    break;
+  }
+
+  case MFRC630_CMD_LOADKEYE2: {
+    uint8_t slot = fifoPop();
+    if (slot >= 128) {
+      localError();
+      return;
+    }
+    memcpy(_key, &_eeprom[SIM_EEPROM_KEYS + slot * 8], 6);
+    break;
+  }
+
+  case MFRC630_CMD_STOREKEYE2: {
+    uint8_t slot = fifoPop();
+    busy = 0;
+    while (_fifo.size() >= 6) {
+      if (slot >= 128) {
+        fifoFlush();
+        localError();
+        return;
+      }
+      for (uint8_t i = 0; i < 6; i++) {
+        _eeprom[SIM_EEPROM_KEYS + slot * 8 + i] = fifoPop();
+      }
+      slot++;
+      _pagewrites++;
+      busy += SIM_EEPROM_WRITE_US;
+    }
+    break;
+  }
+
+  default:
+    break;
+  }
+
+  schedule(busy, &_gen, &MFRC630Sim::commandDone);
+}
+
+/***************************************************************************
+ RF
+ ***************************************************************************/
+
+void MFRC630Sim::txStart(void) {
+  _phase = PH_TX;
+  _txbytes.clear();
+  setComState(MFRC630_COMSTAT_TRANSMITTING);
+
+  /* Start of communication, then the first byte */
+  schedule(bitTime(txRate()), &_gen, &MFRC630Sim::txNextByte);
+}
+
+void MFRC630Sim::txNextByte(void) {
+  if (_fifo.empty()) {
+    txEnd();
+    return;
+  }
+  _txbytes.push_back(fifoPop());
+
+  /* The last byte in the FIFO may be a partial one */
+  if (_fifo.empty()) {
+    uint8_t lastbits = _regs[MFRC630_REG_TX_DATA_NUM] & 0x07;
+    double bits = lastbits ? lastbits : 9;
+    if (_regs[MFRC630_REG_TX_CRC_PRESET] & 0x01) {
+      bits += 18;
+    }
+    schedule((bits + 1) * bitTime(txRate()), &_gen, &MFRC630Sim::txEnd);
+    return;
+  }
+  schedule(9 * bitTime(txRate()), &_gen, &MFRC630Sim::txNextByte);
+}
+
+void MFRC630Sim::txEnd(void) {
+  uint8_t lastbits = _regs[MFRC630_REG_TX_DATA_NUM] & 0x07;
+
+  _tx = SimFrame();
+  _tx.data = _txbytes;
+  if (!_txbytes.empty()) {
+    _tx.bits = (uint16_t)((_txbytes.size() - 1) * 8);
+    _tx.bits += lastbits ? lastbits : 8;
+    if (lastbits) {
+      _tx.data.back() &= (uint8_t)((1 << lastbits) - 1);
+    }
+  }
+  _tx.crc = _regs[MFRC630_REG_TX_CRC_PRESET] & 0x01;
+  _tx.rate = txRate();
+  _lastframe = _tx;
+  _frames++;
+
+  raise0(MFRC630IRQ0_TXIRQ);
+  t0Start();
+  if (_cmd == MFRC630_CMD_TRANSMIT) {
+    commandDone();
+    return;
+  }
+
+  _phase = PH_RXWAIT;
+  setComState(MFRC630_COMSTAT_RXWAIT);
+  _hasresp = deliver(_tx, &_resp);
+  if (_hasresp) {
+    schedule(SIM_FDT_US + _resp.delay_us, &_gen, &MFRC630Sim::rxStart);
+  }
+}
+
+bool MFRC630Sim::deliver(const SimFrame &frame, SimFrame *resp) {
+  bool encrypted = _regs[MFRC630_REG_STATUS] & MFRC630STATUS_CRYPTO1ON;
+  std::vector<SimFrame> answers;
+
+  if (!_field) {
+    return false;
+  }
+
+  for (size_t i = 0; i < _cards.size(); i++) {
+    SimFrame out;
+    if (_cards[i]->receive(frame, encrypted, &out) && (out.rate == rxRate())) {
+      answers.push_back(out);
+    }
+  }
+  if (answers.empty()) {
+    return false;
+  }
+
+  /*
+   * Several cards answering at once: bits they agree on come through, the
+   * first one they don't is the collision. What follows is garbage.
+   */
+  *resp = answers[0];
+  _collision = false;
+  for (size_t a = 1; a < answers.size(); a++) {
+    uint16_t bits = resp->bits;
+    if (answers[a].bits > bits) {
+      bits = answers[a].bits;
+    }
+    for (uint16_t i = 0; i < bits; i++) {
+      uint8_t b0 = (i < resp->bits) ? resp->bit(i) : 0xFF;
+      uint8_t b1 = (i < answers[a].bits) ? answers[a].bit(i) : 0xFF;
+      if (b0 != b1) {
+        if (!_collision || (i < _collpos)) {
+          _collision = true;
+          _collpos = i;
+        }
+        break;
+      }
+    }
+  }
+  if (_collision) {
+    SimFrame merged;
+    for (uint16_t i = 0; i < resp->bits; i++) {
+      merged.push((i < _collpos) ? resp->bit(i) : 0);
+    }
+    merged.crc = resp->crc;
+    merged.badcrc = true;
+    merged.rate = resp->rate;
+    merged.delay_us = resp->delay_us;
+    *resp = merged;
+  }
+
+  return true;
+}
+
+void MFRC630Sim::rxStart(void) {
+  bool rxcrc = _regs[MFRC630_REG_RX_CRC_CON] & 0x01;
+  uint8_t align = (_regs[MFRC630_REG_RX_BIT_CTRL] >> 4) & 0x07;
+  SimFrame bits;
+
+  _phase = PH_RX;
+  setComState(MFRC630_COMSTAT_RECEIVING);
+  raise0(MFRC630IRQ0_RXSOF);
+  if (_regs[MFRC630_REG_T0_CONTROL] & 0x80) {
+    t0Stop();
+  }
+
+  /* Payload, plus the CRC bytes if the receiver doesn't check them */
+  for (uint8_t i = 0; i < align; i++) {
+    bits.push(0);
+  }
+  for (uint16_t i = 0; i < _resp.bits; i++) {
+    bits.push(_resp.bit(i));
+  }
+  if (_resp.crc && !rxcrc) {
+    uint16_t crc = crc_a(_resp.data.data(), _resp.data.size());
+    if (_resp.badcrc) {
+      crc ^= 0x5A5A;
+    }
+    for (uint8_t i = 0; i < 16; i++) {
+      bits.push((crc >> i) & 1);
+    }
+  }
+  _rxbytes = bits.data;
+  _rxbits = bits.bits;
+  _rxpos = 0;
+
+  schedule(9 * bitTime(rxRate()), &_gen, &MFRC630Sim::rxNextByte);
+}
+
+void MFRC630Sim::rxNextByte(void) {
+  if (_rxpos < _rxbytes.size()) {
+    fifoPush(_rxbytes[_rxpos++]);
+  }
+  if (_rxpos < _rxbytes.size()) {
+    schedule(9 * bitTime(rxRate()), &_gen, &MFRC630Sim::rxNextByte);
+    return;
+  }
+
+  /* CRC bytes the receiver checks and strips still take their time */
+  bool rxcrc = _regs[MFRC630_REG_RX_CRC_CON] & 0x01;
+  double left = (_resp.crc && rxcrc) ? 18 : 0;
+  schedule((left + 1) * bitTime(rxRate()), &_gen, &MFRC630Sim::rxEnd);
+}
+
+void MFRC630Sim::rxEnd(void) {
+  bool rxcrc = _regs[MFRC630_REG_RX_CRC_CON] & 0x01;
+
+  _regs[MFRC630_REG_RX_COLL] = 0;
+  if (_collision) {
+    _regs[MFRC630_REG_RX_COLL] = 0x80 | (_collpos & 0x7F);
+    error(MFRC630_ERROR_COLLDET);
+  } else if (rxcrc && (!_resp.crc || _resp.badcrc)) {
+    error(MFRC630_ERROR_INTEG);
+  }
+  _regs[MFRC630_REG_RX_BIT_CTRL] =
+      (_regs[MFRC630_REG_RX_BIT_CTRL] & 0xF8) | (_rxbits & 0x07);
+
+  raise0(MFRC630IRQ0_RXIRQ);
+  commandDone();
+}
+
+/***************************************************************************
+ MFAUTHENT
+ ***************************************************************************/
+
+void MFRC630Sim::authStart(void) {
+  bool encrypted = _regs[MFRC630_REG_STATUS] & MFRC630STATUS_CRYPTO1ON;
+
+  _authkeytype = fifoPop();
+  _authblock = fifoPop();
+  for (uint8_t i = 0; i < 4; i++) {
+    _authuid[i] = fifoPop();
+  }
+  _regs[MFRC630_REG_STATUS] &= ~MFRC630STATUS_CRYPTO1ON;
+  setComState(MFRC630_COMSTAT_TRANSMITTING);
+
+  /* AUTH keytype, block with CRC_A */
+  uint8_t cmd[2] = {_authkeytype, _authblock};
+  _lastframe = SimFrame::bytes(cmd, sizeof(cmd), true);
+  _lastframe.rate = txRate();
+  _frames++;
+  _authcard = NULL;
+  if (_field) {
+    for (size_t i = 0; i < _cards.size(); i++) {
+      if (_cards[i]->authRequest(_authkeytype, _authblock, encrypted) &&
+          !_authcard) {
+        _authcard = _cards[i];
+      }
+    }
+  }
+
+  schedule(38 * bitTime(txRate()), &_gen, &MFRC630Sim::authSent);
+}
+
+void MFRC630Sim::authSent(void) {
+  /* Wait for the card nonce (or Timer0) */
+  t0Start();
+  _phase = PH_RXWAIT;
+  setComState(MFRC630_COMSTAT_RXWAIT);
+  if (_authcard) {
+    double nonce = (4 * 9 + 1) * bitTime(rxRate());
+    double delay = SIM_FDT_US + _authcard->responseDelay();
+    schedule(delay, &_gen, &MFRC630Sim::authNonce);
+    schedule(delay + nonce + SIM_TURNAROUND_US + 74 * bitTime(txRate()),
+             &_gen, &MFRC630Sim::authToken);
+  }
+}
+
+void MFRC630Sim::authNonce(void) {
+  if (_regs[MFRC630_REG_T0_CONTROL] & 0x80) {
+    t0Stop();
+  }
+}
+
+void MFRC630Sim::authToken(void) {
+  /* Reader token sent, the card answers if it agrees on the key */
+  t0Start();
+  if (!_authcard || !_authcard->authVerify(_authuid, _key)) {
+    return;
+  }
+  schedule(SIM_FDT_US + (4 * 9 + 1) * bitTime(rxRate()), &_gen,
+           &MFRC630Sim::authDone);
+}
+
+void MFRC630Sim::authDone(void) {
+  if (_regs[MFRC630_REG_T0_CONTROL] & 0x80) {
+    t0Stop();
+  }
+  _regs[MFRC630_REG_STATUS] |= MFRC630STATUS_CRYPTO1ON;
+  commandDone();
+}
+
+/***************************************************************************
+ TIMERS
+ ***************************************************************************/
+
+/**
+ * Timer0 tick in us for the clock selected in T0_CONTROL
+ */
+static double t0_tick(uint8_t control) {
+  return ((control & 0x03) == 0) ? (1.0 / SIM_FC_MHZ) : (64.0 / SIM_FC_MHZ);
+}
+
+void MFRC630Sim::t0Start(void) {
+  /* T0StartTxEnd */
+  if (((_regs[MFRC630_REG_T0_CONTROL] >> 4) & 0x03) != 0x01) {
+    return;
+  }
+  _t0running = true;
+  _t0start = host::now();
+  _t0value = (_regs[MFRC630_REG_T0_RELOAD_HI] << 8) |
+             _regs[MFRC630_REG_TO_RELOAD_LO];
+  _t0gen++;
+  if (_t0stalled) {
+    return;
+  }
+  schedule(_t0value * t0_tick(_regs[MFRC630_REG_T0_CONTROL]), &_t0gen,
+           &MFRC630Sim::t0Expired);
+}
+
+void MFRC630Sim::t0Stop(void) {
+  if (!_t0running) {
+    return;
+  }
+  _t0value = t0Counter();
+  _t0running = false;
+  _t0gen++;
+}
+
+uint16_t MFRC630Sim::t0Counter(void) const {
+  if (!_t0running) {
+    return _t0value;
+  }
+  double ticks = (host::now() - _t0start) / 1000.0 /
+                 t0_tick(_regs[MFRC630_REG_T0_CONTROL]);
+  return (ticks >= _t0value) ? 0 : (uint16_t)(_t0value - (uint16_t)ticks);
+}
+
+void MFRC630Sim::t0Expired(void) {
+  _t0running = false;
+  _t0value = 0;
+  raise1(MFRC630IRQ1_TIMER0IRQ);
+}
+
+/**
+ * Timer4 tick in us for the LFO divider selected in T4_CONTROL
+ */
+static double t4_tick(uint8_t control) {
+  static const double ticks[4] = {64, 256, 1024, 2048};
+  return ticks[control & MFRC630T4_CLK_LFO_DIV];
+}
+
+void MFRC630Sim::t4Start(void) {
+  uint16_t reload = (_regs[MFRC630_REG_T4_RELOAD_HI] << 8) |
+                    _regs[MFRC630_REG_T4_RELOAD_LO];
+
+  _t4running = true;
+  _t4gen++;
+  schedule((reload ? reload : 1) * t4_tick(_regs[MFRC630_REG_T4_CONTROL]),
+           &_t4gen, &MFRC630Sim::t4Expired);
+}
+
+void MFRC630Sim::t4Expired(void) {
+  uint8_t control = _regs[MFRC630_REG_T4_CONTROL];
+
+  raise1(MFRC630IRQ1_TIMER4IRQ);
+  if ((control & MFRC630T4_AUTOLPCD) && (_phase == PH_LPCD) &&
+      lpcdMeasure()) {
+    return;
+  }
+  if (control & MFRC630T4_AUTORESTART) {
+    t4Start();
+  } else {
+    _t4running = false;
+  }
+}
+
+bool MFRC630Sim::lpcdMeasure(void) {
+  int i = _lpcd_i;
+  int q = _lpcd_q;
+
+  for (size_t c = 0; c < _cards.size(); c++) {
+    i += _cards[c]->lpcdI();
+    q += _cards[c]->lpcdQ();
+  }
+  i = (i < 0) ? 0 : (i > 63) ? 63 : i;
+  q = (q < 0) ? 0 : (q > 63) ? 63 : q;
+  _regs[MFRC630_REG_LPCD_I_RESULT] = (uint8_t)i;
+  _regs[MFRC630_REG_LPCD_Q_RESULT] = (uint8_t)q;
+  _lpcdruns++;
+
+  /* Calibration: one measurement and done */
+  if (!_standby) {
+    _t4running = false;
+    _t4gen++;
+    commandDone();
+    return true;
+  }
+
+  /* The upper bits of the window registers hold IMax */
+  uint8_t qmin = _regs[MFRC630_REG_LPCD_QMIN];
+  uint8_t qmax = _regs[MFRC630_REG_LPCD_QMAX];
+  uint8_t imin = _regs[MFRC630_REG_LPCD_IMIN];
+  uint8_t imax = ((qmin >> 6) << 4) | ((qmax >> 6) << 2) | (imin >> 6);
+  if ((i >= (imin & 0x3F)) && (i <= imax) && (q >= (qmin & 0x3F)) &&
+      (q <= (qmax & 0x3F))) {
+    return false;
+  }
+
+  /* Card detected: wake up */
+  raise1(MFRC630IRQ1_LPCDIRQ);
+  _t4running = false;
+  _t4gen++;
+  _standby = false;
+  commandDone();
+  updateField();
+  return true;
+}
+
+/***************************************************************************
+ BUSES
+ ***************************************************************************/
+
+bool MFRC630Sim::i2cWrite(const uint8_t *data, size_t len) {
+  if (!ready()) {
+    return false;
+  }
+  if (!len) {
+    return true;
+  }
+
+  _i2cptr = data[0] & 0x7F;
+  for (size_t i = 1; i < len; i++) {
+    writeRegister(_i2cptr, data[i]);
+    if (_i2cptr != MFRC630_REG_FIFO_DATA) {
+      _i2cptr++;
+    }
+  }
+
+  return true;
+}
+
+bool MFRC630Sim::i2cRead(uint8_t *data, size_t len) {
+  if (!ready()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    data[i] = readRegister(_i2cptr);
+    if (_i2cptr != MFRC630_REG_FIFO_DATA) {
+      _i2cptr++;
+    }
+  }
+
+  return true;
+}
+
+void MFRC630Sim::spiSelect(bool selected) {
+  (void)selected;
+  _spistate = SPI_ADDR;
+}
+
+uint8_t MFRC630Sim::spiTransfer(uint8_t mosi) {
+  uint8_t miso = 0;
+
+  if (!ready()) {
+    return 0;
+  }
+
+  switch (_spistate) {
+  case SPI_ADDR:
+    _spireg = mosi >> 1;
+    _spistate = (mosi & 0x01) ? SPI_READ : SPI_WRITE;
+    break;
+
+  case SPI_WRITE:
+    writeRegister(_spireg, mosi);
+    if (_spireg != MFRC630_REG_FIFO_DATA) {
+      _spireg++;
+    }
+    break;
+
+  case SPI_READ:
+    /* Data for the last address goes out while the next one comes in */
+    miso = readRegister(_spireg);
+    _spireg = mosi >> 1;
+    break;
+  }
+
+  return miso;
+}
+
+void MFRC630Sim::serialReceive(uint8_t c) {
+  if (!ready() || !_serial) {
+    return;
+  }
+
+  /* No bursts on the UART: address/data pairs and single byte reads */
+  if (_uartwrite) {
+    _uartwrite = false;
+    writeRegister(_uartreg, c);
+    return;
+  }
+  if (c & 0x01) {
+    _serial->deviceWrite(readRegister(c >> 1));
+  } else {
+    _uartreg = c >> 1;
+    _uartwrite = true;
+  }
+}
@@ -0,0 +1,252 @@
+/*!
+ * @file MFRC630Sim.h
+ *
+ * Behavioural model of the MFRC630 for host builds: the register file, the
+ * 255/512 byte FIFO with water level alerts, the command engine (IDLE,
+ * TRANSCEIVE, TRANSMIT, RECEIVE, MFAUTHENT, LOADKEY, the EEPROM commands,
+ * LOADREG, LOADPROTOCOL, READRNR, LPCD, SOFTRESET), Timer0 and Timer4,
+ * IRQ0/IRQ1 with the IRQ pin, the ERROR register and an RF field with
+ * SimCards in it.
+ *
+ * The model is reached like the real IC, over the I2C, SPI or UART shims
+ * (at their timing), or directly through MFRC630SimBus. Everything it does
+ * takes virtual time: frames take their bit times at the configured rates,
+ * cards answer after the ISO14443 frame delay time, Timer0 runs at
+ * 211.875kHz, EEPROM pages take milliseconds to program.
+ *
+ * Not modelled: analog behaviour apart from LPCD, Timer1..3, the CRC
+ * presets (CRC_A is assumed), parity errors, the serial speed register.
+ */
+#ifndef __MFRC630SIM_H__
+#define __MFRC630SIM_H__
+
+#include "SimCard.h"
+
+#include <HardwareSerial.h>
+#include <SPI.h>
+#include <Wire.h>
+
+#include <host.h>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+/**
+ * The MFRC630 model, see the file comment.
+ */
+class MFRC630Sim : public TwoWireDevice, public SPIDevice, public SerialDevice {
+public:
+  MFRC630Sim(void);
+  ~MFRC630Sim();
+
+  /* Wiring */
+
+  /** Puts the IC on 'wire' at 'address' */
+  void attachI2C(TwoWire *wire, uint8_t address);
+
+  /** Puts the IC on 'spi' with its chip select on 'cs' */
+  void attachSPI(SPIClass *spi, uint8_t cs);
+
+  /** Connects the IC's UART to 'serial' */
+  void attachSerial(HardwareSerial *serial);
+
+  /** Connects PDOWN to 'pin'. While it is high the IC is held in reset. */
+  void attachPdown(uint8_t pin);
+
+  /** Lets the IC drive the IRQ pin 'pin' */
+  void attachIrq(uint8_t pin);
+
+  /* Field */
+
+  /** Brings a card into the field (it powers up if the field is on) */
+  void addCard(SimCard *card);
+
+  /** Takes a card out of the field */
+  void removeCard(SimCard *card);
+
+  /* Register access without bus timing, see MFRC630SimBus */
+
+  /** Reads a register, with the side effects of a bus read */
+  uint8_t readRegister(uint8_t reg);
+
+  /** Writes a register, with the side effects of a bus write */
+  void writeRegister(uint8_t reg, uint8_t value);
+
+  /** False while held in reset or starting up (the IC doesn't answer) */
+  bool ready(void) const;
+
+  /* Inspection */
+
+  /** Register file contents, without side effects */
+  uint8_t peek(uint8_t reg) const { return _regs[reg & 0x7F]; }
+
+  /** The RF field is on (DRV_MOD TxEn, not in standby or reset) */
+  bool fieldOn(void) const;
+
+  /** Level of the IRQ pin */
+  bool irqLevel(void) const;
+
+  /** TX and RX rate (0..3 = 106..848 kbit/s) from TX_MOD_WIDTH, RX_CTRL */
+  uint8_t txRate(void) const;
+  uint8_t rxRate(void) const; //!< See txRate()
+
+  /** The 8kB EEPROM */
+  std::vector<uint8_t> &eeprom(void) { return _eeprom; }
+
+  /** LPCD I/Q results with no card in the field */
+  void setLpcdBaseline(uint8_t i, uint8_t q) {
+    _lpcd_i = i;
+    _lpcd_q = q;
+  }
+
+  /** Fault injection: Timer0 counts but never expires (TIMER0IRQ lost) */
+  void stallTimer0(bool stalled) { _t0stalled = stalled; }
+
+  /** Last frame sent to the field */
+  const SimFrame &lastFrame(void) const { return _lastframe; }
+
+  /** Statistics */
+  uint32_t framesSent(void) const { return _frames; }
+  uint32_t eepromPageWrites(void) const { return _pagewrites; }
+  uint32_t lpcdMeasurements(void) const { return _lpcdruns; }
+  uint32_t fifoOverflows(void) const { return _overflows; }
+  uint32_t commandsStarted(void) const { return _commands; }
+
+  /* Bus callbacks (TwoWireDevice, SPIDevice, SerialDevice) */
+  bool i2cWrite(const uint8_t *data, size_t len);
+  bool i2cRead(uint8_t *data, size_t len);
+  void spiSelect(bool selected);
+  uint8_t spiTransfer(uint8_t mosi);
+  void serialReceive(uint8_t c);
+
+private:
+  /* Command engine phases */
+  enum phase {
+    PH_IDLE,      /* No command */
+    PH_PARAMS,    /* Waiting for the command's parameters in the FIFO */
+    PH_BUSY,      /* Local command running */
+    PH_TX,        /* Transmitting */
+    PH_RXWAIT,    /* Waiting for a response */
+    PH_RX,        /* Receiving */
+    PH_LPCD       /* LPCD command armed */
+  };
+
+  void powerOn(void);
+  void powerOff(void);
+  void resetRegisters(void);
+
+  /* FIFO */
+  uint16_t fifoSize(void) const;
+  uint16_t waterLevel(void) const;
+  void fifoPush(uint8_t c);
+  uint8_t fifoPop(void);
+  void fifoFlush(void);
+
+  /* IRQs and errors */
+  void raise0(uint8_t bits);
+  void raise1(uint8_t bits);
+  void error(uint8_t bits);
+  uint8_t irq1(void) const;
+
+  /* Command engine */
+  void schedule(double us, uint32_t *gen, void (MFRC630Sim::*fn)(void));
+  void startCommand(uint8_t value);
+  void tryParams(void);
+  void runLocal(void);
+  void localError(void);
+  void commandDone(void);
+  void cancel(void);
+  void setComState(uint8_t state);
+
+  /* RF */
+  double bitTime(uint8_t rate) const;
+  void updateField(void);
+  void txStart(void);
+  void txNextByte(void);
+  void txEnd(void);
+  bool deliver(const SimFrame &frame, SimFrame *resp);
+  void rxStart(void);
+  void rxNextByte(void);
+  void rxEnd(void);
+  void authStart(void);
+  void authSent(void);
+  void authNonce(void);
+  void authToken(void);
+  void authDone(void);
+
+  /* Timers */
+  void t0Start(void);
+  void t0Stop(void);
+  uint16_t t0Counter(void) const;
+  void t0Expired(void);
+  void t4Start(void);
+  void t4Expired(void);
+  bool lpcdMeasure(void);
+
+  /* Bus protocols */
+  uint8_t _i2cptr;
+  enum { SPI_ADDR, SPI_WRITE, SPI_READ } _spistate;
+  uint8_t _spireg;
+  bool _uartwrite;
+  uint8_t _uartreg;
+  HardwareSerial *_serial;
+  TwoWire *_wire;
+  uint8_t _i2caddr;
+  SPIClass *_spi;
+  uint8_t _spics;
+  int16_t _pdown;
+
+  /* State */
+  uint8_t _regs[128];
+  std::deque<uint8_t> _fifo;
+  std::vector<uint8_t> _eeprom;
+  bool _powered;          /* Out of power down */
+  host::time_ns _readyat; /* End of the startup time */
+  uint8_t _cmd;
+  bool _standby;
+  phase _phase;
+  uint32_t _gen; /* Bumped when a command ends, invalidates its events */
+  uint8_t _key[6];
+  uint32_t _rng;
+  std::shared_ptr<bool> _alive; /* Cleared when destroyed, for callbacks */
+
+  /* Frame in flight */
+  std::vector<uint8_t> _txbytes;
+  SimFrame _tx;
+  SimFrame _resp;
+  bool _hasresp;
+  bool _collision;
+  uint16_t _collpos;
+  std::vector<uint8_t> _rxbytes; /* Bytes for the FIFO, aligned */
+  uint16_t _rxbits;
+  size_t _rxpos;
+  SimCard *_authcard;
+  uint8_t _authkeytype;
+  uint8_t _authblock;
+  uint8_t _authuid[4];
+
+  /* Timers */
+  bool _t0running;
+  host::time_ns _t0start;
+  uint16_t _t0value; /* Counter value while stopped */
+  uint32_t _t0gen;
+  bool _t0stalled;
+  bool _t4running;
+  uint32_t _t4gen;
+
+  /* Field */
+  std::vector<SimCard *> _cards;
+  bool _field;
+  uint8_t _lpcd_i, _lpcd_q;
+
+  /* Statistics */
+  SimFrame _lastframe;
+  uint32_t _frames;
+  uint32_t _pagewrites;
+  uint32_t _lpcdruns;
+  uint32_t _overflows;
+  uint32_t _commands;
+};
+
+#endif
@@ -0,0 +1,722 @@
+/*!
+ * @file SimCard.cpp
+ *
+ * Virtual ISO14443A cards for the MFRC630 model
+ */
+#include "SimCard.h"
+
+#include <string.h>
+
+/* Short frame commands and ISO14443-3 frames */
+#define CMD_REQA 0x26
+#define CMD_WUPA 0x52
+#define CMD_HLTA 0x50
+#define CASCADE_TAG 0x88
+
+/* Mifare ACK/NAK nibbles */
+#define MIFARE_ACK 0x0A
+#define MIFARE_NAK 0x04
+#define NTAG_NAK 0x00
+
+SimFrame SimFrame::bytes(const uint8_t *data, size_t len, bool crc) {
+  SimFrame f;
+  f.data.assign(data, data + len);
+  f.bits = (uint16_t)(len * 8);
+  f.crc = crc;
+  return f;
+}
+
+void SimFrame::push(uint8_t bit) {
+  if (!(bits % 8)) {
+    data.push_back(0);
+  }
+  data[bits / 8] |= (bit & 1) << (bits % 8);
+  bits++;
+}
+
+/***************************************************************************
+ ISO14443-3
+ ***************************************************************************/
+
+SimCard::SimCard(const uint8_t *uid, uint8_t uidlen, uint16_t atqa,
+                 uint8_t sak)
+    : _state(POWER_OFF), _uidlen(uidlen), _atqa(atqa), _sak(sak), _rxrate(0),
+      _txrate(0), _halted(false), _level(1), _delay_us(0), _mute(0),
+      _drop(0), _corrupt(0), _badbcc(0), _lpcd_i(4), _lpcd_q(4),
+      _frames(0) {
+  memset(_uid, 0, sizeof(_uid));
+  memcpy(_uid, uid, uidlen);
+}
+
+void SimCard::power(bool on) {
+  if (on == (_state != POWER_OFF)) {
+    return;
+  }
+  _state = on ? IDLE : POWER_OFF;
+  _halted = false;
+  _rxrate = 0;
+  _txrate = 0;
+  deactivate();
+}
+
+void SimCard::fail(void) {
+  _state = _halted ? HALT : IDLE;
+  deactivate();
+}
+
+void SimCard::answer(SimFrame *out, const uint8_t *data, size_t len) {
+  *out = SimFrame::bytes(data, len, true);
+  out->rate = _txrate;
+}
+
+void SimCard::answer4(SimFrame *out, uint8_t nibble) {
+  *out = SimFrame();
+  out->data.push_back(nibble & 0x0F);
+  out->bits = 4;
+  out->rate = _txrate;
+}
+
+void SimCard::cascadeLevel(uint8_t level, uint8_t *cl) {
+  uint8_t levels = (_uidlen == 10) ? 3 : (_uidlen == 7) ? 2 : 1;
+
+  /* All but the last level start with the cascade tag and 3 UID bytes */
+  if (level < levels) {
+    cl[0] = CASCADE_TAG;
+    memcpy(&cl[1], &_uid[(level - 1) * 3], 3);
+  } else {
+    memcpy(cl, &_uid[(level - 1) * 3], 4);
+  }
+  cl[4] = cl[0] ^ cl[1] ^ cl[2] ^ cl[3];
+}
+
+bool SimCard::anticollision(const SimFrame &in, SimFrame *out) {
+  static const uint8_t sel[3] = {0x93, 0x95, 0x97};
+  uint8_t levels = (_uidlen == 10) ? 3 : (_uidlen == 7) ? 2 : 1;
+  uint8_t cl[5];
+
+  if ((in.bits < 16) || (in.data[0] != sel[_level - 1])) {
+    fail();
+    return false;
+  }
+  cascadeLevel(_level, cl);
+  uint8_t nvb = in.data[1];
+
+  /* SELECT: NVB 0x70 with all 40 bits and a CRC */
+  if (in.crc) {
+    if ((nvb != 0x70) || (in.bits != 56) || memcmp(&in.data[2], cl, 5)) {
+      fail();
+      return false;
+    }
+    uint8_t sak = 0x04; /* Cascade bit, UID not complete */
+    if (_level == levels) {
+      _state = ACTIVE;
+      sak = _sak;
+    } else {
+      _level++;
+    }
+    answer(out, &sak, 1);
+    return true;
+  }
+
+  /*
+   * ANTICOLLISION: the bits of the frame after SEL and NVB are the UID bits
+   * the reader knows. Cards they match answer with the rest.
+   */
+  uint16_t known = (nvb >> 4) * 8 + (nvb & 0x0F);
+  if ((known != in.bits) || (known >= 56)) {
+    fail();
+    return false;
+  }
+  uint16_t kbits = known - 16;
+  for (uint16_t i = 0; i < kbits; i++) {
+    if (in.bit(16 + i) != ((cl[i / 8] >> (i % 8)) & 1)) {
+      return false;
+    }
+  }
+  if (_badbcc) {
+    _badbcc--;
+    cl[4] ^= 0xFF;
+  }
+  *out = SimFrame();
+  for (uint16_t i = kbits; i < 40; i++) {
+    out->push((cl[i / 8] >> (i % 8)) & 1);
+  }
+  out->rate = _txrate;
+  return true;
+}
+
+bool SimCard::receive(const SimFrame &in, bool encrypted, SimFrame *out) {
+  bool answered = false;
+
+  if (_state == POWER_OFF) {
+    return false;
+  }
+  if (_mute) {
+    _mute--;
+    return false;
+  }
+  _frames++;
+
+  /* Wrong bit rate or Crypto1 state: just noise to this card */
+  if ((in.rate != _rxrate) || (encrypted != crypto())) {
+    if ((_state == READY) || (_state == ACTIVE)) {
+      fail();
+    }
+    return false;
+  }
+
+  if ((in.bits == 7) && !in.crc) {
+    uint8_t cmd = in.data[0] & 0x7F;
+    if (((cmd == CMD_REQA) && (_state == IDLE)) ||
+        ((cmd == CMD_WUPA) && ((_state == IDLE) || (_state == HALT)))) {
+      _halted = (_state == HALT);
+      _state = READY;
+      _level = 1;
+      uint8_t atqa[2] = {(uint8_t)(_atqa & 0xFF), (uint8_t)(_atqa >> 8)};
+      *out = SimFrame::bytes(atqa, sizeof(atqa), false);
+      out->rate = _txrate;
+      answered = true;
+    } else if ((_state == READY) || (_state == ACTIVE)) {
+      fail();
+    }
+  } else if (_state == READY) {
+    answered = anticollision(in, out);
+  } else if (_state == ACTIVE) {
+    if (in.crc && (in.bits == 16) && (in.data[0] == CMD_HLTA) &&
+        (in.data[1] == 0x00)) {
+      _state = HALT;
+      deactivate();
+      return false;
+    }
+    answered = command(in, out);
+  }
+
+  if (!answered) {
+    return false;
+  }
+  if (_drop) {
+    _drop--;
+    return false;
+  }
+  if (_corrupt && out->crc) {
+    _corrupt--;
+    out->badcrc = true;
+  }
+  out->delay_us += _delay_us;
+
+  return true;
+}
+
+bool SimCard::command(const SimFrame &in, SimFrame *out) {
+  (void)in;
+  (void)out;
+  fail();
+  return false;
+}
+
+bool SimCard::authRequest(uint8_t keytype, uint8_t block, bool encrypted) {
+  (void)keytype;
+  (void)block;
+  (void)encrypted;
+  if ((_state == READY) || (_state == ACTIVE)) {
+    fail();
+  }
+  return false;
+}
+
+bool SimCard::authVerify(const uint8_t *uid4, const uint8_t *key) {
+  (void)uid4;
+  (void)key;
+  return false;
+}
+
+/***************************************************************************
+ MIFARE CLASSIC
+ ***************************************************************************/
+
+MifareClassicCard::MifareClassicCard(const uint8_t *uid, uint8_t uidlen,
+                                     bool k4)
+    : SimCard(uid, uidlen,
+              (uint16_t)((k4 ? 0x0002 : 0x0004) | ((uidlen == 7) ? 0x40 : 0)),
+              k4 ? 0x18 : 0x08),
+      _mem((k4 ? 256 : 64) * 16), _auth(false), _authtrail(0),
+      _authpending(false), _authkeytype(0), _authblock(0), _writeblock(-1) {
+  static const uint8_t trailer_default[16] = {
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x07,
+      0x80, 0x69, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+  for (uint16_t b = 0; b < blocks(); b++) {
+    for (uint8_t i = 0; i < 16; i++) {
+      _mem[b * 16 + i] = (uint8_t)(b * 16 + i);
+    }
+    if (trailer((uint8_t)b) == b) {
+      memcpy(block((uint8_t)b), trailer_default, 16);
+    }
+  }
+
+  /* Manufacturer block: UID (with BCC for 4 byte UIDs), SAK, ATQA */
+  uint8_t *mb = block(0);
+  memcpy(mb, uid, uidlen);
+  if (uidlen == 4) {
+    mb[4] = uid[0] ^ uid[1] ^ uid[2] ^ uid[3];
+    mb[5] = _sak;
+    mb[6] = (uint8_t)(_atqa & 0xFF);
+    mb[7] = (uint8_t)(_atqa >> 8);
+  } else {
+    mb[7] = _sak;
+    mb[8] = (uint8_t)(_atqa & 0xFF);
+    mb[9] = (uint8_t)(_atqa >> 8);
+  }
+}
+
+uint16_t MifareClassicCard::trailer(uint8_t block) const {
+  return (block < 128) ? (block | 0x03) : (block | 0x0F);
+}
+
+void MifareClassicCard::setKey(uint8_t block, uint8_t keytype,
+                               const uint8_t *key) {
+  uint8_t *t = &_mem[trailer(block) * 16];
+  memcpy((keytype == 0x61) ? &t[10] : t, key, 6);
+}
+
+void MifareClassicCard::deactivate(void) {
+  _auth = false;
+  _authpending = false;
+  _writeblock = -1;
+}
+
+void MifareClassicCard::nak(SimFrame *out) {
+  answer4(out, MIFARE_NAK);
+  fail();
+}
+
+bool MifareClassicCard::authRequest(uint8_t keytype, uint8_t block,
+                                    bool encrypted) {
+  if ((_state != ACTIVE) || (encrypted != _auth)) {
+    return SimCard::authRequest(keytype, block, encrypted);
+  }
+  if ((block >= blocks()) || ((keytype != 0x60) && (keytype != 0x61))) {
+    fail();
+    return false;
+  }
+
+  /* A new authentication ends the current session */
+  _auth = false;
+  _authpending = true;
+  _authkeytype = keytype;
+  _authblock = block;
+  return true;
+}
+
+bool MifareClassicCard::authVerify(const uint8_t *uid4, const uint8_t *key) {
+  if (!_authpending) {
+    return false;
+  }
+  _authpending = false;
+
+  /* The reader keys Crypto1 with the last 4 UID bytes (the last level) */
+  uint8_t *t = &_mem[trailer(_authblock) * 16];
+  const uint8_t *k = (_authkeytype == 0x61) ? &t[10] : t;
+  if (memcmp(uid4, &_uid[_uidlen - 4], 4) || memcmp(key, k, 6)) {
+    fail();
+    return false;
+  }
+
+  _auth = true;
+  _authtrail = trailer(_authblock);
+  return true;
+}
+
+bool MifareClassicCard::command(const SimFrame &in, SimFrame *out) {
+  /* Second half of a WRITE: the 16 data bytes */
+  if (_writeblock >= 0) {
+    if (!in.crc || (in.bits != 128)) {
+      nak(out);
+      return true;
+    }
+    memcpy(block((uint8_t)_writeblock), in.data.data(), 16);
+    _writeblock = -1;
+    answer4(out, MIFARE_ACK);
+    return true;
+  }
+
+  if (!in.crc || (in.bits != 16)) {
+    fail();
+    return false;
+  }
+
+  uint8_t blk = in.data[1];
+  bool allowed = _auth && (blk < blocks()) && (trailer(blk) == _authtrail);
+
+  switch (in.data[0]) {
+  case 0x30: { /* READ */
+    if (!allowed) {
+      nak(out);
+      return true;
+    }
+    uint8_t data[16];
+    memcpy(data, block(blk), 16);
+    if (trailer(blk) == blk) {
+      memset(data, 0, 6); /* Key A never reads back */
+    }
+    answer(out, data, sizeof(data));
+    return true;
+  }
+
+  case 0xA0: /* WRITE */
+    if (!allowed || (blk == 0)) {
+      nak(out);
+      return true;
+    }
+    _writeblock = blk;
+    answer4(out, MIFARE_ACK);
+    return true;
+
+  default:
+    fail();
+    return false;
+  }
+}
+
+/***************************************************************************
+ NTAG21x
+ ***************************************************************************/
+
+NtagCard::NtagCard(const uint8_t *uid7, uint16_t type)
+    : SimCard(uid7, 7, 0x0044, 0x00), _type(type), _writepage(-1) {
+  uint16_t pages = (type == 216) ? 231 : (type == 215) ? 135 : 45;
+  uint8_t cc = (type == 216) ? 0x6D : (type == 215) ? 0x3E : 0x12;
+
+  _mem.resize(pages * 4);
+  for (uint16_t i = 0; i < _mem.size(); i++) {
+    _mem[i] = (uint8_t)i;
+  }
+
+  /* UID with its two check bytes, lock bytes, capability container */
+  uint8_t *p = page(0);
+  p[0] = uid7[0];
+  p[1] = uid7[1];
+  p[2] = uid7[2];
+  p[3] = CASCADE_TAG ^ uid7[0] ^ uid7[1] ^ uid7[2];
+  memcpy(page(1), &uid7[3], 4);
+  p = page(2);
+  p[0] = uid7[3] ^ uid7[4] ^ uid7[5] ^ uid7[6];
+  p[1] = 0x48;
+  p[2] = 0x00;
+  p[3] = 0x00;
+  p = page(3);
+  p[0] = 0xE1;
+  p[1] = 0x10;
+  p[2] = cc;
+  p[3] = 0x00;
+}
+
+void NtagCard::nak(SimFrame *out) {
+  answer4(out, NTAG_NAK);
+  fail();
+}
+
+bool NtagCard::command(const SimFrame &in, SimFrame *out) {
+  /* Second half of a COMPATIBILITY_WRITE: 16 bytes, the first 4 count */
+  if (_writepage >= 0) {
+    if (!in.crc || (in.bits != 128)) {
+      nak(out);
+      return true;
+    }
+    memcpy(page((uint16_t)_writepage), in.data.data(), 4);
+    _writepage = -1;
+    answer4(out, MIFARE_ACK);
+    return true;
+  }
+
+  if (!in.crc || (in.bits < 8)) {
+    fail();
+    return false;
+  }
+
+  switch (in.data[0]) {
+  case 0x30: { /* READ: 4 pages, rolling over to page 0 */
+    if ((in.bits != 16) || (in.data[1] >= pages())) {
+      nak(out);
+      return true;
+    }
+    uint8_t data[16];
+    for (uint8_t i = 0; i < 16; i++) {
+      data[i] = _mem[((in.data[1] + i / 4) % pages()) * 4 + i % 4];
+    }
+    answer(out, data, sizeof(data));
+    return true;
+  }
+
+  case 0x3A: { /* FAST_READ: start and end page, inclusive */
+    if ((in.bits != 24) || (in.data[1] > in.data[2]) ||
+        (in.data[2] >= pages())) {
+      nak(out);
+      return true;
+    }
+    answer(out, page(in.data[1]), (in.data[2] - in.data[1] + 1) * 4);
+    return true;
+  }
+
+  case 0xA2: /* WRITE */
+    if ((in.bits != 48) || (in.data[1] < 4) || (in.data[1] >= pages())) {
+      nak(out);
+      return true;
+    }
+    memcpy(page(in.data[1]), &in.data[2], 4);
+    answer4(out, MIFARE_ACK);
+    return true;
+
+  case 0xA0: /* COMPATIBILITY_WRITE */
+    if ((in.bits != 16) || (in.data[1] < 4) || (in.data[1] >= pages())) {
+      nak(out);
+      return true;
+    }
+    _writepage = in.data[1];
+    answer4(out, MIFARE_ACK);
+    return true;
+
+  case 0x60: { /* GET_VERSION */
+    uint8_t size = (_type == 216) ? 0x13 : (_type == 215) ? 0x11 : 0x0F;
+    uint8_t version[8] = {0x00, 0x04, 0x04, 0x02, 0x01, 0x00, size, 0x03};
+    if (in.bits != 8) {
+      nak(out);
+      return true;
+    }
+    answer(out, version, sizeof(version));
+    return true;
+  }
+
+  default:
+    fail();
+    return false;
+  }
+}
+
+/***************************************************************************
+ ISO14443-4
+ ***************************************************************************/
+
+/* FSDI/FSCI to frame size (ISO14443-4 5.2.3), above 8 is 256 */
+static const uint16_t fsd_sizes[] = {16, 24, 32, 40, 48, 64, 96, 128, 256};
+
+IsoDepCard::IsoDepCard(const uint8_t *uid, uint8_t uidlen, uint16_t filesize)
+    : SimCard(uid, uidlen,
+              (uidlen == 10) ? 0x0084 : (uidlen == 7) ? 0x0044 : 0x0004,
+              0x20),
+      _protocol(false), _ppsok(false), _fsci(8), _ta(0x77), _fwi(4),
+      _sfgi(0), _fsd(256), _block(1), _respoff(0), _respbusy(false),
+      _wtxcount(0), _wtxm(1), _wtxdelay(0), _wtxpending(false),
+      _file(filesize), _apdus(0) {
+  for (uint16_t i = 0; i < filesize; i++) {
+    _file[i] = (uint8_t)(i * 7 + 3);
+  }
+}
+
+void IsoDepCard::setAts(uint8_t fsci, uint8_t ta, uint8_t fwi, uint8_t sfgi) {
+  _fsci = fsci;
+  _ta = ta;
+  _fwi = fwi;
+  _sfgi = sfgi;
+}
+
+void IsoDepCard::deactivate(void) {
+  _protocol = false;
+  _ppsok = false;
+  _block = 1;
+  _cmd.clear();
+  _resp.clear();
+  _respbusy = false;
+  _last.clear();
+  _wtxpending = false;
+  _rxrate = 0;
+  _txrate = 0;
+}
+
+std::vector<uint8_t> IsoDepCard::fileApdu(const std::vector<uint8_t> &apdu) {
+  std::vector<uint8_t> resp;
+
+  if (apdu.size() < 4) {
+    resp.push_back(0x67);
+    resp.push_back(0x00);
+    return resp;
+  }
+
+  uint16_t offset = ((apdu[2] & 0x7F) << 8) | apdu[3];
+  switch (apdu[1]) {
+  case 0xA4: /* SELECT */
+    break;
+
+  case 0xB0: { /* READ BINARY, Le = 0 means 256 */
+    uint16_t le = (apdu.size() >= 5) ? apdu[4] : 0;
+    if (!le) {
+      le = 256;
+    }
+    if (offset >= _file.size()) {
+      resp.push_back(0x6B);
+      resp.push_back(0x00);
+      return resp;
+    }
+    if (le > _file.size() - offset) {
+      le = (uint16_t)(_file.size() - offset);
+    }
+    resp.assign(_file.begin() + offset, _file.begin() + offset + le);
+    break;
+  }
+
+  case 0xD6: { /* UPDATE BINARY */
+    uint16_t lc = (apdu.size() >= 5) ? apdu[4] : 0;
+    if ((apdu.size() < 5u + lc) || (offset + lc > _file.size())) {
+      resp.push_back(0x67);
+      resp.push_back(0x00);
+      return resp;
+    }
+    memcpy(&_file[offset], &apdu[5], lc);
+    break;
+  }
+
+  default:
+    resp.push_back(0x6D);
+    resp.push_back(0x00);
+    return resp;
+  }
+
+  resp.push_back(0x90);
+  resp.push_back(0x00);
+  return resp;
+}
+
+void IsoDepCard::send(SimFrame *out, const uint8_t *data, size_t len) {
+  _last.assign(data, data + len);
+  answer(out, data, len);
+}
+
+void IsoDepCard::sendBlock(SimFrame *out) {
+  uint8_t block[256];
+  size_t maxinf = _fsd - 3; /* PCB and CRC */
+  size_t n = _resp.size() - _respoff;
+  bool more = n > maxinf;
+
+  if (more) {
+    n = maxinf;
+  }
+  block[0] = 0x02 | _block | (more ? 0x10 : 0x00);
+  memcpy(&block[1], &_resp[_respoff], n);
+  _respoff += n;
+  _respbusy = more;
+  send(out, block, n + 1);
+}
+
+bool IsoDepCard::command(const SimFrame &in, SimFrame *out) {
+  if (!in.crc || !in.bits || (in.bits % 8)) {
+    return false;
+  }
+  uint8_t pcb = in.data[0];
+  size_t len = in.bits / 8;
+
+  /* Layer 4 starts with RATS, anything else isn't for this card */
+  if (!_protocol) {
+    if ((pcb != 0xE0) || (len != 2)) {
+      fail();
+      return false;
+    }
+    uint8_t fsdi = in.data[1] >> 4;
+    _fsd = fsd_sizes[(fsdi > 8) ? 8 : fsdi];
+    uint8_t ats[5] = {5, (uint8_t)(0x70 | _fsci), _ta,
+                      (uint8_t)((_fwi << 4) | _sfgi), 0x00};
+    _protocol = true;
+    _ppsok = true;
+    _block = 1;
+    send(out, ats, sizeof(ats));
+    return true;
+  }
+
+  /* PPS is only valid right after the ATS */
+  if (((pcb & 0xF0) == 0xD0) && _ppsok) {
+    _ppsok = false;
+    if ((len != 3) || (in.data[1] != 0x11)) {
+      return false;
+    }
+    send(out, &pcb, 1);
+    /* The answer still goes out at the old rate (see out->rate) */
+    _txrate = (in.data[2] >> 2) & 0x03;
+    _rxrate = in.data[2] & 0x03;
+    return true;
+  }
+  _ppsok = false;
+
+  /* I-block (no CID/NAD support) */
+  if (((pcb & 0xE2) == 0x02) && !(pcb & 0x0C)) {
+    _block = pcb & 0x01;
+    _cmd.insert(_cmd.end(), in.data.begin() + 1, in.data.begin() + len);
+    if (pcb & 0x10) {
+      uint8_t ack = 0xA2 | _block;
+      send(out, &ack, 1);
+      return true;
+    }
+
+    _resp = _handler ? _handler(_cmd) : fileApdu(_cmd);
+    _apdus++;
+    _cmd.clear();
+    _respoff = 0;
+    _respbusy = true;
+    if (_wtxcount) {
+      _wtxcount--;
+      _wtxpending = true;
+      uint8_t wtx[2] = {0xF2, _wtxm};
+      send(out, wtx, sizeof(wtx));
+      return true;
+    }
+    sendBlock(out);
+    return true;
+  }
+
+  /* R(ACK): same block number = resend, the other one = next block */
+  if (((pcb & 0xF6) == 0xA2) && (len == 1)) {
+    if ((pcb & 0x01) == _block) {
+      if (_last.empty()) {
+        return false;
+      }
+      answer(out, _last.data(), _last.size());
+      return true;
+    }
+    _block = pcb & 0x01;
+    if (!_respbusy) {
+      return false;
+    }
+    sendBlock(out);
+    return true;
+  }
+
+  /* R(NAK): resend our last block, or R(ACK) if the reader's got lost */
+  if (((pcb & 0xF6) == 0xB2) && (len == 1)) {
+    if ((pcb & 0x01) == _block) {
+      if (_last.empty()) {
+        return false;
+      }
+      answer(out, _last.data(), _last.size());
+      return true;
+    }
+    uint8_t ack = 0xA2 | _block;
+    send(out, &ack, 1);
+    return true;
+  }
+
+  /* S(WTX) reply: the response follows after the extra processing time */
+  if ((pcb == 0xF2) && (len == 2) && _wtxpending) {
+    _wtxpending = false;
+    sendBlock(out);
+    out->delay_us += _wtxdelay;
+    return true;
+  }
+
+  /* S(DESELECT) */
+  if ((pcb == 0xC2) && (len == 1)) {
+    answer(out, &pcb, 1);
+    _state = HALT;
+    deactivate();
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,293 @@
+/*!
+ * @file SimCard.h
+ *
+ * Virtual ISO14443A cards for the MFRC630 model: the ISO14443-3 state
+ * machine (REQA/WUPA, anticollision, select, HLTA) in SimCard, and Mifare
+ * Classic, NTAG21x and ISO14443-4 (T=CL) cards on top of it.
+ */
+#ifndef __SIMCARD_H__
+#define __SIMCARD_H__
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * One frame on the air, sent LSB first.
+ */
+struct SimFrame {
+  std::vector<uint8_t> data; /**< Payload, without the CRC */
+  uint16_t bits;             /**< Number of payload bits */
+  bool crc;                  /**< A CRC_A follows the payload */
+  bool badcrc;               /**< ... but it is corrupted */
+  uint8_t rate;              /**< 0..3 = 106/212/424/848 kbit/s */
+  uint32_t delay_us;         /**< Answer only: extra delay after the FDT */
+
+  SimFrame(void) : bits(0), crc(false), badcrc(false), rate(0), delay_us(0) {}
+
+  /**
+   * A frame of whole bytes.
+   */
+  static SimFrame bytes(const uint8_t *data, size_t len, bool crc);
+
+  /**
+   * Returns payload bit 'i'.
+   */
+  uint8_t bit(uint16_t i) const { return (data[i / 8] >> (i % 8)) & 1; }
+
+  /**
+   * Appends one payload bit.
+   */
+  void push(uint8_t bit);
+};
+
+/**
+ * A PICC in the field: ISO14443-3 type A activation and HLTA. Subclasses
+ * handle the frames a selected (ACTIVE) card gets in command().
+ */
+class SimCard {
+public:
+  /**
+   * ISO14443-3 card states
+   */
+  enum state { POWER_OFF, IDLE, READY, ACTIVE, HALT };
+
+  SimCard(const uint8_t *uid, uint8_t uidlen, uint16_t atqa, uint8_t sak);
+  virtual ~SimCard() {}
+
+  /**
+   * The RF field came on or went off. The card resets in both cases.
+   */
+  void power(bool on);
+
+  /**
+   * Handles a frame from the reader, 'encrypted' if it has Crypto1 on.
+   * Returns true with the response in 'out', or false to stay silent.
+   */
+  bool receive(const SimFrame &in, bool encrypted, SimFrame *out);
+
+  /**
+   * First half of a Mifare Classic authentication (MFAUTHENT). Returns
+   * true if the card answers with its nonce.
+   */
+  virtual bool authRequest(uint8_t keytype, uint8_t block, bool encrypted);
+
+  /**
+   * Second half: checks the UID bytes and key the reader used. Returns
+   * true if the card answers, which turns Crypto1 on.
+   */
+  virtual bool authVerify(const uint8_t *uid4, const uint8_t *key);
+
+  /* Test knobs */
+
+  /** Extra delay after the minimum frame delay time before answering */
+  void setResponseDelay(uint32_t us) { _delay_us = us; }
+  uint32_t responseDelay(void) const { return _delay_us; }
+
+  /** Ignores the next 'frames' frames completely (lost on the way in) */
+  void mute(uint16_t frames) { _mute = frames; }
+
+  /** Handles the next 'frames' frames but drops the answers */
+  void dropResponses(uint16_t frames) { _drop = frames; }
+
+  /** Sends the next 'frames' answers with a corrupted CRC */
+  void corruptResponses(uint16_t frames) { _corrupt = frames; }
+
+  /** Sends the next 'frames' anticollision answers with a wrong BCC */
+  void corruptBcc(uint16_t frames) { _badbcc = frames; }
+
+  /** Offset of the card's load on the LPCD I and Q results */
+  void setLpcdLoad(int8_t i, int8_t q) {
+    _lpcd_i = i;
+    _lpcd_q = q;
+  }
+  int8_t lpcdI(void) const { return _lpcd_i; }
+  int8_t lpcdQ(void) const { return _lpcd_q; }
+
+  /* Inspection */
+  state getState(void) const { return _state; }
+  const uint8_t *uid(void) const { return _uid; }
+  uint8_t uidLen(void) const { return _uidlen; }
+  uint32_t framesReceived(void) const { return _frames; }
+  uint8_t rxRate(void) const { return _rxrate; }
+  uint8_t txRate(void) const { return _txrate; }
+
+protected:
+  /**
+   * Handles a frame for a selected card, other than HLTA.
+   */
+  virtual bool command(const SimFrame &in, SimFrame *out);
+
+  /**
+   * Drops the state above ISO14443-3 (Crypto1, ISO14443-4, pending
+   * writes) when the card is reset, halted or falls back to IDLE.
+   */
+  virtual void deactivate(void) {}
+
+  /**
+   * Whether the card expects Crypto1 encrypted frames.
+   */
+  virtual bool crypto(void) const { return false; }
+
+  /**
+   * Goes back to IDLE, or HALT if it was woken up from there, after an
+   * unexpected frame.
+   */
+  void fail(void);
+
+  /** Builds an answer of whole bytes with a CRC at the card's rate */
+  void answer(SimFrame *out, const uint8_t *data, size_t len);
+
+  /** Builds a 4-bit ACK/NAK at the card's rate */
+  void answer4(SimFrame *out, uint8_t nibble);
+
+  state _state;
+  uint8_t _uid[10];
+  uint8_t _uidlen;
+  uint16_t _atqa;
+  uint8_t _sak;
+  uint8_t _rxrate; /**< Rate the card listens at (0..3) */
+  uint8_t _txrate; /**< Rate the card answers at (0..3) */
+
+private:
+  bool anticollision(const SimFrame &in, SimFrame *out);
+  void cascadeLevel(uint8_t level, uint8_t *cl);
+
+  bool _halted;  /* Woken up from HALT, falls back there */
+  uint8_t _level; /* Cascade level being selected (1..3) */
+  uint32_t _delay_us;
+  uint16_t _mute;
+  uint16_t _drop;
+  uint16_t _corrupt;
+  uint16_t _badbcc;
+  int8_t _lpcd_i;
+  int8_t _lpcd_q;
+  uint32_t _frames;
+};
+
+/**
+ * Mifare Classic 1K or 4K. Sectors start out with transport keys A and B
+ * (FF..FF) and access bits FF 07 80, blocks hold a pattern of their own
+ * number.
+ */
+class MifareClassicCard : public SimCard {
+public:
+  MifareClassicCard(const uint8_t *uid, uint8_t uidlen, bool k4 = false);
+
+  /** Block 'n' (16 bytes) */
+  uint8_t *block(uint8_t n) { return &_mem[n * 16]; }
+  uint16_t blocks(void) const { return (uint16_t)(_mem.size() / 16); }
+
+  /** Sets key A (0x60) or B (0x61) of the sector holding 'block' */
+  void setKey(uint8_t block, uint8_t keytype, const uint8_t *key);
+
+  bool authRequest(uint8_t keytype, uint8_t block, bool encrypted);
+  bool authVerify(const uint8_t *uid4, const uint8_t *key);
+
+protected:
+  bool command(const SimFrame &in, SimFrame *out);
+  void deactivate(void);
+  bool crypto(void) const { return _auth; }
+
+private:
+  uint16_t trailer(uint8_t block) const;
+  void nak(SimFrame *out);
+
+  std::vector<uint8_t> _mem;
+  bool _auth;          /* Crypto1 session up */
+  uint16_t _authtrail; /* Trailer block of the authenticated sector */
+  bool _authpending;
+  uint8_t _authkeytype;
+  uint8_t _authblock;
+  int16_t _writeblock; /* Second half of a WRITE expected, or -1 */
+};
+
+/**
+ * NTAG213, NTAG215 or NTAG216 with a 7 byte UID.
+ */
+class NtagCard : public SimCard {
+public:
+  NtagCard(const uint8_t *uid7, uint16_t type = 213);
+
+  /** Page 'n' (4 bytes) */
+  uint8_t *page(uint16_t n) { return &_mem[n * 4]; }
+  uint16_t pages(void) const { return (uint16_t)(_mem.size() / 4); }
+
+protected:
+  bool command(const SimFrame &in, SimFrame *out);
+  void deactivate(void) { _writepage = -1; }
+
+private:
+  void nak(SimFrame *out);
+
+  std::vector<uint8_t> _mem;
+  uint16_t _type;
+  int16_t _writepage; /* Second half of a COMPATIBILITY_WRITE expected */
+};
+
+/**
+ * ISO14443-4 (T=CL) card: RATS/ATS, PPS, I-block chaining in both
+ * directions, R(ACK)/R(NAK) recovery, S(WTX) and S(DESELECT). APDUs go to
+ * a handler, by default a file of 'filesize' bytes served by READ BINARY
+ * and UPDATE BINARY.
+ */
+class IsoDepCard : public SimCard {
+public:
+  /** Turns a command APDU into a response APDU (with SW1 SW2) */
+  typedef std::function<std::vector<uint8_t>(const std::vector<uint8_t> &)>
+      apdu_handler;
+
+  IsoDepCard(const uint8_t *uid, uint8_t uidlen, uint16_t filesize = 1024);
+
+  void setApduHandler(apdu_handler handler) { _handler = handler; }
+
+  /** ATS parameters: FSCI, TA(1) bit rates, FWI and SFGI */
+  void setAts(uint8_t fsci, uint8_t ta, uint8_t fwi, uint8_t sfgi);
+
+  /**
+   * Answers the next 'count' APDUs with S(WTX) 'wtxm' first, and the
+   * response 'delay_us' after the reader's S(WTX) reply.
+   */
+  void requestWtx(uint8_t count, uint8_t wtxm, uint32_t delay_us = 0) {
+    _wtxcount = count;
+    _wtxm = wtxm;
+    _wtxdelay = delay_us;
+  }
+
+  std::vector<uint8_t> &file(void) { return _file; }
+
+  /** Size of the largest frame the reader announced with RATS */
+  uint16_t fsd(void) const { return _fsd; }
+
+  /** Number of APDUs handled */
+  uint32_t apdus(void) const { return _apdus; }
+
+protected:
+  bool command(const SimFrame &in, SimFrame *out);
+  void deactivate(void);
+
+private:
+  std::vector<uint8_t> fileApdu(const std::vector<uint8_t> &apdu);
+  void sendBlock(SimFrame *out);
+  void send(SimFrame *out, const uint8_t *data, size_t len);
+
+  bool _protocol;  /* RATS done */
+  bool _ppsok;     /* PPS still allowed */
+  uint8_t _fsci, _ta, _fwi, _sfgi;
+  uint16_t _fsd;
+  uint8_t _block;  /* Card block number */
+  std::vector<uint8_t> _cmd;
+  std::vector<uint8_t> _resp;
+  size_t _respoff; /* Next response byte to send */
+  bool _respbusy;  /* Response blocks still to send */
+  std::vector<uint8_t> _last; /* Last block sent, for retransmission */
+  uint8_t _wtxcount, _wtxm;
+  uint32_t _wtxdelay;
+  bool _wtxpending;
+  apdu_handler _handler;
+  std::vector<uint8_t> _file;
+  uint32_t _apdus;
+};
+
+#endif
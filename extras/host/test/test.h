@@ -0,0 +1,66 @@
+/*!
+ * @file test.h
+ *
+ * Minimal test harness for the host tests: TEST() cases register
+ * themselves, each runs on a fresh virtual clock (host::reset()), and a
+ * failed CHECK() reports the line and fails the case.
+ */
+#ifndef __TEST_H__
+#define __TEST_H__
+
+#include <host.h>
+
+#include <stdio.h>
+
+namespace test {
+
+/** One registered test case */
+struct test_case {
+  const char *name;
+  void (*fn)(void);
+  test_case *next;
+};
+
+/** Registers 'tc', called from the TEST() macro */
+void add(test_case *tc);
+
+/** Records a failed check */
+void fail(const char *file, int line, const char *expr);
+
+/** Records a failed equality check with both values */
+void failEq(const char *file, int line, const char *expr, long long a,
+            long long b);
+
+/** Registers a test case at static initialisation time */
+struct registrar {
+  registrar(test_case *tc) { add(tc); }
+};
+
+} // namespace test
+
+/*! Defines and registers a test case */
+#define TEST(name)                                                             \
+  static void test_##name(void);                                               \
+  static test::test_case test_case_##name = {#name, test_##name, NULL};        \
+  static test::registrar test_registrar_##name(&test_case_##name);             \
+  static void test_##name(void)
+
+/*! Fails the test case if 'cond' is false */
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      test::fail(__FILE__, __LINE__, #cond);                                   \
+    }                                                                          \
+  } while (0)
+
+/*! Fails the test case if 'a' != 'b', showing both */
+#define CHECK_EQ(a, b)                                                         \
+  do {                                                                         \
+    long long test_a_ = (long long)(a);                                        \
+    long long test_b_ = (long long)(b);                                        \
+    if (test_a_ != test_b_) {                                                  \
+      test::failEq(__FILE__, __LINE__, #a " == " #b, test_a_, test_b_);        \
+    }                                                                          \
+  } while (0)
+
+#endif
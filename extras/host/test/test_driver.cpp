@@ -0,0 +1,668 @@
+/*!
+ * @file test_driver.cpp
+ *
+ * The driver against the MFRC630 model and virtual cards, over I2C
+ * unless a test says otherwise
+ */
+#include "test.h"
+
+#include <Adafruit_MFRC630.h>
+#include <MFRC630Sim.h>
+#include <MFRC630SimBus.h>
+
+static uint8_t uid4[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+static uint8_t uid4b[4] = {0x12, 0x34, 0x56, 0x78};
+static uint8_t uid7[7] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+static uint8_t uid10[10] = {0x08, 0x01, 0x02, 0x03, 0x04,
+                            0x05, 0x06, 0x07, 0x08, 0x09};
+
+#define PDOWN_PIN (A2)
+#define IRQ_PIN (7)
+#define CS_PIN (10)
+
+/* The IC on I2C with PDOWN wired up, radio configured */
+static bool start(MFRC630Sim &sim, Adafruit_MFRC630 &rfid) {
+  sim.attachI2C(&Wire, MFRC630_I2C_ADDR);
+  sim.attachPdown(PDOWN_PIN);
+  if (!rfid.begin()) {
+    return false;
+  }
+  return rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+}
+
+TEST(begin_transports) {
+  {
+    MFRC630Sim sim;
+    Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+    CHECK(!rfid.begin()); /* Nothing on the bus */
+  }
+  {
+    MFRC630Sim sim;
+    Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+    CHECK(start(sim, rfid));
+    CHECK(sim.fieldOn());
+  }
+  {
+    MFRC630Sim sim;
+    Adafruit_MFRC630 rfid(MFRC630_TRANSPORT_SPI, CS_PIN, PDOWN_PIN);
+    sim.attachSPI(&SPI, CS_PIN);
+    sim.attachPdown(PDOWN_PIN);
+    CHECK(rfid.begin());
+    CHECK(rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106));
+    CHECK(sim.fieldOn());
+  }
+  {
+    MFRC630Sim sim;
+    MFRC630SimBus bus(&sim);
+    Adafruit_MFRC630 rfid(&bus);
+    CHECK(rfid.begin());
+  }
+}
+
+TEST(uart_fifo_read) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(&Serial1, PDOWN_PIN);
+  uint8_t out[200], in[200];
+
+  Serial1.begin(115200);
+  sim.attachSerial(&Serial1);
+  sim.attachPdown(PDOWN_PIN);
+  CHECK(rfid.begin());
+
+  /* A read longer than the RX buffer must not lose answers */
+  for (uint16_t i = 0; i < sizeof(out); i++) {
+    out[i] = (uint8_t)(i * 7);
+  }
+  CHECK_EQ(rfid.writeFIFO(sizeof(out), out), (int16_t)sizeof(out));
+  memset(in, 0, sizeof(in));
+  CHECK_EQ(rfid.readFIFO(sizeof(in), in), (int16_t)sizeof(in));
+  CHECK(!memcmp(in, out, sizeof(out)));
+  CHECK_EQ(Serial1.overruns(), 0u);
+}
+
+TEST(select_uid_lengths) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard c4(uid4, 4);
+  NtagCard c7(uid7);
+  IsoDepCard c10(uid10, 10);
+  uint8_t uid[10];
+  uint8_t sak;
+
+  CHECK(start(sim, rfid));
+
+  sim.addCard(&c4);
+  CHECK_EQ(rfid.iso14443aRequest(), 0x0004);
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+  CHECK(!memcmp(uid, uid4, 4));
+  CHECK_EQ(sak, 0x08);
+  sim.removeCard(&c4);
+
+  sim.addCard(&c7);
+  CHECK_EQ(rfid.iso14443aRequest(), 0x0044);
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 7);
+  CHECK(!memcmp(uid, uid7, 7));
+  CHECK_EQ(sak, 0x00);
+  sim.removeCard(&c7);
+
+  sim.addCard(&c10);
+  CHECK_EQ(rfid.iso14443aRequest(), 0x0084);
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 10);
+  CHECK(!memcmp(uid, uid10, 10));
+  CHECK_EQ(sak, 0x20);
+  CHECK_EQ(c10.getState(), SimCard::ACTIVE);
+
+  /* Nobody there */
+  sim.removeCard(&c10);
+  CHECK_EQ(rfid.iso14443aRequest(), 0);
+  CHECK_EQ(rfid.getStatus(), MFRC630_STATUS_TIMEOUT);
+}
+
+TEST(select_bad_bcc) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  NtagCard card(uid7);
+  uint8_t uid[10];
+  uint8_t sak;
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+
+  /* A UID that fails its BCC is an integrity error, not a success */
+  card.corruptBcc(1);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 0);
+  CHECK_EQ(rfid.getStatus(), MFRC630_STATUS_INTEGRITY);
+
+  /* A retry starts the cascade level over */
+  sim.removeCard(&card);
+  sim.addCard(&card);
+  CHECK(rfid.setRetryPolicy(MFRC630_OP_SELECT, 1,
+                            MFRC630_STATUS_MASK(MFRC630_STATUS_INTEGRITY)));
+  card.corruptBcc(1);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 7);
+  CHECK(!memcmp(uid, uid7, 7));
+  CHECK_EQ(rfid.getStatus(), MFRC630_STATUS_OK);
+  CHECK_EQ(card.getState(), SimCard::ACTIVE);
+}
+
+TEST(poll_deadline_without_timer_irq) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+
+  CHECK(start(sim, rfid));
+
+  /* Nobody answers and Timer0 never fires: polling IRQ1 must give up */
+  sim.stallTimer0(true);
+  unsigned long t = millis();
+  CHECK_EQ(rfid.iso14443aRequest(), 0);
+  CHECK_EQ(rfid.getStatus(), MFRC630_STATUS_TIMEOUT);
+  CHECK(millis() - t >= MFRC630_FRAME_MARGIN_MS);
+  CHECK(millis() - t < 2 * MFRC630_FRAME_MARGIN_MS);
+}
+
+TEST(select_collision) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard a(uid4, 4), b(uid4b, 4);
+  uint8_t uid[10];
+  uint8_t sak;
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&a);
+  sim.addCard(&b);
+
+  /* Both answer, one of them wins the anticollision */
+  CHECK_EQ(rfid.iso14443aRequest(), 0x0004);
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+  bool isa = !memcmp(uid, uid4, 4);
+  bool isb = !memcmp(uid, uid4b, 4);
+  CHECK(isa || isb);
+  CHECK_EQ((isa ? a : b).getState(), SimCard::ACTIVE);
+  CHECK((isa ? b : a).getState() != SimCard::ACTIVE);
+
+  /* Halt the winner, the other one is found next */
+  CHECK(rfid.iso14443aHalt());
+  CHECK_EQ(rfid.iso14443aRequest(), 0x0004);
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+  CHECK(!memcmp(uid, isa ? uid4b : uid4, 4));
+}
+
+TEST(mifare_read_write) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid4, 4);
+  uint8_t uid[10];
+  uint8_t sak;
+  uint8_t buf[64];
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+
+  rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+  CHECK(rfid.mifareAuth(MIFARE_CMD_AUTH_A, 4, uid));
+  CHECK_EQ(rfid.mifareReadBlock(5, buf), 16);
+  CHECK(!memcmp(buf, card.block(5), 16));
+
+  for (uint8_t i = 0; i < 16; i++) {
+    buf[i] = 0xA0 + i;
+  }
+  CHECK_EQ(rfid.mifareWriteBlock(6, buf), 16);
+  CHECK_EQ(card.block(6)[15], 0xAF);
+
+  /* Other sector: not authenticated, the card NAKs and drops out */
+  CHECK(rfid.mifareReadBlock(8, buf) != 16);
+  CHECK(rfid.getStatus() != MFRC630_STATUS_OK);
+  CHECK(card.getState() != SimCard::ACTIVE);
+}
+
+TEST(mifare_wrong_key) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid4, 4);
+  uint8_t uid[10];
+  uint8_t sak;
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+
+  rfid.mifareLoadKey(rfid.mifareKeyNDEF);
+  CHECK(!rfid.mifareAuth(MIFARE_CMD_AUTH_A, 4, uid));
+}
+
+TEST(mifare_key_eeprom) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid4, 4);
+  uint8_t uid[10];
+  uint8_t sak;
+  uint8_t buf[16];
+
+  CHECK(start(sim, rfid));
+  card.setKey(8, MIFARE_CMD_AUTH_B, rfid.mifareKeyNDEF);
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+
+  CHECK(rfid.mifareStoreKeyE2(3, rfid.mifareKeyNDEF));
+  CHECK(rfid.mifareAuthE2(MIFARE_CMD_AUTH_B, 3, 8, uid));
+  CHECK_EQ(rfid.mifareReadBlock(9, buf), 16);
+}
+
+TEST(mifare_read_card) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid4, 4);
+  uint8_t uid[10];
+  uint8_t sak;
+  static uint8_t buf[1024];
+  uint8_t status[16];
+
+  CHECK(start(sim, rfid));
+  card.setKey(20, MIFARE_CMD_AUTH_A, rfid.mifareKeyNDEF);
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+
+  /* Sector 5 has another key, the rest are read */
+  rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+  CHECK_EQ(rfid.mifareReadCard(MIFARE_LAYOUT_1K, MIFARE_CMD_AUTH_A, uid, buf,
+                               status),
+           15);
+  CHECK_EQ(status[5], MIFARE_SECTOR_AUTH_FAILED);
+  CHECK_EQ(status[6], MIFARE_SECTOR_OK);
+  CHECK(!memcmp(&buf[6 * 64], card.block(24), 16));
+  CHECK_EQ(buf[5 * 64], 0);
+}
+
+TEST(mifare_read_card_uid7) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid7, 7);
+  uint8_t uid[10];
+  uint8_t sak;
+  static uint8_t buf[1024];
+  uint8_t status[16];
+
+  CHECK(start(sim, rfid));
+  card.setKey(20, MIFARE_CMD_AUTH_A, rfid.mifareKeyNDEF);
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 7);
+
+  /* Authenticated with the last four UID bytes, reselected by all seven */
+  rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+  CHECK_EQ(rfid.mifareReadSector(MIFARE_CMD_AUTH_A, 1, uid, buf, 7), 64);
+  CHECK(!memcmp(buf, card.block(4), 16));
+  CHECK_EQ(rfid.mifareReadCard(MIFARE_LAYOUT_1K, MIFARE_CMD_AUTH_A, uid, buf,
+                               status, 7),
+           15);
+  CHECK_EQ(status[5], MIFARE_SECTOR_AUTH_FAILED);
+  CHECK_EQ(status[6], MIFARE_SECTOR_OK);
+  CHECK(!memcmp(&buf[6 * 64], card.block(24), 16));
+}
+
+TEST(ntag_read_write) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  NtagCard card(uid7, 216);
+  uint8_t uid[10];
+  uint8_t sak;
+  static uint8_t buf[231 * 4];
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 7);
+
+  CHECK_EQ(rfid.ntagReadPage(4, buf), 4);
+  CHECK(!memcmp(buf, card.page(4), 4));
+
+  uint8_t data[4] = {1, 2, 3, 4};
+  CHECK_EQ(rfid.ntagWritePage(10, data), 4);
+  CHECK(!memcmp(card.page(10), data, 4));
+
+  /* Whole card, FAST_READ and READ */
+  CHECK_EQ(rfid.ntagReadPages(0, 231, buf), 231 * 4);
+  CHECK(!memcmp(buf, card.page(0), 231 * 4));
+  memset(buf, 0, sizeof(buf));
+  CHECK_EQ(rfid.ntagReadPages(0, 231, buf, false), 231 * 4);
+  CHECK(!memcmp(buf, card.page(0), 231 * 4));
+}
+
+TEST(isodep_exchange) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  IsoDepCard card(uid7, 7);
+  uint8_t uid[10];
+  uint8_t sak;
+  uint8_t ats[32];
+  static uint8_t resp[300];
+
+  card.setAts(5, 0x00, 6, 0); /* FSC 64 */
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 7);
+  CHECK_EQ(rfid.isoDepActivate(ats, sizeof(ats)), 5);
+  CHECK_EQ(card.fsd(), MFRC630_ISODEP_FSD);
+
+  /* UPDATE BINARY of 200 bytes: chained to the card's FSC */
+  uint8_t update[205] = {0x00, 0xD6, 0x00, 0x10, 200};
+  for (uint8_t i = 0; i < 200; i++) {
+    update[5 + i] = i;
+  }
+  CHECK_EQ(rfid.exchange(update, sizeof(update), resp, sizeof(resp)), 2);
+  CHECK_EQ(resp[0], 0x90);
+  CHECK_EQ(card.file()[0x10 + 199], 199);
+
+  /* READ BINARY of 256 bytes: response chained back, with a WTX first */
+  card.requestWtx(1, 2, 3000);
+  uint8_t read[5] = {0x00, 0xB0, 0x00, 0x10, 0x00};
+  CHECK_EQ(rfid.exchange(read, sizeof(read), resp, sizeof(resp)), 258);
+  CHECK_EQ(resp[199], 199);
+  CHECK_EQ(resp[256], 0x90);
+
+  CHECK(rfid.isoDepDeselect());
+  CHECK_EQ(card.getState(), SimCard::HALT);
+  CHECK_EQ(card.apdus(), 2);
+}
+
+TEST(isodep_recovery) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  IsoDepCard card(uid4, 4);
+  uint8_t uid[10];
+  uint8_t sak;
+  uint8_t ats[32];
+  uint8_t resp[64];
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+  CHECK(rfid.isoDepActivate(ats, sizeof(ats)));
+
+  /* Lost and corrupted responses come back after R(NAK) */
+  uint8_t read[5] = {0x00, 0xB0, 0x00, 0x00, 0x10};
+  card.dropResponses(1);
+  CHECK_EQ(rfid.exchange(read, sizeof(read), resp, sizeof(resp)), 18);
+  card.corruptResponses(1);
+  CHECK_EQ(rfid.exchange(read, sizeof(read), resp, sizeof(resp)), 18);
+  CHECK(!memcmp(resp, card.file().data(), 16));
+  CHECK_EQ(card.apdus(), 2);
+}
+
+TEST(rats_pps_bitrates) {
+  static const enum iso14443_bitrate rates[] = {
+      ISO14443_BITRATE_106, ISO14443_BITRATE_212, ISO14443_BITRATE_424,
+      ISO14443_BITRATE_848};
+
+  for (uint8_t r = 0; r < 4; r++) {
+    host::reset();
+    MFRC630Sim sim;
+    Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+    IsoDepCard card(uid4, 4);
+    uint8_t uid[10];
+    uint8_t sak;
+    uint8_t ats[32];
+    uint8_t resp[64];
+    enum iso14443_bitrate dsi, dri;
+
+    CHECK(start(sim, rfid));
+    sim.addCard(&card);
+    CHECK(rfid.iso14443aRequest());
+    CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+    uint8_t len = rfid.isoDepActivate(ats, sizeof(ats));
+    CHECK_EQ(len, 5);
+    CHECK(rfid.iso14443aNegotiateBitrate(ats, len, 0, rates[r], &dsi, &dri));
+    CHECK_EQ(dsi, rates[r]);
+    CHECK_EQ(dri, rates[r]);
+    CHECK_EQ(card.rxRate(), r);
+    CHECK_EQ(card.txRate(), r);
+    CHECK_EQ(sim.rxRate(), r);
+    CHECK_EQ(sim.txRate(), r);
+
+    /* And the link works at the new rate */
+    uint8_t read[5] = {0x00, 0xB0, 0x00, 0x00, 0x20};
+    CHECK_EQ(rfid.exchange(read, sizeof(read), resp, sizeof(resp)), 34);
+  }
+}
+
+TEST(pps_board_settings) {
+  static const uint8_t board[4] = {0x8E, 0x12, 0x39, 0x06};
+  static const struct {
+    enum iso14443_bitrate dsi, dri;
+    const uint8_t *drv; /* Expected DRV_MOD..TXL (0x28..0x2B) */
+  } cases[] = {{ISO14443_BITRATE_106, ISO14443_BITRATE_106, board},
+               {ISO14443_BITRATE_212, ISO14443_BITRATE_106, board},
+               {ISO14443_BITRATE_106, ISO14443_BITRATE_212,
+                antcfg_iso14443a_212}};
+
+  for (uint8_t i = 0; i < sizeof(cases) / sizeof(*cases); i++) {
+    host::reset();
+    MFRC630Sim sim;
+    Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+    IsoDepCard card(uid4, 4);
+    uint8_t uid[10];
+    uint8_t sak;
+    uint8_t ats[32];
+
+    CHECK(start(sim, rfid));
+    sim.addCard(&card);
+    CHECK(rfid.iso14443aRequest());
+    CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+    CHECK_EQ(rfid.isoDepActivate(ats, sizeof(ats)), 5);
+    CHECK(rfid.iso14443aPPS(0, cases[i].dsi, cases[i].dri));
+    for (uint8_t r = 0; r < 4; r++) {
+      CHECK_EQ(sim.peek(MFRC630_REG_DRV_MOD + r), cases[i].drv[r]);
+    }
+  }
+}
+
+TEST(poll_card_events) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid4, 4);
+  uint8_t uid[10];
+  uint8_t uidlen;
+  uint8_t sak;
+
+  CHECK(start(sim, rfid));
+  CHECK_EQ(rfid.pollCard(uid, &uidlen, &sak), MFRC630_CARD_NONE);
+  sim.addCard(&card);
+  CHECK_EQ(rfid.pollCard(uid, &uidlen, &sak), MFRC630_CARD_ARRIVED);
+  CHECK_EQ(uidlen, 4);
+  CHECK_EQ(rfid.pollCard(uid, &uidlen, &sak), MFRC630_CARD_PRESENT);
+  CHECK_EQ(card.getState(), SimCard::ACTIVE);
+  sim.removeCard(&card);
+  CHECK_EQ(rfid.pollCard(uid, &uidlen, &sak), MFRC630_CARD_REMOVED);
+  CHECK_EQ(rfid.pollCard(uid, &uidlen, &sak), MFRC630_CARD_NONE);
+}
+
+static uint16_t done_result;
+static uint8_t done_calls;
+
+static void done(enum mfrc630_op op, uint16_t result, void *arg) {
+  (void)op;
+  (void)arg;
+  done_result = result;
+  done_calls++;
+}
+
+TEST(nonblocking_select_with_irq_pin) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN, IRQ_PIN);
+  MifareClassicCard card(uid7, 7);
+  uint8_t uid[10];
+  uint8_t sak;
+
+  sim.attachIrq(IRQ_PIN);
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+
+  done_calls = 0;
+  CHECK(rfid.startSelect(uid, &sak, done, NULL));
+  CHECK(rfid.busy());
+  CHECK(!rfid.startSelect(uid, &sak, done, NULL));
+  CHECK_EQ(rfid.getStatus(), MFRC630_STATUS_BUSY);
+  while (rfid.poll()) {
+    delayMicroseconds(50);
+  }
+  CHECK_EQ(done_calls, 1);
+  CHECK_EQ(done_result, 7);
+  CHECK_EQ(rfid.getResult(), 7);
+  CHECK(!memcmp(uid, uid7, 7));
+}
+
+TEST(retry_policy) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid4, 4);
+  uint8_t uid[10];
+  uint8_t sak;
+  uint8_t buf[16];
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+  rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+  CHECK(rfid.mifareAuth(MIFARE_CMD_AUTH_A, 4, uid));
+
+  /* A corrupted block is read again */
+  CHECK(rfid.setRetryPolicy(
+      MFRC630_OP_READ, 2,
+      MFRC630_STATUS_MASK(MFRC630_STATUS_INTEGRITY) |
+          MFRC630_STATUS_MASK(MFRC630_STATUS_TIMEOUT)));
+  card.corruptResponses(1);
+  CHECK_EQ(rfid.mifareReadBlock(5, buf), 16);
+  card.dropResponses(2);
+  CHECK_EQ(rfid.mifareReadBlock(5, buf), 16);
+
+  /* Unless it keeps failing */
+  card.dropResponses(3);
+  CHECK_EQ(rfid.mifareReadBlock(5, buf), 0);
+  CHECK_EQ(rfid.getStatus(), MFRC630_STATUS_TIMEOUT);
+
+  /* Sector reads follow the same policy for every block */
+  static uint8_t sector[64];
+  card.corruptResponses(1);
+  CHECK_EQ(rfid.mifareReadSector(MIFARE_CMD_AUTH_A, 2, uid, sector), 64);
+  CHECK(!memcmp(sector, card.block(8), 16));
+}
+
+TEST(eeprom_read_write) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  uint8_t data[100];
+  uint8_t back[100];
+
+  CHECK(start(sim, rfid));
+  for (uint8_t i = 0; i < sizeof(data); i++) {
+    data[i] = i * 3;
+  }
+
+  /* 100 bytes from 200: partial page 3, page 4 partial */
+  CHECK_EQ(rfid.eepromWrite(200, sizeof(data), data), sizeof(data));
+  CHECK_EQ(sim.eepromPageWrites(), 2);
+  CHECK(!memcmp(&sim.eeprom()[200], data, sizeof(data)));
+  CHECK_EQ(rfid.eepromRead(200, sizeof(back), back), sizeof(back));
+  CHECK(!memcmp(back, data, sizeof(data)));
+
+  /* The key area can't be written */
+  CHECK_EQ(rfid.eepromWrite(6100, 64, data), 0);
+}
+
+TEST(register_cache_invalidation) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  uint8_t value = 0x33;
+  uint32_t hits, misses;
+
+  CHECK(start(sim, rfid));
+  rfid.enableRegisterCache(true);
+
+  /* Only the failed lookups at either end of the burst are misses */
+  CHECK(rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106));
+  rfid.getRegisterCacheStats(&hits, &misses);
+  CHECK_EQ(hits, 0u);
+  CHECK_EQ(misses, 2u);
+  CHECK(rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106));
+  rfid.getRegisterCacheStats(&hits, &misses);
+  CHECK_EQ(hits, 18u);
+  CHECK_EQ(misses, 2u);
+
+  /*
+   * Each command below changes TX_MOD_WIDTH behind the cache, so the next
+   * configRadio() only restores it if the cache was dropped
+   */
+  CHECK(rfid.loadProtocol(MFRC630_PROTO_ISO14443A_212,
+                          MFRC630_PROTO_ISO14443A_212));
+  CHECK(sim.peek(MFRC630_REG_TX_MOD_WIDTH) != 0x21);
+  CHECK(rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106));
+  CHECK_EQ(sim.peek(MFRC630_REG_TX_MOD_WIDTH), 0x21);
+
+  CHECK_EQ(rfid.eepromWrite(MFRC630_EEPROM_USER_START, 1, &value), 1);
+  CHECK(rfid.loadRegisters(MFRC630_EEPROM_USER_START,
+                           MFRC630_REG_TX_MOD_WIDTH, 1));
+  CHECK_EQ(sim.peek(MFRC630_REG_TX_MOD_WIDTH), 0x33);
+  CHECK(rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106));
+  CHECK_EQ(sim.peek(MFRC630_REG_TX_MOD_WIDTH), 0x21);
+
+  rfid.softReset();
+  CHECK(sim.peek(MFRC630_REG_TX_MOD_WIDTH) != 0x21);
+  CHECK(rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106));
+  CHECK_EQ(sim.peek(MFRC630_REG_TX_MOD_WIDTH), 0x21);
+}
+
+TEST(lpcd_detects_card) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN, IRQ_PIN);
+  MifareClassicCard card(uid4, 4);
+  uint8_t i, q;
+
+  sim.attachIrq(IRQ_PIN);
+  CHECK(start(sim, rfid));
+  CHECK(rfid.lpcdCalibrate(&i, &q));
+  CHECK_EQ(i, 0x20);
+  CHECK_EQ(q, 0x18);
+
+  CHECK(rfid.lpcdStart(50));
+  CHECK(!sim.fieldOn());
+  delay(500);
+  CHECK(!rfid.lpcdCheck());
+  uint32_t runs = sim.lpcdMeasurements();
+  CHECK(runs >= 8);
+
+  sim.addCard(&card);
+  delay(60);
+  CHECK(rfid.lpcdCheck());
+  rfid.lpcdStop();
+  CHECK(sim.fieldOn());
+
+  /* lpcdWait confirms with WUPA */
+  CHECK(rfid.lpcdWait(1000, 50));
+  CHECK(sim.fieldOn());
+  uint8_t uid[10];
+  uint8_t sak;
+  CHECK(rfid.iso14443aRequest() || rfid.iso14443aWakeup());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+}
+
+TEST(lpcd_timeout_without_card) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+
+  CHECK(start(sim, rfid));
+  unsigned long t = millis();
+  CHECK(!rfid.lpcdWait(300, 50));
+  CHECK(millis() - t >= 300);
+  CHECK(sim.fieldOn());
+}
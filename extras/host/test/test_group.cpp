@@ -0,0 +1,294 @@
+/*!
+ * @file test_group.cpp
+ *
+ * Adafruit_MFRC630_Group with three MFRC630 models on one I2C bus
+ */
+#include "test.h"
+
+#include <Adafruit_MFRC630.h>
+#include <Adafruit_MFRC630_Group.h>
+#include <MFRC630Sim.h>
+
+#define READERS (3)
+
+static uint8_t uids[READERS][4] = {{0xDE, 0xAD, 0xBE, 0xEF},
+                                   {0x12, 0x34, 0x56, 0x78},
+                                   {0xCA, 0xFE, 0xF0, 0x0D}};
+
+static const uint8_t pdown_pins[READERS] = {A2, A3, A4};
+
+/* Three readers at 0x28..0x2A, each with a card in its field */
+struct bench {
+  MFRC630Sim sim[READERS];
+  Adafruit_MFRC630 a, b, c;
+  Adafruit_MFRC630 *rfid[READERS];
+  MifareClassicCard card0, card1, card2;
+  MifareClassicCard *card[READERS];
+  Adafruit_MFRC630_Group group;
+  uint8_t uid[READERS][10];
+  uint8_t sak[READERS];
+
+  bench(void)
+      : a(MFRC630_I2C_ADDR, pdown_pins[0]),
+        b(MFRC630_I2C_ADDR + 1, pdown_pins[1]),
+        c(MFRC630_I2C_ADDR + 2, pdown_pins[2]), card0(uids[0], 4),
+        card1(uids[1], 4), card2(uids[2], 4) {
+    rfid[0] = &a;
+    rfid[1] = &b;
+    rfid[2] = &c;
+    card[0] = &card0;
+    card[1] = &card1;
+    card[2] = &card2;
+  }
+
+  bool start(void) {
+    for (uint8_t i = 0; i < READERS; i++) {
+      sim[i].attachI2C(&Wire, MFRC630_I2C_ADDR + i);
+      sim[i].attachPdown(pdown_pins[i]);
+      if (!rfid[i]->begin() ||
+          !rfid[i]->configRadio(MFRC630_RADIOCFG_ISO1443A_106) ||
+          (group.addReader(rfid[i]) != i)) {
+        return false;
+      }
+      sim[i].addCard(card[i]);
+    }
+    return true;
+  }
+
+  /* Takes the cards out and back in, so they answer REQA again */
+  void powerCycleCards(void) {
+    for (uint8_t i = 0; i < READERS; i++) {
+      sim[i].removeCard(card[i]);
+      sim[i].addCard(card[i]);
+    }
+  }
+};
+
+/* Authenticates every reader's card for block 4 */
+static bool auth(bench &t) {
+  for (uint8_t i = 0; i < READERS; i++) {
+    if (!t.rfid[i]->iso14443aRequest() ||
+        (t.rfid[i]->iso14443aSelect(t.uid[i], &t.sak[i]) != 4)) {
+      return false;
+    }
+    t.rfid[i]->mifareLoadKey(t.rfid[i]->mifareKeyGlobal);
+    if (!t.rfid[i]->mifareAuth(MIFARE_CMD_AUTH_A, 4, t.uid[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(group_overlaps_card_waits) {
+  bench t;
+  uint8_t buf[READERS][16];
+  uint32_t serial_us = 0;
+
+  /* Cards that take 4 ms to answer a READ, the bus at 400 kHz */
+  CHECK(t.start());
+  Wire.setClock(400000);
+  CHECK(auth(t));
+  for (uint8_t i = 0; i < READERS; i++) {
+    t.card[i]->setResponseDelay(4000);
+  }
+
+  /* One block read after the other */
+  for (uint8_t i = 0; i < READERS; i++) {
+    uint32_t start = micros();
+    CHECK_EQ(t.rfid[i]->mifareReadBlock(5, buf[i]), 16);
+    serial_us += micros() - start;
+  }
+
+  /* The same reads through the group, all in flight at once */
+  memset(buf, 0, sizeof(buf));
+  uint32_t start = micros();
+  for (uint8_t i = 0; i < READERS; i++) {
+    CHECK(t.group.startMifareReadBlock(i, 5, buf[i]));
+  }
+  CHECK(t.group.waitAll(100));
+  uint32_t group_us = micros() - start;
+
+  for (uint8_t i = 0; i < READERS; i++) {
+    CHECK(!memcmp(buf[i], t.card[i]->block(5), 16));
+  }
+
+  /*
+   * While one card takes its time to answer the other readers get their
+   * bus work done, so the three reads take about as long as one.
+   */
+  CHECK(group_us * 2 < serial_us);
+}
+
+/* Readers in the order the idle callback saw them */
+static uint8_t idle_order[3 * READERS];
+static uint8_t idle_calls;
+
+/* Records the order of the idle readers */
+static void record_idle(Adafruit_MFRC630_Group *group, uint8_t index,
+                        void *arg) {
+  (void)group;
+  (void)arg;
+  if (idle_calls < sizeof(idle_order)) {
+    idle_order[idle_calls++] = index;
+  }
+}
+
+/* Hands an idle reader the next select, with its card woken up again */
+static void next_select(Adafruit_MFRC630_Group *group, uint8_t index,
+                        void *arg) {
+  bench *t = (bench *)arg;
+
+  t->sim[index].removeCard(t->card[index]);
+  t->sim[index].addCard(t->card[index]);
+  if (t->rfid[index]->iso14443aRequest()) {
+    group->startSelect(index, t->uid[index], &t->sak[index]);
+  }
+}
+
+TEST(group_round_robin) {
+  bench t;
+  struct mfrc630_reader_stats st[READERS];
+  static const uint8_t order[3 * READERS] = {0, 1, 2, 1, 2, 0, 2, 0, 1};
+
+  CHECK(t.start());
+
+  /* Each round starts one reader further */
+  idle_calls = 0;
+  t.group.onIdle(record_idle, NULL);
+  for (uint8_t round = 0; round < 3; round++) {
+    CHECK(!t.group.service());
+  }
+  CHECK_EQ(idle_calls, sizeof(order));
+  CHECK(!memcmp(idle_order, order, sizeof(order)));
+
+  /* Under load every reader gets the same share */
+  t.group.onIdle(next_select, &t);
+  uint32_t start = millis();
+  while ((millis() - start) < 500) {
+    t.group.service();
+  }
+  t.group.onIdle(NULL, NULL);
+  CHECK(t.group.waitAll(100));
+
+  uint32_t min_ops = 0xFFFFFFFF;
+  uint32_t max_ops = 0;
+  for (uint8_t i = 0; i < READERS; i++) {
+    CHECK(t.group.getStats(i, &st[i]));
+    CHECK_EQ(st[i].failures, 0);
+    min_ops = (st[i].ops < min_ops) ? st[i].ops : min_ops;
+    max_ops = (st[i].ops > max_ops) ? st[i].ops : max_ops;
+  }
+  CHECK(min_ops >= 5);
+  CHECK(max_ops - min_ops <= 1);
+}
+
+static uint32_t done_calls;
+
+static void done(enum mfrc630_op op, uint16_t result, void *arg) {
+  (void)op;
+  (void)result;
+  (void)arg;
+  done_calls++;
+}
+
+TEST(group_latency_stats) {
+  bench t;
+  struct mfrc630_reader_stats st;
+
+  CHECK(t.start());
+  CHECK(!t.group.getStats(READERS, &st));
+
+  /* A select that completes, timed by the caller as well */
+  CHECK(t.rfid[0]->iso14443aRequest());
+  done_calls = 0;
+  uint32_t start = micros();
+  CHECK(t.group.startSelect(0, t.uid[0], &t.sak[0], done, NULL));
+  CHECK(t.group.waitAll(100));
+  uint32_t us = micros() - start;
+  CHECK_EQ(done_calls, 1);
+  CHECK(t.group.getStats(0, &st));
+  CHECK_EQ(st.ops, 1);
+  CHECK_EQ(st.failures, 0);
+  CHECK(st.polls > 0);
+  CHECK(st.total_us > 0);
+  CHECK(st.total_us <= us);
+  CHECK_EQ(st.max_us, st.total_us);
+  uint32_t first_us = st.total_us;
+
+  /* A select with the card gone fails and is counted as such */
+  t.sim[0].removeCard(t.card[0]);
+  CHECK(t.group.startSelect(0, t.uid[0], &t.sak[0], done, NULL));
+  CHECK(t.group.waitAll(100));
+  CHECK_EQ(done_calls, 2);
+  CHECK(t.group.getStats(0, &st));
+  CHECK_EQ(st.ops, 2);
+  CHECK_EQ(st.failures, 1);
+  CHECK(st.total_us > first_us);
+  CHECK(st.max_us >= first_us);
+  CHECK(st.max_us < st.total_us);
+
+  /* The other readers ran nothing */
+  CHECK(t.group.getStats(1, &st));
+  CHECK_EQ(st.ops, 0);
+  CHECK_EQ(st.polls, 0);
+
+  t.group.resetStats();
+  CHECK(t.group.getStats(0, &st));
+  CHECK_EQ(st.ops, 0);
+  CHECK_EQ(st.total_us, 0);
+  CHECK_EQ(st.max_us, 0);
+}
+
+static bool tried_during_frame;
+static bool started_during_frame;
+
+TEST(group_start_refused) {
+  bench t;
+  struct mfrc630_reader_stats st;
+
+  CHECK(t.start());
+  CHECK(t.rfid[0]->iso14443aRequest());
+  CHECK(t.group.startSelect(0, t.uid[0], &t.sak[0], done, NULL));
+  CHECK(!t.group.startSelect(0, t.uid[0], &t.sak[0], done, NULL));
+  CHECK(!t.group.startSelect(READERS, t.uid[0], &t.sak[0], done, NULL));
+
+  /* The refused starts leave the operation in flight alone */
+  done_calls = 0;
+  CHECK(t.group.waitAll(100));
+  CHECK_EQ(done_calls, 1);
+
+  /*
+   * A blocking frame owns the reader without an operation in flight, so
+   * a start tried while the REQA waits for its answer fails in the
+   * driver rather than in the group.
+   */
+  t.powerCycleCards();
+  uint32_t frames = t.sim[0].framesSent();
+  tried_during_frame = false;
+  started_during_frame = true;
+  std::function<void(void)> watch = [&]() {
+    if (t.sim[0].framesSent() == frames) {
+      host::at(host::now() + 10000, watch);
+      return;
+    }
+    host::at(host::now() + 100000, [&t]() {
+      tried_during_frame = true;
+      started_during_frame =
+          t.group.startSelect(0, t.uid[0], &t.sak[0], done, NULL);
+    });
+  };
+  host::at(host::now(), watch);
+  CHECK(t.rfid[0]->iso14443aRequest());
+  CHECK(tried_during_frame);
+  CHECK(!started_during_frame);
+  CHECK(!t.rfid[0]->busy());
+
+  /* Nothing of the refused start shows up in the next operation */
+  uint8_t buf[16];
+  CHECK(t.rfid[0]->iso14443aSelect(t.uid[0], &t.sak[0]));
+  CHECK(t.group.startMifareReadBlock(0, 4, buf));
+  CHECK(t.group.waitAll(100));
+  CHECK_EQ(done_calls, 1);
+  CHECK(t.group.getStats(0, &st));
+  CHECK_EQ(st.ops, 2);
+}
@@ -0,0 +1,64 @@
+/*!
+ * @file test_main.cpp
+ *
+ * Runs every registered TEST() case (or the ones named on the command
+ * line) and returns non-zero if any failed.
+ */
+#include "test.h"
+
+#include <string.h>
+
+namespace test {
+
+static test_case *first = NULL;
+static test_case **last = &first;
+static int failures = 0;
+
+void add(test_case *tc) {
+  *last = tc;
+  last = &tc->next;
+}
+
+void fail(const char *file, int line, const char *expr) {
+  printf("  %s:%d: CHECK(%s) failed\n", file, line, expr);
+  failures++;
+}
+
+void failEq(const char *file, int line, const char *expr, long long a,
+            long long b) {
+  printf("  %s:%d: CHECK_EQ(%s) failed: %lld != %lld\n", file, line, expr, a,
+         b);
+  failures++;
+}
+
+} // namespace test
+
+int main(int argc, char **argv) {
+  int failed = 0;
+  int run = 0;
+
+  for (test::test_case *tc = test::first; tc; tc = tc->next) {
+    if (argc > 1) {
+      bool selected = false;
+      for (int i = 1; i < argc; i++) {
+        selected |= !strcmp(argv[i], tc->name);
+      }
+      if (!selected) {
+        continue;
+      }
+    }
+    int before = test::failures;
+    host::reset();
+    tc->fn();
+    run++;
+    if (test::failures != before) {
+      printf("FAIL %s\n", tc->name);
+      failed++;
+    } else {
+      printf("ok   %s\n", tc->name);
+    }
+  }
+
+  printf("%d/%d passed\n", run - failed, run);
+  return failed ? 1 : 0;
+}
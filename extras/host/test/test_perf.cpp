@@ -0,0 +1,112 @@
+/*!
+ * @file test_perf.cpp
+ *
+ * The performance counters, against the instrumented library
+ */
+#include "test.h"
+
+#include <Adafruit_MFRC630.h>
+#include <MFRC630Sim.h>
+
+static uint8_t uid4[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+static uint8_t uid7[7] = {0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+
+#define PDOWN_PIN (A2)
+
+/* The IC on I2C with PDOWN wired up, radio configured */
+static bool start(MFRC630Sim &sim, Adafruit_MFRC630 &rfid) {
+  sim.attachI2C(&Wire, MFRC630_I2C_ADDR);
+  sim.attachPdown(PDOWN_PIN);
+  if (!rfid.begin()) {
+    return false;
+  }
+  return rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+}
+
+static uint32_t calls(Adafruit_MFRC630 &rfid, enum mfrc630_perf_op op) {
+  struct mfrc630_perf_counters c;
+  rfid.getPerfCounters(op, &c);
+  return c.calls;
+}
+
+TEST(perf_mifare_sector_reads) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid4, 4);
+  uint8_t uid[10];
+  uint8_t sak;
+  uint8_t buf[64];
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+  rfid.resetPerfCounters();
+
+  /* One auth and a READ per block */
+  rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+  CHECK_EQ(rfid.mifareReadSector(MIFARE_CMD_AUTH_A, 1, uid, buf), 64);
+  CHECK_EQ(calls(rfid, MFRC630_PERF_AUTH), 1);
+  CHECK_EQ(calls(rfid, MFRC630_PERF_READ), 4);
+
+  struct mfrc630_perf_counters c;
+  rfid.getPerfCounters(MFRC630_PERF_READ, &c);
+  CHECK(c.bus_xfers > 0);
+  CHECK(c.total_us > 0);
+}
+
+TEST(perf_ntag_bulk_reads) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  NtagCard card(uid7, 216);
+  uint8_t uid[10];
+  uint8_t sak;
+  static uint8_t buf[231 * 4];
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 7);
+  rfid.resetPerfCounters();
+
+  /* Every FAST_READ frame is one NTAG read */
+  uint16_t perframe = rfid.getFIFOSize() / 4;
+  uint16_t frames = (231 + perframe - 1) / perframe;
+  CHECK_EQ(rfid.ntagReadPages(0, 231, buf), 231 * 4);
+  CHECK_EQ(calls(rfid, MFRC630_PERF_NTAG_READ), frames);
+
+  struct mfrc630_perf_counters c;
+  rfid.getPerfCounters(MFRC630_PERF_NTAG_READ, &c);
+  CHECK(c.bus_bytes >= 231 * 4);
+}
+
+TEST(perf_ntag_read_during_operation) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid4, 4);
+  uint8_t uid[10];
+  uint8_t sak;
+  uint8_t buf[16];
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+  rfid.mifareLoadKey(rfid.mifareKeyGlobal);
+  CHECK(rfid.mifareAuth(MIFARE_CMD_AUTH_A, 4, uid));
+  rfid.resetPerfCounters();
+
+  /* An NTAG read refused while a READ is in flight leaves it measured */
+  CHECK(rfid.startMifareReadBlock(5, buf));
+  CHECK_EQ(rfid.ntagReadPage(4, buf), 0);
+  CHECK_EQ(rfid.getStatus(), MFRC630_STATUS_BUSY);
+  while (rfid.poll()) {
+    yield();
+  }
+  CHECK_EQ(calls(rfid, MFRC630_PERF_READ), 1);
+
+  struct mfrc630_perf_counters c;
+  rfid.getPerfCounters(MFRC630_PERF_READ, &c);
+  CHECK(c.wait_polls > 0);
+  CHECK(c.total_us > 0);
+}
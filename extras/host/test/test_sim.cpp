@@ -0,0 +1,387 @@
+/*!
+ * @file test_sim.cpp
+ *
+ * The MFRC630 model on its own, driven at the register level
+ */
+#include "test.h"
+
+#include <MFRC630Sim.h>
+#include <Adafruit_MFRC630_regs.h>
+
+static const uint8_t uid4[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+static const uint8_t uid4b[4] = {0xDE, 0xAD, 0x3E, 0x01};
+
+/* Moves the virtual time forward by 'us' */
+static void wait_us(uint32_t us) { host::advance((host::time_ns)us * 1000); }
+
+/* Starts 'cmd' with 'len' parameter bytes in a freshly flushed FIFO */
+static void command(MFRC630Sim &sim, uint8_t cmd, const uint8_t *params,
+                    uint8_t len) {
+  sim.writeRegister(MFRC630_REG_COMMAND, MFRC630_CMD_IDLE);
+  sim.writeRegister(MFRC630_REG_FIFO_CONTROL, 0x80 | 0x10);
+  for (uint8_t i = 0; i < len; i++) {
+    sim.writeRegister(MFRC630_REG_FIFO_DATA, params[i]);
+  }
+  sim.writeRegister(MFRC630_REG_IRQ0, 0x7F);
+  sim.writeRegister(MFRC630_REG_IRQ1, 0x7F);
+  sim.writeRegister(MFRC630_REG_COMMAND, cmd);
+}
+
+/* Turns the field on with the 106 kbit/s protocol and Timer0 at 'ticks' */
+static void radio_on(MFRC630Sim &sim, uint16_t ticks) {
+  static const uint8_t proto[2] = {0, 0};
+  command(sim, MFRC630_CMD_LOADPROTOCOL, proto, sizeof(proto));
+  wait_us(100);
+  sim.writeRegister(MFRC630_REG_T0_CONTROL, 0x91);
+  sim.writeRegister(MFRC630_REG_T0_RELOAD_HI, ticks >> 8);
+  sim.writeRegister(MFRC630_REG_TO_RELOAD_LO, ticks & 0xFF);
+}
+
+/* Sends a frame with TRANSCEIVE and waits for the command to end */
+static void transceive(MFRC630Sim &sim, const uint8_t *tx, uint8_t len,
+                       uint8_t lastbits, bool crc) {
+  sim.writeRegister(MFRC630_REG_TX_CRC_PRESET, 0x18 | (crc ? 1 : 0));
+  sim.writeRegister(MFRC630_REG_RX_CRC_CON, 0x18 | (crc ? 1 : 0));
+  sim.writeRegister(MFRC630_REG_TX_DATA_NUM, 0x08 | lastbits);
+  command(sim, MFRC630_CMD_TRANSCEIVE, tx, len);
+  for (uint32_t i = 0; i < 100000; i++) {
+    if (!(sim.readRegister(MFRC630_REG_STATUS) & 0x07) ||
+        (sim.readRegister(MFRC630_REG_IRQ1) & MFRC630IRQ1_TIMER0IRQ)) {
+      return;
+    }
+    wait_us(1);
+  }
+}
+
+/* Reads the whole FIFO */
+static uint16_t read_fifo(MFRC630Sim &sim, uint8_t *buf) {
+  uint16_t len = sim.readRegister(MFRC630_REG_FIFO_LENGTH);
+  for (uint16_t i = 0; i < len; i++) {
+    buf[i] = sim.readRegister(MFRC630_REG_FIFO_DATA);
+  }
+  return len;
+}
+
+TEST(reset_values) {
+  MFRC630Sim sim;
+  CHECK(sim.ready());
+  CHECK_EQ(sim.readRegister(MFRC630_REG_VERSION), 0x18);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_CONTROL) & 0x80, 0x80);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_WATER_LEVEL), 0x08);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_COMMAND), MFRC630_CMD_IDLE);
+  CHECK(!sim.fieldOn());
+}
+
+TEST(pdown_startup) {
+  MFRC630Sim sim;
+  sim.attachPdown(A2);
+  CHECK(!sim.ready());
+  digitalWrite(A2, LOW);
+  CHECK(!sim.ready());
+  CHECK_EQ(sim.readRegister(MFRC630_REG_VERSION), 0);
+  wait_us(2500);
+  CHECK(sim.ready());
+  CHECK_EQ(sim.readRegister(MFRC630_REG_VERSION), 0x18);
+
+  /* Back into reset: registers lost */
+  sim.writeRegister(MFRC630_REG_WATER_LEVEL, 0x20);
+  digitalWrite(A2, HIGH);
+  digitalWrite(A2, LOW);
+  wait_us(2500);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_WATER_LEVEL), 0x08);
+}
+
+TEST(fifo_255) {
+  MFRC630Sim sim;
+  for (uint16_t i = 0; i < 300; i++) {
+    sim.writeRegister(MFRC630_REG_FIFO_DATA, (uint8_t)i);
+  }
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_LENGTH), 255);
+  CHECK_EQ(sim.fifoOverflows(), 45);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_ERROR), MFRC630_ERROR_FIFOOVL);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_ERRIRQ);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_DATA), 0);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_DATA), 1);
+
+  /* Flush */
+  sim.writeRegister(MFRC630_REG_FIFO_CONTROL, 0x80 | 0x10);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_LENGTH), 0);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_ERROR), 0);
+}
+
+TEST(fifo_512) {
+  MFRC630Sim sim;
+  sim.writeRegister(MFRC630_REG_FIFO_CONTROL, 0x00);
+  for (uint16_t i = 0; i < 300; i++) {
+    sim.writeRegister(MFRC630_REG_FIFO_DATA, (uint8_t)i);
+  }
+  CHECK_EQ(sim.fifoOverflows(), 0);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_LENGTH), 300 & 0xFF);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_CONTROL) & 0x03, 300 >> 8);
+
+  /* Changing the size flushes */
+  sim.writeRegister(MFRC630_REG_FIFO_CONTROL, 0x80);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_LENGTH), 0);
+}
+
+TEST(fifo_water_level) {
+  MFRC630Sim sim;
+  sim.writeRegister(MFRC630_REG_WATER_LEVEL, 16);
+  for (uint16_t i = 0; i < 238; i++) {
+    sim.writeRegister(MFRC630_REG_FIFO_DATA, 0);
+  }
+  CHECK(!(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_HIALERTIRQ));
+  sim.writeRegister(MFRC630_REG_FIFO_DATA, 0);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_HIALERTIRQ);
+  CHECK(sim.readRegister(MFRC630_REG_FIFO_CONTROL) & 0x40);
+
+  sim.writeRegister(MFRC630_REG_IRQ0, 0x7F);
+  while (sim.readRegister(MFRC630_REG_FIFO_LENGTH) > 17) {
+    sim.readRegister(MFRC630_REG_FIFO_DATA);
+  }
+  CHECK(!(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_LOALERTIRQ));
+  sim.readRegister(MFRC630_REG_FIFO_DATA);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_LOALERTIRQ);
+  CHECK(sim.readRegister(MFRC630_REG_FIFO_CONTROL) & 0x20);
+}
+
+TEST(irq_flags_and_pin) {
+  MFRC630Sim sim;
+  sim.attachIrq(7);
+
+  sim.writeRegister(MFRC630_REG_IRQ0, MFRC630IRQ0_SET | MFRC630IRQ0_IDLEIRQ);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_IRQ0), MFRC630IRQ0_IDLEIRQ);
+  CHECK(!(sim.readRegister(MFRC630_REG_IRQ1) & MFRC630IRQ1_GLOBALIRQ));
+
+  /* Enabled IRQs show up in GlobalIRQ, and on the pin if routed there */
+  sim.writeRegister(MFRC630_REG_IRQOEN, MFRC630IRQ0_IDLEIRQ);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ1) & MFRC630IRQ1_GLOBALIRQ);
+  CHECK_EQ(digitalRead(7), LOW);
+  sim.writeRegister(MFRC630_REG_IRQ1EN, MFRC630IRQ1EN_IRQ_PINEN);
+  CHECK_EQ(digitalRead(7), HIGH);
+  sim.writeRegister(MFRC630_REG_IRQOEN,
+                    MFRC630IRQ0EN_IRQ_INV | MFRC630IRQ0_IDLEIRQ);
+  CHECK_EQ(digitalRead(7), LOW);
+
+  /* Clearing */
+  sim.writeRegister(MFRC630_REG_IRQOEN, MFRC630IRQ0_IDLEIRQ);
+  sim.writeRegister(MFRC630_REG_IRQ0, MFRC630IRQ0_IDLEIRQ);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_IRQ0), 0);
+  CHECK_EQ(digitalRead(7), LOW);
+}
+
+TEST(eeprom_commands) {
+  MFRC630Sim sim;
+  uint8_t page[9] = {10, 1, 2, 3, 4, 5, 6, 7, 8};
+  uint8_t buf[16];
+
+  command(sim, MFRC630_CMD_WRITEE2PAGE, page, sizeof(page));
+  wait_us(1000);
+  CHECK(!(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_IDLEIRQ));
+  wait_us(3100);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_IDLEIRQ);
+  CHECK_EQ(sim.eeprom()[640 + 7], 8);
+  CHECK_EQ(sim.eepromPageWrites(), 1);
+
+  uint8_t read[3] = {640 >> 8, 640 & 0xFF, 8};
+  command(sim, MFRC630_CMD_READE2, read, sizeof(read));
+  wait_us(100);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_IDLEIRQ);
+  CHECK_EQ(read_fifo(sim, buf), 8);
+  CHECK_EQ(buf[0], 1);
+  CHECK_EQ(buf[7], 8);
+
+  /* Page 0 (product data) and the key area are off limits */
+  page[0] = 0;
+  command(sim, MFRC630_CMD_WRITEE2PAGE, page, sizeof(page));
+  wait_us(10);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_ERROR), MFRC630_ERROR_EEPROM);
+  uint8_t keys[3] = {6144 >> 8, 6144 & 0xFF, 6};
+  command(sim, MFRC630_CMD_READE2, keys, sizeof(keys));
+  wait_us(10);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_ERROR), MFRC630_ERROR_EEPROM);
+
+  /* The next command clears the error */
+  command(sim, MFRC630_CMD_READE2, read, sizeof(read));
+  CHECK_EQ(sim.readRegister(MFRC630_REG_ERROR), 0);
+}
+
+TEST(load_protocol) {
+  MFRC630Sim sim;
+  uint8_t proto[2] = {MFRC630_PROTO_ISO14443A_848, MFRC630_PROTO_ISO14443A_212};
+
+  command(sim, MFRC630_CMD_LOADPROTOCOL, proto, sizeof(proto));
+  wait_us(100);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_IDLEIRQ);
+  CHECK_EQ(sim.rxRate(), 3);
+  CHECK_EQ(sim.txRate(), 1);
+  CHECK(sim.fieldOn());
+
+  proto[0] = 7;
+  command(sim, MFRC630_CMD_LOADPROTOCOL, proto, sizeof(proto));
+  wait_us(100);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_ERRIRQ);
+}
+
+TEST(readrnr_and_softreset) {
+  MFRC630Sim sim;
+  command(sim, MFRC630_CMD_READRNR, NULL, 0);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_LENGTH), 255);
+  wait_us(1000);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_IDLEIRQ);
+
+  sim.writeRegister(MFRC630_REG_WATER_LEVEL, 0x30);
+  sim.writeRegister(MFRC630_REG_COMMAND, MFRC630_CMD_SOFTRESET);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_WATER_LEVEL), 0x08);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_FIFO_LENGTH), 0);
+}
+
+TEST(timer0_timeout) {
+  MFRC630Sim sim;
+  uint8_t reqa = ISO14443_CMD_REQA;
+
+  radio_on(sim, 1000);
+  command(sim, MFRC630_CMD_TRANSCEIVE, &reqa, 1);
+  host::time_ns start = host::now();
+  while (!(sim.readRegister(MFRC630_REG_IRQ1) & MFRC630IRQ1_TIMER0IRQ)) {
+    wait_us(10);
+  }
+  /* 1000 ticks of 4.72us after the end of a 1 byte frame */
+  uint32_t us = (uint32_t)((host::now() - start) / 1000);
+  CHECK(us >= 4720);
+  CHECK(us < 4720 + 200);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_T0_COUNTER_VAL_HI), 0);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_STATUS) & 0x07,
+           MFRC630_COMSTAT_RXWAIT);
+}
+
+TEST(reqa_and_select) {
+  MFRC630Sim sim;
+  MifareClassicCard card(uid4, 4);
+  uint8_t buf[16];
+
+  sim.addCard(&card);
+  radio_on(sim, 1000);
+  CHECK_EQ(card.getState(), SimCard::IDLE);
+
+  uint8_t reqa = ISO14443_CMD_REQA;
+  transceive(sim, &reqa, 1, 7, false);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_RXIRQ);
+  CHECK(!(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_ERRIRQ));
+  CHECK_EQ(read_fifo(sim, buf), 2);
+  CHECK_EQ(buf[0], 0x04);
+  CHECK_EQ(buf[1], 0x00);
+  CHECK_EQ(sim.lastFrame().bits, 7);
+  CHECK_EQ(card.getState(), SimCard::READY);
+
+  /* Timer0 stopped when the ATQA started: counter = reload - FDT */
+  uint16_t left = (sim.readRegister(MFRC630_REG_T0_COUNTER_VAL_HI) << 8) |
+                  sim.readRegister(MFRC630_REG_T0_COUNTER_VAL_LO);
+  CHECK(left < 1000 - 17);
+  CHECK(left > 1000 - 20);
+
+  uint8_t anticoll[2] = {ISO14443_CAS_LEVEL_1, 0x20};
+  transceive(sim, anticoll, 2, 0, false);
+  CHECK_EQ(read_fifo(sim, buf), 5);
+  CHECK_EQ(buf[0], 0xDE);
+  CHECK_EQ(buf[4], 0xDE ^ 0xAD ^ 0xBE ^ 0xEF);
+
+  uint8_t sel[7] = {ISO14443_CAS_LEVEL_1, 0x70, 0xDE, 0xAD, 0xBE, 0xEF,
+                    0xDE ^ 0xAD ^ 0xBE ^ 0xEF};
+  transceive(sim, sel, 7, 0, true);
+  CHECK_EQ(read_fifo(sim, buf), 1);
+  CHECK_EQ(buf[0], 0x08);
+  CHECK_EQ(card.getState(), SimCard::ACTIVE);
+}
+
+TEST(anticollision_collision) {
+  MFRC630Sim sim;
+  MifareClassicCard a(uid4, 4), b(uid4b, 4);
+  uint8_t buf[16];
+
+  sim.addCard(&a);
+  sim.addCard(&b);
+  radio_on(sim, 1000);
+
+  uint8_t reqa = ISO14443_CMD_REQA;
+  transceive(sim, &reqa, 1, 7, false);
+  CHECK(!(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_ERRIRQ));
+
+  /* DE AD match, BE (10111110) vs 3E (00111110) differ in bit 7 of byte 2 */
+  uint8_t anticoll[2] = {ISO14443_CAS_LEVEL_1, 0x20};
+  transceive(sim, anticoll, 2, 0, false);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_ERROR), MFRC630_ERROR_COLLDET);
+  CHECK_EQ(sim.readRegister(MFRC630_REG_RX_COLL), 0x80 | 23);
+  read_fifo(sim, buf);
+  CHECK_EQ(buf[0], 0xDE);
+  CHECK_EQ(buf[1], 0xAD);
+}
+
+TEST(mfauthent) {
+  MFRC630Sim sim;
+  MifareClassicCard card(uid4, 4);
+  uint8_t key[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+  uint8_t buf[16];
+
+  sim.addCard(&card);
+  radio_on(sim, 2000);
+  uint8_t reqa = ISO14443_CMD_REQA;
+  transceive(sim, &reqa, 1, 7, false);
+  uint8_t sel[7] = {ISO14443_CAS_LEVEL_1, 0x70, 0xDE, 0xAD, 0xBE, 0xEF,
+                    0xDE ^ 0xAD ^ 0xBE ^ 0xEF};
+  transceive(sim, sel, 7, 0, true);
+  read_fifo(sim, buf);
+
+  command(sim, MFRC630_CMD_LOADKEY, key, sizeof(key));
+  wait_us(10);
+  uint8_t auth[6] = {MIFARE_CMD_AUTH_A, 4, 0xDE, 0xAD, 0xBE, 0xEF};
+  command(sim, MFRC630_CMD_MFAUTHENT, auth, sizeof(auth));
+  wait_us(5000);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_IDLEIRQ);
+  CHECK(sim.readRegister(MFRC630_REG_STATUS) & MFRC630STATUS_CRYPTO1ON);
+
+  /* Encrypted READ of the authenticated sector */
+  uint8_t read[2] = {MIFARE_CMD_READ, 5};
+  transceive(sim, read, 2, 0, true);
+  CHECK_EQ(read_fifo(sim, buf), 16);
+  CHECK_EQ(buf[0], 5 * 16);
+
+  /* Wrong key: no answer, Timer0 ends it, Crypto1 stays off */
+  key[0] = 0;
+  command(sim, MFRC630_CMD_LOADKEY, key, sizeof(key));
+  wait_us(10);
+  command(sim, MFRC630_CMD_MFAUTHENT, auth, sizeof(auth));
+  wait_us(20000);
+  CHECK(sim.readRegister(MFRC630_REG_IRQ1) & MFRC630IRQ1_TIMER0IRQ);
+  CHECK(!(sim.readRegister(MFRC630_REG_IRQ0) & MFRC630IRQ0_IDLEIRQ));
+  CHECK(!(sim.readRegister(MFRC630_REG_STATUS) & MFRC630STATUS_CRYPTO1ON));
+}
+
+TEST(i2c_and_spi_transports) {
+  MFRC630Sim a, b;
+  a.attachI2C(&Wire, 0x28);
+  b.attachSPI(&SPI, 10);
+  Wire.begin();
+
+  Wire.beginTransmission(0x28);
+  Wire.write(MFRC630_REG_VERSION);
+  CHECK_EQ(Wire.endTransmission(), 0);
+  CHECK_EQ(Wire.requestFrom(0x28, 1), 1);
+  CHECK_EQ(Wire.read(), 0x18);
+
+  /* Nobody at 0x29 */
+  Wire.beginTransmission(0x29);
+  CHECK(Wire.endTransmission() != 0);
+
+  /* SPI burst write and read with the address in the following byte */
+  digitalWrite(10, LOW);
+  SPI.transfer(MFRC630_REG_T0_RELOAD_HI << 1);
+  SPI.transfer(0x12);
+  SPI.transfer(0x34);
+  digitalWrite(10, HIGH);
+  digitalWrite(10, LOW);
+  SPI.transfer((MFRC630_REG_T0_RELOAD_HI << 1) | 1);
+  CHECK_EQ(SPI.transfer((MFRC630_REG_TO_RELOAD_LO << 1) | 1), 0x12);
+  CHECK_EQ(SPI.transfer(0), 0x34);
+  digitalWrite(10, HIGH);
+}
@@ -0,0 +1,183 @@
+/*!
+ * @file test_trace.cpp
+ *
+ * The trace log, against the instrumented library
+ */
+#include "test.h"
+
+#include <Adafruit_MFRC630.h>
+#include <MFRC630Sim.h>
+
+#include <string>
+
+static uint8_t uid4[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+#define PDOWN_PIN (A2)
+
+/* The IC on I2C with PDOWN wired up, radio configured */
+static bool start(MFRC630Sim &sim, Adafruit_MFRC630 &rfid) {
+  sim.attachI2C(&Wire, MFRC630_I2C_ADDR);
+  sim.attachPdown(PDOWN_PIN);
+  if (!rfid.begin()) {
+    return false;
+  }
+  return rfid.configRadio(MFRC630_RADIOCFG_ISO1443A_106);
+}
+
+/* Logs one FIFO write per value 0..n-1 and nothing else */
+static void writeValues(Adafruit_MFRC630 &rfid, uint8_t n) {
+  rfid.clearFIFO();
+  rfid.traceSetFilter(MFRC630_TRACE_MASK(MFRC630_TRACE_WRITE));
+  rfid.traceClear();
+  for (uint8_t i = 0; i < n; i++) {
+    rfid.writeFIFO(1, &i);
+  }
+}
+
+TEST(trace_wraparound) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  struct mfrc630_trace_record r[MFRC630_TRACE_LOG_LEN + 1];
+
+  CHECK(start(sim, rfid));
+
+  /* Up to MFRC630_TRACE_LOG_LEN records nothing is lost */
+  writeValues(rfid, MFRC630_TRACE_LOG_LEN);
+  CHECK_EQ(rfid.traceDropped(), 0);
+  CHECK_EQ(rfid.traceRead(r, MFRC630_TRACE_LOG_LEN + 1),
+           MFRC630_TRACE_LOG_LEN);
+  CHECK_EQ(r[0].value, 0);
+  CHECK_EQ(rfid.traceRead(r, 1), 0);
+
+  /* Past that the oldest records are overwritten and counted */
+  writeValues(rfid, MFRC630_TRACE_LOG_LEN + 8);
+  CHECK_EQ(rfid.traceDropped(), 8);
+  CHECK_EQ(rfid.traceRead(r, 4), 4);
+  CHECK_EQ(rfid.traceRead(&r[4], MFRC630_TRACE_LOG_LEN + 1),
+           MFRC630_TRACE_LOG_LEN - 4);
+  for (uint8_t i = 0; i < MFRC630_TRACE_LOG_LEN; i++) {
+    CHECK_EQ(r[i].event, MFRC630_TRACE_WRITE);
+    CHECK_EQ(r[i].reg, MFRC630_REG_FIFO_DATA);
+    CHECK_EQ(r[i].value, i + 8);
+    CHECK_EQ(r[i].len, 1);
+    if (i) {
+      CHECK(r[i].us > r[i - 1].us);
+    }
+  }
+
+  /* Reading doesn't reset the count, clearing does */
+  CHECK_EQ(rfid.traceDropped(), 8);
+  rfid.traceClear();
+  CHECK_EQ(rfid.traceDropped(), 0);
+}
+
+TEST(trace_filter) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  MifareClassicCard card(uid4, 4);
+  struct mfrc630_trace_record r[MFRC630_TRACE_LOG_LEN];
+  uint8_t uid[10];
+  uint8_t sak;
+
+  CHECK(start(sim, rfid));
+  sim.addCard(&card);
+  CHECK(rfid.iso14443aRequest());
+
+  /* Only the operation events of a select, none of its bus traffic */
+  rfid.traceSetFilter(MFRC630_TRACE_MASK(MFRC630_TRACE_OP_START) |
+                      MFRC630_TRACE_MASK(MFRC630_TRACE_OP_DONE));
+  rfid.traceClear();
+  CHECK_EQ(rfid.iso14443aSelect(uid, &sak), 4);
+  CHECK_EQ(rfid.traceRead(r, MFRC630_TRACE_LOG_LEN), 2);
+  CHECK_EQ(r[0].event, MFRC630_TRACE_OP_START);
+  CHECK_EQ(r[0].reg, MFRC630_OP_SELECT);
+  CHECK_EQ(r[1].event, MFRC630_TRACE_OP_DONE);
+  CHECK_EQ(r[1].reg, MFRC630_OP_SELECT);
+  CHECK_EQ(r[1].len, 4);
+
+  /* Frames only, here a REQA that goes unanswered */
+  sim.removeCard(&card);
+  rfid.traceSetFilter(MFRC630_TRACE_MASK(MFRC630_TRACE_FRAME));
+  CHECK(rfid.iso14443aRequest() == 0);
+  uint8_t n = rfid.traceRead(r, MFRC630_TRACE_LOG_LEN);
+  CHECK(n > 0);
+  for (uint8_t i = 0; i < n; i++) {
+    CHECK_EQ(r[i].event, MFRC630_TRACE_FRAME);
+    CHECK_EQ(r[i].reg, MFRC630_CMD_TRANSCEIVE);
+  }
+
+  /* Nothing at all */
+  rfid.traceSetFilter(0);
+  CHECK(rfid.iso14443aRequest() == 0);
+  CHECK_EQ(rfid.traceRead(r, MFRC630_TRACE_LOG_LEN), 0);
+  CHECK_EQ(rfid.traceDropped(), 0);
+}
+
+/* Splits a 'mfrc630_trace,...' line into its fields, as the decoder does */
+static bool parse(const std::string &line, struct mfrc630_trace_record *r) {
+  unsigned long us;
+  unsigned event, reg, value, len;
+  int end = 0;
+
+  if ((sscanf(line.c_str(), "mfrc630_trace,%lu,%u,%u,%u,%u%n", &us, &event,
+              &reg, &value, &len, &end) != 5) ||
+      ((size_t)end != line.size())) {
+    return false;
+  }
+  r->us = us;
+  r->event = event;
+  r->reg = reg;
+  r->value = value;
+  r->len = len;
+  return true;
+}
+
+TEST(trace_dump_format) {
+  MFRC630Sim sim;
+  Adafruit_MFRC630 rfid(MFRC630_I2C_ADDR, PDOWN_PIN);
+  struct mfrc630_trace_record r;
+  std::string out;
+
+  CHECK(start(sim, rfid));
+  writeValues(rfid, MFRC630_TRACE_LOG_LEN + 3);
+  Serial.capture(&out);
+  rfid.traceDump(&Serial);
+  Serial.capture(NULL);
+
+  /* One CRLF terminated line per record, then the dropped count */
+  size_t pos = 0;
+  uint8_t lines = 0;
+  uint32_t last_us = 0;
+  while (pos < out.size()) {
+    size_t eol = out.find("\r\n", pos);
+    CHECK(eol != std::string::npos);
+    if (eol == std::string::npos) {
+      break;
+    }
+    std::string line = out.substr(pos, eol - pos);
+    pos = eol + 2;
+
+    if (lines == MFRC630_TRACE_LOG_LEN) {
+      CHECK(line == "mfrc630_trace_dropped,3");
+    } else {
+      CHECK(parse(line, &r));
+      CHECK_EQ(r.event, MFRC630_TRACE_WRITE);
+      CHECK_EQ(r.reg, MFRC630_REG_FIFO_DATA);
+      CHECK_EQ(r.value, lines + 3);
+      CHECK_EQ(r.len, 1);
+      CHECK(r.us > last_us);
+      last_us = r.us;
+    }
+    lines++;
+  }
+  CHECK_EQ(lines, MFRC630_TRACE_LOG_LEN + 1);
+
+  /* The dump drained the log and reset the dropped count */
+  CHECK_EQ(rfid.traceRead(&r, 1), 0);
+  CHECK_EQ(rfid.traceDropped(), 0);
+  out.clear();
+  Serial.capture(&out);
+  rfid.traceDump(&Serial);
+  Serial.capture(NULL);
+  CHECK(out.empty());
+}
@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""
+Decodes the trace log printed by Adafruit_MFRC630::traceDump().
+
+Feed it a capture of the serial output (other lines are ignored):
+
+    python3 mfrc630_trace_decode.py capture.txt
+    python3 mfrc630_trace_decode.py < capture.txt
+
+Register and command names are taken from Adafruit_MFRC630_regs.h, so the
+script has to stay next to the library (or be given --regs).
+"""
+
+import argparse
+import os
+import re
+import sys
+
+EVENTS = ["WRITE", "READ", "FRAME", "OP_START", "OP_DONE"]
+OPS = ["NONE", "SELECT", "AUTH", "READ", "WRITE"]
+
+
+def load_names(path, prefix):
+    """Returns {value: name} for the 'prefix'* enum entries in 'path'."""
+    with open(path) as f:
+        text = f.read()
+    names = {}
+    for name, value in re.findall(prefix + r"(\w+)\s*=\s*(0x[0-9A-Fa-f]+)",
+                                  text):
+        names.setdefault(int(value, 16), name)
+    return names
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("capture", nargs="?", type=argparse.FileType("r"),
+                        default=sys.stdin, help="serial capture (stdin)")
+    parser.add_argument("--regs", default=os.path.join(
+        here, "..", "Adafruit_MFRC630_regs.h"),
+        help="path to Adafruit_MFRC630_regs.h")
+    args = parser.parse_args()
+
+    regs = load_names(args.regs, "MFRC630_REG_")
+    cmds = load_names(args.regs, "MFRC630_CMD_")
+    counts = [0] * len(EVENTS)
+    start = last = None
+
+    for line in args.capture:
+        line = line.strip()
+        if line.startswith("mfrc630_trace_dropped,"):
+            print("*** %s record(s) dropped ***" % line.split(",")[1])
+            continue
+        if not line.startswith("mfrc630_trace,"):
+            continue
+
+        us, event, reg, value, length = (int(x) for x in line.split(",")[1:6])
+        if start is None:
+            start = last = us
+        delta = (us - last) & 0xFFFFFFFF
+        stamp = "%10u  +%7u" % ((us - start) & 0xFFFFFFFF, delta)
+        last = us
+
+        if event >= len(EVENTS):
+            print("%s  ? %d %d %d %d" % (stamp, event, reg, value, length))
+            continue
+        counts[event] += 1
+
+        name = EVENTS[event]
+        if event in (0, 1):
+            what = "%-20s 0x%02X" % ("%s(0x%02X)" % (regs.get(reg, "?"), reg),
+                                     value)
+            if length > 1:
+                what += " .. (%d bytes)" % length
+        elif event == 2:
+            what = "%-20s error=0x%02X rx=%d" % (cmds.get(reg, hex(reg)),
+                                                 value, length)
+        elif event == 3:
+            what = OPS[reg] if reg < len(OPS) else str(reg)
+        else:
+            what = "%-20s result=%d" % (OPS[reg] if reg < len(OPS) else reg,
+                                        length)
+        print("%s  %-8s %s" % (stamp, name, what))
+
+    print("")
+    print(", ".join("%s=%d" % (EVENTS[i], counts[i])
+                    for i in range(len(EVENTS))))
+
+
+if __name__ == "__main__":
+    main()